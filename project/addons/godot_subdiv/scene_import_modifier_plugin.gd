@@ -14,9 +14,53 @@ func _get_import_options(path: String)->void:
 	PROPERTY_HINT_RANGE,
 	"0,6")
 
+	add_import_option_advanced(TYPE_FLOAT,
+	"subdivision/weld_tolerance",
+	0.0,
+	PROPERTY_HINT_RANGE,
+	"0,0.01,0.000001")
+
+	add_import_option_advanced(TYPE_BOOL,
+	"subdivision/use_import_cache",
+	true)
+
+	add_import_option_advanced(TYPE_BOOL,
+	"subdivision/streaming_import",
+	false)
+
+	add_import_option_advanced(TYPE_BOOL,
+	"subdivision/store_refinement_data",
+	false)
+
+	add_import_option_advanced(TYPE_BOOL,
+	"subdivision/quantize_storage",
+	false)
+
+	add_import_option_advanced(TYPE_BOOL,
+	"subdivision/store_baked_mesh",
+	false)
+
+	add_import_option_advanced(TYPE_BOOL,
+	"subdivision/use_cage_normals",
+	false)
+
+	add_import_option_advanced(TYPE_INT,
+	"subdivision/tangent_mode",
+	1,
+	PROPERTY_HINT_ENUM,
+	"Analytic,MikkTSpace")
+
 func _pre_process(scene: Node):
 	var subdiv_import_option=get_option_value("subdivision/import_as")
 	var subdiv_level=get_option_value("subdivision/subdivision_level")
 	var subdiv_converter=preload("res://addons/godot_subdiv/subdiv_converter.gd").new(subdiv_import_option, subdiv_level)
+	subdiv_converter.importer.weld_tolerance=get_option_value("subdivision/weld_tolerance")
+	subdiv_converter.importer.use_import_cache=get_option_value("subdivision/use_import_cache")
+	subdiv_converter.importer.streaming_import=get_option_value("subdivision/streaming_import")
+	subdiv_converter.importer.store_refinement_data=get_option_value("subdivision/store_refinement_data")
+	subdiv_converter.importer.quantize_storage=get_option_value("subdivision/quantize_storage")
+	subdiv_converter.importer.store_baked_mesh=get_option_value("subdivision/store_baked_mesh")
+	subdiv_converter.importer.use_cage_normals=get_option_value("subdivision/use_cage_normals")
+	subdiv_converter.importer.tangent_mode=get_option_value("subdivision/tangent_mode")
 	if scene!=null:
 		subdiv_converter.convert_importer_mesh_instances_recursively(scene)
@@ -3,24 +3,155 @@
 #include "godot_cpp/templates/hash_map.hpp"
 #include "godot_cpp/templates/hash_set.hpp"
 
+#include "godot_cpp/classes/animation.hpp"
+#include "godot_cpp/classes/animation_library.hpp"
 #include "godot_cpp/classes/array_mesh.hpp"
-#include "godot_cpp/classes/importer_mesh.hpp"
-#include "godot_cpp/classes/importer_mesh_instance3d.hpp"
+#include "godot_cpp/classes/dir_access.hpp"
+#include "godot_cpp/classes/file_access.hpp"
+#include "godot_cpp/classes/hashing_context.hpp"
 #include "godot_cpp/classes/mesh_instance3d.hpp"
+#include "godot_cpp/classes/resource_loader.hpp"
+#include "godot_cpp/classes/resource_saver.hpp"
 #include "godot_cpp/classes/scene_tree.hpp"
 #include "godot_cpp/classes/skeleton3d.hpp"
 #include "godot_cpp/variant/utility_functions.hpp"
 
+#include "godot_cpp/templates/local_vector.hpp"
+
 #include "nodes/subdiv_mesh_instance_3d.hpp"
 #include "resources/baked_subdiv_mesh.hpp"
+#include "resources/topology_data_mesh_format.hpp"
 #include "subdivision/subdivision_baker.hpp"
+#include "utility/parallel_for.hpp"
 
 void TopologyDataImporter::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("convert_importer_meshinstance_to_subdiv"), &TopologyDataImporter::convert_importer_meshinstance_to_subdiv);
+	ClassDB::bind_method(D_METHOD("convert_scene", "root", "import_mode", "subdiv_level"), &TopologyDataImporter::convert_scene);
+	ClassDB::bind_method(D_METHOD("convert_animation_blend_shape_tracks", "animation_player"), &TopologyDataImporter::convert_animation_blend_shape_tracks);
 	BIND_ENUM_CONSTANT(SUBDIV_MESHINSTANCE);
 	BIND_ENUM_CONSTANT(BAKED_SUBDIV_MESH);
 	BIND_ENUM_CONSTANT(ARRAY_MESH);
 	BIND_ENUM_CONSTANT(IMPORTER_MESH)
+
+	ClassDB::bind_method(D_METHOD("set_weld_tolerance", "tolerance"), &TopologyDataImporter::set_weld_tolerance);
+	ClassDB::bind_method(D_METHOD("get_weld_tolerance"), &TopologyDataImporter::get_weld_tolerance);
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "weld_tolerance", PROPERTY_HINT_RANGE, "0,0.01,0.000001"), "set_weld_tolerance", "get_weld_tolerance");
+
+	ClassDB::bind_method(D_METHOD("set_streaming_import", "streaming_import"), &TopologyDataImporter::set_streaming_import);
+	ClassDB::bind_method(D_METHOD("get_streaming_import"), &TopologyDataImporter::get_streaming_import);
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "streaming_import"), "set_streaming_import", "get_streaming_import");
+
+	ClassDB::bind_method(D_METHOD("set_store_refinement_data", "store_refinement_data"), &TopologyDataImporter::set_store_refinement_data);
+	ClassDB::bind_method(D_METHOD("get_store_refinement_data"), &TopologyDataImporter::get_store_refinement_data);
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "store_refinement_data"), "set_store_refinement_data", "get_store_refinement_data");
+
+	ClassDB::bind_method(D_METHOD("set_quantize_storage", "quantize_storage"), &TopologyDataImporter::set_quantize_storage);
+	ClassDB::bind_method(D_METHOD("get_quantize_storage"), &TopologyDataImporter::get_quantize_storage);
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "quantize_storage"), "set_quantize_storage", "get_quantize_storage");
+
+	ClassDB::bind_method(D_METHOD("set_store_baked_mesh", "store_baked_mesh"), &TopologyDataImporter::set_store_baked_mesh);
+	ClassDB::bind_method(D_METHOD("get_store_baked_mesh"), &TopologyDataImporter::get_store_baked_mesh);
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "store_baked_mesh"), "set_store_baked_mesh", "get_store_baked_mesh");
+
+	ClassDB::bind_method(D_METHOD("set_use_cage_normals", "use_cage_normals"), &TopologyDataImporter::set_use_cage_normals);
+	ClassDB::bind_method(D_METHOD("get_use_cage_normals"), &TopologyDataImporter::get_use_cage_normals);
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "use_cage_normals"), "set_use_cage_normals", "get_use_cage_normals");
+
+	ClassDB::bind_method(D_METHOD("set_tangent_mode", "tangent_mode"), &TopologyDataImporter::set_tangent_mode);
+	ClassDB::bind_method(D_METHOD("get_tangent_mode"), &TopologyDataImporter::get_tangent_mode);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "tangent_mode", PROPERTY_HINT_ENUM, "Analytic,MikkTSpace"), "set_tangent_mode", "get_tangent_mode");
+
+	ClassDB::bind_method(D_METHOD("set_use_import_cache", "use_import_cache"), &TopologyDataImporter::set_use_import_cache);
+	ClassDB::bind_method(D_METHOD("get_use_import_cache"), &TopologyDataImporter::get_use_import_cache);
+	ClassDB::bind_method(D_METHOD("set_import_cache_path", "path"), &TopologyDataImporter::set_import_cache_path);
+	ClassDB::bind_method(D_METHOD("get_import_cache_path"), &TopologyDataImporter::get_import_cache_path);
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "use_import_cache"), "set_use_import_cache", "get_use_import_cache");
+	ADD_PROPERTY(PropertyInfo(Variant::STRING, "import_cache_path", PROPERTY_HINT_DIR), "set_import_cache_path", "get_import_cache_path");
+	ClassDB::bind_method(D_METHOD("set_import_cache_max_size", "max_size"), &TopologyDataImporter::set_import_cache_max_size);
+	ClassDB::bind_method(D_METHOD("get_import_cache_max_size"), &TopologyDataImporter::get_import_cache_max_size);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "import_cache_max_size", PROPERTY_HINT_RANGE, "0,65536,1,or_greater,suffix:MiB"), "set_import_cache_max_size", "get_import_cache_max_size");
+}
+
+void TopologyDataImporter::set_weld_tolerance(float p_tolerance) {
+	ERR_FAIL_COND(p_tolerance < 0);
+	weld_tolerance = p_tolerance;
+}
+
+float TopologyDataImporter::get_weld_tolerance() const {
+	return weld_tolerance;
+}
+
+void TopologyDataImporter::set_streaming_import(bool p_streaming_import) {
+	streaming_import = p_streaming_import;
+}
+
+bool TopologyDataImporter::get_streaming_import() const {
+	return streaming_import;
+}
+
+void TopologyDataImporter::set_store_refinement_data(bool p_store_refinement_data) {
+	store_refinement_data = p_store_refinement_data;
+}
+
+bool TopologyDataImporter::get_store_refinement_data() const {
+	return store_refinement_data;
+}
+
+void TopologyDataImporter::set_quantize_storage(bool p_quantize_storage) {
+	quantize_storage = p_quantize_storage;
+}
+
+bool TopologyDataImporter::get_quantize_storage() const {
+	return quantize_storage;
+}
+
+void TopologyDataImporter::set_store_baked_mesh(bool p_store_baked_mesh) {
+	store_baked_mesh = p_store_baked_mesh;
+}
+
+bool TopologyDataImporter::get_store_baked_mesh() const {
+	return store_baked_mesh;
+}
+
+void TopologyDataImporter::set_use_cage_normals(bool p_use_cage_normals) {
+	use_cage_normals = p_use_cage_normals;
+}
+
+bool TopologyDataImporter::get_use_cage_normals() const {
+	return use_cage_normals;
+}
+
+void TopologyDataImporter::set_tangent_mode(Subdivider::TangentMode p_tangent_mode) {
+	tangent_mode = p_tangent_mode;
+}
+
+Subdivider::TangentMode TopologyDataImporter::get_tangent_mode() const {
+	return tangent_mode;
+}
+
+void TopologyDataImporter::set_use_import_cache(bool p_use_import_cache) {
+	use_import_cache = p_use_import_cache;
+}
+
+bool TopologyDataImporter::get_use_import_cache() const {
+	return use_import_cache;
+}
+
+void TopologyDataImporter::set_import_cache_path(const String &p_path) {
+	import_cache_path = p_path;
+}
+
+String TopologyDataImporter::get_import_cache_path() const {
+	return import_cache_path;
+}
+
+void TopologyDataImporter::set_import_cache_max_size(int p_max_size) {
+	ERR_FAIL_COND(p_max_size < 0);
+	import_cache_max_size = p_max_size;
+}
+
+int TopologyDataImporter::get_import_cache_max_size() const {
+	return import_cache_max_size;
 }
 
 TopologyDataImporter::SurfaceVertexArrays::SurfaceVertexArrays(const Array &p_mesh_arrays) {
@@ -45,66 +176,513 @@ TopologyDataImporter::SurfaceVertexArrays::SurfaceVertexArrays(const Array &p_me
 
 void TopologyDataImporter::convert_importer_meshinstance_to_subdiv(Object *importer_mesh_instance_object, ImportMode import_mode, int32_t subdiv_level) {
 	ImporterMeshInstance3D *importer_mesh_instance = Object::cast_to<ImporterMeshInstance3D>(importer_mesh_instance_object);
-	Ref<ImporterMesh> importer_mesh = importer_mesh_instance->get_mesh();
-	ERR_FAIL_COND_MSG(importer_mesh.is_null(), "Mesh is null");
+	ERR_FAIL_NULL_MSG(importer_mesh_instance, "Object is not an ImporterMeshInstance3D");
+	Vector<ImporterMeshInstance3D *> importer_mesh_instances;
+	importer_mesh_instances.push_back(importer_mesh_instance);
+	_convert_importer_mesh_instances(importer_mesh_instances, import_mode, subdiv_level);
+}
 
-	//handle cases that don't need to generate TopologyDataMesh
-	if (subdiv_level == 0) {
-		if (import_mode == ImportMode::IMPORTER_MESH) {
-			return;
+void TopologyDataImporter::convert_scene(Object *p_root, ImportMode import_mode, int32_t subdiv_level) {
+	Node *root = Object::cast_to<Node>(p_root);
+	ERR_FAIL_NULL_MSG(root, "Scene root is not a Node");
+
+	Vector<ImporterMeshInstance3D *> importer_mesh_instances;
+	Vector<AnimationPlayer *> animation_players;
+	_collect_scene_nodes(root, importer_mesh_instances, animation_players);
+
+	_convert_importer_mesh_instances(importer_mesh_instances, import_mode, subdiv_level);
+
+	//blend shape tracks don't work with SubdivMeshInstance3D
+	if (import_mode == ImportMode::SUBDIV_MESHINSTANCE) {
+		for (AnimationPlayer *animation_player : animation_players) {
+			convert_animation_blend_shape_tracks(animation_player);
 		}
-		if (import_mode == ImportMode::ARRAY_MESH) {
-			_replace_importer_mesh_instance_with_mesh_instance(importer_mesh_instance);
-			return;
+	}
+}
+
+void TopologyDataImporter::_collect_scene_nodes(Node *p_node, Vector<ImporterMeshInstance3D *> &r_importer_mesh_instances, Vector<AnimationPlayer *> &r_animation_players) const {
+	for (int child_index = 0; child_index < p_node->get_child_count(); child_index++) {
+		Node *child = p_node->get_child(child_index);
+		_collect_scene_nodes(child, r_importer_mesh_instances, r_animation_players);
+		if (ImporterMeshInstance3D *importer_mesh_instance = Object::cast_to<ImporterMeshInstance3D>(child)) {
+			r_importer_mesh_instances.push_back(importer_mesh_instance);
+		} else if (AnimationPlayer *animation_player = Object::cast_to<AnimationPlayer>(child)) {
+			r_animation_players.push_back(animation_player);
+		}
+	}
+}
+
+void TopologyDataImporter::_convert_importer_mesh_instances(const Vector<ImporterMeshInstance3D *> &importer_mesh_instances, ImportMode import_mode, int32_t subdiv_level) {
+	ERR_FAIL_INDEX_MSG(import_mode, ImportMode::IMPORTER_MESH + 1, "Import mode doesn't exist");
+	Vector<MeshConversion> meshes;
+	Vector<SurfaceConversion> surfaces;
+
+	//reading scene and resources stays on the main thread
+	for (ImporterMeshInstance3D *importer_mesh_instance : importer_mesh_instances) {
+		MeshConversion mesh;
+		mesh.importer_mesh_instance = importer_mesh_instance;
+		mesh.importer_mesh = importer_mesh_instance->get_mesh();
+		ERR_CONTINUE_MSG(mesh.importer_mesh.is_null(), "Mesh is null");
+
+		//handle cases that don't need to generate TopologyDataMesh
+		mesh.needs_topology_data = !(subdiv_level == 0 && (import_mode == ImportMode::IMPORTER_MESH || import_mode == ImportMode::ARRAY_MESH));
+		mesh.needs_conversion = mesh.needs_topology_data;
+		mesh.first_surface = surfaces.size();
+		if (mesh.needs_topology_data) {
+			_prepare_surface_conversions(meshes.size(), mesh.importer_mesh, surfaces);
+		}
+		mesh.surface_count = surfaces.size() - mesh.first_surface;
+		meshes.push_back(mesh);
+	}
+
+	MeshConversion *meshes_ptrw = meshes.ptrw();
+	SurfaceConversion *surfaces_ptrw = surfaces.ptrw();
+	if (use_import_cache) {
+		//streaming hashes one mesh at a time
+		parallel_for(
+				meshes.size(), [&](int p_begin, int p_end) {
+					for (int mesh_index = p_begin; mesh_index < p_end; mesh_index++) {
+						MeshConversion &mesh = meshes_ptrw[mesh_index];
+						if (mesh.needs_topology_data) {
+							mesh.cache_key = _generate_cache_key(mesh, surfaces_ptrw + mesh.first_surface);
+						}
+					}
+				},
+				streaming_import ? MAX(meshes.size(), 1) : 1);
+		for (MeshConversion &mesh : meshes) {
+			_load_cached_mesh(mesh, import_mode, subdiv_level);
+		}
+	}
+
+	for (MeshConversion &mesh : meshes) {
+		if (mesh.needs_conversion) {
+			mesh.topology_data_mesh.instantiate();
+			mesh.topology_data_mesh->set_name(mesh.importer_mesh->get_name());
+		}
+	}
+
+	//surfaces are stored in order, so they get added in the same order as in the ImporterMesh
+	if (streaming_import) {
+		//one surface at a time, source arrays only get fetched right before converting
+		for (SurfaceConversion &surface : surfaces) {
+			MeshConversion &mesh = meshes_ptrw[surface.mesh_index];
+			if (mesh.needs_conversion) {
+				_fetch_surface_arrays(mesh.importer_mesh, surface);
+				_convert_surface(surface);
+				_add_converted_surface(mesh, surface);
+			}
+			surface.arrays = Array();
+			surface.blend_shape_arrays = Array();
+			surface.surface_arrays = Array();
+			surface.topology_blend_shape_arrays = Array();
+		}
+	} else {
+		parallel_for(
+				surfaces.size(), [&](int p_begin, int p_end) {
+					for (int surface_index = p_begin; surface_index < p_end; surface_index++) {
+						SurfaceConversion &surface = surfaces_ptrw[surface_index];
+						if (meshes_ptrw[surface.mesh_index].needs_conversion) {
+							_convert_surface(surface);
+						}
+					}
+				},
+				1);
+		for (const SurfaceConversion &surface : surfaces) {
+			if (meshes_ptrw[surface.mesh_index].needs_conversion) {
+				_add_converted_surface(meshes_ptrw[surface.mesh_index], surface);
+			}
 		}
 	}
 
-	Ref<TopologyDataMesh> topology_data_mesh;
-	topology_data_mesh.instantiate();
-	topology_data_mesh->set_name(importer_mesh->get_name());
-	// generate quad_mesh data
+	for (MeshConversion &mesh : meshes) {
+		if (!mesh.needs_conversion) {
+			continue;
+		}
+		//actually add blendshapes to data
+		for (int blend_shape_idx = 0; blend_shape_idx < mesh.importer_mesh->get_blend_shape_count(); blend_shape_idx++) {
+			mesh.topology_data_mesh->add_blend_shape_name(mesh.importer_mesh->get_blend_shape_name(blend_shape_idx));
+		}
+	}
+
+	if (import_mode == ImportMode::SUBDIV_MESHINSTANCE || import_mode == ImportMode::BAKED_SUBDIV_MESH) {
+		//cached meshes might contain refinement data of another level or from an import that had it enabled
+		const bool bake_refinement = store_refinement_data && subdiv_level > 0;
+		parallel_for(
+				meshes.size(), [&](int p_begin, int p_end) {
+					for (int mesh_index = p_begin; mesh_index < p_end; mesh_index++) {
+						MeshConversion &mesh = meshes_ptrw[mesh_index];
+						if (mesh.topology_data_mesh.is_null() || mesh.topology_data_mesh->get_surface_count() == 0) {
+							continue;
+						}
+						if (!bake_refinement) {
+							mesh.topology_data_mesh->clear_refinement_data();
+						} else if (mesh.topology_data_mesh->surface_get_refinement_data(0, subdiv_level).is_empty()) {
+							Ref<SubdivisionBaker> baker;
+							baker.instantiate();
+							baker->bake_refinement_data(mesh.topology_data_mesh, subdiv_level);
+						}
+					}
+				},
+				streaming_import ? MAX(meshes.size(), 1) : 1);
+	}
+
+	if (import_mode == ImportMode::ARRAY_MESH || import_mode == ImportMode::IMPORTER_MESH) {
+		//streaming bakes one mesh at a time
+		parallel_for(
+				meshes.size(), [&](int p_begin, int p_end) {
+					for (int mesh_index = p_begin; mesh_index < p_end; mesh_index++) {
+						MeshConversion &mesh = meshes_ptrw[mesh_index];
+						if (!mesh.needs_topology_data || mesh.baked_mesh.is_valid()) {
+							continue;
+						}
+						Ref<ImporterMesh> subdiv_importer_mesh;
+						subdiv_importer_mesh.instantiate();
+						Ref<SubdivisionBaker> baker;
+						baker.instantiate();
+						baker->set_use_cage_normals(use_cage_normals);
+						baker->set_tangent_mode(tangent_mode);
+						mesh.baked_mesh = baker->get_importer_mesh(subdiv_importer_mesh, mesh.topology_data_mesh, subdiv_level, true);
+					}
+				},
+				streaming_import ? MAX(meshes.size(), 1) : 1);
+	}
+
+	if (import_mode == ImportMode::BAKED_SUBDIV_MESH) {
+		//bakes right away instead of in the background, the scene gets saved right after
+		for (MeshConversion &mesh : meshes) {
+			if (mesh.baked_subdiv_mesh.is_valid()) {
+				continue;
+			}
+			mesh.baked_subdiv_mesh.instantiate();
+			//the import cache needs the baked surfaces, store_bake gets set to store_baked_mesh once it's saved
+			mesh.baked_subdiv_mesh->set_store_bake(store_baked_mesh || !mesh.cache_key.is_empty());
+			mesh.baked_subdiv_mesh->set_use_cage_normals(use_cage_normals);
+			mesh.baked_subdiv_mesh->set_tangent_mode(tangent_mode);
+			mesh.baked_subdiv_mesh->set_background_bake(false);
+			mesh.baked_subdiv_mesh->set_subdiv_level(subdiv_level);
+			mesh.baked_subdiv_mesh->set_data_mesh(mesh.topology_data_mesh);
+			mesh.baked_subdiv_mesh->set_background_bake(true);
+		}
+	}
+
+	HashSet<String> used_cache_keys;
+	for (MeshConversion &mesh : meshes) {
+		if (!mesh.cache_key.is_empty()) {
+			_save_cached_mesh(mesh, import_mode, subdiv_level);
+			_apply_source_materials(mesh, surfaces.ptr() + mesh.first_surface);
+			used_cache_keys.insert(mesh.cache_key);
+		}
+		_apply_mesh_conversion(mesh, import_mode, subdiv_level);
+	}
+	if (use_import_cache) {
+		_prune_import_cache(used_cache_keys);
+	}
+}
+
+void TopologyDataImporter::_prepare_surface_conversions(int mesh_index, const Ref<ImporterMesh> &importer_mesh, Vector<SurfaceConversion> &r_surfaces) const {
 	for (int surface_index = 0; surface_index < importer_mesh->get_surface_count(); surface_index++) {
-		//convert actual mesh data to quad
-		Array p_arrays = importer_mesh->get_surface_arrays(surface_index);
-		int32_t format = generate_fake_format(p_arrays); //importermesh surface_get_format just returns flags
+		SurfaceConversion surface;
+		surface.mesh_index = mesh_index;
+		surface.surface_index = surface_index;
+		surface.arrays = importer_mesh->get_surface_arrays(surface_index);
+		surface.format = generate_fake_format(surface.arrays); //importermesh surface_get_format just returns flags
 
 		// generate_fake_format returns 0 if size != ARRAY_MAX
-		if (format == 0 || !(format & Mesh::ARRAY_FORMAT_VERTEX)) {
+		if (surface.format == 0 || !(surface.format & Mesh::ARRAY_FORMAT_VERTEX)) {
+			continue;
+		}
+		if (streaming_import) {
+			surface.arrays = Array(); //fetched again when the surface gets converted
+		} else {
+			_fetch_surface_arrays(importer_mesh, surface);
+		}
+		r_surfaces.push_back(surface);
+	}
+}
+
+void TopologyDataImporter::_fetch_surface_arrays(const Ref<ImporterMesh> &importer_mesh, SurfaceConversion &surface) const {
+	if (surface.arrays.is_empty()) {
+		surface.arrays = importer_mesh->get_surface_arrays(surface.surface_index);
+	}
+	surface.blend_shape_arrays.clear();
+	for (int blend_shape_idx = 0; blend_shape_idx < importer_mesh->get_blend_shape_count(); blend_shape_idx++) {
+		surface.blend_shape_arrays.push_back(importer_mesh->get_surface_blend_shape_arrays(surface.surface_index, blend_shape_idx));
+	}
+}
+
+void TopologyDataImporter::_add_converted_surface(MeshConversion &mesh, const SurfaceConversion &surface) {
+	ERR_FAIL_COND(!surface.surface_arrays.size());
+	mesh.topology_data_mesh->add_surface(surface.surface_arrays, Dictionary(), surface.topology_blend_shape_arrays,
+			mesh.importer_mesh->get_surface_material(surface.surface_index), mesh.importer_mesh->get_surface_name(surface.surface_index),
+			surface.format, surface.topology_type);
+}
+
+void TopologyDataImporter::_convert_surface(SurfaceConversion &surface) {
+	if (!(surface.format & Mesh::ARRAY_FORMAT_INDEX)) {
+		//generate index array, arrays also used by blend_shapes so generating here
+		const PackedVector3Array &vertex_array = surface.arrays[Mesh::ARRAY_VERTEX];
+		PackedInt32Array simple_index_array;
+		simple_index_array.resize(vertex_array.size());
+		int32_t *simple_index_ptrw = simple_index_array.ptrw();
+		for (int i = 0; i < vertex_array.size(); i++) {
+			simple_index_ptrw[i] = i;
+		}
+		surface.arrays[Mesh::ARRAY_INDEX] = simple_index_array;
+		surface.format |= Mesh::ARRAY_FORMAT_INDEX;
+	}
+
+	PackedInt32Array source_indices;
+	surface.topology_type = _generate_topology_surface_arrays(SurfaceVertexArrays(surface.arrays), surface.format, surface.surface_arrays, source_indices);
+
+	//convert all blend shapes in the exact same way (BlendShapeArrays are also just an Array with the size of ARRAY_MAX and data offsets)
+	if (!surface.blend_shape_arrays.is_empty()) {
+		surface.topology_blend_shape_arrays = _generate_packed_blend_shapes(surface.blend_shape_arrays, source_indices, surface.arrays[Mesh::ARRAY_VERTEX]);
+	}
+}
+
+//bump whenever conversion or baking output changes, invalidates all cached files
+static const int IMPORT_CACHE_VERSION = 16;
+
+static void _hash_variant(const Ref<HashingContext> &p_hashing_context, const Variant &p_variant) {
+	p_hashing_context->update(UtilityFunctions::var_to_bytes(p_variant));
+}
+
+//one array at a time, so only a single array is serialized instead of the whole surface
+static void _hash_arrays(const Ref<HashingContext> &p_hashing_context, const Array &p_arrays) {
+	_hash_variant(p_hashing_context, p_arrays.size());
+	for (int array_index = 0; array_index < p_arrays.size(); array_index++) {
+		_hash_variant(p_hashing_context, p_arrays[array_index]);
+	}
+}
+
+String TopologyDataImporter::_generate_cache_key(const MeshConversion &mesh, const SurfaceConversion *surfaces) const {
+	Ref<HashingContext> hashing_context;
+	hashing_context.instantiate();
+	hashing_context->start(HashingContext::HASH_SHA256);
+	_hash_variant(hashing_context, IMPORT_CACHE_VERSION);
+	_hash_variant(hashing_context, weld_tolerance);
+	_hash_variant(hashing_context, mesh.importer_mesh->get_name());
+	for (int blend_shape_idx = 0; blend_shape_idx < mesh.importer_mesh->get_blend_shape_count(); blend_shape_idx++) {
+		_hash_variant(hashing_context, mesh.importer_mesh->get_blend_shape_name(blend_shape_idx));
+	}
+	//materials are not part of the key, they get reapplied from the source mesh
+	for (int surface_index = 0; surface_index < mesh.surface_count; surface_index++) {
+		const SurfaceConversion &surface = surfaces[surface_index];
+		_hash_variant(hashing_context, surface.format);
+		_hash_variant(hashing_context, mesh.importer_mesh->get_surface_name(surface.surface_index));
+		//streaming doesn't keep the source arrays around
+		_hash_arrays(hashing_context, streaming_import ? mesh.importer_mesh->get_surface_arrays(surface.surface_index) : surface.arrays);
+		for (int blend_shape_idx = 0; blend_shape_idx < mesh.importer_mesh->get_blend_shape_count(); blend_shape_idx++) {
+			const Array blend_shape_arrays = streaming_import
+					? mesh.importer_mesh->get_surface_blend_shape_arrays(surface.surface_index, blend_shape_idx)
+					: Array(surface.blend_shape_arrays[blend_shape_idx]);
+			_hash_arrays(hashing_context, blend_shape_arrays);
+		}
+	}
+	return hashing_context->finish().hex_encode();
+}
+
+//file names start with the cache version, so files of older versions can be told apart and removed
+String TopologyDataImporter::_get_topology_cache_file(const String &cache_key) const {
+	return import_cache_path.path_join(vformat("%d_%s.%s", IMPORT_CACHE_VERSION, cache_key, TopologyDataMeshFormat::EXTENSION));
+}
+
+String TopologyDataImporter::_get_baked_cache_file(const String &cache_key, ImportMode import_mode, int32_t subdiv_level) const {
+	//cage normals and tangents change the bake, not the conversion
+	return import_cache_path.path_join(vformat("%d_%s_%d_%d%s%s.res", IMPORT_CACHE_VERSION, cache_key, import_mode, subdiv_level, use_cage_normals ? "_cage_normals" : "",
+			tangent_mode == Subdivider::TANGENT_MODE_ANALYTIC ? "_analytic_tangents" : ""));
+}
+
+struct ImportCacheFile {
+	String name;
+	uint64_t modified_time = 0;
+	uint64_t size = 0;
+	bool operator<(const ImportCacheFile &p_other) const {
+		return modified_time < p_other.modified_time;
+	}
+};
+
+void TopologyDataImporter::_prune_import_cache(const HashSet<String> &p_used_keys) const {
+	Ref<DirAccess> cache_dir = DirAccess::open(import_cache_path);
+	if (cache_dir.is_null()) {
+		return;
+	}
+	const String version_prefix = itos(IMPORT_CACHE_VERSION) + "_";
+	Vector<ImportCacheFile> cache_files; //candidates for removal
+	uint64_t cache_size = 0;
+	const PackedStringArray file_names = cache_dir->get_files();
+	for (int file_index = 0; file_index < file_names.size(); file_index++) {
+		const String &file_name = file_names[file_index];
+		const String extension = file_name.get_extension();
+		if (extension != TopologyDataMeshFormat::EXTENSION && extension != "res") {
 			continue;
-		} else if (!(format & Mesh::ARRAY_FORMAT_INDEX)) {
-			//generate index array, p_arrays also used by blend_shapes so generating here
-			const PackedVector3Array &vertex_array = p_arrays[Mesh::ARRAY_VERTEX];
-			PackedInt32Array simple_index_array;
-			for (int i = 0; i < vertex_array.size(); i++) {
-				simple_index_array.push_back(i);
+		}
+		//written by another cache version, these never get read again
+		if (!file_name.begins_with(version_prefix)) {
+			cache_dir->remove(file_name);
+			continue;
+		}
+		const String path = import_cache_path.path_join(file_name);
+		ImportCacheFile cache_file;
+		cache_file.name = file_name;
+		cache_file.modified_time = FileAccess::get_modified_time(path);
+		Ref<FileAccess> file = FileAccess::open(path, FileAccess::READ);
+		cache_file.size = file.is_valid() ? file->get_length() : 0;
+		cache_size += cache_file.size;
+		if (!p_used_keys.has(file_name.get_slice("_", 1))) {
+			cache_files.push_back(cache_file);
+		}
+	}
+
+	const uint64_t max_size = uint64_t(import_cache_max_size) << 20;
+	if (cache_size <= max_size) {
+		return;
+	}
+	cache_files.sort(); //oldest first
+	for (int file_index = 0; file_index < cache_files.size() && cache_size > max_size; file_index++) {
+		if (cache_dir->remove(cache_files[file_index].name) == OK) {
+			cache_size -= cache_files[file_index].size;
+		}
+	}
+}
+
+void TopologyDataImporter::_load_cached_mesh(MeshConversion &mesh, ImportMode import_mode, int32_t subdiv_level) const {
+	if (mesh.cache_key.is_empty()) {
+		return;
+	}
+	ResourceLoader *resource_loader = ResourceLoader::get_singleton();
+	//baked modes don't need the TopologyDataMesh if the baked result is cached
+	if (import_mode == ImportMode::ARRAY_MESH || import_mode == ImportMode::IMPORTER_MESH) {
+		const String baked_file = _get_baked_cache_file(mesh.cache_key, import_mode, subdiv_level);
+		if (FileAccess::file_exists(baked_file)) {
+			mesh.baked_mesh = resource_loader->load(baked_file, "ImporterMesh", ResourceLoader::CACHE_MODE_IGNORE);
+			if (mesh.baked_mesh.is_valid()) {
+				mesh.baked_from_cache = true;
+				mesh.needs_conversion = false;
+				return;
+			}
+		}
+	}
+
+	//the cached BakedSubdivMesh contains its TopologyDataMesh
+	if (import_mode == ImportMode::BAKED_SUBDIV_MESH) {
+		const String baked_file = _get_baked_cache_file(mesh.cache_key, import_mode, subdiv_level);
+		if (FileAccess::file_exists(baked_file)) {
+			Ref<BakedSubdivMesh> baked_subdiv_mesh = resource_loader->load(baked_file, "BakedSubdivMesh", ResourceLoader::CACHE_MODE_IGNORE);
+			if (baked_subdiv_mesh.is_valid() && baked_subdiv_mesh->get_data_mesh().is_valid()) {
+				//an outdated stored bake gets baked again while loading, the file then gets written again
+				mesh.baked_from_cache = !baked_subdiv_mesh->is_baking();
+				baked_subdiv_mesh->wait_for_bake();
+				mesh.baked_subdiv_mesh = baked_subdiv_mesh;
+				mesh.topology_data_mesh = baked_subdiv_mesh->get_data_mesh();
+				mesh.needs_conversion = false;
+				return;
 			}
-			p_arrays[Mesh::ARRAY_INDEX] = simple_index_array;
-			format |= Mesh::ARRAY_FORMAT_INDEX;
 		}
+	}
+
+	const String topology_file = _get_topology_cache_file(mesh.cache_key);
+	if (FileAccess::file_exists(topology_file)) {
+		mesh.topology_data_mesh = resource_loader->load(topology_file, "TopologyDataMesh", ResourceLoader::CACHE_MODE_IGNORE);
+		mesh.needs_conversion = mesh.topology_data_mesh.is_null();
+	}
+}
 
-		Array surface_arrays;
-		TopologyDataMesh::TopologyType topology_type = _generate_topology_surface_arrays(SurfaceVertexArrays(p_arrays), format, surface_arrays);
+void TopologyDataImporter::_save_cached_mesh(const MeshConversion &mesh, ImportMode import_mode, int32_t subdiv_level) const {
+	//skipped surfaces would break the surface index mapping for materials
+	if (mesh.topology_data_mesh.is_valid() && mesh.topology_data_mesh->get_surface_count() != mesh.surface_count) {
+		return;
+	}
+	Error err = DirAccess::make_dir_recursive_absolute(import_cache_path);
+	ERR_FAIL_COND_MSG(err != OK, "Couldn't create import cache directory " + import_cache_path);
 
-		//convert all blend shapes in the exact same way (BlendShapeArrays are also just an Array with the size of ARRAY_MAX and data offsets)
-		Array blend_shape_arrays;
-		Array topology_data_blend_shape_arrays;
-		for (int blend_shape_idx = 0; blend_shape_idx < importer_mesh->get_blend_shape_count(); blend_shape_idx++) {
-			blend_shape_arrays.push_back(importer_mesh->get_surface_blend_shape_arrays(surface_index, blend_shape_idx));
+	ResourceSaver *resource_saver = ResourceSaver::get_singleton();
+	if (mesh.needs_conversion) {
+		const Ref<TopologyDataMesh> &topology_data_mesh = mesh.topology_data_mesh;
+		Vector<Ref<Material>> materials;
+		for (int surface_index = 0; surface_index < topology_data_mesh->get_surface_count(); surface_index++) {
+			materials.push_back(topology_data_mesh->surface_get_material(surface_index));
+			topology_data_mesh->surface_set_material(surface_index, Ref<Material>());
 		}
-		if (!blend_shape_arrays.is_empty()) {
-			topology_data_blend_shape_arrays = _generate_packed_blend_shapes(blend_shape_arrays, p_arrays[Mesh::ARRAY_INDEX], p_arrays[Mesh::ARRAY_VERTEX]);
+		err = resource_saver->save(topology_data_mesh, _get_topology_cache_file(mesh.cache_key), ResourceSaver::FLAG_COMPRESS);
+		for (int surface_index = 0; surface_index < materials.size(); surface_index++) {
+			topology_data_mesh->surface_set_material(surface_index, materials[surface_index]);
 		}
+		ERR_FAIL_COND_MSG(err != OK, "Couldn't write TopologyDataMesh to import cache");
+	}
 
-		ERR_FAIL_COND(!surface_arrays.size());
-		topology_data_mesh->add_surface(surface_arrays, Dictionary(), topology_data_blend_shape_arrays,
-				importer_mesh->get_surface_material(surface_index), importer_mesh->get_surface_name(surface_index), format, topology_type);
+	const String baked_file = _get_baked_cache_file(mesh.cache_key, import_mode, subdiv_level);
+	if (mesh.baked_mesh.is_valid() && !mesh.baked_from_cache) {
+		const Ref<ImporterMesh> &baked_mesh = mesh.baked_mesh;
+		Vector<Ref<Material>> materials;
+		for (int surface_index = 0; surface_index < baked_mesh->get_surface_count(); surface_index++) {
+			materials.push_back(baked_mesh->get_surface_material(surface_index));
+			baked_mesh->set_surface_material(surface_index, Ref<Material>());
+		}
+		err = resource_saver->save(baked_mesh, baked_file, ResourceSaver::FLAG_COMPRESS);
+		for (int surface_index = 0; surface_index < materials.size(); surface_index++) {
+			baked_mesh->set_surface_material(surface_index, materials[surface_index]);
+		}
+		ERR_FAIL_COND_MSG(err != OK, "Couldn't write baked mesh to import cache");
 	}
-	//actually add blendshapes to data
-	for (int blend_shape_idx = 0; blend_shape_idx < importer_mesh->get_blend_shape_count(); blend_shape_idx++) {
-		topology_data_mesh->add_blend_shape_name(importer_mesh->get_blend_shape_name(blend_shape_idx));
+
+	if (mesh.baked_subdiv_mesh.is_valid() && !mesh.baked_from_cache) {
+		//data_mesh gets saved with it, so both lose their materials while saving
+		const Ref<BakedSubdivMesh> &baked_subdiv_mesh = mesh.baked_subdiv_mesh;
+		const Ref<TopologyDataMesh> data_mesh = baked_subdiv_mesh->get_data_mesh();
+		ERR_FAIL_COND(data_mesh.is_null() || data_mesh->get_surface_count() != baked_subdiv_mesh->get_surface_count());
+		Vector<Ref<Material>> materials;
+		Vector<Ref<Material>> data_materials;
+		for (int surface_index = 0; surface_index < baked_subdiv_mesh->get_surface_count(); surface_index++) {
+			materials.push_back(baked_subdiv_mesh->surface_get_material(surface_index));
+			data_materials.push_back(data_mesh->surface_get_material(surface_index));
+			baked_subdiv_mesh->surface_set_material(surface_index, Ref<Material>());
+			data_mesh->surface_set_material(surface_index, Ref<Material>());
+		}
+		err = resource_saver->save(baked_subdiv_mesh, baked_file, ResourceSaver::FLAG_COMPRESS);
+		for (int surface_index = 0; surface_index < materials.size(); surface_index++) {
+			baked_subdiv_mesh->surface_set_material(surface_index, materials[surface_index]);
+			data_mesh->surface_set_material(surface_index, data_materials[surface_index]);
+		}
+		ERR_FAIL_COND_MSG(err != OK, "Couldn't write BakedSubdivMesh to import cache");
+	}
+}
+
+void TopologyDataImporter::_apply_source_materials(MeshConversion &mesh, const SurfaceConversion *surfaces) const {
+	if (mesh.topology_data_mesh.is_valid()) {
+		ERR_FAIL_COND(mesh.topology_data_mesh->get_surface_count() != mesh.surface_count);
+		for (int surface_index = 0; surface_index < mesh.surface_count; surface_index++) {
+			mesh.topology_data_mesh->surface_set_material(surface_index, mesh.importer_mesh->get_surface_material(surfaces[surface_index].surface_index));
+		}
+	}
+	if (mesh.baked_mesh.is_valid()) {
+		ERR_FAIL_COND(mesh.baked_mesh->get_surface_count() != mesh.surface_count);
+		for (int surface_index = 0; surface_index < mesh.surface_count; surface_index++) {
+			mesh.baked_mesh->set_surface_material(surface_index, mesh.importer_mesh->get_surface_material(surfaces[surface_index].surface_index));
+		}
+	}
+	if (mesh.baked_subdiv_mesh.is_valid()) {
+		ERR_FAIL_COND(mesh.baked_subdiv_mesh->get_surface_count() != mesh.surface_count);
+		for (int surface_index = 0; surface_index < mesh.surface_count; surface_index++) {
+			mesh.baked_subdiv_mesh->surface_set_material(surface_index, mesh.importer_mesh->get_surface_material(surfaces[surface_index].surface_index));
+		}
+	}
+}
+
+void TopologyDataImporter::_apply_mesh_conversion(const MeshConversion &mesh, ImportMode import_mode, int32_t subdiv_level) {
+	ImporterMeshInstance3D *importer_mesh_instance = mesh.importer_mesh_instance;
+	if (!mesh.needs_topology_data) {
+		if (import_mode == ImportMode::ARRAY_MESH) {
+			_replace_importer_mesh_instance_with_mesh_instance(importer_mesh_instance);
+		}
+		return;
 	}
 
 	StringName mesh_instance_name = importer_mesh_instance->get_name();
+	//set after the import cache got saved, cached meshes keep full precision
+	if (mesh.topology_data_mesh.is_valid()) {
+		mesh.topology_data_mesh->set_quantized_storage(quantize_storage);
+	}
 	switch (import_mode) {
 		case ImportMode::SUBDIV_MESHINSTANCE: {
 			//creates subdiv mesh instance with topologydatamesh
@@ -115,7 +693,7 @@ void TopologyDataImporter::convert_importer_meshinstance_to_subdiv(Object *impor
 				subdiv_mesh_instance->set_skin(importer_mesh_instance->get_skin());
 			}
 			subdiv_mesh_instance->set_transform(importer_mesh_instance->get_transform());
-			subdiv_mesh_instance->set_mesh(topology_data_mesh);
+			subdiv_mesh_instance->set_mesh(mesh.topology_data_mesh);
 
 			subdiv_mesh_instance->set_subdiv_level(subdiv_level);
 
@@ -126,11 +704,9 @@ void TopologyDataImporter::convert_importer_meshinstance_to_subdiv(Object *impor
 			break;
 		}
 		case ImportMode::BAKED_SUBDIV_MESH: {
-			Ref<BakedSubdivMesh> subdiv_mesh;
-			subdiv_mesh.instantiate();
-
-			subdiv_mesh->set_data_mesh(topology_data_mesh);
-			subdiv_mesh->set_subdiv_level(subdiv_level);
+			ERR_FAIL_COND(mesh.baked_subdiv_mesh.is_null());
+			const Ref<BakedSubdivMesh> &subdiv_mesh = mesh.baked_subdiv_mesh;
+			subdiv_mesh->set_store_bake(store_baked_mesh);
 			subdiv_mesh->set_blend_shape_mode(Mesh::BLEND_SHAPE_MODE_NORMALIZED); //otherwise data would need to be converted
 
 			MeshInstance3D *mesh_instance = Object::cast_to<MeshInstance3D>(_replace_importer_mesh_instance_with_mesh_instance(importer_mesh_instance));
@@ -139,15 +715,10 @@ void TopologyDataImporter::convert_importer_meshinstance_to_subdiv(Object *impor
 		}
 		case ImportMode::ARRAY_MESH:
 		case ImportMode::IMPORTER_MESH: {
-			Ref<ImporterMesh> subdiv_importer_mesh;
-			subdiv_importer_mesh.instantiate();
-
-			Ref<SubdivisionBaker> baker;
-			baker.instantiate();
-			subdiv_importer_mesh = baker->get_importer_mesh(subdiv_importer_mesh, topology_data_mesh, subdiv_level, true);
-			importer_mesh_instance->set_mesh(subdiv_importer_mesh);
+			ERR_FAIL_COND(mesh.baked_mesh.is_null());
+			importer_mesh_instance->set_mesh(mesh.baked_mesh);
 			if (import_mode == ImportMode::ARRAY_MESH) {
-				MeshInstance3D *mesh_instance = Object::cast_to<MeshInstance3D>(_replace_importer_mesh_instance_with_mesh_instance(importer_mesh_instance));
+				_replace_importer_mesh_instance_with_mesh_instance(importer_mesh_instance);
 			}
 			break;
 		}
@@ -157,10 +728,58 @@ void TopologyDataImporter::convert_importer_meshinstance_to_subdiv(Object *impor
 	}
 }
 
-TopologyDataMesh::TopologyType TopologyDataImporter::_generate_topology_surface_arrays(const SurfaceVertexArrays &surface, int32_t format, Array &surface_arrays) {
+void TopologyDataImporter::convert_animation_blend_shape_tracks(Object *p_animation_player) {
+	AnimationPlayer *animation_player = Object::cast_to<AnimationPlayer>(p_animation_player);
+	ERR_FAIL_NULL_MSG(animation_player, "Object is not an AnimationPlayer");
+
+	TypedArray<StringName> animation_library_names = animation_player->get_animation_library_list();
+	for (int library_idx = 0; library_idx < animation_library_names.size(); library_idx++) {
+		Ref<AnimationLibrary> animation_library = animation_player->get_animation_library(animation_library_names[library_idx]);
+		if (animation_library.is_null()) {
+			continue;
+		}
+		TypedArray<StringName> animation_names = animation_library->get_animation_list();
+		for (int animation_idx = 0; animation_idx < animation_names.size(); animation_idx++) {
+			Ref<Animation> animation = animation_library->get_animation(animation_names[animation_idx]);
+			if (animation.is_null()) {
+				continue;
+			}
+			for (int track_idx = 0; track_idx < animation->get_track_count(); track_idx++) {
+				if (animation->track_get_type(track_idx) != Animation::TYPE_BLEND_SHAPE) {
+					continue;
+				}
+				//blend shape tracks are stored as Node:blend_shape, value tracks need Node:blend_shapes/blend_shape
+				const NodePath old_track_path = animation->track_get_path(track_idx);
+				ERR_CONTINUE(old_track_path.get_subname_count() == 0);
+				const String new_track_path = String(old_track_path.get_concatenated_names()) + ":blend_shapes/" + String(old_track_path.get_subname(0));
+
+				//inserting at track_idx moves the old track to track_idx + 1
+				animation->add_track(Animation::TYPE_VALUE, track_idx);
+				const int old_track_idx = track_idx + 1;
+				animation->track_set_path(track_idx, NodePath(new_track_path));
+				animation->track_set_enabled(track_idx, animation->track_is_enabled(old_track_idx));
+				animation->track_set_interpolation_type(track_idx, animation->track_get_interpolation_type(old_track_idx));
+				animation->track_set_interpolation_loop_wrap(track_idx, animation->track_get_interpolation_loop_wrap(old_track_idx));
+				animation->value_track_set_update_mode(track_idx, Animation::UPDATE_CONTINUOUS);
+
+				for (int key_idx = 0; key_idx < animation->track_get_key_count(old_track_idx); key_idx++) {
+					animation->track_insert_key(track_idx, animation->track_get_key_time(old_track_idx, key_idx),
+							animation->track_get_key_value(old_track_idx, key_idx), animation->track_get_key_transition(old_track_idx, key_idx));
+				}
+				animation->remove_track(old_track_idx);
+			}
+		}
+	}
+}
+
+TopologyDataMesh::TopologyType TopologyDataImporter::_generate_topology_surface_arrays(const SurfaceVertexArrays &surface, int32_t format, Array &surface_arrays,
+		PackedInt32Array &r_source_indices) {
 	ERR_FAIL_COND_V(!(format & Mesh::ARRAY_FORMAT_INDEX), TopologyDataMesh::TopologyType::QUAD);
 	TopologySurfaceData topology_surface = _remove_duplicate_vertices(surface, format);
-	bool is_quad = _merge_to_quads(topology_surface.index_array, topology_surface.uv_array, format);
+	r_source_indices = topology_surface.source_indices;
+	PackedInt32Array face_vertex_count_array;
+	TopologyDataMesh::TopologyType topology_type = _merge_to_quads(topology_surface.index_array, topology_surface.uv_array,
+			topology_surface.vertex_array, format, face_vertex_count_array);
 	bool has_uv = format & Mesh::ARRAY_FORMAT_TEX_UV;
 
 	surface_arrays.resize(TopologyDataMesh::ARRAY_MAX);
@@ -170,8 +789,9 @@ TopologyDataMesh::TopologyType TopologyDataImporter::_generate_topology_surface_
 	surface_arrays[TopologyDataMesh::ARRAY_BONES] = topology_surface.bones_array; // TODO: docs say bones array can also be floats, might cause issues
 	surface_arrays[TopologyDataMesh::ARRAY_WEIGHTS] = topology_surface.weights_array;
 	surface_arrays[TopologyDataMesh::ARRAY_INDEX] = topology_surface.index_array;
+	surface_arrays[TopologyDataMesh::ARRAY_FACE_VERTEX_COUNT] = face_vertex_count_array;
 	if (has_uv) {
-		PackedInt32Array uv_index_array = _generate_uv_index_array(topology_surface.uv_array);
+		PackedInt32Array uv_index_array = _generate_uv_index_array(topology_surface.index_array, topology_surface.vertex_array.size(), topology_surface.uv_array);
 		surface_arrays[TopologyDataMesh::ARRAY_TEX_UV] = topology_surface.uv_array;
 		surface_arrays[TopologyDataMesh::ARRAY_UV_INDEX] = uv_index_array;
 	} else { //this is to avoid issues with casting null to Array when using these as reference
@@ -179,11 +799,7 @@ TopologyDataMesh::TopologyType TopologyDataImporter::_generate_topology_surface_
 		surface_arrays[TopologyDataMesh::ARRAY_UV_INDEX] = PackedInt32Array();
 	}
 
-	if (is_quad) {
-		return TopologyDataMesh::TopologyType::QUAD;
-	} else {
-		return TopologyDataMesh::TopologyType::TRIANGLE;
-	}
+	return topology_type;
 }
 
 TopologyDataImporter::TopologySurfaceData TopologyDataImporter::_remove_duplicate_vertices(const SurfaceVertexArrays &surface, int32_t format) {
@@ -195,48 +811,266 @@ TopologyDataImporter::TopologySurfaceData TopologyDataImporter::_remove_duplicat
 	//TODO: maybe add tangents, uv2 here too, considering that data is lost after subdivisions not that urgent
 
 	TopologySurfaceData topology_surface;
-	int max_index = 0;
-	HashMap<Vector3, int> original_verts;
-	for (int vert_index = 0; vert_index < surface.index_array.size(); vert_index++) {
-		int index = surface.index_array[vert_index];
-		if (original_verts.has(surface.vertex_array[index])) {
-			topology_surface.index_array.append(original_verts.get(surface.vertex_array[index]));
-		} else {
-			topology_surface.vertex_array.append(surface.vertex_array[index]);
-			if (has_normals) {
-				topology_surface.normal_array.append(surface.normal_array[index]);
+	topology_surface.vertex_remap = _generate_weld_remap(surface.vertex_array, surface.index_array, topology_surface.source_indices);
+	ERR_FAIL_COND_V(topology_surface.vertex_remap.is_empty(), topology_surface);
+	const int index_count = surface.index_array.size();
+	const int vertex_count = topology_surface.source_indices.size();
+	const int bone_weights_per_vert = double_bone_weights ? 8 : 4;
+
+	// everything below is a gather with known output size, so arrays get sized once and filled in parallel
+	topology_surface.index_array.resize(index_count);
+	topology_surface.vertex_array.resize(vertex_count);
+	if (has_normals) {
+		topology_surface.normal_array.resize(vertex_count);
+	}
+	if (has_skinning) {
+		topology_surface.weights_array.resize(vertex_count * bone_weights_per_vert);
+		topology_surface.bones_array.resize(vertex_count * bone_weights_per_vert);
+	}
+	if (has_uv) { // always if uv's exist, uv's stay per face corner
+		topology_surface.uv_array.resize(index_count);
+	}
+
+	const int32_t *src_index = surface.index_array.ptr();
+	const int32_t *remap = topology_surface.vertex_remap.ptr();
+	int32_t *dst_index = topology_surface.index_array.ptrw();
+	const Vector2 *src_uv = has_uv ? surface.uv_array.ptr() : nullptr;
+	Vector2 *dst_uv = has_uv ? topology_surface.uv_array.ptrw() : nullptr;
+	parallel_for(index_count, [&](int p_begin, int p_end) {
+		for (int corner = p_begin; corner < p_end; corner++) {
+			dst_index[corner] = remap[src_index[corner]];
+			if (src_uv) {
+				dst_uv[corner] = src_uv[src_index[corner]];
 			}
+		}
+	});
 
-			// weights and bones arrays to corresponding vertex (4 weights per vert)
-			if (has_skinning) {
-				int bone_weights_per_vert = double_bone_weights ? 8 : 4;
-				for (int weight_index = index * bone_weights_per_vert; weight_index < (index + 1) * bone_weights_per_vert; weight_index++) {
-					topology_surface.weights_array.append(surface.weights_array[weight_index]);
-					topology_surface.bones_array.append(surface.bones_array[weight_index]);
-				}
+	const int32_t *source = topology_surface.source_indices.ptr();
+	const Vector3 *src_vertex = surface.vertex_array.ptr();
+	Vector3 *dst_vertex = topology_surface.vertex_array.ptrw();
+	const Vector3 *src_normal = has_normals ? surface.normal_array.ptr() : nullptr;
+	Vector3 *dst_normal = has_normals ? topology_surface.normal_array.ptrw() : nullptr;
+	const float *src_weights = has_skinning ? surface.weights_array.ptr() : nullptr;
+	float *dst_weights = has_skinning ? topology_surface.weights_array.ptrw() : nullptr;
+	const int32_t *src_bones = has_skinning ? surface.bones_array.ptr() : nullptr;
+	int32_t *dst_bones = has_skinning ? topology_surface.bones_array.ptrw() : nullptr;
+	parallel_for(vertex_count, [&](int p_begin, int p_end) {
+		for (int vertex_index = p_begin; vertex_index < p_end; vertex_index++) {
+			int index = source[vertex_index];
+			dst_vertex[vertex_index] = src_vertex[index];
+			if (dst_normal) {
+				dst_normal[vertex_index] = src_normal[index];
+			}
+			// weights and bones arrays to corresponding vertex (4 or 8 weights per vert)
+			if (dst_weights) {
+				memcpy(&dst_weights[vertex_index * bone_weights_per_vert], &src_weights[index * bone_weights_per_vert], sizeof(float) * bone_weights_per_vert);
+				memcpy(&dst_bones[vertex_index * bone_weights_per_vert], &src_bones[index * bone_weights_per_vert], sizeof(int32_t) * bone_weights_per_vert);
 			}
+		}
+	});
+	if (streaming_import) {
+		topology_surface.vertex_remap = PackedInt32Array(); //only source_indices are needed from here on
+	}
+
+	return topology_surface;
+}
+
+// minimum referenced vertices per shard of the weld cell map
+static const int WELD_SHARD_SIZE = 16384;
+static const int MAX_WELD_SHARDS = 64;
+
+// cell coordinates are 64 bit, positions far from the origin with a tiny tolerance would overflow 32 bits
+static _FORCE_INLINE_ int64_t _weld_cell_coordinate(real_t p_floored) {
+	const real_t limit = 4611686018427387904.0; // 2^62, clamped so the cast stays defined and neighbour offsets can't overflow
+	return (int64_t)CLAMP(p_floored, -limit, limit);
+}
+
+// exact welding uses the bit pattern as cell, -0.0 and 0.0 are the same position
+static _FORCE_INLINE_ int64_t _exact_weld_cell_coordinate(real_t p_position) {
+	const real_t position = p_position == 0.0 ? 0.0 : p_position;
+	int64_t bits = 0;
+	memcpy(&bits, &position, sizeof(real_t));
+	return bits;
+}
+
+struct WeldCell {
+	int64_t x = 0;
+	int64_t y = 0;
+	int64_t z = 0;
+
+	WeldCell() {}
+	WeldCell(int64_t p_x, int64_t p_y, int64_t p_z) :
+			x(p_x), y(p_y), z(p_z) {}
 
-			topology_surface.index_array.append(max_index);
+	WeldCell operator+(const Vector3i &p_offset) const {
+		return WeldCell(x + p_offset.x, y + p_offset.y, z + p_offset.z);
+	}
+	bool operator==(const WeldCell &p_other) const {
+		return x == p_other.x && y == p_other.y && z == p_other.z;
+	}
+	static _FORCE_INLINE_ uint32_t hash(const WeldCell &p_cell) {
+		uint32_t h = hash_murmur3_one_64(p_cell.x);
+		h = hash_murmur3_one_64(p_cell.y, h);
+		h = hash_murmur3_one_64(p_cell.z, h);
+		return hash_fmix32(h);
+	}
+};
+
+// Spatial hash weld: positions get quantized into cells of size 2 * weld_tolerance. A vertex can then only be within
+// weld_tolerance of vertices in its own cell or the neighbouring cell on the nearer side of each axis (8 cells in total).
+// With a tolerance of 0 the cell is the exact position and only the own cell gets checked.
+// Every vertex welds to the first referenced vertex within weld_tolerance, so the result doesn't depend on how the
+// work gets split: the cell map is built in parallel shards and every vertex searches it in parallel.
+PackedInt32Array TopologyDataImporter::_generate_weld_remap(const PackedVector3Array &vertex_array, const PackedInt32Array &index_array,
+		PackedInt32Array &r_source_indices) const {
+	const int vertex_count = vertex_array.size();
+	const int index_count = index_array.size();
+	PackedInt32Array vertex_remap;
+	vertex_remap.resize(vertex_count);
+	vertex_remap.fill(-1);
+	ERR_FAIL_COND_V(vertex_count == 0, PackedInt32Array());
+
+	const Vector3 *vertices = vertex_array.ptr();
+	const int32_t *indices = index_array.ptr();
+	int32_t *remap = vertex_remap.ptrw();
 
-			original_verts.insert(surface.vertex_array[index], max_index);
+	// only referenced vertices get welded, in order of first appearance like before. remap holds that order for now
+	LocalVector<int> first_use; // order -> source vertex
+	if (!streaming_import) {
+		first_use.reserve(vertex_count);
+	}
+	for (int corner = 0; corner < index_count; corner++) {
+		int index = indices[corner];
+		ERR_FAIL_INDEX_V(index, vertex_count, PackedInt32Array());
+		if (remap[index] == -1) {
+			remap[index] = first_use.size();
+			first_use.push_back(index);
+		}
+	}
+	const int referenced_count = first_use.size();
 
-			max_index++;
+	const bool exact = weld_tolerance <= 0.0;
+	const int neighbour_count = exact ? 1 : 8;
+	const real_t inverse_cell_size = exact ? 0.0 : 1.0 / (weld_tolerance * 2.0);
+	const real_t tolerance_squared = weld_tolerance * weld_tolerance;
+	// cell of a vertex and which neighbour cell per axis needs to be checked as well
+	auto quantize = [&](const Vector3 &p_position, WeldCell &r_cell, Vector3i &r_offset) {
+		if (exact) {
+			r_cell = WeldCell(_exact_weld_cell_coordinate(p_position.x), _exact_weld_cell_coordinate(p_position.y), _exact_weld_cell_coordinate(p_position.z));
+			return;
 		}
+		Vector3 scaled = p_position * inverse_cell_size;
+		Vector3 floored = scaled.floor();
+		Vector3 fraction = scaled - floored;
+		r_cell = WeldCell(_weld_cell_coordinate(floored.x), _weld_cell_coordinate(floored.y), _weld_cell_coordinate(floored.z));
+		r_offset = Vector3i(fraction.x < 0.5 ? -1 : 1, fraction.y < 0.5 ? -1 : 1, fraction.z < 0.5 ? -1 : 1);
+	};
+	auto matches = [&](const Vector3 &p_a, const Vector3 &p_b) {
+		return exact ? p_a == p_b : p_a.distance_squared_to(p_b) <= tolerance_squared;
+	};
 
-		// always if uv's exist
-		if (has_uv) {
-			topology_surface.uv_array.append(surface.uv_array[index]);
+	LocalVector<uint32_t> cell_hashes;
+	cell_hashes.resize(referenced_count);
+	uint32_t *cell_hash_write = cell_hashes.ptr();
+	parallel_for(referenced_count, [&](int p_begin, int p_end) {
+		WeldCell cell;
+		Vector3i offset;
+		for (int order = p_begin; order < p_end; order++) {
+			quantize(vertices[first_use[order]], cell, offset);
+			cell_hash_write[order] = WeldCell::hash(cell);
+		}
+	});
+
+	// cell -> first vertex in cell, later ones are reached through next_in_cell. Each shard only holds the cells
+	// with its hash, so shards get filled in parallel and still list vertices in order of first appearance
+	const int shard_count = CLAMP(referenced_count / WELD_SHARD_SIZE, 1, MAX_WELD_SHARDS);
+	LocalVector<HashMap<WeldCell, int, WeldCell>> cell_heads;
+	cell_heads.resize(shard_count);
+	LocalVector<int> next_in_cell;
+	next_in_cell.resize(referenced_count);
+	int *next_in_cell_write = next_in_cell.ptr();
+	parallel_for(
+			shard_count, [&](int p_begin, int p_end) {
+				WeldCell cell;
+				Vector3i offset;
+				for (int shard = p_begin; shard < p_end; shard++) {
+					HashMap<WeldCell, int, WeldCell> &shard_heads = cell_heads[shard];
+					if (!streaming_import) {
+						shard_heads.reserve(referenced_count / shard_count);
+					}
+					// inserted back to front, so the head is always the vertex that appeared first
+					for (int order = referenced_count - 1; order >= 0; order--) {
+						if (cell_hash_write[order] % shard_count != (uint32_t)shard) {
+							continue;
+						}
+						quantize(vertices[first_use[order]], cell, offset);
+						HashMap<WeldCell, int, WeldCell>::Iterator head = shard_heads.find(cell);
+						if (head) {
+							next_in_cell_write[order] = head->value;
+							head->value = order;
+						} else {
+							next_in_cell_write[order] = -1;
+							shard_heads.insert(cell, order);
+						}
+					}
+				}
+			},
+			1);
+
+	// first vertex within weld_tolerance, only reads the finished cell map
+	LocalVector<int> weld_targets;
+	weld_targets.resize(referenced_count);
+	int *weld_target_write = weld_targets.ptr();
+	parallel_for(referenced_count, [&](int p_begin, int p_end) {
+		WeldCell cell;
+		Vector3i offset;
+		for (int order = p_begin; order < p_end; order++) {
+			const Vector3 &position = vertices[first_use[order]];
+			quantize(position, cell, offset);
+			int target = order;
+			for (int neighbour = 0; neighbour < neighbour_count; neighbour++) {
+				WeldCell search_cell = neighbour == 0 ? cell : cell + Vector3i(neighbour & 1 ? offset.x : 0, neighbour & 2 ? offset.y : 0, neighbour & 4 ? offset.z : 0);
+				const HashMap<WeldCell, int, WeldCell> &shard_heads = cell_heads[WeldCell::hash(search_cell) % shard_count];
+				HashMap<WeldCell, int, WeldCell>::ConstIterator head = shard_heads.find(search_cell);
+				if (!head) {
+					continue;
+				}
+				// cells are sorted by first appearance, nothing after target can be earlier
+				for (int candidate = head->value; candidate != -1 && candidate < target; candidate = next_in_cell[candidate]) {
+					if (matches(vertices[first_use[candidate]], position)) {
+						target = candidate;
+						break;
+					}
+				}
+			}
+			weld_target_write[order] = target;
+		}
+	});
+
+	// targets always appeared earlier and already got their welded index, chains end at the first vertex of the group
+	r_source_indices.resize(referenced_count); // upper bound, shrunk at the end
+	int32_t *source_indices = r_source_indices.ptrw();
+	int welded_count = 0;
+	for (int order = 0; order < referenced_count; order++) {
+		const int target = weld_targets[order];
+		if (target == order) {
+			source_indices[welded_count] = first_use[order];
+			remap[first_use[order]] = welded_count++;
+		} else {
+			remap[first_use[order]] = remap[first_use[target]];
 		}
 	}
 
-	return topology_surface;
+	r_source_indices.resize(welded_count);
+	return vertex_remap;
 }
 
 // Goes through index_array and always merges the 6 indices of 2 triangles to 1 quad (uv_array also updated)
-// returns boolean if conversion to quad was successful
-bool TopologyDataImporter::_merge_to_quads(PackedInt32Array &index_array, PackedVector2Array &uv_array, int32_t format) {
+// returns resulting topology type
+TopologyDataMesh::TopologyType TopologyDataImporter::_merge_to_quads(PackedInt32Array &index_array, PackedVector2Array &uv_array, const PackedVector3Array &vertex_array,
+		int32_t format, PackedInt32Array &r_face_vertex_count_array) {
 	if (index_array.size() % 6 != 0) {
-		return false;
+		return _merge_to_quads_by_adjacency(index_array, uv_array, vertex_array, format, r_face_vertex_count_array);
 	}
 
 	bool has_uv = format & Mesh::ARRAY_FORMAT_TEX_UV;
@@ -268,7 +1102,8 @@ bool TopologyDataImporter::_merge_to_quads(PackedInt32Array &index_array, Packed
 			}
 		}
 		if (shared_verts.size() != 2) {
-			return false;
+			// triangles of a quad aren't next to each other, pair them by their shared edges instead
+			return _merge_to_quads_by_adjacency(index_array, uv_array, vertex_array, format, r_face_vertex_count_array);
 		}
 
 		/*isn't always like this, but for recreating triangles later this is
@@ -291,56 +1126,326 @@ bool TopologyDataImporter::_merge_to_quads(PackedInt32Array &index_array, Packed
 	}
 	index_array = quad_index_array;
 	uv_array = quad_uv_array;
-	return true;
+	return TopologyDataMesh::TopologyType::QUAD;
+}
+
+static const real_t MAX_QUAD_FACE_ANGLE = Math::deg_to_rad(40.0);
+// two equilateral triangles are only 30 degrees off, so a triangle grid can't pass as quads
+static const real_t MAX_QUAD_SHAPE_ANGLE = Math::deg_to_rad(25.0);
+
+struct QuadCandidate {
+	real_t score; // face angle + worst corner angle deviation, lower is better
+	int triangle_a;
+	int triangle_b;
+	int corners[4]; // positions in index_array for the quad corners
+	bool operator<(const QuadCandidate &p_other) const {
+		return score < p_other.score;
+	}
+};
+
+// edge key independent of direction, vertex indices are always positive
+static _FORCE_INLINE_ uint64_t _edge_key(int32_t p_a, int32_t p_b) {
+	return p_a < p_b ? ((uint64_t)p_a << 32) | (uint32_t)p_b : ((uint64_t)p_b << 32) | (uint32_t)p_a;
+}
+
+TopologyDataMesh::TopologyType TopologyDataImporter::_merge_to_quads_by_adjacency(PackedInt32Array &index_array, PackedVector2Array &uv_array, const PackedVector3Array &vertex_array,
+		int32_t format, PackedInt32Array &r_face_vertex_count_array) {
+	if (index_array.size() % 3 != 0) {
+		return TopologyDataMesh::TopologyType::TRIANGLE;
+	}
+
+	bool has_uv = format & Mesh::ARRAY_FORMAT_TEX_UV;
+	const int triangle_count = index_array.size() / 3;
+	const int32_t *indices = index_array.ptr();
+	const Vector3 *vertices = vertex_array.ptr();
+
+	// edge -> first corner (triangle * 3 + local edge) that starts that edge
+	HashMap<uint64_t, int> edge_corners;
+	edge_corners.reserve(index_array.size());
+	Vector<QuadCandidate> candidates;
+	candidates.resize(index_array.size()); // at most one candidate per corner
+	int candidate_count = 0;
+
+	for (int triangle = 0; triangle < triangle_count; triangle++) {
+		for (int edge = 0; edge < 3; edge++) {
+			int corner = triangle * 3 + edge;
+			int edge_start = indices[corner];
+			int edge_end = indices[triangle * 3 + (edge + 1) % 3];
+			uint64_t key = _edge_key(edge_start, edge_end);
+			HashMap<uint64_t, int>::Iterator found = edge_corners.find(key);
+			if (!found) {
+				edge_corners.insert(key, corner);
+				continue;
+			}
+
+			// other triangle needs to walk the edge in the opposite direction, otherwise winding flips
+			int other_corner = found->value;
+			int other_triangle = other_corner / 3;
+			int other_edge = other_corner % 3;
+			if (other_triangle == triangle || indices[other_corner] != edge_end) {
+				continue;
+			}
+
+			/*
+			quad corners, triangle a is (q0, q1, q3) and triangle b (q1, q2, q3)
+			q0 (opposite a) - q1 (edge_start)
+			|					|
+			q3 (edge_end)	 - q2 (opposite b)
+			*/
+			QuadCandidate candidate;
+			candidate.triangle_a = triangle;
+			candidate.triangle_b = other_triangle;
+			candidate.corners[0] = triangle * 3 + (edge + 2) % 3;
+			candidate.corners[1] = corner;
+			candidate.corners[2] = other_triangle * 3 + (other_edge + 2) % 3;
+			candidate.corners[3] = triangle * 3 + (edge + 1) % 3;
+
+			Vector3 quad[4];
+			for (int i = 0; i < 4; i++) {
+				quad[i] = vertices[indices[candidate.corners[i]]];
+			}
+			Vector3 normal_a = (quad[1] - quad[0]).cross(quad[3] - quad[0]);
+			Vector3 normal_b = (quad[2] - quad[1]).cross(quad[3] - quad[1]);
+			if (normal_a.is_zero_approx() || normal_b.is_zero_approx()) {
+				continue;
+			}
+			real_t face_angle = normal_a.angle_to(normal_b);
+			if (face_angle > MAX_QUAD_FACE_ANGLE) {
+				continue;
+			}
+
+			Vector3 quad_normal = normal_a.normalized() + normal_b.normalized();
+			real_t shape_error = 0.0;
+			bool convex = true;
+			for (int i = 0; i < 4; i++) {
+				Vector3 to_next = quad[(i + 1) % 4] - quad[i];
+				Vector3 to_previous = quad[(i + 3) % 4] - quad[i];
+				if (to_next.cross(to_previous).dot(quad_normal) <= 0.0) {
+					convex = false;
+					break;
+				}
+				shape_error = MAX(shape_error, Math::abs(to_next.angle_to(to_previous) - (real_t)Math_PI * 0.5));
+			}
+			if (!convex || shape_error > MAX_QUAD_SHAPE_ANGLE) {
+				continue;
+			}
+			// the shared edge is the diagonal of the quad, so it has to be the longest edge of both triangles
+			real_t diagonal = quad[1].distance_squared_to(quad[3]);
+			if (diagonal <= MAX(quad[0].distance_squared_to(quad[1]), quad[0].distance_squared_to(quad[3])) ||
+					diagonal <= MAX(quad[2].distance_squared_to(quad[1]), quad[2].distance_squared_to(quad[3]))) {
+				continue;
+			}
+
+			candidate.score = face_angle + shape_error;
+			candidates.write[candidate_count++] = candidate;
+		}
+	}
+
+	// can't pair half of the triangles anyway, Loop works better for mostly triangle meshes
+	if (candidate_count * 4 < triangle_count) {
+		return TopologyDataMesh::TopologyType::TRIANGLE;
+	}
+	candidates.resize(candidate_count);
+	candidates.sort();
+
+	PackedInt32Array triangle_candidate; // chosen candidate of every triangle
+	triangle_candidate.resize(triangle_count);
+	triangle_candidate.fill(-1);
+	int paired_count = 0;
+	for (int candidate_index = 0; candidate_index < candidate_count; candidate_index++) {
+		const QuadCandidate &candidate = candidates[candidate_index];
+		if (triangle_candidate[candidate.triangle_a] != -1 || triangle_candidate[candidate.triangle_b] != -1) {
+			continue;
+		}
+		triangle_candidate.set(candidate.triangle_a, candidate_index);
+		triangle_candidate.set(candidate.triangle_b, candidate_index);
+		paired_count += 2;
+	}
+
+	if (paired_count * 2 < triangle_count) {
+		return TopologyDataMesh::TopologyType::TRIANGLE;
+	}
+	const bool mixed = paired_count != triangle_count;
+
+	// emit faces in order of their first triangle to keep some of the original locality
+	const int unpaired_count = triangle_count - paired_count;
+	const int face_count = paired_count / 2 + unpaired_count;
+	const int face_corner_count = paired_count * 2 + unpaired_count * 3;
+	PackedInt32Array quad_index_array;
+	PackedVector2Array quad_uv_array;
+	quad_index_array.resize(face_corner_count);
+	if (has_uv) {
+		quad_uv_array.resize(face_corner_count);
+	}
+	r_face_vertex_count_array.clear();
+	if (mixed) {
+		r_face_vertex_count_array.resize(face_count);
+	}
+	int face_corner = 0;
+	int face_index = 0;
+	for (int triangle = 0; triangle < triangle_count; triangle++) {
+		int corners[4];
+		int face_vertex_count;
+		if (triangle_candidate[triangle] == -1) { // leftover triangle, stays as it is
+			face_vertex_count = 3;
+			for (int i = 0; i < 3; i++) {
+				corners[i] = triangle * 3 + i;
+			}
+		} else {
+			const QuadCandidate &candidate = candidates[triangle_candidate[triangle]];
+			if (MIN(candidate.triangle_a, candidate.triangle_b) != triangle) {
+				continue;
+			}
+			face_vertex_count = 4;
+			for (int i = 0; i < 4; i++) {
+				corners[i] = candidate.corners[i];
+			}
+		}
+
+		for (int i = 0; i < face_vertex_count; i++) {
+			quad_index_array.set(face_corner, indices[corners[i]]);
+			if (has_uv) {
+				quad_uv_array.set(face_corner, uv_array[corners[i]]);
+			}
+			face_corner++;
+		}
+		if (mixed) {
+			r_face_vertex_count_array.set(face_index, face_vertex_count);
+		}
+		face_index++;
+	}
+
+	index_array = quad_index_array;
+	uv_array = quad_uv_array;
+	return mixed ? TopologyDataMesh::TopologyType::MIXED : TopologyDataMesh::TopologyType::QUAD;
 }
 
 // tries to store uv's as compact as possible with an index array, an additional index array
 // is needed for uv data, because the index array for the vertices connects faces while uv's
-// can still be different for faces even when it's the same vertex, works similar to _remove_duplicate_vertices
-PackedInt32Array TopologyDataImporter::_generate_uv_index_array(PackedVector2Array &uv_array) {
+// can still be different for faces even when it's the same vertex. Corners get bucketed by cage vertex
+// (counting sort), so every corner only gets compared against the few other corners of its vertex.
+static const double UV_QUANTIZATION_SCALE = 1 << 20; // uv's closer than ~1e-6 count as equal
+
+PackedInt32Array TopologyDataImporter::_generate_uv_index_array(const PackedInt32Array &index_array, int vertex_count, PackedVector2Array &uv_array) {
 	ERR_FAIL_COND_V(uv_array.is_empty(), PackedInt32Array());
-	int max_index = 0;
-	HashMap<Vector2, int> found_uvs;
+	ERR_FAIL_COND_V(uv_array.size() != index_array.size(), PackedInt32Array());
+	const int corner_count = index_array.size();
+	const int32_t *indices = index_array.ptr();
+	const Vector2 *uvs = uv_array.ptr();
+
+	// corner lists per cage vertex, corners stay in ascending order inside each bucket
+	LocalVector<int> bucket_offsets;
+	bucket_offsets.resize(vertex_count + 1);
+	memset(bucket_offsets.ptr(), 0, sizeof(int) * (vertex_count + 1));
+	for (int corner = 0; corner < corner_count; corner++) {
+		ERR_FAIL_INDEX_V(indices[corner], vertex_count, PackedInt32Array());
+		bucket_offsets[indices[corner] + 1]++;
+	}
+	for (int vertex_index = 0; vertex_index < vertex_count; vertex_index++) {
+		bucket_offsets[vertex_index + 1] += bucket_offsets[vertex_index];
+	}
+	LocalVector<int> bucket_corners;
+	bucket_corners.resize(corner_count);
+	{
+		LocalVector<int> bucket_fill = bucket_offsets;
+		for (int corner = 0; corner < corner_count; corner++) {
+			bucket_corners[bucket_fill[indices[corner]]++] = corner;
+		}
+	}
+
+	LocalVector<int64_t> uv_keys;
+	uv_keys.resize(corner_count * 2);
+	int64_t *keys = uv_keys.ptr();
+	parallel_for(corner_count, [&](int p_begin, int p_end) {
+		for (int corner = p_begin; corner < p_end; corner++) {
+			keys[corner * 2] = (int64_t)Math::round(uvs[corner].x * UV_QUANTIZATION_SCALE);
+			keys[corner * 2 + 1] = (int64_t)Math::round(uvs[corner].y * UV_QUANTIZATION_SCALE);
+		}
+	});
+
+	// first earlier corner of the same vertex with the same uv, or the corner itself
+	LocalVector<int> representative;
+	representative.resize(corner_count);
+	int *representative_ptr = representative.ptr();
+	const int *offsets = bucket_offsets.ptr();
+	const int *buckets = bucket_corners.ptr();
+	parallel_for(corner_count, [&](int p_begin, int p_end) {
+		for (int corner = p_begin; corner < p_end; corner++) {
+			representative_ptr[corner] = corner;
+			const int vertex_index = indices[corner];
+			for (int bucket_index = offsets[vertex_index]; bucket_index < offsets[vertex_index + 1]; bucket_index++) {
+				const int other = buckets[bucket_index];
+				if (other >= corner) {
+					break;
+				}
+				if (keys[other * 2] == keys[corner * 2] && keys[other * 2 + 1] == keys[corner * 2 + 1]) {
+					representative_ptr[corner] = other;
+					break;
+				}
+			}
+		}
+	});
+
+	// numbering in order of first appearance, representatives always come before the corners pointing to them
 	PackedInt32Array uv_index_array;
+	uv_index_array.resize(corner_count);
+	int32_t *uv_indices = uv_index_array.ptrw();
 	PackedVector2Array packed_uv_array; // will overwrite the given uv_array before returning
-	for (int uv_index = 0; uv_index < uv_array.size(); uv_index++) {
-		Vector2 single_uv = uv_array[uv_index];
-		if (found_uvs.has(single_uv)) {
-			uv_index_array.append(found_uvs.get(single_uv));
+	packed_uv_array.resize(corner_count);
+	Vector2 *packed_uvs = packed_uv_array.ptrw();
+	int max_index = 0;
+	for (int corner = 0; corner < corner_count; corner++) {
+		if (representative_ptr[corner] == corner) {
+			packed_uvs[max_index] = uvs[corner];
+			uv_indices[corner] = max_index++;
 		} else {
-			packed_uv_array.append(single_uv);
-			uv_index_array.append(max_index);
-			found_uvs.insert(single_uv, max_index);
-			max_index++;
+			uv_indices[corner] = uv_indices[representative_ptr[corner]];
 		}
 	}
+	packed_uv_array.resize(max_index);
 	uv_array = packed_uv_array;
 	return uv_index_array;
 }
 
-//same as remove duplicate vertices, just runs for every blend shape
-Array TopologyDataImporter::_generate_packed_blend_shapes(const Array &tri_blend_shapes, const PackedInt32Array &mesh_index_array,
+//same gather as remove duplicate vertices, just runs for every blend shape
+Array TopologyDataImporter::_generate_packed_blend_shapes(const Array &tri_blend_shapes, const PackedInt32Array &source_indices,
 		const PackedVector3Array &mesh_vertex_array) {
-	int max_index = 0;
-	HashMap<Vector3, int> original_verts;
+	const int blend_shape_count = tri_blend_shapes.size();
+	const int vertex_count = source_indices.size();
+	Vector<PackedVector3Array> tri_blend_vertex_arrays; //keeps source data alive while reading through raw pointers
 	Vector<PackedVector3Array> packed_vertex_arrays;
-	packed_vertex_arrays.resize(tri_blend_shapes.size());
-	for (int vert_index = 0; vert_index < mesh_index_array.size(); vert_index++) {
-		int index = mesh_index_array[vert_index];
-		if (!original_verts.has(mesh_vertex_array[index])) {
-			original_verts.insert(mesh_vertex_array[index], max_index);
-			for (int blend_shape_idx = 0; blend_shape_idx < tri_blend_shapes.size(); blend_shape_idx++) { //TODO: possibly add normal and tangent here as well
-				const Array &single_blend_shape_array = tri_blend_shapes[blend_shape_idx];
-				const PackedVector3Array &tri_blend_vertex_array = single_blend_shape_array[Mesh::ARRAY_VERTEX];
-				packed_vertex_arrays.write[blend_shape_idx].append(tri_blend_vertex_array[index] - mesh_vertex_array[index]);
+	LocalVector<const Vector3 *> src_blend_vertices;
+	LocalVector<Vector3 *> dst_blend_vertices;
+	tri_blend_vertex_arrays.resize(blend_shape_count);
+	packed_vertex_arrays.resize(blend_shape_count);
+	src_blend_vertices.resize(blend_shape_count);
+	dst_blend_vertices.resize(blend_shape_count);
+	for (int blend_shape_idx = 0; blend_shape_idx < blend_shape_count; blend_shape_idx++) { //TODO: possibly add normal and tangent here as well
+		const Array &single_blend_shape_array = tri_blend_shapes[blend_shape_idx];
+		tri_blend_vertex_arrays.write[blend_shape_idx] = single_blend_shape_array[Mesh::ARRAY_VERTEX];
+		ERR_FAIL_COND_V(tri_blend_vertex_arrays[blend_shape_idx].size() != mesh_vertex_array.size(), Array());
+		packed_vertex_arrays.write[blend_shape_idx].resize(vertex_count);
+		src_blend_vertices[blend_shape_idx] = tri_blend_vertex_arrays[blend_shape_idx].ptr();
+		dst_blend_vertices[blend_shape_idx] = packed_vertex_arrays.write[blend_shape_idx].ptrw();
+	}
+
+	// each chunk walks one blend shape at a time, so reads and writes stay sequential per shape
+	const int32_t *source = source_indices.ptr();
+	const Vector3 *mesh_vertices = mesh_vertex_array.ptr();
+	parallel_for(vertex_count, [&](int p_begin, int p_end) {
+		for (int blend_shape_idx = 0; blend_shape_idx < blend_shape_count; blend_shape_idx++) {
+			const Vector3 *src = src_blend_vertices[blend_shape_idx];
+			Vector3 *dst = dst_blend_vertices[blend_shape_idx];
+			for (int vertex_index = p_begin; vertex_index < p_end; vertex_index++) {
+				int index = source[vertex_index];
+				dst[vertex_index] = src[index] - mesh_vertices[index];
 			}
-			max_index++;
 		}
-	}
+	});
 
 	Array packed_blend_shape_array;
-	packed_blend_shape_array.resize(tri_blend_shapes.size());
-	for (int blend_shape_idx = 0; blend_shape_idx < tri_blend_shapes.size(); blend_shape_idx++) {
+	packed_blend_shape_array.resize(blend_shape_count);
+	for (int blend_shape_idx = 0; blend_shape_idx < blend_shape_count; blend_shape_idx++) {
 		Array single_blend_shape_array;
 		single_blend_shape_array.resize(TopologyDataMesh::ARRAY_MAX);
 		single_blend_shape_array[TopologyDataMesh::ARRAY_VERTEX] = packed_vertex_arrays.get(blend_shape_idx);
@@ -1,17 +1,31 @@
 #pragma once
 
+#include "godot_cpp/classes/animation_player.hpp"
 #include "godot_cpp/classes/global_constants.hpp"
+#include "godot_cpp/classes/importer_mesh.hpp"
+#include "godot_cpp/classes/importer_mesh_instance3d.hpp"
 #include "godot_cpp/classes/mesh.hpp"
 #include "godot_cpp/templates/hash_map.hpp"
+#include "godot_cpp/templates/hash_set.hpp"
 #include "godot_cpp/templates/vector.hpp"
 
+#include "resources/baked_subdiv_mesh.hpp"
 #include "resources/topology_data_mesh.hpp"
+#include "subdivision/subdivider.hpp"
 
 using namespace godot;
 
 class TopologyDataImporter : public Object {
 	GDCLASS(TopologyDataImporter, Object);
 
+public:
+	enum ImportMode {
+		SUBDIV_MESHINSTANCE = 0,
+		BAKED_SUBDIV_MESH = 1,
+		ARRAY_MESH = 2,
+		IMPORTER_MESH = 3
+	};
+
 private:
 	/**
 	 * @brief Struct used to simplfiy working with arrays of TopologyDataMesh
@@ -24,6 +38,8 @@ private:
 		godot::PackedInt32Array index_array;
 		godot::PackedInt32Array bones_array;
 		godot::PackedFloat32Array weights_array;
+		godot::PackedInt32Array vertex_remap; //welded index of every source vertex (old -> new), -1 if unreferenced
+		godot::PackedInt32Array source_indices; //source vertex of every welded vertex (new -> old)
 	};
 
 	/**
@@ -41,12 +57,108 @@ private:
 		SurfaceVertexArrays(){};
 	};
 
+	/**
+	 * @brief Input and result of converting a single surface. Filled on the main thread, converted on worker threads
+	 *
+	 */
+	struct SurfaceConversion {
+		int mesh_index = 0; //index in the MeshConversion list
+		int surface_index = 0; //surface index in ImporterMesh
+		Array arrays; //triangle arrays of ImporterMesh, index array gets generated if missing
+		Array blend_shape_arrays;
+		int32_t format = 0;
+
+		Array surface_arrays; //result topology arrays
+		Array topology_blend_shape_arrays;
+		TopologyDataMesh::TopologyType topology_type = TopologyDataMesh::TopologyType::TRIANGLE;
+	};
+
+	/**
+	 * @brief A single ImporterMeshInstance3D that gets converted
+	 *
+	 */
+	struct MeshConversion {
+		ImporterMeshInstance3D *importer_mesh_instance = nullptr;
+		Ref<ImporterMesh> importer_mesh;
+		bool needs_topology_data = true; //false if subdiv level 0 doesn't need a TopologyDataMesh
+		Ref<TopologyDataMesh> topology_data_mesh;
+		Ref<ImporterMesh> baked_mesh; //only for import modes that bake at import
+		Ref<BakedSubdivMesh> baked_subdiv_mesh; //only for BAKED_SUBDIV_MESH
+		bool baked_from_cache = false; //baked_mesh or baked_subdiv_mesh got loaded from the import cache
+		int first_surface = 0; //range in the SurfaceConversion list
+		int surface_count = 0;
+		bool needs_conversion = false; //false if topology data or baked mesh came from the import cache
+		String cache_key; //hash of source arrays, empty if cache not used
+	};
+
+	/**
+	 * @brief Max distance between two vertices that still get welded, 0 means only exact positions are welded
+	 * like before weld_tolerance existed
+	 *
+	 */
+	float weld_tolerance = 0.0;
+
+	/**
+	 * @brief Converts surfaces one after another and frees intermediate buffers as early as possible,
+	 * buffers aren't reserved up front. Peak memory then depends on the largest surface instead of
+	 * the whole scene, a single surface still needs its conversion buffers (weld remap, quad candidates) at once.
+	 *
+	 */
+	bool streaming_import = false;
+
+	/**
+	 * @brief Precompute stencils and refined topology for subdiv_level and store them in the TopologyDataMesh,
+	 * SubdivMeshInstance3D and BakedSubdivMesh then skip refinement when loading. Only used by the runtime import modes.
+	 *
+	 */
+	bool store_refinement_data = false;
+
+	/**
+	 * @brief Save the generated TopologyDataMesh resources quantized, see TopologyDataMesh::set_quantized_storage.
+	 * Only used by the runtime import modes.
+	 *
+	 */
+	bool quantize_storage = false;
+
+	/**
+	 * @brief Save the baked surfaces of BakedSubdivMesh with the scene, see BakedSubdivMesh::set_store_bake.
+	 * Only used by the BAKED_SUBDIV_MESH import mode.
+	 *
+	 */
+	bool store_baked_mesh = false;
+
+	/**
+	 * @brief Interpolate the normals of the source mesh instead of calculating smooth normals from the subdivided faces,
+	 * see Subdivider::set_use_cage_normals. Only used by the baked import modes.
+	 *
+	 */
+	bool use_cage_normals = false;
+
+	/**
+	 * @brief How tangents of the baked meshes get generated, see Subdivider::set_tangent_mode.
+	 * Only used by the baked import modes.
+	 *
+	 */
+	Subdivider::TangentMode tangent_mode = Subdivider::TANGENT_MODE_MIKKTSPACE;
+
+	/**
+	 * @brief Reuse converted TopologyDataMesh and baked meshes of byte identical source meshes
+	 *
+	 */
+	bool use_import_cache = true;
+	String import_cache_path = "res://.godot/godot_subdiv/import_cache";
+	/**
+	 * @brief Once the cache folder is larger than this (in MiB), the oldest files get removed after an import
+	 *
+	 */
+	int import_cache_max_size = 1024;
+
 	/**
 	 * @brief Find and remove vertices in vertex_array at same position. This edits the other arrays accordingly and then
 	 * returns the TopologyDataArrays (which means faces are connected and not just floating triangles)
 	 *
 	 * @details This can lead to data loss / wrong results if two verticse that weren't connected before triangulating
-	 * are at the same position.
+	 * are at the same position. Vertices closer than weld_tolerance count as the same position.
 	 *
 	 *
 	 * @param surface
@@ -55,43 +167,180 @@ private:
 	 */
 	TopologyDataImporter::TopologySurfaceData _remove_duplicate_vertices(const SurfaceVertexArrays &surface, int32_t format);
 	/**
-	 * @brief Uses the mesh_vertex_array to merge blendshape arrays the exact same way
+	 * @brief Welds the vertices referenced by index_array, every source vertex only gets looked up once
+	 *
+	 * @details Vertices get welded to the first referenced vertex within weld_tolerance. Building the cell map and
+	 * searching it run in parallel, the result is the same for any amount of threads.
+	 *
+	 * @param vertex_array source vertices
+	 * @param index_array source index array
+	 * @param r_source_indices receives the first source vertex of every welded vertex (new -> old)
+	 * @return PackedInt32Array welded index for every source vertex (old -> new), -1 if the vertex isn't referenced
+	 */
+	PackedInt32Array _generate_weld_remap(const PackedVector3Array &vertex_array, const PackedInt32Array &index_array,
+			PackedInt32Array &r_source_indices) const;
+	/**
+	 * @brief Gathers blend shape offsets of every welded vertex, uses the source indices from _remove_duplicate_vertices
+	 * so blend shapes get merged the exact same way as the mesh
 	 *
 	 * @param tri_blend_shapes
-	 * @param mesh_index_array
-	 * @param mesh_vertex_array
+	 * @param source_indices source vertex of every welded vertex (new -> old)
+	 * @param mesh_vertex_array source vertices
 	 * @return Array
 	 */
 	Array _generate_packed_blend_shapes(const Array &tri_blend_shapes,
-			const PackedInt32Array &mesh_index_array, const PackedVector3Array &mesh_vertex_array);
+			const PackedInt32Array &source_indices, const PackedVector3Array &mesh_vertex_array);
 
 	/**
-	 * @brief
+	 * @brief Merges pairs of triangles to quads. Tries consecutive triangles first (how most exporters write quads)
+	 * and falls back to _merge_to_quads_by_adjacency if that fails.
 	 *
 	 * @param index_array Topology Index Array after removing duplicate vertices
 	 * @param uv_array Array of original UV's. UV's are in most cases different and part of the reason why
 	 * the Triangles even got split up at export even when they are at the same position
+	 * @param vertex_array Topology vertices, used for the planarity and shape checks of the adjacency pass
 	 * @param format
-	 * @return true The mesh is a QuadMesh
-	 * @return false The mesh is not a QuadMesh and didn't merge faces -> fallback to TriangleMesh
+	 * @param r_face_vertex_count_array receives the vertex count of every face if the result is MIXED
+	 * @return TopologyDataMesh::TopologyType QUAD if every triangle was merged, MIXED if most were merged
+	 * (arrays then contain quads and the leftover triangles), TRIANGLE if arrays are unchanged
 	 */
-	bool _merge_to_quads(PackedInt32Array &index_array, PackedVector2Array &uv_array, int32_t format);
+	TopologyDataMesh::TopologyType _merge_to_quads(PackedInt32Array &index_array, PackedVector2Array &uv_array, const PackedVector3Array &vertex_array,
+			int32_t format, PackedInt32Array &r_face_vertex_count_array);
 	/**
-	 * @brief Generates minimal needed UV index array (as vertex index array would cause data to be lost)
+	 * @brief Pairs triangles across shared edges independent of their order in index_array.
 	 *
+	 * @details Candidate pairs need consistent winding, a convex quad, a face angle below MAX_QUAD_FACE_ANGLE,
+	 * corner angles within MAX_QUAD_SHAPE_ANGLE of 90 degrees and the shared edge has to be the longest edge of
+	 * both triangles. Candidates are then picked greedily, flattest and
+	 * most rectangular first. Triangles without partner stay triangles if at least half of all triangles got paired.
+	 *
+	 * @param index_array
 	 * @param uv_array
+	 * @param vertex_array
+	 * @param format
+	 * @param r_face_vertex_count_array
+	 * @return TopologyDataMesh::TopologyType same as _merge_to_quads
+	 */
+	TopologyDataMesh::TopologyType _merge_to_quads_by_adjacency(PackedInt32Array &index_array, PackedVector2Array &uv_array, const PackedVector3Array &vertex_array,
+			int32_t format, PackedInt32Array &r_face_vertex_count_array);
+	/**
+	 * @brief Generates minimal needed UV index array (as vertex index array would cause data to be lost)
+	 *
+	 * @details Only corners of the same cage vertex get checked for equal UV's, sharing a value anywhere else
+	 * doesn't matter to OpenSubdiv and would just connect unrelated UV islands.
+	 *
+	 * @param index_array topology index array, uv_array has one entry per index
+	 * @param vertex_count amount of topology vertices
+	 * @param uv_array per corner uv's, gets replaced with the deduplicated uv's
 	 * @return PackedInt32Array
 	 */
-	PackedInt32Array _generate_uv_index_array(PackedVector2Array &uv_array);
+	PackedInt32Array _generate_uv_index_array(const PackedInt32Array &index_array, int vertex_count, PackedVector2Array &uv_array);
 	/**
 	 * @brief Goes through all of the above methods (remove_duplicate, merge_to_quads) and saves the result in surface_arrays
 	 *
 	 * @param surface Surfaces of triangulated Mesh
 	 * @param format
 	 * @param surface_arrays Free Array where the result can be stored
+	 * @param r_source_indices receives the source vertex of every topology vertex, used to remap other per vertex data
 	 * @return TopologyDataMesh::TopologyType
 	 */
-	TopologyDataMesh::TopologyType _generate_topology_surface_arrays(const SurfaceVertexArrays &surface, int32_t format, Array &surface_arrays);
+	TopologyDataMesh::TopologyType _generate_topology_surface_arrays(const SurfaceVertexArrays &surface, int32_t format, Array &surface_arrays,
+			PackedInt32Array &r_source_indices);
+
+	/**
+	 * @brief Converts all given ImporterMeshInstance3D's, surfaces and bakes run in parallel on the WorkerThreadPool
+	 *
+	 * @param importer_mesh_instances
+	 * @param import_mode
+	 * @param subdiv_level
+	 */
+	void _convert_importer_mesh_instances(const Vector<ImporterMeshInstance3D *> &importer_mesh_instances, ImportMode import_mode, int32_t subdiv_level);
+	/**
+	 * @brief Reads surface arrays of the mesh into SurfaceConversions, has to run on the main thread.
+	 * Streaming import only keeps the surface indices and format, arrays get fetched right before converting.
+	 *
+	 * @param mesh_index
+	 * @param importer_mesh
+	 * @param r_surfaces
+	 */
+	void _prepare_surface_conversions(int mesh_index, const Ref<ImporterMesh> &importer_mesh, Vector<SurfaceConversion> &r_surfaces) const;
+	/**
+	 * @brief Reads the surface and blend shape arrays of surface from importer_mesh, surface arrays only if not already read
+	 *
+	 * @param importer_mesh
+	 * @param surface
+	 */
+	void _fetch_surface_arrays(const Ref<ImporterMesh> &importer_mesh, SurfaceConversion &surface) const;
+	/**
+	 * @brief Adds the converted surface to the TopologyDataMesh of mesh, needs to run on the main thread
+	 *
+	 * @param mesh
+	 * @param surface
+	 */
+	void _add_converted_surface(MeshConversion &mesh, const SurfaceConversion &surface);
+	/**
+	 * @brief Generates topology and blend shape arrays of a single surface, safe to call from worker threads
+	 *
+	 * @param surface
+	 */
+	void _convert_surface(SurfaceConversion &surface);
+	/**
+	 * @brief Hashes everything the conversion to TopologyDataMesh depends on (surface arrays, blend shapes, names, weld tolerance)
+	 *
+	 * @param mesh
+	 * @param surfaces first surface of the mesh
+	 * @return String hex encoded SHA-256
+	 */
+	String _generate_cache_key(const MeshConversion &mesh, const SurfaceConversion *surfaces) const;
+	String _get_topology_cache_file(const String &cache_key) const;
+	String _get_baked_cache_file(const String &cache_key, ImportMode import_mode, int32_t subdiv_level) const;
+	/**
+	 * @brief Removes files of older cache versions and the oldest files once the folder exceeds import_cache_max_size.
+	 * Files of p_used_keys stay, they might still be read by the current import.
+	 *
+	 * @param p_used_keys cache keys of the current import
+	 */
+	void _prune_import_cache(const HashSet<String> &p_used_keys) const;
+	/**
+	 * @brief Loads cached results into mesh, sets needs_conversion if nothing usable was cached
+	 *
+	 * @param mesh
+	 * @param import_mode
+	 * @param subdiv_level
+	 */
+	void _load_cached_mesh(MeshConversion &mesh, ImportMode import_mode, int32_t subdiv_level) const;
+	/**
+	 * @brief Stores converted and baked results without materials, materials always come from the current import
+	 *
+	 * @param mesh
+	 * @param import_mode
+	 * @param subdiv_level
+	 */
+	void _save_cached_mesh(const MeshConversion &mesh, ImportMode import_mode, int32_t subdiv_level) const;
+	/**
+	 * @brief Applies materials of the source ImporterMesh to cached resources
+	 *
+	 * @param mesh
+	 * @param surfaces first surface of the mesh
+	 */
+	void _apply_source_materials(MeshConversion &mesh, const SurfaceConversion *surfaces) const;
+
+	/**
+	 * @brief Replaces the ImporterMeshInstance3D based on import mode, needs to run on the main thread
+	 *
+	 * @param mesh
+	 * @param import_mode
+	 * @param subdiv_level
+	 */
+	void _apply_mesh_conversion(const MeshConversion &mesh, ImportMode import_mode, int32_t subdiv_level);
+	/**
+	 * @brief Collects all ImporterMeshInstance3D and AnimationPlayer nodes below p_node
+	 *
+	 * @param p_node
+	 * @param r_importer_mesh_instances
+	 * @param r_animation_players
+	 */
+	void _collect_scene_nodes(Node *p_node, Vector<ImporterMeshInstance3D *> &r_importer_mesh_instances, Vector<AnimationPlayer *> &r_animation_players) const;
 
 	/**
 	 * @brief Checks what arrays are not null and generates a format based on that
@@ -113,13 +362,6 @@ protected:
 	static void _bind_methods();
 
 public:
-	enum ImportMode {
-		SUBDIV_MESHINSTANCE = 0,
-		BAKED_SUBDIV_MESH = 1,
-		ARRAY_MESH = 2,
-		IMPORTER_MESH = 3
-	};
-
 	/**
 	 * @brief Replaces the ImporterMeshInstance3D with a SubdivMeshInstance3D
 	 *
@@ -128,6 +370,44 @@ public:
 	 * @param subdiv_level
 	 */
 	void convert_importer_meshinstance_to_subdiv(Object *p_meshinstance, ImportMode import_mode, int32_t subdiv_level);
+
+	/**
+	 * @brief Replaces all ImporterMeshInstance3D's below p_root, surfaces of all meshes get converted in parallel.
+	 * For SUBDIV_MESHINSTANCE blend shape tracks of all AnimationPlayers get converted as well.
+	 *
+	 * @param p_root scene root
+	 * @param import_mode
+	 * @param subdiv_level
+	 */
+	void convert_scene(Object *p_root, ImportMode import_mode, int32_t subdiv_level);
+
+	/**
+	 * @brief Replaces blend shape tracks with value tracks, SubdivMeshInstance3D only exposes blend shapes as properties
+	 *
+	 * @param p_animation_player
+	 */
+	void convert_animation_blend_shape_tracks(Object *p_animation_player);
+
+	void set_weld_tolerance(float p_tolerance);
+	float get_weld_tolerance() const;
+	void set_streaming_import(bool p_streaming_import);
+	bool get_streaming_import() const;
+	void set_store_refinement_data(bool p_store_refinement_data);
+	bool get_store_refinement_data() const;
+	void set_quantize_storage(bool p_quantize_storage);
+	bool get_quantize_storage() const;
+	void set_store_baked_mesh(bool p_store_baked_mesh);
+	bool get_store_baked_mesh() const;
+	void set_use_cage_normals(bool p_use_cage_normals);
+	bool get_use_cage_normals() const;
+	void set_tangent_mode(Subdivider::TangentMode p_tangent_mode);
+	Subdivider::TangentMode get_tangent_mode() const;
+	void set_use_import_cache(bool p_use_import_cache);
+	bool get_use_import_cache() const;
+	void set_import_cache_path(const String &p_path);
+	String get_import_cache_path() const;
+	void set_import_cache_max_size(int p_max_size);
+	int get_import_cache_max_size() const;
 };
 
 VARIANT_ENUM_CAST(TopologyDataImporter::ImportMode);
\ No newline at end of file
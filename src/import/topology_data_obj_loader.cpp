@@ -0,0 +1,399 @@
+#include "topology_data_obj_loader.hpp"
+
+#include "godot_cpp/variant/utility_functions.hpp"
+
+//bytes read from the file at once, lines crossing block borders get carried over
+static const int READ_BLOCK_SIZE = 1 << 20;
+
+void TopologyDataObjLoader::_bind_methods() {
+}
+
+static _FORCE_INLINE_ bool _is_space(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static _FORCE_INLINE_ const char *_skip_spaces(const char *p_ptr, const char *p_end) {
+	while (p_ptr < p_end && _is_space(*p_ptr)) {
+		p_ptr++;
+	}
+	return p_ptr;
+}
+
+static bool _parse_int(const char *&r_ptr, const char *p_end, int64_t &r_value) {
+	bool negative = false;
+	if (r_ptr < p_end && (*r_ptr == '-' || *r_ptr == '+')) {
+		negative = *r_ptr == '-';
+		r_ptr++;
+	}
+	const char *start = r_ptr;
+	int64_t value = 0;
+	while (r_ptr < p_end && *r_ptr >= '0' && *r_ptr <= '9') {
+		value = value * 10 + (*r_ptr - '0');
+		r_ptr++;
+	}
+	r_value = negative ? -value : value;
+	return r_ptr != start;
+}
+
+// simple decimal parser, obj files only use plain and exponent notation
+static bool _parse_real(const char *&r_ptr, const char *p_end, real_t &r_value) {
+	r_ptr = _skip_spaces(r_ptr, p_end);
+	bool negative = false;
+	if (r_ptr < p_end && (*r_ptr == '-' || *r_ptr == '+')) {
+		negative = *r_ptr == '-';
+		r_ptr++;
+	}
+	const char *start = r_ptr;
+	double value = 0.0;
+	while (r_ptr < p_end && *r_ptr >= '0' && *r_ptr <= '9') {
+		value = value * 10.0 + (*r_ptr - '0');
+		r_ptr++;
+	}
+	if (r_ptr < p_end && *r_ptr == '.') {
+		r_ptr++;
+		double scale = 0.1;
+		while (r_ptr < p_end && *r_ptr >= '0' && *r_ptr <= '9') {
+			value += (*r_ptr - '0') * scale;
+			scale *= 0.1;
+			r_ptr++;
+		}
+	}
+	if (r_ptr == start) {
+		return false;
+	}
+	if (r_ptr < p_end && (*r_ptr == 'e' || *r_ptr == 'E')) {
+		r_ptr++;
+		int64_t exponent = 0;
+		if (!_parse_int(r_ptr, p_end, exponent)) {
+			return false;
+		}
+		value *= Math::pow(10.0, (double)exponent);
+	}
+	r_value = negative ? -value : value;
+	return true;
+}
+
+// obj indices start at 1, negative ones are relative to the end
+static bool _resolve_index(int64_t p_obj_index, int p_count, int32_t &r_index) {
+	int64_t index = p_obj_index > 0 ? p_obj_index - 1 : p_count + p_obj_index;
+	if (p_obj_index == 0 || index < 0 || index >= p_count) {
+		return false;
+	}
+	r_index = (int32_t)index;
+	return true;
+}
+
+Error TopologyDataObjLoader::_parse_line(const char *p_line, const char *p_line_end, LocalVector<Vector3> &r_vertices, LocalVector<Vector2> &r_uvs,
+		LocalVector<Vector3> &r_normals, LocalVector<ObjSurface> &r_surfaces) const {
+	const char *ptr = _skip_spaces(p_line, p_line_end);
+	const char *keyword = ptr;
+	while (ptr < p_line_end && !_is_space(*ptr)) {
+		ptr++;
+	}
+	const int keyword_length = ptr - keyword;
+	if (keyword_length == 0 || keyword[0] == '#') {
+		return OK;
+	}
+
+	if (keyword_length == 1 && keyword[0] == 'v') {
+		Vector3 vertex;
+		if (!_parse_real(ptr, p_line_end, vertex.x) || !_parse_real(ptr, p_line_end, vertex.y) || !_parse_real(ptr, p_line_end, vertex.z)) {
+			return ERR_PARSE_ERROR;
+		}
+		r_vertices.push_back(vertex);
+	} else if (keyword_length == 2 && keyword[0] == 'v' && keyword[1] == 't') {
+		Vector2 uv;
+		if (!_parse_real(ptr, p_line_end, uv.x)) {
+			return ERR_PARSE_ERROR;
+		}
+		//v is optional and defaults to 0
+		if (_skip_spaces(ptr, p_line_end) < p_line_end && !_parse_real(ptr, p_line_end, uv.y)) {
+			return ERR_PARSE_ERROR;
+		}
+		uv.y = 1.0 - uv.y; //obj uv origin is bottom left
+		r_uvs.push_back(uv);
+	} else if (keyword_length == 2 && keyword[0] == 'v' && keyword[1] == 'n') {
+		Vector3 normal;
+		if (!_parse_real(ptr, p_line_end, normal.x) || !_parse_real(ptr, p_line_end, normal.y) || !_parse_real(ptr, p_line_end, normal.z)) {
+			return ERR_PARSE_ERROR;
+		}
+		r_normals.push_back(normal.normalized());
+	} else if (keyword_length == 1 && keyword[0] == 'f') {
+		ObjSurface &surface = r_surfaces[r_surfaces.size() - 1];
+		int face_vertex_count = 0;
+		while (true) {
+			ptr = _skip_spaces(ptr, p_line_end);
+			if (ptr >= p_line_end) {
+				break;
+			}
+			// v, v/vt, v//vn or v/vt/vn
+			int64_t obj_index = 0;
+			int32_t vertex_index = 0;
+			int32_t uv_index = -1;
+			int32_t normal_index = -1;
+			if (!_parse_int(ptr, p_line_end, obj_index) || !_resolve_index(obj_index, r_vertices.size(), vertex_index)) {
+				return ERR_PARSE_ERROR;
+			}
+			if (ptr < p_line_end && *ptr == '/') {
+				ptr++;
+				if (ptr < p_line_end && *ptr != '/') {
+					if (!_parse_int(ptr, p_line_end, obj_index) || !_resolve_index(obj_index, r_uvs.size(), uv_index)) {
+						return ERR_PARSE_ERROR;
+					}
+				}
+				if (ptr < p_line_end && *ptr == '/') {
+					ptr++;
+					if (!_parse_int(ptr, p_line_end, obj_index) || !_resolve_index(obj_index, r_normals.size(), normal_index)) {
+						return ERR_PARSE_ERROR;
+					}
+				}
+			}
+			surface.vertex_indices.push_back(vertex_index);
+			surface.uv_indices.push_back(uv_index);
+			surface.normal_indices.push_back(normal_index);
+			surface.has_uv = surface.has_uv && uv_index != -1;
+			surface.has_normal = surface.has_normal && normal_index != -1;
+			face_vertex_count++;
+		}
+		if (face_vertex_count < 3) { //points and lines can't be subdivided
+			surface.vertex_indices.resize(surface.vertex_indices.size() - face_vertex_count);
+			surface.uv_indices.resize(surface.uv_indices.size() - face_vertex_count);
+			surface.normal_indices.resize(surface.normal_indices.size() - face_vertex_count);
+		} else {
+			surface.face_vertex_counts.push_back(face_vertex_count);
+		}
+	} else if (keyword_length == 1 && (keyword[0] == 'g' || keyword[0] == 'o')) {
+		ptr = _skip_spaces(ptr, p_line_end);
+		const char *name_end = p_line_end;
+		while (name_end > ptr && _is_space(*(name_end - 1))) {
+			name_end--;
+		}
+		String name = String::utf8(ptr, name_end - ptr);
+		// a group without faces just gets renamed, happens for o directly followed by g
+		if (r_surfaces[r_surfaces.size() - 1].face_vertex_counts.is_empty()) {
+			r_surfaces[r_surfaces.size() - 1].name = name;
+		} else {
+			ObjSurface surface;
+			surface.name = name;
+			r_surfaces.push_back(surface);
+		}
+	}
+	return OK;
+}
+
+void TopologyDataObjLoader::_add_surface(const ObjSurface &p_surface, const LocalVector<Vector3> &p_vertices, const LocalVector<Vector2> &p_uvs,
+		const LocalVector<Vector3> &p_normals, LocalVector<int32_t> &r_vertex_remap, LocalVector<int32_t> &r_uv_remap,
+		const Ref<TopologyDataMesh> &p_mesh) const {
+	const int corner_count = p_surface.vertex_indices.size();
+	if (corner_count == 0) {
+		return;
+	}
+	const bool has_uv = p_surface.has_uv;
+	const bool has_normal = p_surface.has_normal;
+
+	PackedVector3Array vertex_array;
+	PackedVector3Array normal_array;
+	PackedVector2Array uv_array;
+	PackedInt32Array index_array;
+	PackedInt32Array uv_index_array;
+	PackedInt32Array face_vertex_count_array;
+	index_array.resize(corner_count);
+	if (has_uv) {
+		uv_index_array.resize(corner_count);
+	}
+	int32_t *indices = index_array.ptrw();
+	int32_t *uv_indices = has_uv ? uv_index_array.ptrw() : nullptr;
+	LocalVector<int32_t> used_vertices;
+	LocalVector<int32_t> used_vertex_normals; //normal of the first corner of every used vertex
+	LocalVector<int32_t> used_uvs;
+
+	bool all_triangles = true;
+	bool all_quads = true;
+	int face_start = 0;
+	for (const int32_t face_vertex_count : p_surface.face_vertex_counts) {
+		all_triangles = all_triangles && face_vertex_count == 3;
+		all_quads = all_quads && face_vertex_count == 4;
+		for (int face_corner = 0; face_corner < face_vertex_count; face_corner++) {
+			// obj faces are counter clockwise, reversing keeps the first corner in place
+			const int source_corner = face_start + (face_corner == 0 ? 0 : face_vertex_count - face_corner);
+			const int target_corner = face_start + face_corner;
+
+			const int32_t vertex_index = p_surface.vertex_indices[source_corner];
+			if (r_vertex_remap[vertex_index] == -1) {
+				r_vertex_remap[vertex_index] = used_vertices.size();
+				used_vertices.push_back(vertex_index);
+				if (has_normal) {
+					used_vertex_normals.push_back(p_surface.normal_indices[source_corner]);
+				}
+			}
+			indices[target_corner] = r_vertex_remap[vertex_index];
+
+			if (has_uv) {
+				const int32_t uv_index = p_surface.uv_indices[source_corner];
+				if (r_uv_remap[uv_index] == -1) {
+					r_uv_remap[uv_index] = used_uvs.size();
+					used_uvs.push_back(uv_index);
+				}
+				uv_indices[target_corner] = r_uv_remap[uv_index];
+			}
+		}
+		face_start += face_vertex_count;
+	}
+
+	vertex_array.resize(used_vertices.size());
+	Vector3 *vertices = vertex_array.ptrw();
+	for (uint32_t vertex_index = 0; vertex_index < used_vertices.size(); vertex_index++) {
+		vertices[vertex_index] = p_vertices[used_vertices[vertex_index]];
+		r_vertex_remap[used_vertices[vertex_index]] = -1;
+	}
+	if (has_normal) {
+		normal_array.resize(used_vertex_normals.size());
+		Vector3 *normals = normal_array.ptrw();
+		for (uint32_t vertex_index = 0; vertex_index < used_vertex_normals.size(); vertex_index++) {
+			normals[vertex_index] = p_normals[used_vertex_normals[vertex_index]];
+		}
+	}
+	uv_array.resize(used_uvs.size());
+	Vector2 *uvs = uv_array.ptrw();
+	for (uint32_t uv_index = 0; uv_index < used_uvs.size(); uv_index++) {
+		uvs[uv_index] = p_uvs[used_uvs[uv_index]];
+		r_uv_remap[used_uvs[uv_index]] = -1;
+	}
+
+	TopologyDataMesh::TopologyType topology_type = TopologyDataMesh::TopologyType::MIXED;
+	if (all_triangles) {
+		topology_type = TopologyDataMesh::TopologyType::TRIANGLE;
+	} else if (all_quads) {
+		topology_type = TopologyDataMesh::TopologyType::QUAD;
+	} else {
+		face_vertex_count_array.resize(p_surface.face_vertex_counts.size());
+		memcpy(face_vertex_count_array.ptrw(), p_surface.face_vertex_counts.ptr(), sizeof(int32_t) * p_surface.face_vertex_counts.size());
+	}
+
+	Array surface_arrays;
+	surface_arrays.resize(TopologyDataMesh::ARRAY_MAX);
+	surface_arrays[TopologyDataMesh::ARRAY_VERTEX] = vertex_array;
+	surface_arrays[TopologyDataMesh::ARRAY_NORMAL] = normal_array;
+	surface_arrays[TopologyDataMesh::ARRAY_BONES] = PackedInt32Array();
+	surface_arrays[TopologyDataMesh::ARRAY_WEIGHTS] = PackedFloat32Array();
+	surface_arrays[TopologyDataMesh::ARRAY_INDEX] = index_array;
+	surface_arrays[TopologyDataMesh::ARRAY_TEX_UV] = uv_array;
+	surface_arrays[TopologyDataMesh::ARRAY_UV_INDEX] = uv_index_array;
+	surface_arrays[TopologyDataMesh::ARRAY_FACE_VERTEX_COUNT] = face_vertex_count_array;
+
+	int32_t format = Mesh::ARRAY_FORMAT_VERTEX | Mesh::ARRAY_FORMAT_INDEX;
+	if (has_uv) {
+		format |= Mesh::ARRAY_FORMAT_TEX_UV;
+	}
+	if (has_normal) {
+		format |= Mesh::ARRAY_FORMAT_NORMAL;
+	}
+	p_mesh->add_surface(surface_arrays, Dictionary(), Array(), Ref<Material>(), p_surface.name, format, topology_type);
+}
+
+Ref<TopologyDataMesh> TopologyDataObjLoader::load_obj(const String &p_path, Error &r_error) const {
+	Ref<FileAccess> file = FileAccess::open(p_path, FileAccess::READ);
+	r_error = FileAccess::get_open_error();
+	ERR_FAIL_COND_V_MSG(file.is_null(), Ref<TopologyDataMesh>(), "Couldn't open " + p_path);
+
+	LocalVector<Vector3> vertices;
+	LocalVector<Vector2> uvs;
+	LocalVector<Vector3> normals;
+	LocalVector<ObjSurface> surfaces;
+	surfaces.push_back(ObjSurface());
+
+	LocalVector<char> pending_line; //line that continues in the next block
+	int line_number = 1;
+	auto parse_line = [&](const char *p_line, const char *p_line_end) {
+		r_error = _parse_line(p_line, p_line_end, vertices, uvs, normals, surfaces);
+		if (r_error != OK) {
+			ERR_PRINT(vformat("%s:%d: Couldn't parse line.", p_path, line_number));
+		}
+		line_number++;
+		return r_error == OK;
+	};
+
+	uint64_t remaining = file->get_length();
+	while (remaining > 0) {
+		PackedByteArray block = file->get_buffer(MIN(remaining, (uint64_t)READ_BLOCK_SIZE));
+		if (block.is_empty()) {
+			break;
+		}
+		remaining -= block.size();
+		const char *data = (const char *)block.ptr();
+		const int block_size = block.size();
+		int line_start = 0;
+		for (int i = 0; i < block_size; i++) {
+			if (data[i] != '\n') {
+				continue;
+			}
+			bool parsed;
+			if (pending_line.is_empty()) {
+				parsed = parse_line(data + line_start, data + i);
+			} else {
+				for (int j = line_start; j < i; j++) {
+					pending_line.push_back(data[j]);
+				}
+				parsed = parse_line(pending_line.ptr(), pending_line.ptr() + pending_line.size());
+				pending_line.clear();
+			}
+			if (!parsed) {
+				return Ref<TopologyDataMesh>();
+			}
+			line_start = i + 1;
+		}
+		for (int j = line_start; j < block_size; j++) {
+			pending_line.push_back(data[j]);
+		}
+	}
+	if (!pending_line.is_empty() && !parse_line(pending_line.ptr(), pending_line.ptr() + pending_line.size())) {
+		return Ref<TopologyDataMesh>();
+	}
+
+	Ref<TopologyDataMesh> topology_data_mesh;
+	topology_data_mesh.instantiate();
+	topology_data_mesh->set_name(p_path.get_file().get_basename());
+	LocalVector<int32_t> vertex_remap;
+	LocalVector<int32_t> uv_remap;
+	vertex_remap.resize(vertices.size());
+	uv_remap.resize(uvs.size());
+	for (int32_t &index : vertex_remap) {
+		index = -1;
+	}
+	for (int32_t &index : uv_remap) {
+		index = -1;
+	}
+	for (const ObjSurface &surface : surfaces) {
+		_add_surface(surface, vertices, uvs, normals, vertex_remap, uv_remap, topology_data_mesh);
+	}
+
+	r_error = topology_data_mesh->get_surface_count() > 0 ? OK : ERR_FILE_CORRUPT;
+	ERR_FAIL_COND_V_MSG(r_error != OK, Ref<TopologyDataMesh>(), "No faces found in " + p_path);
+	return topology_data_mesh;
+}
+
+PackedStringArray TopologyDataObjLoader::_get_recognized_extensions() const {
+	PackedStringArray extensions;
+	extensions.push_back("obj");
+	return extensions;
+}
+
+bool TopologyDataObjLoader::_handles_type(const StringName &p_type) const {
+	return p_type == StringName("TopologyDataMesh");
+}
+
+String TopologyDataObjLoader::_get_resource_type(const String &p_path) const {
+	if (p_path.get_extension().to_lower() == "obj") {
+		return "TopologyDataMesh";
+	}
+	return "";
+}
+
+Variant TopologyDataObjLoader::_load(const String &p_path, const String &p_original_path, bool p_use_sub_threads, int32_t p_cache_mode) const {
+	Error err;
+	Ref<TopologyDataMesh> topology_data_mesh = load_obj(p_path, err);
+	if (err != OK) {
+		return err;
+	}
+	return topology_data_mesh;
+}
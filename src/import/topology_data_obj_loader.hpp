@@ -0,0 +1,75 @@
+#pragma once
+
+#include "godot_cpp/classes/file_access.hpp"
+#include "godot_cpp/classes/resource_format_loader.hpp"
+#include "godot_cpp/templates/local_vector.hpp"
+
+#include "resources/topology_data_mesh.hpp"
+
+using namespace godot;
+
+/**
+ * @brief Loads .obj files directly as TopologyDataMesh. Faces stay exactly like in the file (quads, n-gons),
+ * so no duplicate removal or quad merging is needed. Every group/object becomes a surface.
+ *
+ * @details Only used for .obj files that don't get imported (Import As: Keep File) or files outside of res://.
+ * Normals are stored per vertex like the importer does (first face corner of a vertex wins), materials are ignored.
+ */
+class TopologyDataObjLoader : public ResourceFormatLoader {
+	GDCLASS(TopologyDataObjLoader, ResourceFormatLoader);
+
+private:
+	/**
+	 * @brief Faces of a single group, indices are still global obj indices
+	 *
+	 */
+	struct ObjSurface {
+		String name;
+		LocalVector<int32_t> vertex_indices; //per face corner
+		LocalVector<int32_t> uv_indices; //per face corner, -1 if the corner has no uv
+		LocalVector<int32_t> normal_indices; //per face corner, -1 if the corner has no normal
+		LocalVector<int32_t> face_vertex_counts;
+		bool has_uv = true; //false as soon as one corner has no uv
+		bool has_normal = true; //false as soon as one corner has no normal
+	};
+
+	/**
+	 * @brief Parses a single line, p_line is not null terminated
+	 *
+	 * @return Error ERR_PARSE_ERROR on broken face indices
+	 */
+	Error _parse_line(const char *p_line, const char *p_line_end, LocalVector<Vector3> &r_vertices, LocalVector<Vector2> &r_uvs,
+			LocalVector<Vector3> &r_normals, LocalVector<ObjSurface> &r_surfaces) const;
+	/**
+	 * @brief Compacts vertices and uv's of one group, reverses winding (obj is counter clockwise) and adds it to p_mesh
+	 *
+	 * @param p_surface
+	 * @param p_vertices all vertices of the file
+	 * @param p_uvs all uv's of the file
+	 * @param p_normals all normals of the file
+	 * @param r_vertex_remap global -> local vertex index, needs to be all -1 and gets reset before returning
+	 * @param r_uv_remap global -> local uv index, needs to be all -1 and gets reset before returning
+	 * @param p_mesh
+	 */
+	void _add_surface(const ObjSurface &p_surface, const LocalVector<Vector3> &p_vertices, const LocalVector<Vector2> &p_uvs,
+			const LocalVector<Vector3> &p_normals, LocalVector<int32_t> &r_vertex_remap, LocalVector<int32_t> &r_uv_remap,
+			const Ref<TopologyDataMesh> &p_mesh) const;
+
+protected:
+	static void _bind_methods();
+
+public:
+	/**
+	 * @brief Reads the obj file in blocks and builds a TopologyDataMesh
+	 *
+	 * @param p_path
+	 * @param r_error
+	 * @return Ref<TopologyDataMesh> null on error
+	 */
+	Ref<TopologyDataMesh> load_obj(const String &p_path, Error &r_error) const;
+
+	virtual PackedStringArray _get_recognized_extensions() const override;
+	virtual bool _handles_type(const StringName &p_type) const override;
+	virtual String _get_resource_type(const String &p_path) const override;
+	virtual Variant _load(const String &p_path, const String &p_original_path, bool p_use_sub_threads, int32_t p_cache_mode) const override;
+};
@@ -288,8 +288,10 @@ void SubdivMeshInstance3D::_update_skinning() {
 //calls subdiv mesh function to rerun subdivision with custom vertex array
 void SubdivMeshInstance3D::_update_subdiv_mesh_vertices(int p_surface, const PackedVector3Array &vertex_array) {
 	ERR_FAIL_COND(vertex_array.size() != get_mesh()->surface_get_length(p_surface));
-	const PackedInt32Array &index_array = get_mesh()->surface_get_arrays(p_surface)[TopologyDataMesh::ARRAY_INDEX];
-	subdiv_mesh->update_subdivision_vertices(p_surface, vertex_array, index_array, mesh->surface_get_topology_type(p_surface));
+	const Array &surface_arrays = get_mesh()->surface_get_arrays(p_surface);
+	const PackedInt32Array &index_array = surface_arrays[TopologyDataMesh::ARRAY_INDEX];
+	const PackedInt32Array &face_vertex_count_array = surface_arrays[TopologyDataMesh::ARRAY_FACE_VERTEX_COUNT];
+	subdiv_mesh->update_subdivision_vertices(p_surface, vertex_array, index_array, face_vertex_count_array, mesh->surface_get_topology_type(p_surface));
 }
 
 void SubdivMeshInstance3D::_resolve_skeleton_path() {
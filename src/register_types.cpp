@@ -3,21 +3,27 @@
 #include "gdextension_interface.h"
 
 #include "godot_cpp/classes/engine.hpp"
+#include "godot_cpp/classes/resource_loader.hpp"
+#include "godot_cpp/classes/resource_saver.hpp"
 #include "godot_cpp/core/class_db.hpp"
 #include "godot_cpp/core/defs.hpp"
 #include "godot_cpp/godot.hpp"
 
 #include "import/topology_data_importer.hpp"
+#include "import/topology_data_obj_loader.hpp"
 #include "nodes/subdiv_mesh_instance_3d.hpp"
 #include "resources/baked_subdiv_mesh.hpp"
 #include "resources/topology_data_mesh.hpp"
+#include "resources/topology_data_mesh_format.hpp"
 #include "subdivision/subdivision_baker.hpp"
 #include "subdivision/subdivision_mesh.hpp"
 #include "subdivision/subdivision_server.hpp"
 
+#include "subdivision/mixed_subdivider.hpp"
 #include "subdivision/quad_subdivider.hpp"
 #include "subdivision/subdivider.hpp"
 #include "subdivision/triangle_subdivider.hpp"
+#include "utility/mapped_file.hpp"
 #ifdef TESTS_ENABLED
 #include "subdiv_test.hpp"
 #endif
@@ -25,12 +31,16 @@
 using namespace godot;
 
 static SubdivisionServer *_subdivision_server;
+static Ref<TopologyDataObjLoader> _topology_data_obj_loader;
+static Ref<TopologyDataMeshFormatLoader> _topology_data_mesh_format_loader;
+static Ref<TopologyDataMeshFormatSaver> _topology_data_mesh_format_saver;
 
 void gdextension_initialize(ModuleInitializationLevel p_level) {
 	if (p_level == MODULE_INITIALIZATION_LEVEL_SCENE) {
 		ClassDB::register_class<Subdivider>();
 		ClassDB::register_class<QuadSubdivider>();
 		ClassDB::register_class<TriangleSubdivider>();
+		ClassDB::register_class<MixedSubdivider>();
 
 		ClassDB::register_class<SubdivisionServer>();
 		ClassDB::register_class<SubdivisionMesh>();
@@ -39,13 +49,24 @@ void gdextension_initialize(ModuleInitializationLevel p_level) {
 		ClassDB::register_class<SubdivMeshInstance3D>();
 
 		ClassDB::register_class<TopologyDataImporter>();
+		ClassDB::register_class<TopologyDataObjLoader>();
 
 		ClassDB::register_class<TopologyDataMesh>();
 		ClassDB::register_class<BakedSubdivMesh>();
+		ClassDB::register_class<TopologyDataMeshFormatLoader>();
+		ClassDB::register_class<TopologyDataMeshFormatSaver>();
+		ClassDB::register_class<MappedFile>();
 
 		_subdivision_server = memnew(SubdivisionServer);
 		Engine::get_singleton()->register_singleton("SubdivisionServer", _subdivision_server);
 
+		_topology_data_obj_loader.instantiate();
+		ResourceLoader::get_singleton()->add_resource_format_loader(_topology_data_obj_loader);
+		_topology_data_mesh_format_loader.instantiate();
+		ResourceLoader::get_singleton()->add_resource_format_loader(_topology_data_mesh_format_loader);
+		_topology_data_mesh_format_saver.instantiate();
+		ResourceSaver::get_singleton()->add_resource_format_saver(_topology_data_mesh_format_saver);
+
 #ifdef TESTS_ENABLED
 		ClassDB::register_class<SubdivTest>();
 		Ref<SubdivTest> subdiv_test = memnew(SubdivTest);
@@ -58,6 +79,13 @@ void gdextension_terminate(ModuleInitializationLevel p_level) {
 	if (p_level == MODULE_INITIALIZATION_LEVEL_SCENE) {
 		Engine::get_singleton()->unregister_singleton("SubdivisionServer");
 		memdelete(_subdivision_server);
+
+		ResourceLoader::get_singleton()->remove_resource_format_loader(_topology_data_obj_loader);
+		_topology_data_obj_loader.unref();
+		ResourceLoader::get_singleton()->remove_resource_format_loader(_topology_data_mesh_format_loader);
+		_topology_data_mesh_format_loader.unref();
+		ResourceSaver::get_singleton()->remove_resource_format_saver(_topology_data_mesh_format_saver);
+		_topology_data_mesh_format_saver.unref();
 	}
 }
 
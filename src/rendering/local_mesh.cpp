@@ -14,9 +14,24 @@
 
 #include "godot_cpp/classes/mesh.hpp"
 
+#if !defined(REAL_T_IS_DOUBLE) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+#include <xmmintrin.h>
+#define LOCAL_MESH_USE_SSE 1
+#else
+#define LOCAL_MESH_USE_SSE 0
+#endif
+
 void LocalMesh::clear_surfaces() {
 	RenderingServer::get_singleton()->mesh_clear(local_mesh);
 	mesh_surface_offsets.clear();
+	vertex_strides.clear();
+	vertex_buffers.clear();
+	vertex_counts.clear();
+	surface_aabbs.clear();
+	if (uses_custom_aabb) {
+		RenderingServer::get_singleton()->mesh_set_custom_aabb(local_mesh, AABB());
+		uses_custom_aabb = false;
+	}
 	num_surfaces = 0;
 }
 
@@ -39,69 +54,236 @@ void LocalMesh::add_surface(const Array &p_arrays, const Dictionary &p_lods, con
 	mesh_surface_offsets.append(offsets);
 
 	vertex_strides.append(rendering_server->mesh_surface_get_format_vertex_stride(p_format, vertex_array.size()));
+	//read back once, later updates work on this copy instead of fetching the whole surface every time
+	vertex_buffers.append(rendering_server->mesh_get_surface(local_mesh, num_surfaces)["vertex_data"]);
+	vertex_counts.append(vertex_array.size());
+	surface_aabbs.append(AABB());
+	_update_surface_aabb(num_surfaces, vertex_array);
 	num_surfaces++;
+	if (uses_custom_aabb) {
+		_update_mesh_aabb();
+	}
 }
 
-void LocalMesh::update_surface_vertices(int surface_idx, const Array &p_arrays) {
-	ERR_FAIL_COND(p_arrays.size() != Mesh::ARRAY_MAX);
-	ERR_FAIL_INDEX(surface_idx, num_surfaces);
+AABB LocalMesh::_compute_aabb(const Vector3 *p_vertices, int p_count) {
+	if (p_count <= 0) {
+		return AABB();
+	}
+	real_t min_x = p_vertices[0].x;
+	real_t min_y = p_vertices[0].y;
+	real_t min_z = p_vertices[0].z;
+	real_t max_x = min_x;
+	real_t max_y = min_y;
+	real_t max_z = min_z;
+	int vertex_index = 0;
+#if LOCAL_MESH_USE_SSE
+	//4 vertices are 3 registers, lanes are x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3
+	const int block_count = p_count / 4;
+	if (block_count > 0) {
+		const float *data = &p_vertices[0].x;
+		__m128 min_0 = _mm_loadu_ps(data);
+		__m128 min_1 = _mm_loadu_ps(data + 4);
+		__m128 min_2 = _mm_loadu_ps(data + 8);
+		__m128 max_0 = min_0;
+		__m128 max_1 = min_1;
+		__m128 max_2 = min_2;
+		for (int block = 1; block < block_count; block++) {
+			const float *block_data = data + block * 12;
+			const __m128 vertices_0 = _mm_loadu_ps(block_data);
+			const __m128 vertices_1 = _mm_loadu_ps(block_data + 4);
+			const __m128 vertices_2 = _mm_loadu_ps(block_data + 8);
+			min_0 = _mm_min_ps(min_0, vertices_0);
+			min_1 = _mm_min_ps(min_1, vertices_1);
+			min_2 = _mm_min_ps(min_2, vertices_2);
+			max_0 = _mm_max_ps(max_0, vertices_0);
+			max_1 = _mm_max_ps(max_1, vertices_1);
+			max_2 = _mm_max_ps(max_2, vertices_2);
+		}
+		float lane_min[12];
+		float lane_max[12];
+		_mm_storeu_ps(lane_min, min_0);
+		_mm_storeu_ps(lane_min + 4, min_1);
+		_mm_storeu_ps(lane_min + 8, min_2);
+		_mm_storeu_ps(lane_max, max_0);
+		_mm_storeu_ps(lane_max + 4, max_1);
+		_mm_storeu_ps(lane_max + 8, max_2);
+		for (int lane = 0; lane < 12; lane += 3) {
+			min_x = MIN(min_x, lane_min[lane]);
+			min_y = MIN(min_y, lane_min[lane + 1]);
+			min_z = MIN(min_z, lane_min[lane + 2]);
+			max_x = MAX(max_x, lane_max[lane]);
+			max_y = MAX(max_y, lane_max[lane + 1]);
+			max_z = MAX(max_z, lane_max[lane + 2]);
+		}
+		vertex_index = block_count * 4;
+	}
+#endif
+	for (; vertex_index < p_count; vertex_index++) {
+		const Vector3 &vertex = p_vertices[vertex_index];
+		min_x = MIN(min_x, vertex.x);
+		min_y = MIN(min_y, vertex.y);
+		min_z = MIN(min_z, vertex.z);
+		max_x = MAX(max_x, vertex.x);
+		max_y = MAX(max_y, vertex.y);
+		max_z = MAX(max_z, vertex.z);
+	}
+	return AABB(Vector3(min_x, min_y, min_z), Vector3(max_x - min_x, max_y - min_y, max_z - min_z));
+}
 
-	// update vertices
-	//Vector<uint8_t> vertex_data; // Vertex, Normal, Tangent (change with skinning, blendshape).
-	PackedByteArray vertex_buffer = RenderingServer::get_singleton()->mesh_get_surface(local_mesh, surface_idx)["vertex_data"];
-	uint8_t *vertex_write_buffer = vertex_buffer.ptrw();
+void LocalMesh::_update_surface_aabb(int p_surface_idx, const PackedVector3Array &p_vertex_array) {
+	surface_aabbs.write[p_surface_idx] = _compute_aabb(p_vertex_array.ptr(), p_vertex_array.size());
+}
 
-	uint32_t vertex_stride = vertex_strides.get(surface_idx); //vector3 size
+void LocalMesh::_update_mesh_aabb() {
+	AABB mesh_aabb;
+	for (int surface_idx = 0; surface_idx < num_surfaces; surface_idx++) {
+		mesh_aabb = surface_idx == 0 ? surface_aabbs[surface_idx] : mesh_aabb.merge(surface_aabbs[surface_idx]);
+	}
+	RenderingServer::get_singleton()->mesh_set_custom_aabb(local_mesh, mesh_aabb);
+	uses_custom_aabb = true;
+}
 
-	const PackedVector3Array &vertex_array = p_arrays[Mesh::ARRAY_VERTEX];
-	const PackedVector3Array &normal_array = p_arrays[Mesh::ARRAY_NORMAL];
-	const PackedFloat32Array &tangent_array = p_arrays[Mesh::ARRAY_TANGENT];
+AABB LocalMesh::surface_get_aabb(int surface_idx) const {
+	ERR_FAIL_INDEX_V(surface_idx, num_surfaces, AABB());
+	return surface_aabbs[surface_idx];
+}
 
-	bool has_normals = p_arrays[Mesh::ARRAY_NORMAL] && normal_array.size() > 0;
-	bool has_tangents = p_arrays[Mesh::ARRAY_TANGENT] && tangent_array.size() > 0;
+uint32_t LocalMesh::_encode_normal(const Vector3 &p_normal) {
+	//normal and tangent get compressed here, code taken from Sprite3D implementation
+	Vector2 res = p_normal.octahedron_encode();
+	uint32_t value = 0;
+	value |= (uint16_t)CLAMP(res.x * 65535, 0, 65535);
+	value |= (uint16_t)CLAMP(res.y * 65535, 0, 65535) << 16;
+	return value;
+}
 
-	const Vector<uint32_t> &vertex_stride_offsets = mesh_surface_offsets[surface_idx];
+uint32_t LocalMesh::_encode_tangent(const Plane &p_tangent) {
+	Vector2 res = p_tangent.normal.octahedron_tangent_encode(p_tangent.d);
+	uint32_t value = 0;
+	value |= (uint16_t)CLAMP(res.x * 65535, 0, 65535);
+	value |= (uint16_t)CLAMP(res.y * 65535, 0, 65535) << 16;
+	return value;
+}
 
-	//actually update
-	for (int vertex_index = 0; vertex_index < vertex_array.size(); vertex_index++) {
-		//normal and tangent get compressed here, code taken from Sprite3D implementation
-		// uv's and positions/vertex do not get compressed.
-		memcpy(&vertex_write_buffer[vertex_index * vertex_stride + vertex_stride_offsets[Mesh::ARRAY_VERTEX]], &vertex_array[vertex_index], sizeof(float) * 3);
-		if (has_normals) {
-			Vector3 normal = normal_array[vertex_index];
+void LocalMesh::_upload_vertex_range(int p_surface_idx, int p_begin, int p_end) {
+	const uint32_t vertex_stride = vertex_strides[p_surface_idx];
+	const PackedByteArray &vertex_buffer = vertex_buffers[p_surface_idx];
+	if (p_begin == 0 && p_end == vertex_counts[p_surface_idx]) {
+		RenderingServer::get_singleton()->mesh_surface_update_vertex_region(local_mesh, p_surface_idx, 0, vertex_buffer);
+		return;
+	}
+	RenderingServer::get_singleton()->mesh_surface_update_vertex_region(local_mesh, p_surface_idx, p_begin * vertex_stride,
+			vertex_buffer.slice(p_begin * vertex_stride, p_end * vertex_stride));
+}
 
-			uint32_t v_normal;
-			{ //code to compress normal
-				Vector2 res = normal.octahedron_encode();
-				uint32_t value = 0;
-				value |= (uint16_t)CLAMP(res.x * 65535, 0, 65535);
-				value |= (uint16_t)CLAMP(res.y * 65535, 0, 65535) << 16;
+bool LocalMesh::write_vertex_channels(PackedByteArray &r_vertex_buffer, uint32_t p_vertex_stride, const Vector<uint32_t> &p_offsets,
+		const PackedVector3Array &p_vertex_array, const PackedVector3Array &p_normal_array, const PackedFloat32Array &p_tangent_array,
+		int p_vertex_count, Vector<Vector2i> &r_dirty_ranges) {
+	r_dirty_ranges.clear();
+	ERR_FAIL_COND_V(p_offsets.size() < Mesh::ARRAY_MAX, false);
+	ERR_FAIL_COND_V(r_vertex_buffer.size() < int64_t(p_vertex_count) * p_vertex_stride, false);
+	const bool has_vertices = !p_vertex_array.is_empty();
+	const bool has_normals = !p_normal_array.is_empty();
+	const bool has_tangents = !p_tangent_array.is_empty();
+	ERR_FAIL_COND_V(has_vertices && p_vertex_array.size() < p_vertex_count, false);
+	ERR_FAIL_COND_V(has_normals && p_normal_array.size() < p_vertex_count, false);
+	ERR_FAIL_COND_V(has_tangents && p_tangent_array.size() < int64_t(p_vertex_count) * 4, false);
 
-				v_normal = value;
-			}
+	const uint32_t vertex_offset = p_offsets[Mesh::ARRAY_VERTEX];
+	const uint32_t normal_offset = p_offsets[Mesh::ARRAY_NORMAL];
+	const uint32_t tangent_offset = p_offsets[Mesh::ARRAY_TANGENT];
+	const Vector3 *vertex_ptr = p_vertex_array.ptr();
+	const Vector3 *normal_ptr = p_normal_array.ptr();
+	const float *tangent_ptr = p_tangent_array.ptr();
+	uint8_t *vertex_write_buffer = r_vertex_buffer.ptrw();
 
-			memcpy(&vertex_write_buffer[vertex_index * vertex_stride + vertex_stride_offsets[Mesh::ARRAY_NORMAL]], &v_normal, 4);
+	//channels get written separately, a vertex is dirty as soon as one of its written channels changed
+	bool positions_changed = false;
+	int range_begin = -1;
+	int range_end = -1;
+	for (int vertex_index = 0; vertex_index < p_vertex_count; vertex_index++) {
+		uint8_t *vertex_write_ptr = &vertex_write_buffer[vertex_index * p_vertex_stride];
+		bool dirty = false;
+		if (has_vertices) {
+			// uv's and positions/vertex do not get compressed.
+			const float position[3] = { float(vertex_ptr[vertex_index].x), float(vertex_ptr[vertex_index].y), float(vertex_ptr[vertex_index].z) };
+			if (memcmp(vertex_write_ptr + vertex_offset, position, sizeof(position)) != 0) {
+				memcpy(vertex_write_ptr + vertex_offset, position, sizeof(position));
+				dirty = true;
+				positions_changed = true;
+			}
+		}
+		if (has_normals) {
+			const uint32_t v_normal = _encode_normal(normal_ptr[vertex_index]);
+			if (memcmp(vertex_write_ptr + normal_offset, &v_normal, 4) != 0) {
+				memcpy(vertex_write_ptr + normal_offset, &v_normal, 4);
+				dirty = true;
+			}
 		}
-
 		if (has_tangents) {
-			int tangent_index = vertex_index * 4;
-			Plane tangent = tangent = Plane(tangent_array[tangent_index], tangent_array[tangent_index + 1], tangent_array[tangent_index + 2], tangent_array[tangent_index + 3]);
-			uint32_t v_tangent;
-			{ //code to compress tangent
-				Plane t = tangent;
-				Vector2 res = t.normal.octahedron_tangent_encode(t.d);
-				uint32_t value = 0;
-				value |= (uint16_t)CLAMP(res.x * 65535, 0, 65535);
-				value |= (uint16_t)CLAMP(res.y * 65535, 0, 65535) << 16;
-
-				v_tangent = value;
+			const float *tangent = &tangent_ptr[vertex_index * 4];
+			const uint32_t v_tangent = _encode_tangent(Plane(tangent[0], tangent[1], tangent[2], tangent[3]));
+			if (memcmp(vertex_write_ptr + tangent_offset, &v_tangent, 4) != 0) {
+				memcpy(vertex_write_ptr + tangent_offset, &v_tangent, 4);
+				dirty = true;
 			}
+		}
 
-			memcpy(&vertex_write_buffer[vertex_index * vertex_stride + vertex_stride_offsets[Mesh::ARRAY_TANGENT]], &v_tangent, 4);
+		if (!dirty) {
+			continue;
+		}
+		if (range_begin != -1 && vertex_index - range_end > DIRTY_RANGE_MERGE_GAP) {
+			r_dirty_ranges.push_back(Vector2i(range_begin, range_end));
+			range_begin = -1;
+		}
+		if (range_begin == -1) {
+			range_begin = vertex_index;
 		}
+		range_end = vertex_index + 1;
+	}
+	if (range_begin != -1) {
+		r_dirty_ranges.push_back(Vector2i(range_begin, range_end));
+	}
+	return positions_changed;
+}
+
+void LocalMesh::update_surface_vertices(int surface_idx, const Array &p_arrays) {
+	ERR_FAIL_COND(p_arrays.size() != Mesh::ARRAY_MAX);
+	ERR_FAIL_INDEX(surface_idx, num_surfaces);
+
+	const int vertex_count = vertex_counts[surface_idx];
+	const bool has_vertices = p_arrays[Mesh::ARRAY_VERTEX].get_type() == Variant::PACKED_VECTOR3_ARRAY;
+	const bool has_normals = p_arrays[Mesh::ARRAY_NORMAL].get_type() == Variant::PACKED_VECTOR3_ARRAY;
+	const bool has_tangents = p_arrays[Mesh::ARRAY_TANGENT].get_type() == Variant::PACKED_FLOAT32_ARRAY;
+	PackedVector3Array vertex_array;
+	PackedVector3Array normal_array;
+	PackedFloat32Array tangent_array;
+	if (has_vertices) {
+		vertex_array = p_arrays[Mesh::ARRAY_VERTEX];
 	}
+	if (has_normals) {
+		normal_array = p_arrays[Mesh::ARRAY_NORMAL];
+	}
+	if (has_tangents) {
+		tangent_array = p_arrays[Mesh::ARRAY_TANGENT];
+	}
+	ERR_FAIL_COND(has_vertices && vertex_array.size() != vertex_count);
+	ERR_FAIL_COND(has_normals && normal_array.size() != vertex_count);
+	ERR_FAIL_COND(has_tangents && tangent_array.size() != vertex_count * 4);
+	ERR_FAIL_COND(vertex_buffers[surface_idx].size() < int64_t(vertex_count) * vertex_strides[surface_idx]);
 
-	RenderingServer::get_singleton()->mesh_surface_update_vertex_region(local_mesh, surface_idx, 0, vertex_buffer);
+	Vector<Vector2i> dirty_ranges;
+	const bool positions_changed = write_vertex_channels(vertex_buffers.write[surface_idx], vertex_strides[surface_idx], mesh_surface_offsets[surface_idx],
+			vertex_array, normal_array, tangent_array, vertex_count, dirty_ranges);
+	for (const Vector2i &dirty_range : dirty_ranges) {
+		_upload_vertex_range(surface_idx, dirty_range.x, dirty_range.y);
+	}
+
+	//culling would otherwise still use the bounds of the undeformed mesh
+	if (positions_changed) {
+		_update_surface_aabb(surface_idx, vertex_array);
+		_update_mesh_aabb();
+	}
 }
 
 RID LocalMesh::get_rid() const {
@@ -113,6 +295,7 @@ void LocalMesh::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("add_surface", "p_arrays", "p_lods", "p_material", "p_name", "p_format"), &LocalMesh::add_surface);
 	ClassDB::bind_method(D_METHOD("update_surface_vertices", "surface_idx", "p_arrays"), &LocalMesh::update_surface_vertices);
 	ClassDB::bind_method(D_METHOD("get_rid"), &LocalMesh::get_rid);
+	ClassDB::bind_method(D_METHOD("surface_get_aabb", "surface_idx"), &LocalMesh::surface_get_aabb);
 }
 
 LocalMesh::LocalMesh() {
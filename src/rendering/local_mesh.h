@@ -8,6 +8,7 @@
 #include "godot_cpp/classes/ref_counted.hpp"
 #include "godot_cpp/templates/vector.hpp"
 #include "godot_cpp/variant/array.hpp"
+#include "godot_cpp/variant/builtin_types.hpp"
 
 using namespace godot;
 
@@ -31,12 +32,62 @@ class LocalMesh : public RefCounted {
 	 */
 	Vector<Vector<uint32_t>> mesh_surface_offsets;
 	Vector<uint32_t> vertex_strides;
+	/**
+	 * @brief CPU copy of the vertex buffer (vertex, normal, tangent) of every surface. Updates get written into it
+	 * and only the vertex ranges that actually changed get uploaded.
+	 *
+	 */
+	Vector<PackedByteArray> vertex_buffers;
+	Vector<int> vertex_counts;
+
+	/**
+	 * @brief Bounds of the current vertex positions per surface, the mesh AABB on the RenderingServer is the merge of them
+	 *
+	 */
+	Vector<AABB> surface_aabbs;
+	bool uses_custom_aabb = false;
+
+	/**
+	 * @brief Min/max over positions, 4 vertices at a time with SSE if available
+	 *
+	 */
+	static AABB _compute_aabb(const Vector3 *p_vertices, int p_count);
+	void _update_surface_aabb(int p_surface_idx, const PackedVector3Array &p_vertex_array);
+	void _update_mesh_aabb();
+
+	static uint32_t _encode_normal(const Vector3 &p_normal);
+	static uint32_t _encode_tangent(const Plane &p_tangent);
+	void _upload_vertex_range(int p_surface_idx, int p_begin, int p_end);
 
 protected:
 	static void
 	_bind_methods();
 
 public:
+	/**
+	 * @brief Dirty ranges closer than this amount of vertices get uploaded together, fewer but slightly larger uploads
+	 *
+	 */
+	static const int DIRTY_RANGE_MERGE_GAP = 64;
+
+	/**
+	 * @brief Writes vertex, normal and tangent into an interleaved vertex buffer and collects the vertex ranges whose bytes changed.
+	 * Channels with empty arrays don't get written, ranges less than DIRTY_RANGE_MERGE_GAP vertices apart get merged.
+	 *
+	 * @param r_vertex_buffer needs at least p_vertex_count * p_vertex_stride bytes
+	 * @param p_vertex_stride
+	 * @param p_offsets byte offsets inside a vertex indexed by Mesh::ArrayType
+	 * @param p_vertex_array
+	 * @param p_normal_array
+	 * @param p_tangent_array 4 floats per vertex
+	 * @param p_vertex_count
+	 * @param r_dirty_ranges x is the first, y one past the last dirty vertex of every range
+	 * @return bool true if a position changed
+	 */
+	static bool write_vertex_channels(PackedByteArray &r_vertex_buffer, uint32_t p_vertex_stride, const Vector<uint32_t> &p_offsets,
+			const PackedVector3Array &p_vertex_array, const PackedVector3Array &p_normal_array, const PackedFloat32Array &p_tangent_array,
+			int p_vertex_count, Vector<Vector2i> &r_dirty_ranges);
+
 	LocalMesh();
 	~LocalMesh();
 
@@ -55,13 +106,22 @@ public:
 			const String &p_name, int32_t p_format);
 
 	/**
-	 * @brief Update vertex, tangent and normal of a surface
+	 * @brief Update vertex, tangent and normal of a surface. Every channel is optional, channels that are null in p_arrays
+	 * keep their data. Only vertex ranges that changed get uploaded to the RenderingServer.
 	 *
 	 * @param surface_idx
-	 * @param p_arrays vertex, normal, tangent
+	 * @param p_arrays vertex, normal, tangent, each needs the vertex count of the surface if it's set
 	 */
 	void update_surface_vertices(int surface_idx, const Array &p_arrays);
 
+	/**
+	 * @brief Bounds of the surface after the last update, the mesh AABB used for culling gets updated with them
+	 *
+	 * @param surface_idx
+	 * @return AABB
+	 */
+	AABB surface_get_aabb(int surface_idx) const;
+
 	/**
 	 * @brief Clears mesh:
 	 *
@@ -1,11 +1,15 @@
 #include "baked_subdiv_mesh.hpp"
+#include "godot_cpp/classes/hashing_context.hpp"
 #include "godot_cpp/classes/rendering_server.hpp"
 #include "godot_cpp/classes/surface_tool.hpp"
+#include "godot_cpp/templates/local_vector.hpp"
 #include "godot_cpp/variant/utility_functions.hpp"
 #include "resources/topology_data_mesh.hpp"
+#include "resources/topology_data_quantization.hpp"
 #include "subdivision/subdivision_baker.hpp"
 #include "subdivision/subdivision_mesh.hpp"
 #include "subdivision/subdivision_server.hpp"
+#include "utility/parallel_for.hpp"
 
 void BakedSubdivMesh::set_data_mesh(Ref<TopologyDataMesh> p_data_mesh) {
 	data_mesh = p_data_mesh;
@@ -23,42 +27,282 @@ int BakedSubdivMesh::get_subdiv_level() const {
 	return subdiv_level;
 }
 
-void BakedSubdivMesh::_update_subdiv() {
-	if (data_mesh.is_valid()) {
-		Ref<SubdivisionBaker> baker;
-		baker.instantiate();
-		_clear();
-
-		//add blendshapes
-		if (data_mesh->get_blend_shape_count() != get_blend_shape_count()) {
-			clear_blend_shapes();
-			for (int blend_shape_idx = 0; blend_shape_idx < data_mesh->get_blend_shape_count(); blend_shape_idx++) {
-				add_blend_shape(data_mesh->get_blend_shape_name(blend_shape_idx));
+void BakedSubdivMesh::set_use_cage_normals(bool p_use_cage_normals) {
+	if (use_cage_normals == p_use_cage_normals) {
+		return;
+	}
+	use_cage_normals = p_use_cage_normals;
+	_update_subdiv();
+}
+
+bool BakedSubdivMesh::get_use_cage_normals() const {
+	return use_cage_normals;
+}
+
+void BakedSubdivMesh::set_tangent_mode(Subdivider::TangentMode p_tangent_mode) {
+	if (tangent_mode == p_tangent_mode) {
+		return;
+	}
+	tangent_mode = p_tangent_mode;
+	_update_subdiv();
+}
+
+Subdivider::TangentMode BakedSubdivMesh::get_tangent_mode() const {
+	return tangent_mode;
+}
+
+void BakedSubdivMesh::set_store_bake(bool p_store_bake) {
+	store_bake = p_store_bake;
+	if (!store_bake) {
+		bake_hash = String();
+	} else if (bake_hash.is_empty() && data_mesh.is_valid() && baked_data_mesh == data_mesh && !is_baking()) {
+		bake_hash = _generate_bake_hash(); //current surfaces are already baked from data_mesh, otherwise _finish_bake stamps it
+	}
+}
+
+bool BakedSubdivMesh::get_store_bake() const {
+	return store_bake;
+}
+
+void BakedSubdivMesh::_set_bake_hash(const String &p_bake_hash) {
+	bake_hash = p_bake_hash;
+}
+
+String BakedSubdivMesh::_get_bake_hash() const {
+	return bake_hash;
+}
+
+//bump whenever baking output changes, invalidates all stored bakes
+static const int BAKE_VERSION = 12;
+
+static void _hash_variant(const Ref<HashingContext> &p_hashing_context, const Variant &p_variant) {
+	p_hashing_context->update(UtilityFunctions::var_to_bytes(p_variant));
+}
+
+String BakedSubdivMesh::_generate_bake_hash() const {
+	Ref<HashingContext> hashing_context;
+	hashing_context.instantiate();
+	hashing_context->start(HashingContext::HASH_SHA256);
+	_hash_variant(hashing_context, BAKE_VERSION);
+	_hash_variant(hashing_context, subdiv_level);
+	_hash_variant(hashing_context, use_cage_normals);
+	_hash_variant(hashing_context, int64_t(tangent_mode));
+	for (int blend_shape_idx = 0; blend_shape_idx < data_mesh->get_blend_shape_count(); blend_shape_idx++) {
+		_hash_variant(hashing_context, data_mesh->get_blend_shape_name(blend_shape_idx));
+	}
+	//quantized storage changes the arrays on load, so the hash has to be of what gets loaded again
+	const bool quantized_storage = data_mesh->get_quantized_storage();
+	const AABB quantization_aabb = quantized_storage ? TopologyDataQuantization::get_mesh_aabb(data_mesh.ptr()) : AABB();
+	//materials are saved with the surfaces and not part of the hash
+	for (int surface_index = 0; surface_index < data_mesh->get_surface_count(); surface_index++) {
+		_hash_variant(hashing_context, data_mesh->surface_get_name(surface_index));
+		_hash_variant(hashing_context, int64_t(data_mesh->surface_get_format(surface_index)));
+		_hash_variant(hashing_context, data_mesh->surface_get_topology_type(surface_index));
+		Array arrays = data_mesh->surface_get_arrays(surface_index);
+		Array blend_shape_arrays = data_mesh->surface_get_blend_shape_arrays(surface_index);
+		if (quantized_storage) {
+			Dictionary quantization;
+			arrays = TopologyDataQuantization::dequantize_arrays(TopologyDataQuantization::quantize_arrays(arrays, quantization_aabb, quantization), quantization);
+			blend_shape_arrays = blend_shape_arrays.duplicate(false);
+			for (int blend_shape_idx = 0; blend_shape_idx < blend_shape_arrays.size(); blend_shape_idx++) {
+				blend_shape_arrays[blend_shape_idx] = TopologyDataQuantization::dequantize_blend_shape_arrays(
+						TopologyDataQuantization::quantize_blend_shape_arrays(blend_shape_arrays[blend_shape_idx]));
 			}
 		}
+		_hash_variant(hashing_context, arrays);
+		_hash_variant(hashing_context, blend_shape_arrays);
+	}
+	return hashing_context->finish().hex_encode();
+}
 
-		for (int surface_index = 0; surface_index < data_mesh->get_surface_count(); surface_index++) {
-			const Array &source_arrays = data_mesh->surface_get_arrays(surface_index);
-			int64_t p_format = data_mesh->surface_get_format(surface_index);
-			TopologyDataMesh::TopologyType topology_type = data_mesh->surface_get_topology_type(surface_index);
-			const Array &triangle_arrays = baker->get_baked_arrays(source_arrays,
-					subdiv_level, p_format, topology_type);
-
-			//bake blendshapes
-			TypedArray<Array> baked_blend_shape_arrays;
-			if (data_mesh->get_blend_shape_count() > 0) {
-				const Array &blend_shape_arrays = data_mesh->surface_get_blend_shape_arrays(surface_index);
-				baked_blend_shape_arrays = baker->get_baked_blend_shape_arrays(source_arrays, blend_shape_arrays,
-						subdiv_level, p_format, topology_type);
-			}
-			add_surface_from_arrays(Mesh::PRIMITIVE_TRIANGLES, triangle_arrays, baked_blend_shape_arrays, Dictionary(), 0);
-			surface_set_name(surface_index, data_mesh->surface_get_name(surface_index));
-			surface_set_material(surface_index, data_mesh->surface_get_material(surface_index));
+void BakedSubdivMesh::set_background_bake(bool p_background_bake) {
+	background_bake = p_background_bake;
+}
+
+bool BakedSubdivMesh::get_background_bake() const {
+	return background_bake;
+}
+
+void BakedSubdivMesh::_update_subdiv() {
+	use_stored_bake = false;
+	const uint64_t generation = ++bake_generation; //supersedes running bakes
+	if (data_mesh.is_null()) {
+		if (baked_data_mesh.is_valid()) {
+			_clear();
+			baked_data_mesh = Ref<TopologyDataMesh>();
+		}
+		emit_changed();
+		return;
+	}
+
+	const String hash = store_bake ? _generate_bake_hash() : String();
+	//store_bake and _bake_hash get loaded before data_mesh, the stored _surfaces come after it
+	if (store_bake && hash == bake_hash) {
+		use_stored_bake = get_surface_count() == 0;
+		baked_data_mesh = data_mesh;
+		return;
+	}
+
+	if (!background_bake) {
+		BakeSource source;
+		_gather_bake_source(subdiv_level, source);
+		Vector<BakedSurface> surfaces;
+		_bake_surfaces(source, surfaces, generation);
+		bake_hash = hash;
+		_apply_bake(data_mesh, source, surfaces);
+		return;
+	}
+
+	//new meshes show the cage until the bake is done, otherwise the last bake stays
+	bake_hash = String();
+	if (baked_data_mesh != data_mesh && subdiv_level > 0) {
+		BakeSource cage_source;
+		_gather_bake_source(0, cage_source);
+		Vector<BakedSurface> surfaces;
+		_bake_surfaces(cage_source, surfaces, generation);
+		_apply_bake(data_mesh, cage_source, surfaces);
+	}
+
+	BakeTask *task = memnew(BakeTask);
+	task->mesh = this;
+	task->generation = generation;
+	task->data_mesh = data_mesh;
+	_gather_bake_source(subdiv_level, task->source);
+	task->bake_hash = hash;
+	bake_tasks.insert(generation, task);
+	task->task_id = WorkerThreadPool::get_singleton()->add_native_task(&BakedSubdivMesh::_bake_task, task, false, "BakedSubdivMesh bake");
+}
+
+void BakedSubdivMesh::_gather_bake_source(int p_level, BakeSource &r_source) const {
+	r_source.subdiv_level = p_level;
+	r_source.use_cage_normals = use_cage_normals;
+	r_source.tangent_mode = tangent_mode;
+	r_source.blend_shape_names.clear();
+	for (int blend_shape_idx = 0; blend_shape_idx < data_mesh->get_blend_shape_count(); blend_shape_idx++) {
+		r_source.blend_shape_names.push_back(data_mesh->get_blend_shape_name(blend_shape_idx));
+	}
+	//shallow copies, packed arrays are copy on write so later edits of data_mesh don't reach the worker
+	r_source.surfaces.resize(data_mesh->get_surface_count());
+	for (int surface_index = 0; surface_index < data_mesh->get_surface_count(); surface_index++) {
+		BakeSourceSurface &surface = r_source.surfaces.write[surface_index];
+		surface.arrays = data_mesh->surface_get_arrays(surface_index).duplicate(false);
+		if (data_mesh->get_blend_shape_count() > 0) {
+			surface.blend_shape_arrays = data_mesh->surface_get_blend_shape_arrays(surface_index).duplicate(true);
+		}
+		surface.refinement_arrays = data_mesh->surface_get_refinement_data(surface_index, p_level).duplicate(false);
+		surface.format = data_mesh->surface_get_format(surface_index);
+		surface.topology_type = data_mesh->surface_get_topology_type(surface_index);
+		surface.name = data_mesh->surface_get_name(surface_index);
+		surface.material = data_mesh->surface_get_material(surface_index);
+	}
+}
+
+bool BakedSubdivMesh::_bake_surfaces(const BakeSource &p_source, Vector<BakedSurface> &r_surfaces, uint64_t p_generation) const {
+	Ref<SubdivisionBaker> baker;
+	baker.instantiate();
+	baker->set_use_cage_normals(p_source.use_cage_normals);
+	baker->set_tangent_mode(p_source.tangent_mode);
+	const int p_level = p_source.subdiv_level;
+	r_surfaces.resize(p_source.surfaces.size());
+	for (int surface_index = 0; surface_index < p_source.surfaces.size(); surface_index++) {
+		if (bake_generation.load() != p_generation) {
+			return false;
+		}
+		const BakeSourceSurface &source_surface = p_source.surfaces[surface_index];
+		const TopologyDataMesh::TopologyType topology_type = static_cast<TopologyDataMesh::TopologyType>(source_surface.topology_type);
+		BakedSurface &surface = r_surfaces.write[surface_index];
+		surface.arrays = baker->get_baked_arrays(source_surface.arrays, p_level, source_surface.format, topology_type,
+				source_surface.refinement_arrays, &surface.lods);
+
+		//bake blendshapes
+		if (p_source.blend_shape_names.size() > 0) {
+			surface.blend_shape_arrays = baker->get_baked_blend_shape_arrays(source_surface.arrays, source_surface.blend_shape_arrays,
+					p_level, source_surface.format, topology_type, source_surface.refinement_arrays);
+		}
+		surface.name = source_surface.name;
+		surface.material = source_surface.material;
+	}
+	return true;
+}
+
+void BakedSubdivMesh::_apply_bake(const Ref<TopologyDataMesh> &p_data_mesh, const BakeSource &p_source, const Vector<BakedSurface> &p_surfaces) {
+	_clear();
+
+	//add blendshapes
+	if (p_source.blend_shape_names.size() != get_blend_shape_count()) {
+		clear_blend_shapes();
+		for (int blend_shape_idx = 0; blend_shape_idx < p_source.blend_shape_names.size(); blend_shape_idx++) {
+			add_blend_shape(p_source.blend_shape_names[blend_shape_idx]);
 		}
 	}
+
+	for (int surface_index = 0; surface_index < p_surfaces.size(); surface_index++) {
+		const BakedSurface &surface = p_surfaces[surface_index];
+		add_surface_from_arrays(Mesh::PRIMITIVE_TRIANGLES, surface.arrays, surface.blend_shape_arrays, surface.lods, 0);
+		surface_set_name(surface_index, surface.name);
+		surface_set_material(surface_index, surface.material);
+	}
+	baked_data_mesh = p_data_mesh;
 	emit_changed();
 }
 
+void BakedSubdivMesh::_bake_task(void *p_userdata) {
+	BakeTask *task = static_cast<BakeTask *>(p_userdata);
+	//already on a pool thread, the baker's parallel_for calls run inline
+	ParallelForTaskScope task_scope;
+	task->completed = task->mesh->_bake_surfaces(task->source, task->surfaces, task->generation);
+	task->mesh->call_deferred("_finish_bake", task->generation);
+}
+
+void BakedSubdivMesh::_finish_bake(uint64_t p_generation) {
+	if (!bake_tasks.has(p_generation)) {
+		return; //already finished by wait_for_bake
+	}
+	BakeTask *task = bake_tasks[p_generation];
+	WorkerThreadPool::get_singleton()->wait_for_task_completion(task->task_id);
+	bake_tasks.erase(p_generation);
+	if (task->completed && p_generation == bake_generation.load()) {
+		//store_bake might have been enabled while baking, settings still match since nothing requested a new bake
+		if (!store_bake) {
+			bake_hash = String();
+		} else if (!task->bake_hash.is_empty()) {
+			bake_hash = task->bake_hash;
+		} else {
+			bake_hash = _generate_bake_hash();
+		}
+		_apply_bake(task->data_mesh, task->source, task->surfaces);
+	}
+	memdelete(task);
+}
+
+void BakedSubdivMesh::wait_for_bake() {
+	//older tasks only need to be freed, their result would get ignored anyway
+	LocalVector<uint64_t> generations;
+	for (const KeyValue<uint64_t, BakeTask *> &E : bake_tasks) {
+		generations.push_back(E.key);
+	}
+	for (uint64_t generation : generations) {
+		_finish_bake(generation);
+	}
+}
+
+bool BakedSubdivMesh::is_baking() const {
+	return bake_tasks.has(bake_generation.load());
+}
+
+bool BakedSubdivMesh::is_using_stored_bake() const {
+	return use_stored_bake;
+}
+
+BakedSubdivMesh::~BakedSubdivMesh() {
+	++bake_generation;
+	for (const KeyValue<uint64_t, BakeTask *> &E : bake_tasks) {
+		WorkerThreadPool::get_singleton()->wait_for_task_completion(E.value->task_id);
+		memdelete(E.value);
+	}
+	bake_tasks.clear();
+}
+
 void BakedSubdivMesh::_clear() {
 	clear_surfaces();
 }
@@ -69,7 +313,7 @@ bool BakedSubdivMesh::_set(const StringName &p_name, const Variant &p_value) {
 		set_subdiv_level(p_value); //updates subdiv
 		return true;
 	} else if (s_name.begins_with("_surfaces") || s_name.begins_with("_blend_shape_names")) {
-		return true;
+		return !use_stored_bake; //false lets ArrayMesh load them
 	}
 	return false;
 }
@@ -79,17 +323,38 @@ bool BakedSubdivMesh::_get(const StringName &p_name, Variant &r_ret) {
 		r_ret = get_subdiv_level();
 		return true;
 	} else if (s_name.begins_with("_surfaces") || s_name.begins_with("_blend_shape_names")) {
-		return true;
+		return !store_bake; //false lets ArrayMesh save them
 	}
 
 	return false;
 }
 
 void BakedSubdivMesh::_bind_methods() {
-	ClassDB::bind_method(D_METHOD("sedata_mesh", "data_mesh"), &BakedSubdivMesh::set_data_mesh);
-	ClassDB::bind_method(D_METHOD("gedata_mesh"), &BakedSubdivMesh::get_data_mesh);
-	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "data_mesh", PROPERTY_HINT_RESOURCE_TYPE, "TopologyDataMesh"), "sedata_mesh", "gedata_mesh");
+	//bound before data_mesh and subdiv_level, so they're already set when loading triggers _update_subdiv
+	ClassDB::bind_method(D_METHOD("set_background_bake", "background_bake"), &BakedSubdivMesh::set_background_bake);
+	ClassDB::bind_method(D_METHOD("get_background_bake"), &BakedSubdivMesh::get_background_bake);
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "background_bake"), "set_background_bake", "get_background_bake");
+	ClassDB::bind_method(D_METHOD("set_store_bake", "store_bake"), &BakedSubdivMesh::set_store_bake);
+	ClassDB::bind_method(D_METHOD("get_store_bake"), &BakedSubdivMesh::get_store_bake);
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "store_bake"), "set_store_bake", "get_store_bake");
+	ClassDB::bind_method(D_METHOD("_set_bake_hash", "bake_hash"), &BakedSubdivMesh::_set_bake_hash);
+	ClassDB::bind_method(D_METHOD("_get_bake_hash"), &BakedSubdivMesh::_get_bake_hash);
+	ADD_PROPERTY(PropertyInfo(Variant::STRING, "_bake_hash", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NO_EDITOR), "_set_bake_hash", "_get_bake_hash");
+	ClassDB::bind_method(D_METHOD("set_use_cage_normals", "use_cage_normals"), &BakedSubdivMesh::set_use_cage_normals);
+	ClassDB::bind_method(D_METHOD("get_use_cage_normals"), &BakedSubdivMesh::get_use_cage_normals);
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "use_cage_normals"), "set_use_cage_normals", "get_use_cage_normals");
+	ClassDB::bind_method(D_METHOD("set_tangent_mode", "tangent_mode"), &BakedSubdivMesh::set_tangent_mode);
+	ClassDB::bind_method(D_METHOD("get_tangent_mode"), &BakedSubdivMesh::get_tangent_mode);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "tangent_mode", PROPERTY_HINT_ENUM, "Analytic,MikkTSpace"), "set_tangent_mode", "get_tangent_mode");
 	ClassDB::bind_method(D_METHOD("set_subdiv_level", "subdiv_level"), &BakedSubdivMesh::set_subdiv_level);
 	ClassDB::bind_method(D_METHOD("get_subdiv_level"), &BakedSubdivMesh::get_subdiv_level);
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "subdiv_level", PROPERTY_HINT_RANGE, "0,6"), "set_subdiv_level", "get_subdiv_level");
+	ClassDB::bind_method(D_METHOD("sedata_mesh", "data_mesh"), &BakedSubdivMesh::set_data_mesh);
+	ClassDB::bind_method(D_METHOD("gedata_mesh"), &BakedSubdivMesh::get_data_mesh);
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "data_mesh", PROPERTY_HINT_RESOURCE_TYPE, "TopologyDataMesh"), "sedata_mesh", "gedata_mesh");
+
+	ClassDB::bind_method(D_METHOD("wait_for_bake"), &BakedSubdivMesh::wait_for_bake);
+	ClassDB::bind_method(D_METHOD("is_baking"), &BakedSubdivMesh::is_baking);
+	ClassDB::bind_method(D_METHOD("is_using_stored_bake"), &BakedSubdivMesh::is_using_stored_bake);
+	ClassDB::bind_method(D_METHOD("_finish_bake", "generation"), &BakedSubdivMesh::_finish_bake);
 }
\ No newline at end of file
@@ -7,7 +7,12 @@
 #include "godot_cpp/classes/material.hpp"
 #include "godot_cpp/classes/mesh.hpp"
 #include "godot_cpp/classes/resource.hpp"
+#include "godot_cpp/classes/worker_thread_pool.hpp"
+#include "godot_cpp/templates/hash_map.hpp"
 #include "godot_cpp/templates/vector.hpp"
+#include "subdivision/subdivider.hpp"
+
+#include <atomic>
 
 using namespace godot;
 
@@ -18,9 +23,96 @@ class BakedSubdivMesh : public ArrayMesh {
 	GDCLASS(BakedSubdivMesh, ArrayMesh);
 
 protected:
+	struct BakedSurface {
+		Array arrays;
+		Dictionary lods;
+		TypedArray<Array> blend_shape_arrays;
+		String name;
+		Ref<Material> material;
+	};
+
+	struct BakeSourceSurface {
+		Array arrays;
+		Array blend_shape_arrays;
+		Array refinement_arrays;
+		int64_t format = 0;
+		int32_t topology_type = 0;
+		String name;
+		Ref<Material> material;
+	};
+
+	/**
+	 * @brief Copy of everything a bake reads, gathered on the main thread so workers never touch data_mesh
+	 * or settings that might change while they run
+	 *
+	 */
+	struct BakeSource {
+		Vector<BakeSourceSurface> surfaces;
+		Vector<StringName> blend_shape_names;
+		int subdiv_level = 0;
+		bool use_cage_normals = false;
+		Subdivider::TangentMode tangent_mode = Subdivider::TANGENT_MODE_MIKKTSPACE;
+	};
+
+	/**
+	 * @brief Inputs and results of a bake running on the WorkerThreadPool
+	 *
+	 */
+	struct BakeTask {
+		BakedSubdivMesh *mesh = nullptr;
+		WorkerThreadPool::TaskID task_id = -1;
+		uint64_t generation = 0;
+		Ref<TopologyDataMesh> data_mesh; //only used on the main thread once the bake is applied
+		BakeSource source;
+		String bake_hash; //empty if store_bake was off when the bake got requested
+		Vector<BakedSurface> surfaces;
+		bool completed = false; //false if the task got superseded before finishing
+	};
+
 	Ref<TopologyDataMesh> data_mesh;
 	int subdiv_level = 0;
+	bool use_cage_normals = false;
+	Subdivider::TangentMode tangent_mode = Subdivider::TANGENT_MODE_MIKKTSPACE;
+	bool background_bake = true;
+	std::atomic<uint64_t> bake_generation = { 0 }; //increased by every bake request, running tasks stop once it changes
+	HashMap<uint64_t, BakeTask *> bake_tasks; //generation -> task, only touched on the main thread
+	Ref<TopologyDataMesh> baked_data_mesh; //data_mesh of the surfaces that are currently shown
+	bool store_bake = false;
+	String bake_hash; //data_mesh and subdiv_level the current surfaces were baked from, only kept with store_bake and set once a bake is applied
+	bool use_stored_bake = false; //hash matched while loading, surfaces get set from the saved resource
 	void _update_subdiv();
+	/**
+	 * @brief SHA256 of everything in data_mesh that changes the bake, subdiv_level, use_cage_normals and tangent_mode
+	 *
+	 */
+	String _generate_bake_hash() const;
+	/**
+	 * @brief Gathers the bake inputs of data_mesh with the current settings, main thread only
+	 *
+	 * @param p_level
+	 * @param r_source
+	 */
+	void _gather_bake_source(int p_level, BakeSource &r_source) const;
+	/**
+	 * @brief Bakes all surfaces of p_source, safe to call from a worker thread
+	 *
+	 * @param p_source
+	 * @param r_surfaces
+	 * @param p_generation stops early and returns false once bake_generation doesn't match this anymore
+	 * @return bool true if all surfaces got baked
+	 */
+	bool _bake_surfaces(const BakeSource &p_source, Vector<BakedSurface> &r_surfaces, uint64_t p_generation) const;
+	/**
+	 * @brief Replaces all surfaces at once and emits changed
+	 *
+	 */
+	void _apply_bake(const Ref<TopologyDataMesh> &p_data_mesh, const BakeSource &p_source, const Vector<BakedSurface> &p_surfaces);
+	static void _bake_task(void *p_userdata);
+	/**
+	 * @brief Called deferred once a task finished, applies its result if no newer bake got requested meanwhile
+	 *
+	 */
+	void _finish_bake(uint64_t p_generation);
 	void _clear();
 
 	bool _set(const StringName &p_name, const Variant &p_value);
@@ -33,4 +125,55 @@ public:
 	Ref<TopologyDataMesh> get_data_mesh() const;
 	void set_subdiv_level(int p_level);
 	int get_subdiv_level() const;
+
+	/**
+	 * @brief If enabled the authored normals of data_mesh get interpolated instead of calculating smooth normals,
+	 * see Subdivider::set_use_cage_normals
+	 *
+	 * @param p_use_cage_normals
+	 */
+	void set_use_cage_normals(bool p_use_cage_normals);
+	bool get_use_cage_normals() const;
+
+	/**
+	 * @brief How tangents of the baked surfaces get generated, see Subdivider::set_tangent_mode.
+	 * Defaults to TANGENT_MODE_MIKKTSPACE since the bake only happens once.
+	 *
+	 * @param p_tangent_mode
+	 */
+	void set_tangent_mode(Subdivider::TangentMode p_tangent_mode);
+	Subdivider::TangentMode get_tangent_mode() const;
+
+	/**
+	 * @brief If enabled the baked surfaces get saved with the resource together with a hash of data_mesh and subdiv_level.
+	 * Loading then reuses them and only bakes again if the hash doesn't match anymore.
+	 *
+	 * @param p_store_bake
+	 */
+	void set_store_bake(bool p_store_bake);
+	bool get_store_bake() const;
+	void _set_bake_hash(const String &p_bake_hash);
+	String _get_bake_hash() const;
+
+	/**
+	 * @brief If enabled (default) changing data_mesh or subdiv_level bakes on the WorkerThreadPool. Until the bake is done
+	 * the last finished bake (or subdiv level 0 for a new data_mesh) stays visible. Newer requests supersede running bakes.
+	 *
+	 * @param p_background_bake
+	 */
+	void set_background_bake(bool p_background_bake);
+	bool get_background_bake() const;
+	/**
+	 * @brief Blocks until the running background bake is done and applies it
+	 *
+	 */
+	void wait_for_bake();
+	bool is_baking() const;
+	/**
+	 * @brief True if the current surfaces were loaded from the saved resource instead of getting baked, see set_store_bake
+	 *
+	 */
+	bool is_using_stored_bake() const;
+
+	~BakedSubdivMesh();
 };
\ No newline at end of file
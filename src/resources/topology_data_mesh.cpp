@@ -1,41 +1,133 @@
 #include "topology_data_mesh.hpp"
+#include "topology_data_mesh_format.hpp"
+#include "topology_data_quantization.hpp"
 #include "godot_cpp/classes/rendering_server.hpp"
 #include "godot_cpp/classes/surface_tool.hpp"
 #include "godot_cpp/variant/utility_functions.hpp"
 
 void TopologyDataMesh::add_surface(const Array &p_arrays, const Dictionary &p_lods, const Array &p_blend_shapes, const Ref<Material> &p_material,
 		const String &p_name, BitField<Mesh::ArrayFormat> p_format, TopologyType p_topology_type) {
-	ERR_FAIL_COND(p_arrays.size() != TopologyDataMesh::ARRAY_MAX);
+	if (_add_surface(p_arrays, p_lods, p_blend_shapes, p_material, p_name, p_format, p_topology_type)) {
+		emit_changed();
+	}
+}
+
+bool TopologyDataMesh::_add_surface(const Array &p_arrays, const Dictionary &p_lods, const Array &p_blend_shapes, const Ref<Material> &p_material,
+		const String &p_name, BitField<Mesh::ArrayFormat> p_format, TopologyType p_topology_type) {
 	Surface s;
-	s.arrays = p_arrays;
 	s.name = p_name;
 	s.material = p_material;
 	s.format = p_format;
 	s.topology_type = p_topology_type;
 	s.lods = p_lods;
+	if (!_set_surface_arrays(s, p_arrays, p_blend_shapes)) {
+		return false;
+	}
+
+	surfaces.push_back(s);
+	return true;
+}
+
+bool TopologyDataMesh::_set_surface_arrays(Surface &r_surface, const Array &p_arrays, const Array &p_blend_shapes) {
+	//surfaces saved before ARRAY_FACE_VERTEX_COUNT existed are one shorter
+	ERR_FAIL_COND_V(p_arrays.size() != TopologyDataMesh::ARRAY_MAX && p_arrays.size() != TopologyDataMesh::ARRAY_FACE_VERTEX_COUNT, false);
+	Array arrays = p_arrays;
+	if (arrays.size() != TopologyDataMesh::ARRAY_MAX) {
+		arrays = p_arrays.duplicate(false);
+		arrays.resize(TopologyDataMesh::ARRAY_MAX);
+	}
 	PackedVector3Array vertex_array = p_arrays[TopologyDataMesh::ARRAY_VERTEX];
 	int vertex_count = vertex_array.size();
-	ERR_FAIL_COND(vertex_count == 0);
+	ERR_FAIL_COND_V(vertex_count == 0, false);
+
+	if (r_surface.topology_type == TopologyType::MIXED) {
+		const PackedInt32Array &index_array = arrays[TopologyDataMesh::ARRAY_INDEX];
+		const PackedInt32Array &face_vertex_count_array = arrays[TopologyDataMesh::ARRAY_FACE_VERTEX_COUNT];
+		int face_index_count = 0;
+		for (int face_index = 0; face_index < face_vertex_count_array.size(); face_index++) {
+			ERR_FAIL_COND_V_MSG(face_vertex_count_array[face_index] < 3, false, "Faces need at least 3 vertices.");
+			face_index_count += face_vertex_count_array[face_index];
+		}
+		ERR_FAIL_COND_V_MSG(face_index_count != index_array.size(), false, "Face vertex counts don't add up to the index array size.");
+	}
 
+	Array blend_shape_data;
 	for (int i = 0; i < p_blend_shapes.size(); i++) {
 		Array bsdata = p_blend_shapes[i];
-		ERR_FAIL_COND(bsdata.size() != TopologyDataMesh::ARRAY_MAX);
+		ERR_FAIL_COND_V(bsdata.size() != TopologyDataMesh::ARRAY_MAX && bsdata.size() != TopologyDataMesh::ARRAY_FACE_VERTEX_COUNT, false);
 		PackedVector3Array vertex_data = bsdata[TopologyDataMesh::ARRAY_VERTEX];
-		ERR_FAIL_COND(vertex_data.size() != vertex_count);
-		s.blend_shape_data.push_back(bsdata);
+		ERR_FAIL_COND_V(vertex_data.size() != vertex_count, false);
+		blend_shape_data.push_back(bsdata);
 	}
 
+	r_surface.arrays = arrays;
+	r_surface.blend_shape_data = blend_shape_data;
+	return true;
+}
+
+void TopologyDataMesh::_add_lazy_surface(const LazySurfaceData &p_lazy_data, const Dictionary &p_lods, const Ref<Material> &p_material,
+		const String &p_name, BitField<Mesh::ArrayFormat> p_format, TopologyType p_topology_type) {
+	ERR_FAIL_COND(p_lazy_data.file.is_null());
+	Surface s;
+	s.name = p_name;
+	s.material = p_material;
+	s.format = p_format;
+	s.topology_type = p_topology_type;
+	s.lods = p_lods;
+	s.lazy_data = p_lazy_data;
 	surfaces.push_back(s);
-	emit_changed();
+	lazy_surface_count++;
+}
+
+void TopologyDataMesh::_ensure_surface_loaded(int64_t p_surface) const {
+	if (lazy_surface_count.load() == 0) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(lazy_mutex);
+	if (surfaces[p_surface].lazy_data.file.is_null()) {
+		return; //loaded while waiting for the lock
+	}
+
+	Surface &surface = const_cast<TopologyDataMesh *>(this)->surfaces.write[p_surface];
+	const LazySurfaceData lazy_data = surface.lazy_data;
+	surface.lazy_data = LazySurfaceData();
+
+	Array arrays;
+	Array blend_shape_arrays;
+	lazy_data.file->seek(lazy_data.offset);
+	const Error err = TopologyDataMeshFormat::read_surface_data(lazy_data.file, lazy_data.version, lazy_data.quantization, arrays, blend_shape_arrays);
+	//same check as the loader does for surfaces that aren't lazy
+	const bool loaded = err == OK && (blend_shape_arrays.is_empty() || blend_shape_arrays.size() == blend_shapes.size()) &&
+			_set_surface_arrays(surface, arrays, blend_shape_arrays);
+	if (!loaded) {
+		//stays empty instead of trying again on every access
+		surface.arrays.resize(TopologyDataMesh::ARRAY_MAX);
+	}
+	_remove_invalid_refinement_data(surface);
+	//only decremented once the arrays are set, other threads skip the lock as soon as this reaches 0
+	const String path = lazy_data.file->get_path();
+	if (--lazy_surface_count == 0) {
+		lazy_data.file->close(); //last lazy surface, the file doesn't need to stay open
+	}
+	ERR_FAIL_COND_MSG(!loaded, "Couldn't read surface " + itos(p_surface) + " from " + path);
+}
+
+void TopologyDataMesh::_clear_surfaces() {
+	std::lock_guard<std::mutex> lock(lazy_mutex);
+	surfaces.clear();
+	lazy_surface_count = 0;
 }
 
 Array TopologyDataMesh::surface_get_arrays(int p_surface) const {
 	ERR_FAIL_INDEX_V(p_surface, surfaces.size(), Array());
+	_ensure_surface_loaded(p_surface);
 	return surfaces[p_surface].arrays;
 }
 
+//only emits changed once at the end, adding every surface on its own would emit for each of them
 void TopologyDataMesh::_set_data(const Dictionary &p_data) {
-	clear();
+	_clear_surfaces();
+	blend_shapes.clear();
 	if (p_data.has("blend_shape_names")) {
 		blend_shapes = p_data["blend_shape_names"];
 	}
@@ -45,6 +137,10 @@ void TopologyDataMesh::_set_data(const Dictionary &p_data) {
 			Dictionary s = surface_arr[i];
 			ERR_CONTINUE(!s.has("arrays"));
 			Array arr = s["arrays"];
+			const bool quantized = s.has("quantization");
+			if (quantized) {
+				arr = TopologyDataQuantization::dequantize_arrays(arr, s["quantization"]);
+			}
 			int32_t format = s["format"];
 			String name;
 			if (s.has("name")) {
@@ -53,6 +149,11 @@ void TopologyDataMesh::_set_data(const Dictionary &p_data) {
 			Array b_shapes;
 			if (s.has("blend_shapes")) {
 				b_shapes = s["blend_shapes"];
+				if (quantized) {
+					for (int blend_shape_idx = 0; blend_shape_idx < b_shapes.size(); blend_shape_idx++) {
+						b_shapes[blend_shape_idx] = TopologyDataQuantization::dequantize_blend_shape_arrays(b_shapes[blend_shape_idx]);
+					}
+				}
 			}
 			Ref<Material> material;
 			if (s.has("material")) {
@@ -69,9 +170,20 @@ void TopologyDataMesh::_set_data(const Dictionary &p_data) {
 
 			TopologyType topology_type = static_cast<TopologyType>(topology_type_num);
 
-			add_surface(arr, lods, b_shapes, material, name, format, topology_type);
+			if (_add_surface(arr, lods, b_shapes, material, name, format, topology_type) && s.has("refinement_data")) {
+				//same checks as for runtime data, broken levels just get refined again
+				const Dictionary refinement_data = s["refinement_data"];
+				const Array refinement_levels = refinement_data.keys();
+				for (int level_index = 0; level_index < refinement_levels.size(); level_index++) {
+					const Variant &level = refinement_levels[level_index];
+					ERR_CONTINUE(level.get_type() != Variant::INT);
+					ERR_CONTINUE(refinement_data[level].get_type() != Variant::ARRAY);
+					surface_set_refinement_data(surfaces.size() - 1, level, refinement_data[level]);
+				}
+			}
 		}
 	}
+	emit_changed();
 }
 Dictionary TopologyDataMesh::_get_data() const {
 	Dictionary data;
@@ -79,15 +191,27 @@ Dictionary TopologyDataMesh::_get_data() const {
 		data["blend_shape_names"] = blend_shapes;
 	}
 	Array surface_arr;
+	const AABB quantization_aabb = quantized_storage ? TopologyDataQuantization::get_mesh_aabb(this) : AABB();
 	for (int i = 0; i < surfaces.size(); i++) {
+		_ensure_surface_loaded(i);
 		Dictionary d;
-		d["arrays"] = surfaces[i].arrays;
+		if (quantized_storage) {
+			Dictionary quantization;
+			d["arrays"] = TopologyDataQuantization::quantize_arrays(surfaces[i].arrays, quantization_aabb, quantization);
+			d["quantization"] = quantization;
+		} else {
+			d["arrays"] = surfaces[i].arrays;
+		}
 		d["format"] = surfaces[i].format;
 		d["topology_type"] = surfaces[i].topology_type;
 		if (surfaces[i].blend_shape_data.size()) {
 			Array bs_data;
 			for (int j = 0; j < surfaces[i].blend_shape_data.size(); j++) {
-				bs_data.push_back(surfaces[i].blend_shape_data[j]);
+				if (quantized_storage) {
+					bs_data.push_back(TopologyDataQuantization::quantize_blend_shape_arrays(surfaces[i].blend_shape_data[j]));
+				} else {
+					bs_data.push_back(surfaces[i].blend_shape_data[j]);
+				}
 			}
 			d["blend_shapes"] = bs_data;
 		}
@@ -103,6 +227,16 @@ Dictionary TopologyDataMesh::_get_data() const {
 			d["lods"] = surfaces[i].lods;
 		}
 
+		if (!surfaces[i].refinement_data.is_empty()) {
+			//memory mapped stencils get copied in
+			Dictionary refinement_data;
+			const PackedInt32Array refinement_levels = surface_get_refinement_levels(i);
+			for (int level_index = 0; level_index < refinement_levels.size(); level_index++) {
+				refinement_data[refinement_levels[level_index]] = surface_get_refinement_data(i, refinement_levels[level_index]);
+			}
+			d["refinement_data"] = refinement_data;
+		}
+
 		surface_arr.push_back(d);
 	}
 	data["surfaces"] = surface_arr;
@@ -110,11 +244,19 @@ Dictionary TopologyDataMesh::_get_data() const {
 }
 
 void TopologyDataMesh::clear() {
-	surfaces.clear();
+	_clear_surfaces();
 	blend_shapes.clear();
 	emit_changed();
 }
 
+void TopologyDataMesh::set_quantized_storage(bool p_quantized_storage) {
+	quantized_storage = p_quantized_storage;
+}
+
+bool TopologyDataMesh::get_quantized_storage() const {
+	return quantized_storage;
+}
+
 int64_t TopologyDataMesh::get_surface_count() const {
 	return surfaces.size();
 }
@@ -138,6 +280,8 @@ Ref<Material> TopologyDataMesh::surface_get_material(int64_t index) const {
 void TopologyDataMesh::surface_set_topology_type(int64_t index, TopologyType p_topology_type) {
 	ERR_FAIL_INDEX(index, surfaces.size());
 	surfaces.write[index].topology_type = p_topology_type;
+	surfaces.write[index].refinement_data.clear(); //refined with the old scheme
+	surfaces.write[index].mapped_stencil_tables.clear();
 	emit_changed();
 }
 
@@ -146,6 +290,213 @@ TopologyDataMesh::TopologyType TopologyDataMesh::surface_get_topology_type(int64
 	return surfaces[index].topology_type;
 }
 
+void TopologyDataMesh::surface_set_refinement_data(int64_t surface_index, int32_t p_level, const Array &p_refinement_arrays) {
+	ERR_FAIL_INDEX(surface_index, surfaces.size());
+	ERR_FAIL_COND(p_level <= 0);
+	const Array refinement_arrays = _add_missing_refinement_arrays(p_refinement_arrays);
+	ERR_FAIL_COND(refinement_arrays.size() != REFINEMENT_MAX);
+	const PackedInt32Array &stencil_sizes = refinement_arrays[REFINEMENT_STENCIL_SIZES];
+	const PackedInt32Array &stencil_indices = refinement_arrays[REFINEMENT_STENCIL_INDICES];
+	const PackedFloat32Array &stencil_weights = refinement_arrays[REFINEMENT_STENCIL_WEIGHTS];
+	ERR_FAIL_COND(stencil_sizes.is_empty() || stencil_indices.size() != stencil_weights.size());
+	//lazy surfaces get checked once their arrays are read
+	if (surface_is_loaded(surface_index)) {
+		const StencilTableView stencil_table = StencilTableView::from_refinement_arrays(refinement_arrays);
+		ERR_FAIL_COND_MSG(!stencil_table.is_valid_for(_get_surface_vertex_count(surfaces[surface_index])),
+				"Refinement data of level " + itos(p_level) + " doesn't match the vertices of surface " + itos(surface_index) + ".");
+	}
+	surfaces.write[surface_index].refinement_data[p_level] = refinement_arrays;
+	surfaces.write[surface_index].mapped_stencil_tables.erase(p_level);
+}
+
+void TopologyDataMesh::_surface_set_mapped_refinement_data(int64_t surface_index, int32_t p_level, const Array &p_refinement_arrays,
+		const MappedStencilTable &p_stencil_table) {
+	ERR_FAIL_INDEX(surface_index, surfaces.size());
+	ERR_FAIL_COND(p_level <= 0);
+	const Array refinement_arrays = _add_missing_refinement_arrays(p_refinement_arrays);
+	ERR_FAIL_COND(refinement_arrays.size() != REFINEMENT_MAX);
+	ERR_FAIL_COND(p_stencil_table.mapped_file.is_null() || !p_stencil_table.mapped_file->is_open());
+	ERR_FAIL_COND(p_stencil_table.counts[REFINEMENT_STENCIL_SIZES] == 0);
+	ERR_FAIL_COND(p_stencil_table.counts[REFINEMENT_STENCIL_INDICES] != p_stencil_table.counts[REFINEMENT_STENCIL_WEIGHTS]);
+	if (surface_is_loaded(surface_index)) {
+		ERR_FAIL_COND_MSG(!_get_mapped_stencil_table_view(p_stencil_table).is_valid_for(_get_surface_vertex_count(surfaces[surface_index])),
+				"Refinement data of level " + itos(p_level) + " doesn't match the vertices of surface " + itos(surface_index) + ".");
+	}
+	surfaces.write[surface_index].refinement_data[p_level] = refinement_arrays;
+	surfaces.write[surface_index].mapped_stencil_tables[p_level] = p_stencil_table;
+}
+
+Array TopologyDataMesh::_add_missing_refinement_arrays(const Array &p_refinement_arrays) {
+	if (p_refinement_arrays.size() != REFINEMENT_LOD_CORNERS) {
+		return p_refinement_arrays;
+	}
+	//stored before lods were part of the refinement data, the level just doesn't get lods
+	Array refinement_arrays = p_refinement_arrays.duplicate(false);
+	refinement_arrays.resize(REFINEMENT_MAX);
+	return refinement_arrays;
+}
+
+Array TopologyDataMesh::surface_get_refinement_data(int64_t surface_index, int32_t p_level) const {
+	return _surface_get_refinement_data(surface_index, p_level, true);
+}
+
+Array TopologyDataMesh::_surface_get_refinement_data(int64_t surface_index, int32_t p_level, bool p_include_stencils) const {
+	ERR_FAIL_INDEX_V(surface_index, surfaces.size(), Array());
+	const Surface &surface = surfaces[surface_index];
+	if (!surface.refinement_data.has(p_level)) {
+		return Array();
+	}
+	Array refinement_arrays = surface.refinement_data[p_level];
+	if (!p_include_stencils || !surface.mapped_stencil_tables.has(p_level)) {
+		return refinement_arrays;
+	}
+
+	StencilTableView stencil_table;
+	surface_get_stencil_table(surface_index, p_level, stencil_table);
+	PackedInt32Array stencil_sizes;
+	PackedInt32Array stencil_indices;
+	PackedFloat32Array stencil_weights;
+	stencil_sizes.resize(stencil_table.stencil_count);
+	stencil_indices.resize(stencil_table.control_count);
+	stencil_weights.resize(stencil_table.control_count);
+	memcpy(stencil_sizes.ptrw(), stencil_table.sizes, stencil_table.stencil_count * sizeof(int32_t));
+	memcpy(stencil_indices.ptrw(), stencil_table.indices, stencil_table.control_count * sizeof(int32_t));
+	memcpy(stencil_weights.ptrw(), stencil_table.weights, stencil_table.control_count * sizeof(float));
+
+	refinement_arrays = refinement_arrays.duplicate(false);
+	refinement_arrays[REFINEMENT_STENCIL_SIZES] = stencil_sizes;
+	refinement_arrays[REFINEMENT_STENCIL_INDICES] = stencil_indices;
+	refinement_arrays[REFINEMENT_STENCIL_WEIGHTS] = stencil_weights;
+	return refinement_arrays;
+}
+
+bool TopologyDataMesh::surface_get_stencil_table(int64_t surface_index, int32_t p_level, StencilTableView &r_stencil_table) const {
+	ERR_FAIL_INDEX_V(surface_index, surfaces.size(), false);
+	const Surface &surface = surfaces[surface_index];
+	if (!surface.refinement_data.has(p_level)) {
+		return false;
+	}
+	if (!surface.mapped_stencil_tables.has(p_level)) {
+		r_stencil_table = StencilTableView::from_refinement_arrays(surface.refinement_data[p_level]);
+		return r_stencil_table.is_valid();
+	}
+
+	r_stencil_table = _get_mapped_stencil_table_view(surface.mapped_stencil_tables[p_level]);
+	return true;
+}
+
+TopologyDataMesh::StencilTableView TopologyDataMesh::_get_mapped_stencil_table_view(const MappedStencilTable &p_stencil_table) {
+	const uint8_t *data = p_stencil_table.mapped_file->get_data();
+	StencilTableView stencil_table;
+	stencil_table.mapped_file = p_stencil_table.mapped_file;
+	stencil_table.sizes = reinterpret_cast<const int32_t *>(data + p_stencil_table.offsets[REFINEMENT_STENCIL_SIZES]);
+	stencil_table.indices = reinterpret_cast<const int32_t *>(data + p_stencil_table.offsets[REFINEMENT_STENCIL_INDICES]);
+	stencil_table.weights = reinterpret_cast<const float *>(data + p_stencil_table.offsets[REFINEMENT_STENCIL_WEIGHTS]);
+	stencil_table.stencil_count = p_stencil_table.counts[REFINEMENT_STENCIL_SIZES];
+	stencil_table.control_count = p_stencil_table.counts[REFINEMENT_STENCIL_INDICES];
+	return stencil_table;
+}
+
+int32_t TopologyDataMesh::_get_surface_vertex_count(const Surface &p_surface) {
+	if (p_surface.arrays.size() != ARRAY_MAX) {
+		return 0;
+	}
+	const PackedVector3Array vertex_array = p_surface.arrays[ARRAY_VERTEX];
+	return vertex_array.size();
+}
+
+void TopologyDataMesh::_remove_invalid_refinement_data(Surface &r_surface) {
+	const int32_t vertex_count = _get_surface_vertex_count(r_surface);
+	const Array levels = r_surface.refinement_data.keys();
+	for (int level_index = 0; level_index < levels.size(); level_index++) {
+		const int32_t level = levels[level_index];
+		const StencilTableView stencil_table = r_surface.mapped_stencil_tables.has(level)
+				? _get_mapped_stencil_table_view(r_surface.mapped_stencil_tables[level])
+				: StencilTableView::from_refinement_arrays(r_surface.refinement_data[level]);
+		if (!stencil_table.is_valid_for(vertex_count)) {
+			ERR_PRINT("Refinement data of level " + itos(level) + " doesn't match the surface vertices, it will be refined at runtime.");
+			r_surface.refinement_data.erase(level);
+			r_surface.mapped_stencil_tables.erase(level);
+		}
+	}
+}
+
+bool TopologyDataMesh::StencilTableView::is_valid_for(int32_t p_cage_vertex_count) const {
+	if (!is_valid()) {
+		return false;
+	}
+	int64_t size_sum = 0;
+	for (int32_t stencil_index = 0; stencil_index < stencil_count; stencil_index++) {
+		if (sizes[stencil_index] < 0) {
+			return false;
+		}
+		size_sum += sizes[stencil_index];
+	}
+	if (size_sum != control_count) {
+		return false;
+	}
+	for (int32_t control_index = 0; control_index < control_count; control_index++) {
+		if (indices[control_index] < 0 || indices[control_index] >= p_cage_vertex_count) {
+			return false;
+		}
+	}
+	return true;
+}
+
+TopologyDataMesh::StencilTableView TopologyDataMesh::StencilTableView::from_refinement_arrays(const Array &p_refinement_arrays) {
+	StencilTableView stencil_table;
+	ERR_FAIL_COND_V(p_refinement_arrays.size() != REFINEMENT_MAX, stencil_table);
+	stencil_table.owned_sizes = p_refinement_arrays[REFINEMENT_STENCIL_SIZES];
+	stencil_table.owned_indices = p_refinement_arrays[REFINEMENT_STENCIL_INDICES];
+	stencil_table.owned_weights = p_refinement_arrays[REFINEMENT_STENCIL_WEIGHTS];
+	ERR_FAIL_COND_V(stencil_table.owned_indices.size() != stencil_table.owned_weights.size(), StencilTableView());
+	stencil_table.sizes = stencil_table.owned_sizes.ptr();
+	stencil_table.indices = stencil_table.owned_indices.ptr();
+	stencil_table.weights = stencil_table.owned_weights.ptr();
+	stencil_table.stencil_count = stencil_table.owned_sizes.size();
+	stencil_table.control_count = stencil_table.owned_indices.size();
+	return stencil_table;
+}
+
+PackedInt32Array TopologyDataMesh::surface_get_refinement_levels(int64_t surface_index) const {
+	ERR_FAIL_INDEX_V(surface_index, surfaces.size(), PackedInt32Array());
+	PackedInt32Array levels;
+	const Array keys = surfaces[surface_index].refinement_data.keys();
+	for (int key_index = 0; key_index < keys.size(); key_index++) {
+		levels.push_back(keys[key_index]);
+	}
+	levels.sort();
+	return levels;
+}
+
+void TopologyDataMesh::clear_refinement_data() {
+	for (int surface_index = 0; surface_index < surfaces.size(); surface_index++) {
+		surfaces.write[surface_index].refinement_data.clear();
+		surfaces.write[surface_index].mapped_stencil_tables.clear();
+	}
+}
+
+void TopologyDataMesh::release_files() {
+	bool released = false;
+	for (int surface_index = 0; surface_index < surfaces.size(); surface_index++) {
+		_ensure_surface_loaded(surface_index);
+		if (surfaces[surface_index].mapped_stencil_tables.is_empty()) {
+			continue;
+		}
+		const PackedInt32Array levels = surface_get_refinement_levels(surface_index);
+		for (int level_index = 0; level_index < levels.size(); level_index++) {
+			if (surfaces[surface_index].mapped_stencil_tables.has(levels[level_index])) {
+				surfaces.write[surface_index].refinement_data[levels[level_index]] = _surface_get_refinement_data(surface_index, levels[level_index], true);
+			}
+		}
+		surfaces.write[surface_index].mapped_stencil_tables.clear();
+		released = true;
+	}
+	if (released) {
+		emit_changed();
+	}
+}
+
 Dictionary TopologyDataMesh::surface_get_lods(int64_t surface_index) const {
 	ERR_FAIL_INDEX_V(surface_index, surfaces.size(), Dictionary());
 
@@ -158,11 +509,13 @@ int64_t TopologyDataMesh::get_blend_shape_count() const {
 
 Array TopologyDataMesh::surface_get_blend_shape_arrays(int64_t surface_index) const {
 	ERR_FAIL_INDEX_V(surface_index, surfaces.size(), Array());
+	_ensure_surface_loaded(surface_index);
 	return surfaces[surface_index].blend_shape_data;
 }
 
 Array TopologyDataMesh::surface_get_single_blend_shape_array(int64_t surface_index, int64_t blend_shape_idx) const {
 	ERR_FAIL_INDEX_V(surface_index, surfaces.size(), Array());
+	_ensure_surface_loaded(surface_index);
 	ERR_FAIL_INDEX_V(blend_shape_idx, surfaces[surface_index].blend_shape_data.size(), Array());
 	return surfaces[surface_index].blend_shape_data[blend_shape_idx];
 }
@@ -204,8 +557,18 @@ void TopologyDataMesh::surface_set_name(int p_surface, const String &p_name) {
 	surfaces.write[p_surface].name = p_name;
 }
 
+bool TopologyDataMesh::surface_is_loaded(int p_surface) const {
+	ERR_FAIL_INDEX_V(p_surface, surfaces.size(), false);
+	if (lazy_surface_count.load() == 0) {
+		return true;
+	}
+	std::lock_guard<std::mutex> lock(lazy_mutex);
+	return surfaces[p_surface].lazy_data.file.is_null();
+}
+
 int TopologyDataMesh::surface_get_length(int p_surface) {
 	ERR_FAIL_INDEX_V(p_surface, surfaces.size(), -1);
+	_ensure_surface_loaded(p_surface);
 	const PackedVector3Array &vertex_array = surfaces[p_surface].arrays[TopologyDataMesh::ARRAY_VERTEX];
 	return vertex_array.size();
 }
@@ -220,17 +583,26 @@ void TopologyDataMesh::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("_set_data", "data"), &TopologyDataMesh::_set_data);
 	ClassDB::bind_method(D_METHOD("_get_data"), &TopologyDataMesh::_get_data);
 
+	ClassDB::bind_method(D_METHOD("set_quantized_storage", "quantized_storage"), &TopologyDataMesh::set_quantized_storage);
+	ClassDB::bind_method(D_METHOD("get_quantized_storage"), &TopologyDataMesh::get_quantized_storage);
+
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "quantized_storage"), "set_quantized_storage", "get_quantized_storage");
 	ADD_PROPERTY(PropertyInfo(Variant::DICTIONARY, "_data", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NO_EDITOR), "_set_data", "_get_data");
 	ClassDB::bind_method(D_METHOD("add_surface", "p_arrays", "p_lods", "p_blend_shapes", "p_material", "p_name", "p_format", "p_topology_type"), &TopologyDataMesh::add_surface);
 	ClassDB::bind_method(D_METHOD("add_surface_from_arrays", "topology_type", "arrays", "blend_shapes", "lods", "format"), &TopologyDataMesh::add_surface_from_arrays, DEFVAL(Array()), DEFVAL(Dictionary()), DEFVAL(Mesh::ARRAY_FORMAT_VERTEX));
 	ClassDB::bind_method(D_METHOD("surface_get_arrays", "surface_index"), &TopologyDataMesh::surface_get_arrays);
 	ClassDB::bind_method(D_METHOD("clear"), &TopologyDataMesh::clear);
 	ClassDB::bind_method(D_METHOD("get_surface_count"), &TopologyDataMesh::get_surface_count);
+	ClassDB::bind_method(D_METHOD("surface_is_loaded", "surface_index"), &TopologyDataMesh::surface_is_loaded);
 	ClassDB::bind_method(D_METHOD("surface_get_format", "index"), &TopologyDataMesh::surface_get_format);
 	ClassDB::bind_method(D_METHOD("surface_set_material", "index", "material"), &TopologyDataMesh::surface_set_material);
 	ClassDB::bind_method(D_METHOD("surface_set_topology_type", "index", "p_topology_type"), &TopologyDataMesh::surface_set_topology_type);
 	ClassDB::bind_method(D_METHOD("surface_get_topology_type", "index"), &TopologyDataMesh::surface_get_topology_type);
 	ClassDB::bind_method(D_METHOD("surface_get_lods", "surface_index"), &TopologyDataMesh::surface_get_lods);
+	ClassDB::bind_method(D_METHOD("surface_set_refinement_data", "surface_index", "level", "refinement_arrays"), &TopologyDataMesh::surface_set_refinement_data);
+	ClassDB::bind_method(D_METHOD("surface_get_refinement_data", "surface_index", "level"), &TopologyDataMesh::surface_get_refinement_data);
+	ClassDB::bind_method(D_METHOD("surface_get_refinement_levels", "surface_index"), &TopologyDataMesh::surface_get_refinement_levels);
+	ClassDB::bind_method(D_METHOD("clear_refinement_data"), &TopologyDataMesh::clear_refinement_data);
 	ClassDB::bind_method(D_METHOD("get_blend_shape_count"), &TopologyDataMesh::get_blend_shape_count);
 	ClassDB::bind_method(D_METHOD("surface_get_blend_shape_arrays", "surface_index"), &TopologyDataMesh::surface_get_blend_shape_arrays);
 	ClassDB::bind_method(D_METHOD("surface_get_single_blend_shape_array", "surface_index", "blend_shape_idx"), &TopologyDataMesh::surface_get_single_blend_shape_array);
@@ -244,6 +616,7 @@ void TopologyDataMesh::_bind_methods() {
 	//TopologyType
 	BIND_ENUM_CONSTANT(QUAD);
 	BIND_ENUM_CONSTANT(TRIANGLE);
+	BIND_ENUM_CONSTANT(MIXED);
 
 	//ArrayType
 	BIND_ENUM_CONSTANT(ARRAY_VERTEX);
@@ -260,5 +633,21 @@ void TopologyDataMesh::_bind_methods() {
 	BIND_ENUM_CONSTANT(ARRAY_WEIGHTS);
 	BIND_ENUM_CONSTANT(ARRAY_INDEX);
 	BIND_ENUM_CONSTANT(ARRAY_UV_INDEX);
+	BIND_ENUM_CONSTANT(ARRAY_FACE_VERTEX_COUNT);
 	BIND_ENUM_CONSTANT(ARRAY_MAX);
+
+	//RefinementArrayType
+	BIND_ENUM_CONSTANT(REFINEMENT_STENCIL_SIZES);
+	BIND_ENUM_CONSTANT(REFINEMENT_STENCIL_INDICES);
+	BIND_ENUM_CONSTANT(REFINEMENT_STENCIL_WEIGHTS);
+	BIND_ENUM_CONSTANT(REFINEMENT_INDEX);
+	BIND_ENUM_CONSTANT(REFINEMENT_TEX_UV);
+	BIND_ENUM_CONSTANT(REFINEMENT_UV_INDEX);
+	BIND_ENUM_CONSTANT(REFINEMENT_BONES);
+	BIND_ENUM_CONSTANT(REFINEMENT_WEIGHTS);
+	BIND_ENUM_CONSTANT(REFINEMENT_LOD_CORNERS);
+	BIND_ENUM_CONSTANT(REFINEMENT_LOD_FACE_VERTEX_COUNTS);
+	BIND_ENUM_CONSTANT(REFINEMENT_LOD_FACE_COUNTS);
+	BIND_ENUM_CONSTANT(REFINEMENT_LOD_ERRORS);
+	BIND_ENUM_CONSTANT(REFINEMENT_MAX);
 }
\ No newline at end of file
@@ -4,11 +4,18 @@
 #include "godot_cpp/core/binder_common.hpp"
 
 #include "godot_cpp/classes/array_mesh.hpp"
+#include "godot_cpp/classes/file_access.hpp"
 #include "godot_cpp/classes/material.hpp"
 #include "godot_cpp/classes/mesh.hpp"
 #include "godot_cpp/classes/resource.hpp"
+#include "godot_cpp/templates/hash_map.hpp"
 #include "godot_cpp/templates/vector.hpp"
 
+#include "utility/mapped_file.hpp"
+
+#include <atomic>
+#include <mutex>
+
 using namespace godot;
 
 class TopologyDataMesh : public Resource {
@@ -34,20 +41,97 @@ public:
 		ARRAY_WEIGHTS = Mesh::ARRAY_WEIGHTS,
 		ARRAY_INDEX = Mesh::ARRAY_INDEX,
 		ARRAY_UV_INDEX = Mesh::ARRAY_MAX, //just an index array for uv's (ARRAY_INDEX does not work with uv's anymore in favour of face connection)
-		ARRAY_MAX = Mesh::ARRAY_MAX + 1
+		ARRAY_FACE_VERTEX_COUNT = Mesh::ARRAY_MAX + 1, //vertex count of every face, only used by MIXED surfaces
+		ARRAY_MAX = Mesh::ARRAY_MAX + 2
 	};
 
 	//TODO: Maybe make seperate class for storage:
-	//need to make TRIANGLE_FLAT, QUAD_FLAT, TRIANGLE_SMOOTH, QUAD_SMOOTH and FULL_TOPOLOGY
-	//since normals/tangents are stored differently based on shading,
-	//full topology would have vertex array of actual topology vertices, but normals for each individual face vertex
-	//the index array wouldn't be used and instead face_index_array=[[0,1,2,3], [2,5,6,9,8], ...], need to read on how to triangulate that
+	//need to make TRIANGLE_FLAT, QUAD_FLAT, TRIANGLE_SMOOTH, QUAD_SMOOTH
+	//since normals/tangents are stored differently based on shading
+	/**
+	 * @brief TRIANGLE uses Loop, QUAD and MIXED use Catmull-Clark.
+	 *
+	 * MIXED surfaces can contain faces with any vertex count, index array is then split up into faces
+	 * with ARRAY_FACE_VERTEX_COUNT ([4, 3, 5] -> first face uses indices 0-3, second 4-6, third 7-11)
+	 */
 	enum TopologyType {
 		TRIANGLE = 0,
-		QUAD = 1
+		QUAD = 1,
+		MIXED = 2
+	};
+
+	/**
+	 * @brief Layout of precomputed refinement data of a single subdivision level.
+	 *
+	 * Stencils map cage vertices to final level vertices (vertex i = sum of weights * cage vertices),
+	 * REFINEMENT_INDEX and REFINEMENT_UV_INDEX index the final level only, faces are quads for Catmull-Clark and triangles for Loop.
+	 * UV's, bones and weights stay null if the surface format doesn't contain them.
+	 */
+	enum RefinementArrayType {
+		REFINEMENT_STENCIL_SIZES = 0, //amount of cage vertices contributing to each final vertex
+		REFINEMENT_STENCIL_INDICES = 1,
+		REFINEMENT_STENCIL_WEIGHTS = 2,
+		REFINEMENT_INDEX = 3,
+		REFINEMENT_TEX_UV = 4,
+		REFINEMENT_UV_INDEX = 5,
+		REFINEMENT_BONES = 6,
+		REFINEMENT_WEIGHTS = 7,
+		REFINEMENT_LOD_CORNERS = 8, //corners of every coarser level one after another, see Subdivider::get_lods
+		REFINEMENT_LOD_FACE_VERTEX_COUNTS = 9,
+		REFINEMENT_LOD_FACE_COUNTS = 10, //faces per coarser level
+		REFINEMENT_LOD_ERRORS = 11,
+		REFINEMENT_MAX = 12
+	};
+
+	/**
+	 * @brief Raw pointers to a stencil table, either into the refinement arrays or into a memory mapped .tdmesh file.
+	 * Keeps whatever it points into alive.
+	 *
+	 */
+	struct StencilTableView {
+		const int32_t *sizes = nullptr;
+		const int32_t *indices = nullptr;
+		const float *weights = nullptr;
+		int32_t stencil_count = 0;
+		int32_t control_count = 0;
+
+		PackedInt32Array owned_sizes;
+		PackedInt32Array owned_indices;
+		PackedFloat32Array owned_weights;
+		Ref<MappedFile> mapped_file;
+
+		bool is_valid() const { return stencil_count > 0; }
+		/**
+		 * @brief Checks that the sizes add up to control_count and every index is a cage vertex. Done once when
+		 * the table gets stored, applying the stencils doesn't check indices.
+		 *
+		 */
+		bool is_valid_for(int32_t p_cage_vertex_count) const;
+		static StencilTableView from_refinement_arrays(const Array &p_refinement_arrays);
 	};
 
 protected:
+	/**
+	 * @brief Stencil table that stays inside a memory mapped .tdmesh file, indexed by RefinementArrayType
+	 *
+	 */
+	struct MappedStencilTable {
+		Ref<MappedFile> mapped_file;
+		uint64_t offsets[REFINEMENT_STENCIL_WEIGHTS + 1] = {};
+		int32_t counts[REFINEMENT_STENCIL_WEIGHTS + 1] = {};
+	};
+
+	/**
+	 * @brief Where the arrays and blend shapes of a surface that wasn't read yet are inside a .tdmesh file
+	 *
+	 */
+	struct LazySurfaceData {
+		Ref<FileAccess> file; //shared by all lazy surfaces of a mesh, null once the surface is loaded, closed after the last one
+		uint64_t offset = 0;
+		uint32_t version = 0;
+		Dictionary quantization;
+	};
+
 	struct Surface {
 		Array arrays;
 		Array blend_shape_data; //Array[Array]
@@ -58,14 +142,61 @@ protected:
 		int32_t format;
 		TopologyType topology_type;
 		Dictionary lods;
+		Dictionary refinement_data; //subdivision level -> Array, see RefinementArrayType
+		HashMap<int32_t, MappedStencilTable> mapped_stencil_tables; //stencil arrays of these levels are null in refinement_data
+		LazySurfaceData lazy_data; //arrays and blend_shape_data are empty until read
 	};
 	Vector<Surface> surfaces;
+	std::atomic<int> lazy_surface_count = { 0 }; //lets loaded meshes skip the lock
+	mutable std::mutex lazy_mutex;
 	Array blend_shapes; //is Vector<StringName>, but that caused casting issues
+	bool quantized_storage = false;
 
 	void _set_data(const Dictionary &p_data);
 	Dictionary _get_data() const;
+	/**
+	 * @brief Validates and stores the surface without emitting changed, used for bulk construction
+	 *
+	 * @return true if the surface was added
+	 */
+	bool _add_surface(const Array &p_arrays, const Dictionary &p_lods, const Array &p_blend_shapes,
+			const Ref<Material> &p_material, const String &p_name, BitField<Mesh::ArrayFormat> p_format, TopologyType p_topology_type);
+	/**
+	 * @brief Validates arrays and blend shapes against r_surface.topology_type and stores them in r_surface
+	 *
+	 */
+	static bool _set_surface_arrays(Surface &r_surface, const Array &p_arrays, const Array &p_blend_shapes);
+	/**
+	 * @brief Adds a surface whose arrays and blend shapes only get read from the file when they're first requested,
+	 * used by TopologyDataMeshFormatLoader
+	 *
+	 */
+	void _add_lazy_surface(const LazySurfaceData &p_lazy_data, const Dictionary &p_lods, const Ref<Material> &p_material,
+			const String &p_name, BitField<Mesh::ArrayFormat> p_format, TopologyType p_topology_type);
+	/**
+	 * @brief Reads arrays and blend shapes of a lazy surface, does nothing for surfaces that are already loaded.
+	 * Counts as const since the surface doesn't change from the outside.
+	 *
+	 */
+	void _ensure_surface_loaded(int64_t p_surface) const;
+	void _clear_surfaces();
+	/**
+	 * @brief Stores refinement data whose stencil arrays stay in a memory mapping, used by TopologyDataMeshFormatLoader
+	 *
+	 */
+	void _surface_set_mapped_refinement_data(int64_t surface_index, int32_t p_level, const Array &p_refinement_arrays, const MappedStencilTable &p_stencil_table);
+	static StencilTableView _get_mapped_stencil_table_view(const MappedStencilTable &p_stencil_table);
+	static Array _add_missing_refinement_arrays(const Array &p_refinement_arrays);
+	static int32_t _get_surface_vertex_count(const Surface &p_surface);
+	/**
+	 * @brief Drops refinement levels whose stencils don't fit the cage, lazy surfaces can only be checked once their arrays are read
+	 *
+	 */
+	static void _remove_invalid_refinement_data(Surface &r_surface);
 	static void _bind_methods();
 
+	friend class TopologyDataMeshFormatLoader;
+
 public:
 	struct TopologySurfaceData {
 		godot::PackedVector3Array vertex_array;
@@ -75,6 +206,7 @@ public:
 		godot::PackedInt32Array index_array;
 		godot::PackedFloat32Array bones_array;
 		godot::PackedFloat32Array weights_array;
+		godot::PackedInt32Array face_vertex_count_array;
 		TopologySurfaceData(Array p_mesh_arrays) {
 			vertex_array = p_mesh_arrays[TopologyDataMesh::ARRAY_VERTEX];
 			normal_array = p_mesh_arrays[TopologyDataMesh::ARRAY_NORMAL];
@@ -86,6 +218,9 @@ public:
 
 			if (p_mesh_arrays[TopologyDataMesh::ARRAY_WEIGHTS])
 				weights_array = p_mesh_arrays[TopologyDataMesh::ARRAY_WEIGHTS];
+
+			if (p_mesh_arrays.size() > TopologyDataMesh::ARRAY_FACE_VERTEX_COUNT && p_mesh_arrays[TopologyDataMesh::ARRAY_FACE_VERTEX_COUNT])
+				face_vertex_count_array = p_mesh_arrays[TopologyDataMesh::ARRAY_FACE_VERTEX_COUNT];
 		}
 	};
 
@@ -106,7 +241,7 @@ public:
 	 * @param p_material material
 	 * @param p_name surface name
 	 * @param p_format arrayformat from mesh
-	 * @param p_topology_type triangle or quad
+	 * @param p_topology_type triangle, quad or mixed
 	 */
 	void add_surface(const Array &p_arrays, const Dictionary &p_lods, const Array &p_blend_shapes,
 			const Ref<Material> &p_material, const String &p_name, BitField<Mesh::ArrayFormat> p_format, TopologyType p_topology_type);
@@ -144,6 +279,14 @@ public:
 	 */
 	int surface_get_length(int p_surface);
 
+	/**
+	 * @brief False while arrays and blend shapes of a surface loaded lazily from a .tdmesh file weren't requested yet
+	 *
+	 * @param p_surface surface index
+	 * @return bool
+	 */
+	bool surface_is_loaded(int p_surface) const;
+
 	/**
 	 * @brief Get the number of surfaces mesh has
 	 *
@@ -176,10 +319,10 @@ public:
 	Ref<Material> surface_get_material(int64_t surface_index) const;
 
 	/**
-	 * @brief Set surface topology type (triangle/quad)
+	 * @brief Set surface topology type (triangle/quad/mixed)
 	 *
 	 * @param surface_index
-	 * @param p_topology_type triangle or quad
+	 * @param p_topology_type triangle, quad or mixed
 	 */
 	void surface_set_topology_type(int64_t surface_index, TopologyType p_topology_type);
 
@@ -192,10 +335,62 @@ public:
 	TopologyType surface_get_topology_type(int64_t surface_index) const;
 
 	/**
-	 * @brief Get amount of blendshapes
+	 * @brief Store precomputed refinement data for a subdivision level, see SubdivisionBaker::bake_refinement_data
+	 *
+	 * @param surface_index
+	 * @param p_level subdivision level, needs to be at least 1
+	 * @param p_refinement_arrays REFINEMENT_MAX long Array, rejected if a stencil index isn't a vertex of the surface.
+	 * REFINEMENT_LOD_CORNERS long arrays from before lods were stored still work, the level just has no lods.
+	 */
+	void surface_set_refinement_data(int64_t surface_index, int32_t p_level, const Array &p_refinement_arrays);
+
+	/**
+	 * @brief Getter for precomputed refinement data
+	 *
+	 * @param surface_index
+	 * @param p_level subdivision level
+	 * @return Array empty if nothing was stored for this level
+	 */
+	Array surface_get_refinement_data(int64_t surface_index, int32_t p_level) const;
+
+	/**
+	 * @brief Same as surface_get_refinement_data, but memory mapped stencil arrays don't get copied and stay null,
+	 * use surface_get_stencil_table to access them
 	 *
-	 * @return int64_t
 	 */
+	Array _surface_get_refinement_data(int64_t surface_index, int32_t p_level, bool p_include_stencils) const;
+
+	/**
+	 * @brief Stencil table of a level without copying it
+	 *
+	 * @param surface_index
+	 * @param p_level
+	 * @param r_stencil_table
+	 * @return true if the level has refinement data
+	 */
+	bool surface_get_stencil_table(int64_t surface_index, int32_t p_level, StencilTableView &r_stencil_table) const;
+
+	/**
+	 * @brief Levels that have precomputed refinement data stored
+	 *
+	 * @param surface_index
+	 * @return PackedInt32Array
+	 */
+	PackedInt32Array surface_get_refinement_levels(int64_t surface_index) const;
+
+	/**
+	 * @brief Removes precomputed refinement data of all surfaces
+	 *
+	 */
+	void clear_refinement_data();
+
+	/**
+	 * @brief Reads all lazy surfaces and copies stencil tables that are still inside a memory mapped .tdmesh file
+	 * into the refinement arrays, afterwards nothing keeps the file open. Emits changed if mappings were dropped
+	 * so SubdivMeshInstance3D's let go of their views as well.
+	 * @details Windows can't replace a file that is open or mapped, so this runs before saving over the file.
+	 */
+	void release_files();
 
 	Dictionary surface_get_lods(int64_t surface_index) const;
 
@@ -249,9 +444,19 @@ public:
 	 */
 	void clear();
 
+	/**
+	 * @brief If enabled, vertices, uv's, bones, weights and blend shapes get saved quantized, see TopologyDataQuantization.
+	 * Only changes the saved data, loading dequantizes again.
+	 *
+	 * @param p_quantized_storage
+	 */
+	void set_quantized_storage(bool p_quantized_storage);
+	bool get_quantized_storage() const;
+
 	TopologyDataMesh();
 	~TopologyDataMesh();
 };
 
 VARIANT_ENUM_CAST(TopologyDataMesh::TopologyType);
-VARIANT_ENUM_CAST(TopologyDataMesh::ArrayType);
\ No newline at end of file
+VARIANT_ENUM_CAST(TopologyDataMesh::ArrayType);
+VARIANT_ENUM_CAST(TopologyDataMesh::RefinementArrayType);
\ No newline at end of file
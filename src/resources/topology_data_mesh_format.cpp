@@ -0,0 +1,413 @@
+#include "topology_data_mesh_format.hpp"
+
+#include "godot_cpp/classes/resource_loader.hpp"
+#include "resources/topology_data_quantization.hpp"
+
+const char *TopologyDataMeshFormat::EXTENSION = "tdmesh";
+
+static const uint32_t STENCIL_SECTION_MASK = (1u << TopologyDataMesh::REFINEMENT_STENCIL_SIZES) |
+		(1u << TopologyDataMesh::REFINEMENT_STENCIL_INDICES) | (1u << TopologyDataMesh::REFINEMENT_STENCIL_WEIGHTS);
+
+static uint64_t _get_aligned_position(uint64_t p_position) {
+	const uint64_t alignment = TopologyDataMeshFormat::SECTION_ALIGNMENT;
+	return (p_position + alignment - 1) / alignment * alignment;
+}
+
+template <typename T>
+static void _write_section(const Ref<FileAccess> &p_file, TopologyDataMeshFormat::SectionType p_type, const T &p_array) {
+	p_file->store_8(p_type);
+	p_file->store_32(p_array.size());
+	const uint64_t aligned_position = _get_aligned_position(p_file->get_position());
+	while (p_file->get_position() < aligned_position) {
+		p_file->store_8(0);
+	}
+	p_file->store_buffer(p_array.to_byte_array());
+}
+
+template <typename T, typename Element>
+static Error _read_section(const Ref<FileAccess> &p_file, uint32_t p_version, Variant &r_array,
+		TopologyDataMeshFormat::MappedSection *r_mapped_section) {
+	const uint32_t element_count = p_file->get_32();
+	if (p_version >= 3) {
+		p_file->seek(_get_aligned_position(p_file->get_position()));
+	}
+	const uint64_t byte_count = uint64_t(element_count) * sizeof(Element);
+	ERR_FAIL_COND_V(byte_count > p_file->get_length() - p_file->get_position(), ERR_FILE_CORRUPT);
+	if (r_mapped_section) {
+		r_mapped_section->offset = p_file->get_position();
+		r_mapped_section->count = element_count;
+		p_file->seek(p_file->get_position() + byte_count);
+		return OK;
+	}
+	PackedByteArray bytes = p_file->get_buffer(byte_count);
+	ERR_FAIL_COND_V(uint64_t(bytes.size()) != byte_count, ERR_FILE_CORRUPT);
+	T array;
+	array.resize(element_count);
+	if (element_count) {
+		memcpy(array.ptrw(), bytes.ptr(), byte_count);
+	}
+	r_array = array;
+	return OK;
+}
+
+void TopologyDataMeshFormat::write_arrays(const Ref<FileAccess> &p_file, const Array &p_arrays) {
+	p_file->store_32(p_arrays.size());
+	for (int array_index = 0; array_index < p_arrays.size(); array_index++) {
+		const Variant &array = p_arrays[array_index];
+		switch (array.get_type()) {
+			case Variant::NIL:
+				p_file->store_8(SECTION_NULL);
+				break;
+			case Variant::PACKED_VECTOR3_ARRAY:
+				_write_section(p_file, SECTION_VECTOR3, PackedVector3Array(array));
+				break;
+			case Variant::PACKED_VECTOR2_ARRAY:
+				_write_section(p_file, SECTION_VECTOR2, PackedVector2Array(array));
+				break;
+			case Variant::PACKED_INT32_ARRAY:
+				_write_section(p_file, SECTION_INT32, PackedInt32Array(array));
+				break;
+			case Variant::PACKED_FLOAT32_ARRAY:
+				_write_section(p_file, SECTION_FLOAT32, PackedFloat32Array(array));
+				break;
+			case Variant::PACKED_COLOR_ARRAY:
+				_write_section(p_file, SECTION_COLOR, PackedColorArray(array));
+				break;
+			case Variant::PACKED_BYTE_ARRAY:
+				_write_section(p_file, SECTION_BYTES, PackedByteArray(array));
+				break;
+			default:
+				p_file->store_8(SECTION_VARIANT);
+				p_file->store_var(array);
+				break;
+		}
+	}
+}
+
+Error TopologyDataMeshFormat::read_arrays(const Ref<FileAccess> &p_file, Array &r_arrays, uint32_t p_version,
+		uint32_t p_mapped_mask, MappedSection *r_mapped_sections) {
+	ERR_FAIL_COND_V(p_mapped_mask && (p_version < 3 || !r_mapped_sections), ERR_INVALID_PARAMETER);
+	const uint32_t array_count = p_file->get_32();
+	ERR_FAIL_COND_V(array_count > TopologyDataMesh::ARRAY_MAX, ERR_FILE_CORRUPT);
+	r_arrays.resize(array_count);
+	for (uint32_t array_index = 0; array_index < array_count; array_index++) {
+		Variant array;
+		Error err = OK;
+		MappedSection *mapped_section = (p_mapped_mask & (1u << array_index)) ? r_mapped_sections + array_index : nullptr;
+		const uint8_t section_type = p_file->get_8();
+		if (mapped_section && section_type != SECTION_VARIANT) {
+			mapped_section->type = static_cast<SectionType>(section_type);
+		}
+		switch (section_type) {
+			case SECTION_NULL:
+				break;
+			case SECTION_VECTOR3:
+				err = _read_section<PackedVector3Array, Vector3>(p_file, p_version, array, mapped_section);
+				break;
+			case SECTION_VECTOR2:
+				err = _read_section<PackedVector2Array, Vector2>(p_file, p_version, array, mapped_section);
+				break;
+			case SECTION_INT32:
+				err = _read_section<PackedInt32Array, int32_t>(p_file, p_version, array, mapped_section);
+				break;
+			case SECTION_FLOAT32:
+				err = _read_section<PackedFloat32Array, float>(p_file, p_version, array, mapped_section);
+				break;
+			case SECTION_COLOR:
+				err = _read_section<PackedColorArray, Color>(p_file, p_version, array, mapped_section);
+				break;
+			case SECTION_BYTES:
+				err = _read_section<PackedByteArray, uint8_t>(p_file, p_version, array, mapped_section);
+				break;
+			case SECTION_VARIANT:
+				array = p_file->get_var();
+				break;
+			default:
+				err = ERR_FILE_CORRUPT;
+				break;
+		}
+		ERR_FAIL_COND_V(err != OK, err);
+		r_arrays[array_index] = array;
+	}
+	return OK;
+}
+
+Error TopologyDataMeshFormat::read_surface_data(const Ref<FileAccess> &p_file, uint32_t p_version, const Dictionary &p_quantization,
+		Array &r_arrays, Array &r_blend_shape_arrays) {
+	Error err = read_arrays(p_file, r_arrays, p_version);
+	ERR_FAIL_COND_V(err != OK, err);
+	if (!p_quantization.is_empty()) {
+		r_arrays = TopologyDataQuantization::dequantize_arrays(r_arrays, p_quantization);
+	}
+	const uint32_t blend_shape_count = p_file->get_32();
+	ERR_FAIL_COND_V(blend_shape_count > p_file->get_length() - p_file->get_position(), ERR_FILE_CORRUPT);
+	r_blend_shape_arrays.clear();
+	for (uint32_t blend_shape_idx = 0; blend_shape_idx < blend_shape_count; blend_shape_idx++) {
+		Array blend_shape_array;
+		err = read_arrays(p_file, blend_shape_array, p_version);
+		ERR_FAIL_COND_V(err != OK, err);
+		if (!p_quantization.is_empty()) {
+			blend_shape_array = TopologyDataQuantization::dequantize_blend_shape_arrays(blend_shape_array);
+		}
+		r_blend_shape_arrays.push_back(blend_shape_array);
+	}
+	return OK;
+}
+
+void TopologyDataMeshFormatSaver::_bind_methods() {
+}
+
+Error TopologyDataMeshFormatSaver::_save(const Ref<Resource> &p_resource, const String &p_path, uint32_t p_flags) {
+	Ref<TopologyDataMesh> topology_data_mesh = p_resource;
+	ERR_FAIL_COND_V(topology_data_mesh.is_null(), ERR_INVALID_PARAMETER);
+	//the file might be mapped by this mesh or the cached one that gets reimported
+	topology_data_mesh->release_files();
+	if (ResourceLoader::get_singleton()->has_cached(p_path)) {
+		Ref<TopologyDataMesh> cached_mesh = ResourceLoader::get_singleton()->load(p_path, "", ResourceLoader::CACHE_MODE_REUSE);
+		if (cached_mesh.is_valid()) {
+			cached_mesh->release_files();
+		}
+	}
+	Ref<FileAccess> file = FileAccess::open(p_path, FileAccess::WRITE);
+	ERR_FAIL_COND_V_MSG(file.is_null(), FileAccess::get_open_error(), "Couldn't open " + p_path);
+
+	file->store_32(TopologyDataMeshFormat::MAGIC);
+	file->store_32(TopologyDataMeshFormat::VERSION);
+	file->store_8(sizeof(real_t));
+	file->store_pascal_string(topology_data_mesh->get_name());
+
+	file->store_32(topology_data_mesh->get_blend_shape_count());
+	for (int blend_shape_idx = 0; blend_shape_idx < topology_data_mesh->get_blend_shape_count(); blend_shape_idx++) {
+		file->store_pascal_string(topology_data_mesh->get_blend_shape_name(blend_shape_idx));
+	}
+
+	file->store_32(topology_data_mesh->get_surface_count());
+	const AABB quantization_aabb = topology_data_mesh->get_quantized_storage() ? TopologyDataQuantization::get_mesh_aabb(topology_data_mesh.ptr()) : AABB();
+	for (int surface_index = 0; surface_index < topology_data_mesh->get_surface_count(); surface_index++) {
+		file->store_pascal_string(topology_data_mesh->surface_get_name(surface_index));
+		file->store_32(topology_data_mesh->surface_get_format(surface_index));
+		file->store_32(topology_data_mesh->surface_get_topology_type(surface_index));
+		Dictionary quantization;
+		Array arrays = topology_data_mesh->surface_get_arrays(surface_index);
+		if (topology_data_mesh->get_quantized_storage()) {
+			arrays = TopologyDataQuantization::quantize_arrays(arrays, quantization_aabb, quantization);
+		}
+		file->store_var(quantization);
+
+		//materials saved in their own file only get referenced
+		Ref<Material> material = topology_data_mesh->surface_get_material(surface_index);
+		if (material.is_null()) {
+			file->store_8(TopologyDataMeshFormat::MATERIAL_NONE);
+		} else if (!material->get_path().is_empty() && !material->get_path().contains("::")) {
+			file->store_8(TopologyDataMeshFormat::MATERIAL_EXTERNAL);
+			file->store_pascal_string(material->get_path());
+		} else {
+			file->store_8(TopologyDataMeshFormat::MATERIAL_EMBEDDED);
+			file->store_var(material, true);
+		}
+		file->store_var(topology_data_mesh->surface_get_lods(surface_index));
+
+		//byte size of arrays and blend shapes, filled in afterwards
+		const uint64_t data_size_position = file->get_position();
+		file->store_64(0);
+		const uint64_t data_start = file->get_position();
+		TopologyDataMeshFormat::write_arrays(file, arrays);
+		Array blend_shape_arrays = topology_data_mesh->surface_get_blend_shape_arrays(surface_index);
+		file->store_32(blend_shape_arrays.size());
+		for (int blend_shape_idx = 0; blend_shape_idx < blend_shape_arrays.size(); blend_shape_idx++) {
+			if (topology_data_mesh->get_quantized_storage()) {
+				TopologyDataMeshFormat::write_arrays(file, TopologyDataQuantization::quantize_blend_shape_arrays(blend_shape_arrays[blend_shape_idx]));
+			} else {
+				TopologyDataMeshFormat::write_arrays(file, blend_shape_arrays[blend_shape_idx]);
+			}
+		}
+		const uint64_t data_end = file->get_position();
+		file->seek(data_size_position);
+		file->store_64(data_end - data_start);
+		file->seek(data_end);
+
+		const PackedInt32Array refinement_levels = topology_data_mesh->surface_get_refinement_levels(surface_index);
+		file->store_32(refinement_levels.size());
+		for (int level_index = 0; level_index < refinement_levels.size(); level_index++) {
+			file->store_32(refinement_levels[level_index]);
+			TopologyDataMeshFormat::write_arrays(file, topology_data_mesh->surface_get_refinement_data(surface_index, refinement_levels[level_index]));
+		}
+	}
+
+	return file->get_error() == OK || file->get_error() == ERR_FILE_EOF ? OK : ERR_FILE_CANT_WRITE;
+}
+
+bool TopologyDataMeshFormatSaver::_recognize(const Ref<Resource> &p_resource) const {
+	return Object::cast_to<TopologyDataMesh>(p_resource.ptr()) != nullptr;
+}
+
+PackedStringArray TopologyDataMeshFormatSaver::_get_recognized_extensions(const Ref<Resource> &p_resource) const {
+	PackedStringArray extensions;
+	if (_recognize(p_resource)) {
+		extensions.push_back(TopologyDataMeshFormat::EXTENSION);
+	}
+	return extensions;
+}
+
+void TopologyDataMeshFormatLoader::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("set_use_memory_mapping", "use_memory_mapping"), &TopologyDataMeshFormatLoader::set_use_memory_mapping);
+	ClassDB::bind_method(D_METHOD("get_use_memory_mapping"), &TopologyDataMeshFormatLoader::get_use_memory_mapping);
+	ClassDB::bind_method(D_METHOD("set_lazy_loading", "lazy_loading"), &TopologyDataMeshFormatLoader::set_lazy_loading);
+	ClassDB::bind_method(D_METHOD("get_lazy_loading"), &TopologyDataMeshFormatLoader::get_lazy_loading);
+
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "use_memory_mapping"), "set_use_memory_mapping", "get_use_memory_mapping");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "lazy_loading"), "set_lazy_loading", "get_lazy_loading");
+}
+
+void TopologyDataMeshFormatLoader::set_use_memory_mapping(bool p_use_memory_mapping) {
+	use_memory_mapping = p_use_memory_mapping;
+}
+
+bool TopologyDataMeshFormatLoader::get_use_memory_mapping() const {
+	return use_memory_mapping;
+}
+
+void TopologyDataMeshFormatLoader::set_lazy_loading(bool p_lazy_loading) {
+	lazy_loading = p_lazy_loading;
+}
+
+bool TopologyDataMeshFormatLoader::get_lazy_loading() const {
+	return lazy_loading;
+}
+
+Ref<TopologyDataMesh> TopologyDataMeshFormatLoader::load_topology_data_mesh(const String &p_path, Error &r_error) const {
+	Ref<FileAccess> file = FileAccess::open(p_path, FileAccess::READ);
+	r_error = FileAccess::get_open_error();
+	ERR_FAIL_COND_V_MSG(file.is_null(), Ref<TopologyDataMesh>(), "Couldn't open " + p_path);
+
+	r_error = ERR_FILE_UNRECOGNIZED;
+	ERR_FAIL_COND_V_MSG(file->get_32() != TopologyDataMeshFormat::MAGIC, Ref<TopologyDataMesh>(), p_path + " is not a TopologyDataMesh file.");
+	const uint32_t version = file->get_32();
+	ERR_FAIL_COND_V_MSG(version > TopologyDataMeshFormat::VERSION, Ref<TopologyDataMesh>(), p_path + " was saved with a newer version.");
+	ERR_FAIL_COND_V_MSG(file->get_8() != sizeof(real_t), Ref<TopologyDataMesh>(), p_path + " was saved with a different float precision.");
+
+	r_error = ERR_FILE_CORRUPT;
+	Ref<MappedFile> mapped_file;
+	bool use_mapping = version >= 3 && use_memory_mapping;
+	Ref<TopologyDataMesh> topology_data_mesh;
+	topology_data_mesh.instantiate();
+	topology_data_mesh->set_name(file->get_pascal_string());
+
+	const uint32_t blend_shape_count = file->get_32();
+	for (uint32_t blend_shape_idx = 0; blend_shape_idx < blend_shape_count && !file->eof_reached(); blend_shape_idx++) {
+		topology_data_mesh->blend_shapes.push_back(StringName(file->get_pascal_string()));
+	}
+
+	const uint32_t surface_count = file->get_32();
+	for (uint32_t surface_index = 0; surface_index < surface_count; surface_index++) {
+		ERR_FAIL_COND_V(file->eof_reached(), Ref<TopologyDataMesh>());
+		const String name = file->get_pascal_string();
+		const int32_t format = file->get_32();
+		const uint32_t stored_topology_type = file->get_32();
+		ERR_FAIL_COND_V_MSG(stored_topology_type > TopologyDataMesh::MIXED, Ref<TopologyDataMesh>(), "Unknown topology type in " + p_path);
+		const TopologyDataMesh::TopologyType topology_type = static_cast<TopologyDataMesh::TopologyType>(stored_topology_type);
+		const Dictionary quantization = version >= 4 ? Dictionary(file->get_var()) : Dictionary();
+
+		Ref<Material> material;
+		switch (file->get_8()) {
+			case TopologyDataMeshFormat::MATERIAL_NONE:
+				break;
+			case TopologyDataMeshFormat::MATERIAL_EXTERNAL:
+				material = ResourceLoader::get_singleton()->load(file->get_pascal_string());
+				break;
+			case TopologyDataMeshFormat::MATERIAL_EMBEDDED:
+				material = file->get_var(true);
+				break;
+			default:
+				ERR_FAIL_V_MSG(Ref<TopologyDataMesh>(), "Unknown material type in " + p_path);
+		}
+		const Dictionary lods = file->get_var();
+
+		if (!quantization.is_empty()) {
+			topology_data_mesh->set_quantized_storage(true);
+		}
+
+		const uint64_t data_size = version >= 5 ? file->get_64() : 0;
+		if (version >= 5 && lazy_loading) {
+			ERR_FAIL_COND_V(data_size > file->get_length() - file->get_position(), Ref<TopologyDataMesh>());
+			TopologyDataMesh::LazySurfaceData lazy_data;
+			lazy_data.file = file;
+			lazy_data.offset = file->get_position();
+			lazy_data.version = version;
+			lazy_data.quantization = quantization;
+			topology_data_mesh->_add_lazy_surface(lazy_data, lods, material, name, format, topology_type);
+			file->seek(lazy_data.offset + data_size);
+		} else {
+			Array arrays;
+			Array blend_shape_arrays;
+			ERR_FAIL_COND_V(TopologyDataMeshFormat::read_surface_data(file, version, quantization, arrays, blend_shape_arrays) != OK, Ref<TopologyDataMesh>());
+			ERR_FAIL_COND_V(blend_shape_arrays.size() != int(blend_shape_count) && !blend_shape_arrays.is_empty(), Ref<TopologyDataMesh>());
+			ERR_FAIL_COND_V(!topology_data_mesh->_add_surface(arrays, lods, blend_shape_arrays, material, name, format, topology_type), Ref<TopologyDataMesh>());
+		}
+
+		const uint32_t refinement_level_count = version >= 2 ? file->get_32() : 0;
+		if (refinement_level_count && use_mapping && mapped_file.is_null()) {
+			//stencil tables are the biggest part and only get read per frame, they stay in the mapping
+			mapped_file.instantiate();
+			if (mapped_file->open(p_path) != OK) {
+				mapped_file = Ref<MappedFile>();
+				use_mapping = false;
+			}
+		}
+		for (uint32_t level_index = 0; level_index < refinement_level_count; level_index++) {
+			const int32_t level = file->get_32();
+			Array refinement_arrays;
+			TopologyDataMeshFormat::MappedSection mapped_sections[TopologyDataMesh::REFINEMENT_MAX];
+			const uint32_t mapped_mask = use_mapping ? STENCIL_SECTION_MASK : 0;
+			ERR_FAIL_COND_V(TopologyDataMeshFormat::read_arrays(file, refinement_arrays, version, mapped_mask, mapped_sections) != OK, Ref<TopologyDataMesh>());
+			if (!use_mapping) {
+				topology_data_mesh->surface_set_refinement_data(surface_index, level, refinement_arrays);
+				continue;
+			}
+
+			TopologyDataMesh::MappedStencilTable stencil_table;
+			stencil_table.mapped_file = mapped_file;
+			for (int array_index = TopologyDataMesh::REFINEMENT_STENCIL_SIZES; array_index <= TopologyDataMesh::REFINEMENT_STENCIL_WEIGHTS; array_index++) {
+				const TopologyDataMeshFormat::MappedSection &section = mapped_sections[array_index];
+				const TopologyDataMeshFormat::SectionType expected_type = array_index == TopologyDataMesh::REFINEMENT_STENCIL_WEIGHTS
+						? TopologyDataMeshFormat::SECTION_FLOAT32
+						: TopologyDataMeshFormat::SECTION_INT32;
+				ERR_FAIL_COND_V(section.type != expected_type, Ref<TopologyDataMesh>());
+				ERR_FAIL_COND_V(section.offset + uint64_t(section.count) * 4 > mapped_file->get_size(), Ref<TopologyDataMesh>());
+				stencil_table.offsets[array_index] = section.offset;
+				stencil_table.counts[array_index] = section.count;
+			}
+			topology_data_mesh->_surface_set_mapped_refinement_data(surface_index, level, refinement_arrays, stencil_table);
+		}
+	}
+
+	r_error = OK;
+	topology_data_mesh->emit_changed();
+	return topology_data_mesh;
+}
+
+PackedStringArray TopologyDataMeshFormatLoader::_get_recognized_extensions() const {
+	PackedStringArray extensions;
+	extensions.push_back(TopologyDataMeshFormat::EXTENSION);
+	return extensions;
+}
+
+bool TopologyDataMeshFormatLoader::_handles_type(const StringName &p_type) const {
+	return p_type == StringName("TopologyDataMesh");
+}
+
+String TopologyDataMeshFormatLoader::_get_resource_type(const String &p_path) const {
+	if (p_path.get_extension().to_lower() == TopologyDataMeshFormat::EXTENSION) {
+		return "TopologyDataMesh";
+	}
+	return "";
+}
+
+Variant TopologyDataMeshFormatLoader::_load(const String &p_path, const String &p_original_path, bool p_use_sub_threads, int32_t p_cache_mode) const {
+	Error err;
+	Ref<TopologyDataMesh> topology_data_mesh = load_topology_data_mesh(p_path, err);
+	if (err != OK) {
+		return err;
+	}
+	return topology_data_mesh;
+}
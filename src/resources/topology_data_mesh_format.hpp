@@ -0,0 +1,138 @@
+#pragma once
+
+#include "godot_cpp/classes/file_access.hpp"
+#include "godot_cpp/classes/resource_format_loader.hpp"
+#include "godot_cpp/classes/resource_format_saver.hpp"
+
+#include "resources/topology_data_mesh.hpp"
+
+using namespace godot;
+
+/**
+ * @brief Binary format for TopologyDataMesh (.tdmesh). Arrays get written as raw typed sections instead of Variants,
+ * so files stay small and loading is mostly memcpy.
+ *
+ * @details Layout (little endian): magic "TDMS", version, size of real_t, blend shape names, then per surface
+ * name, format, topology type, material, lods, the surface arrays, the blend shape arrays and (since version 2)
+ * the precomputed refinement data per level. Every array is stored as type tag, element count and raw data.
+ * Since version 3 raw data starts at a multiple of SECTION_ALIGNMENT, so stencil tables can be used straight from
+ * a memory mapping of the file instead of getting copied. Version 4 adds the quantization Dictionary after the topology type,
+ * it's empty unless the mesh uses quantized storage. Version 5 stores the byte size of surface and blend shape arrays
+ * in front of them, so the loader can skip them and read them only when they're requested.
+ */
+class TopologyDataMeshFormat {
+public:
+	static const uint32_t MAGIC = 0x534d4454; //"TDMS"
+	static const uint32_t VERSION = 5;
+	static const uint32_t SECTION_ALIGNMENT = 16;
+	static const char *EXTENSION;
+
+	enum SectionType : uint8_t {
+		SECTION_NULL = 0,
+		SECTION_VECTOR3 = 1,
+		SECTION_VECTOR2 = 2,
+		SECTION_INT32 = 3,
+		SECTION_FLOAT32 = 4,
+		SECTION_COLOR = 5,
+		SECTION_BYTES = 6, //quantized data
+		SECTION_VARIANT = 255, //anything else, stored with store_var
+	};
+
+	enum MaterialType : uint8_t {
+		MATERIAL_NONE = 0,
+		MATERIAL_EXTERNAL = 1,
+		MATERIAL_EMBEDDED = 2,
+	};
+
+	/**
+	 * @brief Location of raw section data inside the file, used for sections that stay in the memory mapping
+	 *
+	 */
+	struct MappedSection {
+		uint64_t offset = 0;
+		uint32_t count = 0;
+		SectionType type = SECTION_NULL; //stays SECTION_NULL if the array wasn't a raw section
+	};
+
+	static void write_arrays(const Ref<FileAccess> &p_file, const Array &p_arrays);
+	/**
+	 * @brief Reads arrays written by write_arrays
+	 *
+	 * @param p_file
+	 * @param r_arrays
+	 * @param p_version file version
+	 * @param p_mapped_mask bit per array index, raw sections with their bit set get skipped and stay null in r_arrays,
+	 * their location is written to r_mapped_sections instead. Needs version 3 (aligned sections).
+	 * @param r_mapped_sections needs to hold an entry for every bit in p_mapped_mask
+	 */
+	static Error read_arrays(const Ref<FileAccess> &p_file, Array &r_arrays, uint32_t p_version = VERSION,
+			uint32_t p_mapped_mask = 0, MappedSection *r_mapped_sections = nullptr);
+	/**
+	 * @brief Reads the surface arrays and blend shape arrays of one surface starting at the current file position
+	 * and dequantizes them
+	 *
+	 * @param p_file
+	 * @param p_version file version
+	 * @param p_quantization quantization Dictionary of the surface, empty if it isn't quantized
+	 * @param r_arrays
+	 * @param r_blend_shape_arrays
+	 */
+	static Error read_surface_data(const Ref<FileAccess> &p_file, uint32_t p_version, const Dictionary &p_quantization,
+			Array &r_arrays, Array &r_blend_shape_arrays);
+};
+
+class TopologyDataMeshFormatSaver : public ResourceFormatSaver {
+	GDCLASS(TopologyDataMeshFormatSaver, ResourceFormatSaver);
+
+protected:
+	static void _bind_methods();
+
+public:
+	virtual Error _save(const Ref<Resource> &p_resource, const String &p_path, uint32_t p_flags) override;
+	virtual bool _recognize(const Ref<Resource> &p_resource) const override;
+	virtual PackedStringArray _get_recognized_extensions(const Ref<Resource> &p_resource) const override;
+};
+
+class TopologyDataMeshFormatLoader : public ResourceFormatLoader {
+	GDCLASS(TopologyDataMeshFormatLoader, ResourceFormatLoader);
+
+private:
+	bool use_memory_mapping = true;
+	bool lazy_loading = true;
+
+protected:
+	static void _bind_methods();
+
+public:
+	/**
+	 * @brief If enabled (default) stencil tables of version 3 files stay in a read only memory mapping of the file
+	 * and get paged in when they're first used. Files inside a pck always get copied.
+	 *
+	 * @param p_use_memory_mapping
+	 */
+	void set_use_memory_mapping(bool p_use_memory_mapping);
+	bool get_use_memory_mapping() const;
+
+	/**
+	 * @brief If enabled (default) arrays and blend shapes of version 5 files only get read when a surface is first
+	 * requested, see TopologyDataMesh::surface_is_loaded. The file stays open until every surface was read.
+	 *
+	 * @param p_lazy_loading
+	 */
+	void set_lazy_loading(bool p_lazy_loading);
+	bool get_lazy_loading() const;
+
+	/**
+	 * @brief Reads a .tdmesh file, all surfaces get added at once so changed only gets emitted once
+	 *
+	 * @param p_path
+	 * @param r_error
+	 * @return Ref<TopologyDataMesh> null on error
+	 */
+	Ref<TopologyDataMesh> load_topology_data_mesh(const String &p_path, Error &r_error) const;
+
+	virtual PackedStringArray _get_recognized_extensions() const override;
+	virtual bool _handles_type(const StringName &p_type) const override;
+	virtual String _get_resource_type(const String &p_path) const override;
+	virtual Variant _load(const String &p_path, const String &p_original_path, bool p_use_sub_threads, int32_t p_cache_mode) const override;
+};
@@ -0,0 +1,336 @@
+#include "topology_data_quantization.hpp"
+
+#include "godot_cpp/variant/packed_byte_array.hpp"
+#include "resources/topology_data_mesh.hpp"
+
+#include <cmath>
+
+static const float UNORM16_MAX = 65535.0f;
+static const real_t GRID_MAX_INTEGER = 16777216.0; //2^24, every integer multiple of a grid step up to this fits into a float
+static const uint16_t HALF_MAX = 0x7bff; //65504
+
+static uint16_t _float_to_half(float p_value) {
+	uint32_t bits;
+	memcpy(&bits, &p_value, sizeof(float));
+	const uint16_t sign = (bits >> 16) & 0x8000;
+	const int32_t exponent = int32_t((bits >> 23) & 0xff) - 127 + 15;
+	uint32_t mantissa = bits & 0x7fffff;
+
+	if (exponent <= 0) { //subnormal or zero
+		if (exponent < -10) {
+			return sign;
+		}
+		mantissa |= 0x800000;
+		const int32_t shift = 14 - exponent;
+		uint16_t half = mantissa >> shift;
+		if ((mantissa >> (shift - 1)) & 1) {
+			half++;
+		}
+		return sign | half;
+	}
+	if (exponent >= 31) { //clamp to the largest finite half, inf would break every vertex it gets added to
+		return sign | HALF_MAX;
+	}
+	uint16_t half = sign | (exponent << 10) | (mantissa >> 13);
+	if ((mantissa & 0x1000) && (half & 0x7fff) != HALF_MAX) { //round, carry moves into the exponent correctly
+		half++;
+	}
+	return half;
+}
+
+static float _half_to_float(uint16_t p_half) {
+	const uint32_t sign = uint32_t(p_half & 0x8000) << 16;
+	int32_t exponent = (p_half >> 10) & 0x1f;
+	uint32_t mantissa = p_half & 0x3ff;
+	uint32_t bits;
+	if (exponent == 0) {
+		if (mantissa == 0) {
+			bits = sign;
+		} else { //subnormal, normalize
+			exponent = 1;
+			while (!(mantissa & 0x400)) {
+				mantissa <<= 1;
+				exponent--;
+			}
+			mantissa &= 0x3ff;
+			bits = sign | (uint32_t(exponent - 15 + 127) << 23) | (mantissa << 13);
+		}
+	} else if (exponent == 31) {
+		bits = sign | 0x7f800000 | (mantissa << 13);
+	} else {
+		bits = sign | (uint32_t(exponent - 15 + 127) << 23) | (mantissa << 13);
+	}
+	float value;
+	memcpy(&value, &bits, sizeof(float));
+	return value;
+}
+
+static uint16_t _quantize_unorm16(real_t p_value, real_t p_begin, real_t p_size) {
+	if (p_size <= 0) {
+		return 0;
+	}
+	return uint16_t(CLAMP(Math::round((p_value - p_begin) / p_size * UNORM16_MAX), 0.0f, UNORM16_MAX));
+}
+
+static real_t _dequantize_unorm16(uint16_t p_value, real_t p_begin, real_t p_size) {
+	return p_begin + p_size * (p_value / UNORM16_MAX);
+}
+
+/**
+ * @brief Power of two step of the grid [p_begin, p_end] gets quantized on. Grid values are exact multiples of the step,
+ * so quantizing dequantized values again returns the same values, even when the bounds of the dequantized values
+ * are slightly smaller.
+ *
+ */
+static real_t _get_grid_step(real_t p_begin, real_t p_end) {
+	const real_t max_magnitude = MAX(Math::abs(p_begin), Math::abs(p_end));
+	const real_t min_step = MAX((p_end - p_begin) / UNORM16_MAX, max_magnitude / GRID_MAX_INTEGER);
+	if (min_step <= 0) {
+		return 1;
+	}
+	int exponent;
+	const real_t mantissa = std::frexp(min_step, &exponent);
+	real_t step = std::ldexp(real_t(1), mantissa == real_t(0.5) ? exponent - 1 : exponent);
+	while (p_end - Math::floor(p_begin / step) * step > UNORM16_MAX * step) {
+		step *= 2;
+	}
+	return step;
+}
+
+static uint16_t _quantize_grid(real_t p_value, real_t p_origin, real_t p_step) {
+	return uint16_t(CLAMP(Math::round((p_value - p_origin) / p_step), real_t(0), real_t(UNORM16_MAX)));
+}
+
+static real_t _dequantize_grid(uint16_t p_value, real_t p_origin, real_t p_step) {
+	return p_origin + p_value * p_step;
+}
+
+AABB TopologyDataQuantization::get_mesh_aabb(const TopologyDataMesh *p_mesh) {
+	ERR_FAIL_NULL_V(p_mesh, AABB());
+	AABB aabb;
+	bool has_vertices = false;
+	for (int surface_index = 0; surface_index < p_mesh->get_surface_count(); surface_index++) {
+		const Array arrays = p_mesh->surface_get_arrays(surface_index);
+		if (arrays.size() != TopologyDataMesh::ARRAY_MAX || arrays[TopologyDataMesh::ARRAY_VERTEX].get_type() != Variant::PACKED_VECTOR3_ARRAY) {
+			continue;
+		}
+		const PackedVector3Array vertex_array = arrays[TopologyDataMesh::ARRAY_VERTEX];
+		for (int vertex_index = 0; vertex_index < vertex_array.size(); vertex_index++) {
+			if (has_vertices) {
+				aabb.expand_to(vertex_array[vertex_index]);
+			} else {
+				aabb.position = vertex_array[vertex_index];
+				has_vertices = true;
+			}
+		}
+	}
+	return aabb;
+}
+
+Array TopologyDataQuantization::quantize_arrays(const Array &p_arrays, const AABB &p_aabb, Dictionary &r_quantization) {
+	Array quantized_arrays = p_arrays.duplicate(false);
+	r_quantization.clear();
+
+	if (p_arrays[TopologyDataMesh::ARRAY_VERTEX].get_type() == Variant::PACKED_VECTOR3_ARRAY) {
+		const PackedVector3Array &vertex_array = p_arrays[TopologyDataMesh::ARRAY_VERTEX];
+		Vector3 origin;
+		Vector3 step;
+		for (int axis = 0; axis < 3; axis++) {
+			step[axis] = _get_grid_step(p_aabb.position[axis], p_aabb.get_end()[axis]);
+			origin[axis] = Math::floor(p_aabb.position[axis] / step[axis]) * step[axis];
+		}
+		PackedByteArray quantized_vertices;
+		quantized_vertices.resize(vertex_array.size() * 3 * sizeof(uint16_t));
+		uint16_t *quantized_ptrw = reinterpret_cast<uint16_t *>(quantized_vertices.ptrw());
+		for (int vertex_index = 0; vertex_index < vertex_array.size(); vertex_index++) {
+			for (int axis = 0; axis < 3; axis++) {
+				quantized_ptrw[vertex_index * 3 + axis] = _quantize_grid(vertex_array[vertex_index][axis], origin[axis], step[axis]);
+			}
+		}
+		quantized_arrays[TopologyDataMesh::ARRAY_VERTEX] = quantized_vertices;
+		r_quantization["vertex_origin"] = origin;
+		r_quantization["vertex_step"] = step;
+	}
+
+	if (p_arrays[TopologyDataMesh::ARRAY_TEX_UV].get_type() == Variant::PACKED_VECTOR2_ARRAY) {
+		const PackedVector2Array &uv_array = p_arrays[TopologyDataMesh::ARRAY_TEX_UV];
+		Rect2 uv_rect;
+		if (uv_array.size()) {
+			uv_rect.position = uv_array[0];
+		}
+		for (int uv_index = 1; uv_index < uv_array.size(); uv_index++) {
+			uv_rect.expand_to(uv_array[uv_index]);
+		}
+		Vector2 origin;
+		Vector2 step;
+		for (int axis = 0; axis < 2; axis++) {
+			step[axis] = _get_grid_step(uv_rect.position[axis], uv_rect.get_end()[axis]);
+			origin[axis] = Math::floor(uv_rect.position[axis] / step[axis]) * step[axis];
+		}
+		PackedByteArray quantized_uvs;
+		quantized_uvs.resize(uv_array.size() * 2 * sizeof(uint16_t));
+		uint16_t *quantized_ptrw = reinterpret_cast<uint16_t *>(quantized_uvs.ptrw());
+		for (int uv_index = 0; uv_index < uv_array.size(); uv_index++) {
+			quantized_ptrw[uv_index * 2] = _quantize_grid(uv_array[uv_index].x, origin.x, step.x);
+			quantized_ptrw[uv_index * 2 + 1] = _quantize_grid(uv_array[uv_index].y, origin.y, step.y);
+		}
+		quantized_arrays[TopologyDataMesh::ARRAY_TEX_UV] = quantized_uvs;
+		r_quantization["uv_origin"] = origin;
+		r_quantization["uv_step"] = step;
+	}
+
+	if (p_arrays[TopologyDataMesh::ARRAY_BONES].get_type() == Variant::PACKED_INT32_ARRAY) {
+		const PackedInt32Array &bones_array = p_arrays[TopologyDataMesh::ARRAY_BONES];
+		int32_t highest_bone = 0;
+		for (int bone_index = 0; bone_index < bones_array.size(); bone_index++) {
+			highest_bone = MAX(highest_bone, bones_array[bone_index]);
+		}
+		if (highest_bone <= UINT16_MAX) {
+			const int bone_bytes = highest_bone <= UINT8_MAX ? 1 : 2;
+			PackedByteArray quantized_bones;
+			quantized_bones.resize(bones_array.size() * bone_bytes);
+			uint8_t *quantized_ptrw = quantized_bones.ptrw();
+			for (int bone_index = 0; bone_index < bones_array.size(); bone_index++) {
+				if (bone_bytes == 1) {
+					quantized_ptrw[bone_index] = bones_array[bone_index];
+				} else {
+					const uint16_t bone = bones_array[bone_index];
+					memcpy(quantized_ptrw + bone_index * 2, &bone, sizeof(uint16_t));
+				}
+			}
+			quantized_arrays[TopologyDataMesh::ARRAY_BONES] = quantized_bones;
+			r_quantization["bone_bytes"] = bone_bytes;
+		}
+	}
+
+	if (p_arrays[TopologyDataMesh::ARRAY_WEIGHTS].get_type() == Variant::PACKED_FLOAT32_ARRAY) {
+		const PackedFloat32Array &weights_array = p_arrays[TopologyDataMesh::ARRAY_WEIGHTS];
+		PackedByteArray quantized_weights;
+		quantized_weights.resize(weights_array.size() * sizeof(uint16_t));
+		uint16_t *quantized_ptrw = reinterpret_cast<uint16_t *>(quantized_weights.ptrw());
+		for (int weight_index = 0; weight_index < weights_array.size(); weight_index++) {
+			quantized_ptrw[weight_index] = _quantize_unorm16(weights_array[weight_index], 0, 1);
+		}
+		quantized_arrays[TopologyDataMesh::ARRAY_WEIGHTS] = quantized_weights;
+	}
+
+	return quantized_arrays;
+}
+
+Array TopologyDataQuantization::dequantize_arrays(const Array &p_arrays, const Dictionary &p_quantization) {
+	Array arrays = p_arrays.duplicate(false);
+
+	if (p_arrays[TopologyDataMesh::ARRAY_VERTEX].get_type() == Variant::PACKED_BYTE_ARRAY) {
+		const bool use_grid = p_quantization.has("vertex_step");
+		ERR_FAIL_COND_V(!use_grid && !p_quantization.has("aabb"), Array());
+		//files from before the grid stored the bounds instead
+		const AABB aabb = p_quantization.get("aabb", AABB());
+		const Vector3 origin = p_quantization.get("vertex_origin", Vector3());
+		const Vector3 step = p_quantization.get("vertex_step", Vector3());
+		const PackedByteArray &quantized_vertices = p_arrays[TopologyDataMesh::ARRAY_VERTEX];
+		const uint16_t *quantized_ptr = reinterpret_cast<const uint16_t *>(quantized_vertices.ptr());
+		PackedVector3Array vertex_array;
+		vertex_array.resize(quantized_vertices.size() / (3 * sizeof(uint16_t)));
+		Vector3 *vertex_ptrw = vertex_array.ptrw();
+		for (int vertex_index = 0; vertex_index < vertex_array.size(); vertex_index++) {
+			for (int axis = 0; axis < 3; axis++) {
+				const uint16_t quantized_value = quantized_ptr[vertex_index * 3 + axis];
+				vertex_ptrw[vertex_index][axis] = use_grid ? _dequantize_grid(quantized_value, origin[axis], step[axis])
+														   : _dequantize_unorm16(quantized_value, aabb.position[axis], aabb.size[axis]);
+			}
+		}
+		arrays[TopologyDataMesh::ARRAY_VERTEX] = vertex_array;
+	}
+
+	if (p_arrays[TopologyDataMesh::ARRAY_TEX_UV].get_type() == Variant::PACKED_BYTE_ARRAY) {
+		const bool use_grid = p_quantization.has("uv_step");
+		ERR_FAIL_COND_V(!use_grid && !p_quantization.has("uv_rect"), Array());
+		const Rect2 uv_rect = p_quantization.get("uv_rect", Rect2());
+		const Vector2 origin = p_quantization.get("uv_origin", Vector2());
+		const Vector2 step = p_quantization.get("uv_step", Vector2());
+		const PackedByteArray &quantized_uvs = p_arrays[TopologyDataMesh::ARRAY_TEX_UV];
+		const uint16_t *quantized_ptr = reinterpret_cast<const uint16_t *>(quantized_uvs.ptr());
+		PackedVector2Array uv_array;
+		uv_array.resize(quantized_uvs.size() / (2 * sizeof(uint16_t)));
+		Vector2 *uv_ptrw = uv_array.ptrw();
+		for (int uv_index = 0; uv_index < uv_array.size(); uv_index++) {
+			for (int axis = 0; axis < 2; axis++) {
+				const uint16_t quantized_value = quantized_ptr[uv_index * 2 + axis];
+				uv_ptrw[uv_index][axis] = use_grid ? _dequantize_grid(quantized_value, origin[axis], step[axis])
+												   : _dequantize_unorm16(quantized_value, uv_rect.position[axis], uv_rect.size[axis]);
+			}
+		}
+		arrays[TopologyDataMesh::ARRAY_TEX_UV] = uv_array;
+	}
+
+	if (p_arrays[TopologyDataMesh::ARRAY_BONES].get_type() == Variant::PACKED_BYTE_ARRAY) {
+		const int bone_bytes = p_quantization.get("bone_bytes", 1);
+		ERR_FAIL_COND_V(bone_bytes != 1 && bone_bytes != 2, Array());
+		const PackedByteArray &quantized_bones = p_arrays[TopologyDataMesh::ARRAY_BONES];
+		const uint8_t *quantized_ptr = quantized_bones.ptr();
+		PackedInt32Array bones_array;
+		bones_array.resize(quantized_bones.size() / bone_bytes);
+		int32_t *bones_ptrw = bones_array.ptrw();
+		for (int bone_index = 0; bone_index < bones_array.size(); bone_index++) {
+			if (bone_bytes == 1) {
+				bones_ptrw[bone_index] = quantized_ptr[bone_index];
+			} else {
+				uint16_t bone;
+				memcpy(&bone, quantized_ptr + bone_index * 2, sizeof(uint16_t));
+				bones_ptrw[bone_index] = bone;
+			}
+		}
+		arrays[TopologyDataMesh::ARRAY_BONES] = bones_array;
+	}
+
+	if (p_arrays[TopologyDataMesh::ARRAY_WEIGHTS].get_type() == Variant::PACKED_BYTE_ARRAY) {
+		const PackedByteArray &quantized_weights = p_arrays[TopologyDataMesh::ARRAY_WEIGHTS];
+		const uint16_t *quantized_ptr = reinterpret_cast<const uint16_t *>(quantized_weights.ptr());
+		PackedFloat32Array weights_array;
+		weights_array.resize(quantized_weights.size() / sizeof(uint16_t));
+		float *weights_ptrw = weights_array.ptrw();
+		for (int weight_index = 0; weight_index < weights_array.size(); weight_index++) {
+			weights_ptrw[weight_index] = quantized_ptr[weight_index] / UNORM16_MAX;
+		}
+		arrays[TopologyDataMesh::ARRAY_WEIGHTS] = weights_array;
+	}
+
+	return arrays;
+}
+
+Array TopologyDataQuantization::quantize_blend_shape_arrays(const Array &p_blend_shape_arrays) {
+	Array quantized_arrays = p_blend_shape_arrays.duplicate(false);
+	if (p_blend_shape_arrays[TopologyDataMesh::ARRAY_VERTEX].get_type() != Variant::PACKED_VECTOR3_ARRAY) {
+		return quantized_arrays;
+	}
+	const PackedVector3Array &delta_array = p_blend_shape_arrays[TopologyDataMesh::ARRAY_VERTEX];
+	PackedByteArray quantized_deltas;
+	quantized_deltas.resize(delta_array.size() * 3 * sizeof(uint16_t));
+	uint16_t *quantized_ptrw = reinterpret_cast<uint16_t *>(quantized_deltas.ptrw());
+	for (int vertex_index = 0; vertex_index < delta_array.size(); vertex_index++) {
+		for (int axis = 0; axis < 3; axis++) {
+			quantized_ptrw[vertex_index * 3 + axis] = _float_to_half(delta_array[vertex_index][axis]);
+		}
+	}
+	quantized_arrays[TopologyDataMesh::ARRAY_VERTEX] = quantized_deltas;
+	return quantized_arrays;
+}
+
+Array TopologyDataQuantization::dequantize_blend_shape_arrays(const Array &p_blend_shape_arrays) {
+	Array arrays = p_blend_shape_arrays.duplicate(false);
+	if (p_blend_shape_arrays[TopologyDataMesh::ARRAY_VERTEX].get_type() != Variant::PACKED_BYTE_ARRAY) {
+		return arrays;
+	}
+	const PackedByteArray &quantized_deltas = p_blend_shape_arrays[TopologyDataMesh::ARRAY_VERTEX];
+	const uint16_t *quantized_ptr = reinterpret_cast<const uint16_t *>(quantized_deltas.ptr());
+	PackedVector3Array delta_array;
+	delta_array.resize(quantized_deltas.size() / (3 * sizeof(uint16_t)));
+	Vector3 *delta_ptrw = delta_array.ptrw();
+	for (int vertex_index = 0; vertex_index < delta_array.size(); vertex_index++) {
+		for (int axis = 0; axis < 3; axis++) {
+			delta_ptrw[vertex_index][axis] = _half_to_float(quantized_ptr[vertex_index * 3 + axis]);
+		}
+	}
+	arrays[TopologyDataMesh::ARRAY_VERTEX] = delta_array;
+	return arrays;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "godot_cpp/variant/aabb.hpp"
+#include "godot_cpp/variant/array.hpp"
+#include "godot_cpp/variant/dictionary.hpp"
+
+using namespace godot;
+
+class TopologyDataMesh;
+
+/**
+ * @brief Quantized storage for TopologyDataMesh, only used while saving and loading. Data gets dequantized on load,
+ * so everything else keeps working with the full precision arrays.
+ *
+ * @details Vertices are stored as 16 bit per component on a grid covering the AABB of the whole mesh, UV's as 16 bit on
+ * a grid covering their bounds, bones as 8 or 16 bit depending on the highest bone index, weights as 16 bit unorm and
+ * blend shape deltas as half floats. Grid steps are powers of two, so quantizing a loaded mesh again gives the exact
+ * same arrays, which keeps hashes of quantized meshes stable. Quantized arrays are PackedByteArrays in the same array slot, the Dictionary returned next to
+ * them contains everything needed to restore them. Index arrays stay as they are.
+ */
+class TopologyDataQuantization {
+public:
+	/**
+	 * @brief AABB of the vertices of all surfaces. Surfaces that share boundary vertices need to be quantized relative
+	 * to the same bounds, otherwise those vertices round to different positions and open cracks.
+	 *
+	 */
+	static AABB get_mesh_aabb(const TopologyDataMesh *p_mesh);
+
+	/**
+	 * @brief Quantizes vertex, uv, bones and weights array of a surface
+	 *
+	 * @param p_arrays TopologyDataMesh surface arrays
+	 * @param p_aabb bounds the vertices get quantized in, see get_mesh_aabb
+	 * @param r_quantization gets filled with bounds and bone size
+	 * @return Array copy of p_arrays with quantized slots
+	 */
+	static Array quantize_arrays(const Array &p_arrays, const AABB &p_aabb, Dictionary &r_quantization);
+	static Array dequantize_arrays(const Array &p_arrays, const Dictionary &p_quantization);
+
+	/**
+	 * @brief Stores relative blend shape vertices as half floats, deltas beyond the half range get clamped to it
+	 *
+	 * @param p_blend_shape_arrays single blend shape array
+	 * @return Array
+	 */
+	static Array quantize_blend_shape_arrays(const Array &p_blend_shape_arrays);
+	static Array dequantize_blend_shape_arrays(const Array &p_blend_shape_arrays);
+};
@@ -0,0 +1,117 @@
+#include "mixed_subdivider.hpp"
+#include "godot_cpp/classes/geometry2d.hpp"
+#include "godot_cpp/classes/mesh.hpp"
+
+using namespace OpenSubdiv;
+
+OpenSubdiv::Sdc::SchemeType MixedSubdivider::_get_refiner_type() const {
+	return OpenSubdiv::Sdc::SchemeType::SCHEME_CATMARK;
+}
+
+Array MixedSubdivider::_get_triangle_arrays() {
+	const bool mixed = topology_data.vertex_count_per_face == 0;
+
+	PackedInt32Array triangle_corners;
+	int face_start = 0;
+	for (int face_index = 0; face_index < topology_data.face_count; face_index++) {
+		const int face_vertex_count = mixed ? topology_data.face_vertex_count_array[face_index] : topology_data.vertex_count_per_face;
+		const PackedInt32Array triangles = _triangulate_face(face_start, face_vertex_count);
+		for (int triangle_index = 0; triangle_index < triangles.size(); triangle_index++) {
+			triangle_corners.push_back(face_start + triangles[triangle_index]);
+		}
+		face_start += face_vertex_count;
+	}
+	return _create_triangle_arrays(triangle_corners);
+}
+
+PackedInt32Array MixedSubdivider::_triangulate_face(int face_start, int face_vertex_count) const {
+	PackedInt32Array triangles;
+	if (face_vertex_count == 3) {
+		triangles.append(0);
+		triangles.append(1);
+		triangles.append(2);
+		return triangles;
+	}
+	if (face_vertex_count == 4) { //same split as QuadSubdivider
+		triangles.append(0);
+		triangles.append(1);
+		triangles.append(3);
+		triangles.append(1);
+		triangles.append(2);
+		triangles.append(3);
+		return triangles;
+	}
+
+	//n-gons: project onto plane of the Newell normal and ear clip there, handles concave faces as well
+	PackedVector3Array face_points;
+	face_points.resize(face_vertex_count);
+	Vector3 face_normal;
+	for (int i = 0; i < face_vertex_count; i++) {
+		face_points.set(i, topology_data.vertex_array[topology_data.index_array[face_start + i]]);
+	}
+	for (int i = 0; i < face_vertex_count; i++) {
+		const Vector3 &current = face_points[i];
+		const Vector3 &next = face_points[(i + 1) % face_vertex_count];
+		face_normal.x += (current.y - next.y) * (current.z + next.z);
+		face_normal.y += (current.z - next.z) * (current.x + next.x);
+		face_normal.z += (current.x - next.x) * (current.y + next.y);
+	}
+
+	if (!face_normal.is_zero_approx()) {
+		face_normal.normalize();
+		Vector3 axis_u = (Math::abs(face_normal.x) < 0.9 ? Vector3(1, 0, 0) : Vector3(0, 1, 0)).cross(face_normal).normalized();
+		Vector3 axis_v = face_normal.cross(axis_u);
+		PackedVector2Array projected_points;
+		projected_points.resize(face_vertex_count);
+		for (int i = 0; i < face_vertex_count; i++) {
+			projected_points.set(i, Vector2(face_points[i].dot(axis_u), face_points[i].dot(axis_v)));
+		}
+		triangles = Geometry2D::get_singleton()->triangulate_polygon(projected_points);
+	}
+
+	if (triangles.size() != (face_vertex_count - 2) * 3) { //degenerate face, fan triangulation is still better than a hole
+		triangles.clear();
+		for (int i = 1; i < face_vertex_count - 1; i++) {
+			triangles.append(0);
+			triangles.append(i);
+			triangles.append(i + 1);
+		}
+		return triangles;
+	}
+
+	//ear clipping doesn't guarantee winding, so make every triangle face the same way as the face
+	for (int triangle_start = 0; triangle_start < triangles.size(); triangle_start += 3) {
+		const Vector3 &p_point1 = face_points[triangles[triangle_start]];
+		const Vector3 &p_point2 = face_points[triangles[triangle_start + 1]];
+		const Vector3 &p_point3 = face_points[triangles[triangle_start + 2]];
+		if ((p_point2 - p_point1).cross(p_point3 - p_point1).dot(face_normal) < 0) {
+			int tmp = triangles[triangle_start + 1];
+			triangles.set(triangle_start + 1, triangles[triangle_start + 2]);
+			triangles.set(triangle_start + 2, tmp);
+		}
+	}
+	return triangles;
+}
+
+Vector<int> MixedSubdivider::_get_face_vertex_count() const {
+	Vector<int> face_vertex_count;
+	face_vertex_count.resize(topology_data.face_count);
+	if (topology_data.vertex_count_per_face != 0) {
+		face_vertex_count.fill(topology_data.vertex_count_per_face);
+		return face_vertex_count;
+	}
+	for (int face_index = 0; face_index < topology_data.face_count; face_index++) {
+		face_vertex_count.write[face_index] = topology_data.face_vertex_count_array[face_index];
+	}
+	return face_vertex_count;
+};
+
+int32_t MixedSubdivider::_get_vertices_per_face_count() const {
+	return 0;
+}
+Array MixedSubdivider::_get_direct_triangle_arrays() {
+	return _get_triangle_arrays();
+};
+
+void MixedSubdivider::_bind_methods() {
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "godot_cpp/classes/global_constants.hpp"
+#include "godot_cpp/classes/ref_counted.hpp"
+#include "godot_cpp/core/binder_common.hpp"
+#include "subdivider.hpp"
+
+//Catmull-Clark on faces with any vertex count, after the first subdivision all faces are quads
+class MixedSubdivider : public Subdivider {
+	GDCLASS(MixedSubdivider, Subdivider);
+
+protected:
+	static void _bind_methods();
+
+	/**
+	 * @brief Triangulates a single face of topology_data
+	 *
+	 * @param face_start position of first face vertex in index_array
+	 * @param face_vertex_count
+	 * @return PackedInt32Array triangle indices relative to face_start
+	 */
+	PackedInt32Array _triangulate_face(int face_start, int face_vertex_count) const;
+
+	virtual OpenSubdiv::Sdc::SchemeType _get_refiner_type() const override;
+	virtual Array _get_triangle_arrays() override;
+	virtual Vector<int> _get_face_vertex_count() const override;
+	virtual int32_t _get_vertices_per_face_count() const override;
+	virtual Array _get_direct_triangle_arrays() override;
+};
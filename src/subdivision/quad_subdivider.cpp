@@ -1,6 +1,5 @@
 #include "quad_subdivider.hpp"
 #include "godot_cpp/classes/mesh.hpp"
-#include "godot_cpp/classes/surface_tool.hpp"
 
 using namespace OpenSubdiv;
 
@@ -8,55 +7,23 @@ OpenSubdiv::Sdc::SchemeType QuadSubdivider::_get_refiner_type() const {
 	return OpenSubdiv::Sdc::SchemeType::SCHEME_CATMARK;
 }
 
-Array QuadSubdivider::_get_triangle_arrays() const {
-	Ref<SurfaceTool> st;
-	st.instantiate();
-
-	bool use_uv = topology_data.uv_array.size();
-	bool use_bones = topology_data.bones_array.size();
-	bool has_normals = topology_data.normal_array.size();
-
-	st->begin(Mesh::PRIMITIVE_TRIANGLES);
+Array QuadSubdivider::_get_triangle_arrays() {
+	PackedInt32Array triangle_corners;
+	triangle_corners.resize(topology_data.index_array.size() / 4 * 6);
+	int32_t *triangle_corners_ptrw = triangle_corners.ptrw();
+	int triangle_corner = 0;
 	for (int quad_index = 0; quad_index < topology_data.index_array.size(); quad_index += 4) {
-		//add vertices part of quad
-
-		//after for loop unshared0 vertex will be at the positon quad_index in the new vertex_array in the SurfaceTool
-		for (int single_quad_index = quad_index; single_quad_index < quad_index + 4; single_quad_index++) {
-			if (use_uv) {
-				st->set_uv(topology_data.uv_array[topology_data.uv_index_array[single_quad_index]]);
-			}
-
-			if (has_normals) {
-				st->set_normal(topology_data.normal_array[topology_data.index_array[single_quad_index]]);
-			}
-			if (use_bones) {
-				PackedInt32Array bones_array;
-				PackedFloat32Array weights_array;
-				for (int bone_index = 0; bone_index < 4; bone_index++) {
-					bones_array.append(topology_data.bones_array[topology_data.index_array[single_quad_index] * 4 + bone_index]);
-					weights_array.append(topology_data.weights_array[topology_data.index_array[single_quad_index] * 4 + bone_index]);
-				}
-				st->set_bones(bones_array);
-				st->set_weights(weights_array);
-			}
-			st->add_vertex(topology_data.vertex_array[topology_data.index_array[single_quad_index]]);
-
-		} //unshared0, shared0, unshared1, shared1
-
 		//add triangle 1 with unshared0
-		st->add_index(quad_index);
-		st->add_index(quad_index + 1);
-		st->add_index(quad_index + 3);
+		triangle_corners_ptrw[triangle_corner++] = quad_index;
+		triangle_corners_ptrw[triangle_corner++] = quad_index + 1;
+		triangle_corners_ptrw[triangle_corner++] = quad_index + 3;
 
 		//add triangle 2 with unshared1
-		st->add_index(quad_index + 1);
-		st->add_index(quad_index + 2);
-		st->add_index(quad_index + 3);
-	}
-	if (has_normals && use_uv) {
-		st->generate_tangents();
+		triangle_corners_ptrw[triangle_corner++] = quad_index + 1;
+		triangle_corners_ptrw[triangle_corner++] = quad_index + 2;
+		triangle_corners_ptrw[triangle_corner++] = quad_index + 3;
 	}
-	return st->commit_to_arrays();
+	return _create_triangle_arrays(triangle_corners);
 }
 
 Vector<int> QuadSubdivider::_get_face_vertex_count() const {
@@ -69,7 +36,7 @@ Vector<int> QuadSubdivider::_get_face_vertex_count() const {
 int32_t QuadSubdivider::_get_vertices_per_face_count() const {
 	return 4;
 }
-Array QuadSubdivider::_get_direct_triangle_arrays() const {
+Array QuadSubdivider::_get_direct_triangle_arrays() {
 	return _get_triangle_arrays();
 };
 
@@ -2,10 +2,17 @@
 
 #include "godot_cpp/classes/mesh_data_tool.hpp"
 #include "godot_cpp/classes/rendering_server.hpp"
+#include "godot_cpp/classes/surface_tool.hpp"
 #include "godot_cpp/templates/hash_set.hpp"
+#include "godot_cpp/templates/local_vector.hpp"
 #include "godot_cpp/variant/builtin_types.hpp"
 #include "godot_cpp/variant/utility_functions.hpp"
 #include "resources/topology_data_mesh.hpp"
+#include "utility/parallel_for.hpp"
+#include "utility/vertex_cache_optimizer.hpp"
+#include "utility/vertex_face_fan.hpp"
+
+#include "far/stencilTableFactory.h"
 
 //debug
 // #include <chrono>
@@ -28,7 +35,14 @@ Subdivider::TopologyData::TopologyData(const Array &p_mesh_arrays, int32_t p_for
 
 	vertex_count_per_face = p_face_verts;
 	index_count = index_array.size();
-	face_count = index_array.size() / vertex_count_per_face;
+	if (vertex_count_per_face == 0) { //mixed topology
+		if (p_mesh_arrays.size() > TopologyDataMesh::ARRAY_FACE_VERTEX_COUNT) {
+			face_vertex_count_array = p_mesh_arrays[TopologyDataMesh::ARRAY_FACE_VERTEX_COUNT];
+		}
+		face_count = face_vertex_count_array.size();
+	} else {
+		face_count = index_array.size() / vertex_count_per_face;
+	}
 	vertex_count = vertex_array.size();
 	uv_count = uv_index_array.size();
 	bone_count = bones_array.size();
@@ -134,31 +148,126 @@ Far::TopologyRefiner *Subdivider::_create_topology_refiner(const int32_t p_level
 
 	return refiner;
 }
-void Subdivider::_create_subdivision_vertices(Far::TopologyRefiner *refiner, const int p_level, const int32_t p_format) {
+/**
+ * @brief Storage of one primvar for every refinement level. Either all levels stay in the output one after another,
+ * or (final level only) levels in between alternate between two buffers and only the last level gets written to the output.
+ */
+template <typename T>
+struct LevelBuffers {
+	T *output = nullptr;
+	const T *cage = nullptr; //level 0, only used for final level only
+	LocalVector<int> level_offsets; //start of every level in output, only used if all levels are kept
+	LocalVector<T> buffers[2];
+	bool final_level_only = false;
+	int last_level = 0;
+
+	const T *get_level(int p_level) const {
+		if (!final_level_only) {
+			return output + level_offsets[p_level];
+		}
+		if (p_level == 0) {
+			return cage;
+		}
+		return p_level == last_level ? output : buffers[(p_level - 1) % 2].ptr();
+	}
+
+	//p_level gets written next, the buffer of p_level - 2 gets reused for it
+	T *get_level_for_write(int p_level, int p_count) {
+		if (!final_level_only) {
+			return output + level_offsets[p_level];
+		}
+		if (p_level == last_level) {
+			return output;
+		}
+		LocalVector<T> &buffer = buffers[(p_level - 1) % 2];
+		buffer.resize(p_count);
+		return buffer.ptr();
+	}
+};
+
+void Subdivider::_create_subdivision_vertices(Far::TopologyRefiner *refiner, const int p_level, const int32_t p_format, bool p_measure_lod_errors) {
 	const bool use_uv = p_format & Mesh::ARRAY_FORMAT_TEX_UV;
 	const bool use_bones = (p_format & Mesh::ARRAY_FORMAT_BONES) && (p_format & Mesh::ARRAY_FORMAT_WEIGHTS);
 
-	int original_vertex_count = topology_data.vertex_array.size();
-	topology_data.vertex_array.resize(topology_data.vertex_count);
+	const int original_vertex_count = topology_data.vertex_array.size();
+	const Far::TopologyLevel &last_level = refiner->GetLevel(p_level);
+	Far::PrimvarRefiner primvar_refiner(*refiner);
 
 	// Interpolate vertex primvar data
-	Far::PrimvarRefiner primvar_refiner(*refiner);
-	//vertices
-	Vertex *src = (Vertex *)topology_data.vertex_array.ptr();
+	//vertices, also measures how far vertices move per level for the lod distances
+	const PackedVector3Array cage_vertex_array = topology_data.vertex_array;
+	topology_data.vertex_array.resize(final_level_only ? last_level.GetNumVertices() : topology_data.vertex_count);
+	LevelBuffers<Vertex> vertex_levels;
+	vertex_levels.final_level_only = final_level_only;
+	vertex_levels.last_level = p_level;
+	vertex_levels.output = (Vertex *)topology_data.vertex_array.ptrw();
+	vertex_levels.cage = (const Vertex *)cage_vertex_array.ptr();
+	vertex_levels.level_offsets.resize(p_level + 1);
+	vertex_levels.level_offsets[0] = 0;
 	for (int level = 0; level < p_level; ++level) {
-		Vertex *dst = src + refiner->GetLevel(level).GetNumVertices();
+		vertex_levels.level_offsets[level + 1] = vertex_levels.level_offsets[level] + refiner->GetLevel(level).GetNumVertices();
+	}
+	LocalVector<float> level_displacements;
+	level_displacements.resize(p_level);
+	for (int level = 0; level < p_level; ++level) {
+		const Vertex *src = vertex_levels.get_level(level);
+		Vertex *dst = vertex_levels.get_level_for_write(level + 1, refiner->GetLevel(level + 1).GetNumVertices());
 		primvar_refiner.Interpolate(level + 1, src, dst);
-		src = dst;
+		if (!p_measure_lod_errors) {
+			continue;
+		}
+
+		const Far::TopologyLevel &parent_level = refiner->GetLevel(level);
+		float displacement = 0.0;
+		for (int vertex_index = 0; vertex_index < parent_level.GetNumVertices(); vertex_index++) {
+			const Vertex &parent = src[vertex_index];
+			const Vertex &child = dst[parent_level.GetVertexChildVertex(vertex_index)];
+			displacement = MAX(displacement, Vector3(child.x - parent.x, child.y - parent.y, child.z - parent.z).length());
+		}
+		level_displacements[level] = displacement;
+	}
+	//a vertex can't move further from level n to the last level than the sum of its moves in between
+	topology_data.lod_errors.resize(p_measure_lod_errors ? p_level : 0);
+	float lod_error = 0.0;
+	for (int level = topology_data.lod_errors.size() - 1; level >= 0; --level) {
+		lod_error += level_displacements[level];
+		topology_data.lod_errors.write[level] = lod_error;
+	}
+
+	//only filled with cage normals if they get interpolated, see _get_cage_normals
+	if (topology_data.normal_array.size() == original_vertex_count) {
+		const PackedVector3Array cage_normal_array = topology_data.normal_array;
+		topology_data.normal_array.resize(topology_data.vertex_array.size());
+		LevelBuffers<Vertex> normal_levels;
+		normal_levels.final_level_only = final_level_only;
+		normal_levels.last_level = p_level;
+		normal_levels.output = (Vertex *)topology_data.normal_array.ptrw();
+		normal_levels.cage = (const Vertex *)cage_normal_array.ptr();
+		normal_levels.level_offsets = vertex_levels.level_offsets;
+		for (int level = 0; level < p_level; ++level) {
+			Vertex *dst_normals = normal_levels.get_level_for_write(level + 1, refiner->GetLevel(level + 1).GetNumVertices());
+			primvar_refiner.Interpolate(level + 1, normal_levels.get_level(level), dst_normals);
+		}
 	}
 
 	if (use_uv) {
-		topology_data.uv_array.resize(topology_data.uv_count);
-		VertexUV *src_uv = (VertexUV *)topology_data.uv_array.ptr();
+		const PackedVector2Array cage_uv_array = topology_data.uv_array;
+		topology_data.uv_array.resize(final_level_only ? last_level.GetNumFVarValues(Channels::UV) : topology_data.uv_count);
+		LevelBuffers<VertexUV> uv_levels;
+		uv_levels.final_level_only = final_level_only;
+		uv_levels.last_level = p_level;
+		uv_levels.output = (VertexUV *)topology_data.uv_array.ptrw();
+		uv_levels.cage = (const VertexUV *)cage_uv_array.ptr();
+		uv_levels.level_offsets.resize(p_level + 1);
+		uv_levels.level_offsets[0] = 0;
+		for (int level = 0; level < p_level; ++level) {
+			uv_levels.level_offsets[level + 1] = uv_levels.level_offsets[level] + refiner->GetLevel(level).GetNumFVarValues(Channels::UV);
+		}
 		for (int level = 0; level < p_level; ++level) {
-			VertexUV *dst_uv = src_uv + refiner->GetLevel(level).GetNumFVarValues(Channels::UV);
-			primvar_refiner.InterpolateFaceVarying(level + 1, src_uv, dst_uv, Channels::UV);
-			src_uv = dst_uv;
+			VertexUV *dst_uv = uv_levels.get_level_for_write(level + 1, refiner->GetLevel(level + 1).GetNumFVarValues(Channels::UV));
+			primvar_refiner.InterpolateFaceVarying(level + 1, uv_levels.get_level(level), dst_uv, Channels::UV);
 		}
+		topology_data.uv_count = topology_data.uv_array.size();
 	}
 
 	if (use_bones) {
@@ -174,12 +283,20 @@ void Subdivider::_create_subdivision_vertices(Far::TopologyRefiner *refiner, con
 		}
 
 		//create array with all weights per vertex
-		Vector<PackedFloat32Array> all_vertex_bone_weights; //will contain all weights per vertex indexed to bones
-		all_vertex_bone_weights.resize(topology_data.vertex_count);
+		LocalVector<VertexWeights> cage_bone_weights; //will contain all weights per vertex indexed to bones
+		LocalVector<VertexWeights> all_vertex_bone_weights; //last level or all levels
+		all_vertex_bone_weights.resize(topology_data.vertex_array.size());
+		if (final_level_only) {
+			cage_bone_weights.resize(original_vertex_count);
+		}
+		LocalVector<VertexWeights> &cage_weights = final_level_only ? cage_bone_weights : all_vertex_bone_weights;
 
 		//resize to fit all weights
-		for (int vertex_index = 0; vertex_index < topology_data.vertex_count; vertex_index++) {
-			all_vertex_bone_weights.write[vertex_index].resize(highest_bone_index + 1);
+		for (uint32_t vertex_index = 0; vertex_index < all_vertex_bone_weights.size(); vertex_index++) {
+			all_vertex_bone_weights[vertex_index].weights.resize(highest_bone_index + 1);
+		}
+		for (uint32_t vertex_index = 0; vertex_index < cage_bone_weights.size(); vertex_index++) {
+			cage_bone_weights[vertex_index].weights.resize(highest_bone_index + 1);
 		}
 
 		//fill in already existing weights
@@ -187,25 +304,36 @@ void Subdivider::_create_subdivision_vertices(Far::TopologyRefiner *refiner, con
 			for (int weight_index = 0; weight_index < 4; weight_index++) {
 				if (topology_data.weights_array[vertex_index * 4 + weight_index] != 0.0f) {
 					int bone_index = topology_data.bones_array[vertex_index * 4 + weight_index];
-					all_vertex_bone_weights.write[vertex_index][bone_index] = topology_data.weights_array[vertex_index * 4 + weight_index];
+					cage_weights[vertex_index].weights[bone_index] = topology_data.weights_array[vertex_index * 4 + weight_index];
 				}
 			}
 		}
 
 		//interpolate with the custom class (just iterates over a packedfloatarray)
-		VertexWeights *src_weights = (VertexWeights *)all_vertex_bone_weights.ptrw();
+		LevelBuffers<VertexWeights> weight_levels;
+		weight_levels.final_level_only = final_level_only;
+		weight_levels.last_level = p_level;
+		weight_levels.output = all_vertex_bone_weights.ptr();
+		weight_levels.cage = cage_bone_weights.ptr();
+		weight_levels.level_offsets = vertex_levels.level_offsets;
 		for (int level = 0; level < p_level; ++level) {
-			VertexWeights *dst_weights = src_weights + refiner->GetLevel(level).GetNumVertices();
-			primvar_refiner.Interpolate(level + 1, src_weights, dst_weights);
-			src_weights = dst_weights;
+			const int child_vertex_count = refiner->GetLevel(level + 1).GetNumVertices();
+			VertexWeights *dst_weights = weight_levels.get_level_for_write(level + 1, child_vertex_count);
+			if (final_level_only && level + 1 < p_level) { //buffers start empty or hold a smaller level
+				for (int vertex_index = 0; vertex_index < child_vertex_count; vertex_index++) {
+					dst_weights[vertex_index].weights.resize(highest_bone_index + 1);
+				}
+			}
+			primvar_refiner.Interpolate(level + 1, weight_levels.get_level(level), dst_weights);
 		}
 
 		//select 4 highest weights and set them in topology_data
-		topology_data.bones_array.resize(topology_data.vertex_count * 4);
-		topology_data.weights_array.resize(topology_data.vertex_count * 4);
-		for (int vertex_index = 0; vertex_index < topology_data.vertex_count; vertex_index++) {
+		const int weights_vertex_count = all_vertex_bone_weights.size();
+		topology_data.bones_array.resize(weights_vertex_count * 4);
+		topology_data.weights_array.resize(weights_vertex_count * 4);
+		for (int vertex_index = 0; vertex_index < weights_vertex_count; vertex_index++) {
 			int weight_indices[4] = { -1, -1, -1, -1 };
-			const PackedFloat32Array &vertex_bones_weights = all_vertex_bone_weights[vertex_index];
+			const PackedFloat32Array &vertex_bones_weights = all_vertex_bone_weights[vertex_index].weights;
 
 			for (int weight_index = 0; weight_index <= highest_bone_index; weight_index++) {
 				if (vertex_bones_weights[weight_index] != 0 && (weight_indices[3] == -1 || vertex_bones_weights[weight_index] > vertex_bones_weights[weight_indices[3]])) {
@@ -235,6 +363,9 @@ void Subdivider::_create_subdivision_vertices(Far::TopologyRefiner *refiner, con
 			}
 		}
 	}
+
+	//indices of the last level start at vertex_count - last level vertices, which is 0 if only the last level was kept
+	topology_data.vertex_count = topology_data.vertex_array.size();
 }
 
 Array Subdivider::get_subdivided_arrays(const Array &p_arrays, int p_level, int32_t p_format, bool calculate_normals) {
@@ -257,28 +388,282 @@ Array Subdivider::get_subdivided_topology_arrays(const Array &p_arrays, int p_le
 	return arr;
 }
 
+Array Subdivider::get_subdivided_arrays_from_refinement(const Array &p_arrays, const Array &p_refinement_arrays, int32_t p_format, bool calculate_normals) {
+	ERR_FAIL_COND_V(p_arrays.size() != TopologyDataMesh::ARRAY_MAX, Array());
+	//these arrays didn't go through TopologyDataMesh, so the indices weren't checked yet
+	const TopologyDataMesh::StencilTableView stencil_table = TopologyDataMesh::StencilTableView::from_refinement_arrays(p_refinement_arrays);
+	const PackedVector3Array cage_vertex_array = p_arrays[TopologyDataMesh::ARRAY_VERTEX];
+	ERR_FAIL_COND_V_MSG(!stencil_table.is_valid_for(cage_vertex_array.size()), Array(), "Refinement data doesn't match the cage vertices.");
+	return get_subdivided_arrays_from_refinement(p_arrays, p_refinement_arrays, stencil_table, p_format, calculate_normals);
+}
+
+Array Subdivider::get_subdivided_arrays_from_refinement(const Array &p_arrays, const Array &p_refinement_arrays,
+		const TopologyDataMesh::StencilTableView &p_stencil_table, int32_t p_format, bool calculate_normals) {
+	subdivide_from_refinement(p_arrays, p_refinement_arrays, p_stencil_table, p_format, calculate_normals);
+	return _get_triangle_arrays();
+}
+
+Array Subdivider::get_subdivided_arrays_with_base(const Array &p_arrays, int p_level, const Array &p_refinement_arrays, const Array &p_base_arrays,
+		int32_t p_format) {
+	ERR_FAIL_COND_V(p_arrays.size() != TopologyDataMesh::ARRAY_MAX, Array());
+	ERR_FAIL_COND_V(p_base_arrays.size() != Mesh::ARRAY_MAX, Array());
+	if (p_level > 0 && !p_refinement_arrays.is_empty()) {
+		const TopologyDataMesh::StencilTableView stencil_table = TopologyDataMesh::StencilTableView::from_refinement_arrays(p_refinement_arrays);
+		const PackedVector3Array cage_vertex_array = p_arrays[TopologyDataMesh::ARRAY_VERTEX];
+		ERR_FAIL_COND_V_MSG(!stencil_table.is_valid_for(cage_vertex_array.size()), Array(), "Refinement data doesn't match the cage vertices.");
+		subdivide_from_refinement(p_arrays, p_refinement_arrays, stencil_table, p_format, true);
+	} else {
+		subdivide(p_arrays, p_level, p_format, true);
+	}
+	const PackedVector3Array base_vertex_array = p_base_arrays[Mesh::ARRAY_VERTEX];
+	ERR_FAIL_COND_V_MSG(vertex_remap.size() != base_vertex_array.size(), Array(), "Base arrays weren't created by this subdivider.");
+
+	Array arrays;
+	arrays.resize(Mesh::ARRAY_MAX);
+	arrays[Mesh::ARRAY_VERTEX] = remap_vertices(topology_data.vertex_array, vertex_remap);
+	arrays[Mesh::ARRAY_NORMAL] = remap_vertices(topology_data.normal_array, vertex_remap);
+	arrays[Mesh::ARRAY_TEX_UV] = p_base_arrays[Mesh::ARRAY_TEX_UV];
+	arrays[Mesh::ARRAY_INDEX] = p_base_arrays[Mesh::ARRAY_INDEX];
+	return _add_tangents(arrays);
+}
+
+Array Subdivider::get_refinement_arrays(const Array &p_arrays, int p_level, int32_t p_format) {
+	ERR_FAIL_COND_V(p_level <= 0, Array());
+	const bool use_uv = p_format & Mesh::ARRAY_FORMAT_TEX_UV;
+	const bool use_bones = (p_format & Mesh::ARRAY_FORMAT_BONES) && (p_format & Mesh::ARRAY_FORMAT_WEIGHTS);
+
+	topology_data = TopologyData(p_arrays, p_format, _get_vertices_per_face_count());
+	Far::TopologyRefiner *refiner = _create_topology_refiner(p_level, p_format);
+	ERR_FAIL_COND_V_MSG(!refiner, Array(), "Refiner couldn't be created, numVertsPerFace array likely lost.");
+	_create_subdivision_vertices(refiner, p_level, p_format, true);
+	_create_subdivision_faces(refiner, p_level, p_format);
+	_create_lod_data(refiner, p_level);
+
+	//stencils straight from the cage to the last level, intermediate levels get factorized in
+	Far::StencilTableFactory::Options stencil_options;
+	stencil_options.generateIntermediateLevels = false;
+	stencil_options.generateOffsets = true;
+	stencil_options.maxLevel = p_level;
+	const Far::StencilTable *stencil_table = Far::StencilTableFactory::Create(*refiner, stencil_options);
+	const Far::TopologyLevel &last_level = refiner->GetLevel(p_level);
+
+	Array refinement_arrays;
+	refinement_arrays.resize(TopologyDataMesh::REFINEMENT_MAX);
+	PackedInt32Array stencil_sizes;
+	PackedInt32Array stencil_indices;
+	PackedFloat32Array stencil_weights;
+	stencil_sizes.resize(stencil_table->GetNumStencils());
+	stencil_indices.resize(stencil_table->GetControlIndices().size());
+	stencil_weights.resize(stencil_table->GetWeights().size());
+	memcpy(stencil_sizes.ptrw(), stencil_table->GetSizes().data(), stencil_sizes.size() * sizeof(int32_t));
+	memcpy(stencil_indices.ptrw(), stencil_table->GetControlIndices().data(), stencil_indices.size() * sizeof(int32_t));
+	memcpy(stencil_weights.ptrw(), stencil_table->GetWeights().data(), stencil_weights.size() * sizeof(float));
+	refinement_arrays[TopologyDataMesh::REFINEMENT_STENCIL_SIZES] = stencil_sizes;
+	refinement_arrays[TopologyDataMesh::REFINEMENT_STENCIL_INDICES] = stencil_indices;
+	refinement_arrays[TopologyDataMesh::REFINEMENT_STENCIL_WEIGHTS] = stencil_weights;
+	delete stencil_table;
+
+	//remove offsets of the previous levels, only the last level gets stored
+	const int vertex_index_offset = topology_data.vertex_count - last_level.GetNumVertices();
+	PackedInt32Array index_array = topology_data.index_array;
+	int32_t *index_ptrw = index_array.ptrw();
+	for (int index = 0; index < index_array.size(); index++) {
+		index_ptrw[index] -= vertex_index_offset;
+	}
+	refinement_arrays[TopologyDataMesh::REFINEMENT_INDEX] = index_array;
+
+	if (use_uv) {
+		const int uv_index_offset = topology_data.uv_count - last_level.GetNumFVarValues(Channels::UV);
+		PackedInt32Array uv_index_array = topology_data.uv_index_array;
+		int32_t *uv_index_ptrw = uv_index_array.ptrw();
+		for (int index = 0; index < uv_index_array.size(); index++) {
+			uv_index_ptrw[index] -= uv_index_offset;
+		}
+		refinement_arrays[TopologyDataMesh::REFINEMENT_TEX_UV] = topology_data.uv_array.slice(uv_index_offset);
+		refinement_arrays[TopologyDataMesh::REFINEMENT_UV_INDEX] = uv_index_array;
+	}
+
+	if (use_bones) {
+		refinement_arrays[TopologyDataMesh::REFINEMENT_BONES] = topology_data.bones_array.slice(vertex_index_offset * 4);
+		refinement_arrays[TopologyDataMesh::REFINEMENT_WEIGHTS] = topology_data.weights_array.slice(vertex_index_offset * 4);
+	}
+
+	//lod corners point into the index array of the last level, so they stay valid without the refiner
+	PackedInt32Array lod_corners;
+	PackedInt32Array lod_face_vertex_counts;
+	PackedInt32Array lod_face_counts;
+	PackedFloat32Array lod_errors;
+	for (int lod_level = 0; lod_level < topology_data.lod_corners.size(); lod_level++) {
+		lod_corners.append_array(topology_data.lod_corners[lod_level]);
+		lod_face_vertex_counts.append_array(topology_data.lod_face_vertex_counts[lod_level]);
+		lod_face_counts.push_back(topology_data.lod_face_vertex_counts[lod_level].size());
+		lod_errors.push_back(topology_data.lod_errors[lod_level]);
+	}
+	refinement_arrays[TopologyDataMesh::REFINEMENT_LOD_CORNERS] = lod_corners;
+	refinement_arrays[TopologyDataMesh::REFINEMENT_LOD_FACE_VERTEX_COUNTS] = lod_face_vertex_counts;
+	refinement_arrays[TopologyDataMesh::REFINEMENT_LOD_FACE_COUNTS] = lod_face_counts;
+	refinement_arrays[TopologyDataMesh::REFINEMENT_LOD_ERRORS] = lod_errors;
+
+	delete refiner;
+	return refinement_arrays;
+}
+
+void Subdivider::_set_lod_data_from_refinement(const Array &p_refinement_arrays) {
+	topology_data.lod_corners.clear();
+	topology_data.lod_face_vertex_counts.clear();
+	topology_data.lod_errors.clear();
+	//missing for data stored before lods were part of it
+	if (p_refinement_arrays[TopologyDataMesh::REFINEMENT_LOD_FACE_COUNTS].get_type() != Variant::PACKED_INT32_ARRAY) {
+		return;
+	}
+	const PackedInt32Array lod_corners = p_refinement_arrays[TopologyDataMesh::REFINEMENT_LOD_CORNERS];
+	const PackedInt32Array lod_face_vertex_counts = p_refinement_arrays[TopologyDataMesh::REFINEMENT_LOD_FACE_VERTEX_COUNTS];
+	const PackedInt32Array lod_face_counts = p_refinement_arrays[TopologyDataMesh::REFINEMENT_LOD_FACE_COUNTS];
+	const PackedFloat32Array lod_errors = p_refinement_arrays[TopologyDataMesh::REFINEMENT_LOD_ERRORS];
+	ERR_FAIL_COND_MSG(lod_face_counts.size() != lod_errors.size(), "Lod data of the refinement data is broken, no lods get created.");
+
+	Vector<PackedInt32Array> corners_per_level;
+	Vector<PackedInt32Array> face_vertex_counts_per_level;
+	int face_start = 0;
+	int corner_start = 0;
+	for (int lod_level = 0; lod_level < lod_face_counts.size(); lod_level++) {
+		const int face_count = lod_face_counts[lod_level];
+		ERR_FAIL_COND_MSG(face_count < 0 || face_start + face_count > lod_face_vertex_counts.size(), "Lod data of the refinement data is broken, no lods get created.");
+		const PackedInt32Array face_vertex_counts = lod_face_vertex_counts.slice(face_start, face_start + face_count);
+		int corner_count = 0;
+		for (int face_index = 0; face_index < face_count; face_index++) {
+			ERR_FAIL_COND_MSG(face_vertex_counts[face_index] < 3, "Lod data of the refinement data is broken, no lods get created.");
+			corner_count += face_vertex_counts[face_index];
+		}
+		ERR_FAIL_COND_MSG(corner_start + corner_count > lod_corners.size(), "Lod data of the refinement data is broken, no lods get created.");
+		const PackedInt32Array corners = lod_corners.slice(corner_start, corner_start + corner_count);
+		for (int corner = 0; corner < corners.size(); corner++) {
+			ERR_FAIL_INDEX_MSG(corners[corner], topology_data.index_count, "Lod data of the refinement data is broken, no lods get created.");
+		}
+		corners_per_level.push_back(corners);
+		face_vertex_counts_per_level.push_back(face_vertex_counts);
+		face_start += face_count;
+		corner_start += corner_count;
+	}
+
+	topology_data.lod_corners = corners_per_level;
+	topology_data.lod_face_vertex_counts = face_vertex_counts_per_level;
+	for (int lod_level = 0; lod_level < lod_errors.size(); lod_level++) {
+		topology_data.lod_errors.push_back(lod_errors[lod_level]);
+	}
+}
+
+void Subdivider::subdivide_from_refinement(const Array &p_arrays, const Array &p_refinement_arrays, const TopologyDataMesh::StencilTableView &p_stencil_table,
+		int32_t p_format, bool calculate_normals) {
+	ERR_FAIL_COND(p_refinement_arrays.size() != TopologyDataMesh::REFINEMENT_MAX);
+	ERR_FAIL_COND(!p_stencil_table.is_valid());
+	const bool use_uv = p_format & Mesh::ARRAY_FORMAT_TEX_UV;
+	const bool use_bones = (p_format & Mesh::ARRAY_FORMAT_BONES) && (p_format & Mesh::ARRAY_FORMAT_WEIGHTS);
+
+	topology_data = TopologyData();
+	topology_data.vertex_array = _apply_stencils(p_arrays[TopologyDataMesh::ARRAY_VERTEX], p_stencil_table);
+	topology_data.index_array = p_refinement_arrays[TopologyDataMesh::REFINEMENT_INDEX];
+	if (use_uv) {
+		topology_data.uv_array = p_refinement_arrays[TopologyDataMesh::REFINEMENT_TEX_UV];
+		topology_data.uv_index_array = p_refinement_arrays[TopologyDataMesh::REFINEMENT_UV_INDEX];
+	}
+	if (use_bones) {
+		topology_data.bones_array = p_refinement_arrays[TopologyDataMesh::REFINEMENT_BONES];
+		topology_data.weights_array = p_refinement_arrays[TopologyDataMesh::REFINEMENT_WEIGHTS];
+	}
+
+	//Catmull-Clark only outputs quads (mixed included), Loop only triangles
+	topology_data.vertex_count_per_face = _get_refiner_type() == Sdc::SchemeType::SCHEME_LOOP ? 3 : 4;
+	topology_data.index_count = topology_data.index_array.size();
+	topology_data.face_count = topology_data.index_count / topology_data.vertex_count_per_face;
+	topology_data.vertex_count = topology_data.vertex_array.size();
+	topology_data.uv_count = topology_data.uv_array.size();
+	topology_data.bone_count = topology_data.bones_array.size();
+	topology_data.weight_count = topology_data.weights_array.size();
+	_set_lod_data_from_refinement(p_refinement_arrays);
+
+	PackedVector3Array cage_normal_array;
+	if (calculate_normals && _get_cage_normals(p_arrays, p_format, cage_normal_array)) {
+		//vertex stencils work for any vertex primvar
+		topology_data.normal_array = _apply_stencils(cage_normal_array, p_stencil_table);
+		_normalize_normals(topology_data.normal_array);
+	} else if (calculate_normals) {
+		topology_data.normal_array = _calculate_smooth_normals(topology_data.vertex_array, topology_data.index_array);
+	}
+}
+
+PackedVector3Array Subdivider::_apply_stencils(const PackedVector3Array &p_cage_vertex_array, const TopologyDataMesh::StencilTableView &p_stencil_table) const {
+	//offsets aren't stored, a prefix sum is cheap compared to the stencils themselves
+	const int stencil_count = p_stencil_table.stencil_count;
+	const int32_t *sizes_ptr = p_stencil_table.sizes;
+	LocalVector<int32_t> stencil_offsets;
+	stencil_offsets.resize(stencil_count);
+	int32_t offset = 0;
+	for (int stencil_index = 0; stencil_index < stencil_count; stencil_index++) {
+		stencil_offsets[stencil_index] = offset;
+		offset += sizes_ptr[stencil_index];
+	}
+	ERR_FAIL_COND_V(offset != p_stencil_table.control_count, PackedVector3Array());
+
+	PackedVector3Array vertex_array;
+	vertex_array.resize(stencil_count);
+	Vector3 *vertex_ptrw = vertex_array.ptrw();
+	const Vector3 *cage_ptr = p_cage_vertex_array.ptr();
+	const int32_t *indices_ptr = p_stencil_table.indices;
+	const float *weights_ptr = p_stencil_table.weights;
+	//indices were checked against the cage once when the table got stored, see StencilTableView::is_valid_for
+	parallel_for(stencil_count, [&](int p_begin, int p_end) {
+		for (int stencil_index = p_begin; stencil_index < p_end; stencil_index++) {
+			Vector3 vertex;
+			const int32_t stencil_end = stencil_offsets[stencil_index] + sizes_ptr[stencil_index];
+			for (int32_t control_index = stencil_offsets[stencil_index]; control_index < stencil_end; control_index++) {
+				vertex += cage_ptr[indices_ptr[control_index]] * weights_ptr[control_index];
+			}
+			vertex_ptrw[stencil_index] = vertex;
+		}
+	});
+	return vertex_array;
+}
+
 void Subdivider::subdivide(const Array &p_arrays, int p_level, int32_t p_format, bool calculate_normals) {
 	ERR_FAIL_COND(p_level < 0);
 	const bool use_uv = p_format & Mesh::ARRAY_FORMAT_TEX_UV;
 	const bool use_bones = (p_format & Mesh::ARRAY_FORMAT_BONES) && (p_format & Mesh::ARRAY_FORMAT_WEIGHTS);
 
 	topology_data = TopologyData(p_arrays, p_format, _get_vertices_per_face_count());
+	//cage normals get refined together with the vertices
+	const bool interpolate_normals = calculate_normals && _get_cage_normals(p_arrays, p_format, topology_data.normal_array);
 	//if p_level not 0 subdivide mesh and store in topology_data again
 	if (p_level != 0) {
 		Far::TopologyRefiner *refiner = _create_topology_refiner(p_level, p_format);
 		ERR_FAIL_COND_MSG(!refiner, "Refiner couldn't be created, numVertsPerFace array likely lost.");
-		_create_subdivision_vertices(refiner, p_level, p_format);
+		_create_subdivision_vertices(refiner, p_level, p_format, true);
 		_create_subdivision_faces(refiner, p_level, p_format);
+		_create_lod_data(refiner, p_level);
 		//free memory
 
 		delete refiner;
 	}
 
-	if (calculate_normals) {
+	if (interpolate_normals) {
+		_normalize_normals(topology_data.normal_array);
+	} else if (calculate_normals) {
 		topology_data.normal_array = _calculate_smooth_normals(topology_data.vertex_array, topology_data.index_array);
 	}
 }
 
+void Subdivider::_subdivide_vertices(const Array &p_arrays, int p_level) {
+	ERR_FAIL_COND(p_level < 0);
+	topology_data = TopologyData(p_arrays, Mesh::ARRAY_FORMAT_VERTEX, _get_vertices_per_face_count());
+	if (p_level == 0) {
+		return;
+	}
+	Far::TopologyRefiner *refiner = _create_topology_refiner(p_level, Mesh::ARRAY_FORMAT_VERTEX);
+	ERR_FAIL_COND_MSG(!refiner, "Refiner couldn't be created, numVertsPerFace array likely lost.");
+	_create_subdivision_vertices(refiner, p_level, Mesh::ARRAY_FORMAT_VERTEX, false);
+	delete refiner;
+}
+
 //TODO: virtual calls are not implemented yet in godot cpp (I think, it wasnt 2 weeks ago and didn't see any commit)
 OpenSubdiv::Sdc::SchemeType Subdivider::_get_refiner_type() const {
 	return Sdc::SchemeType::SCHEME_CATMARK;
@@ -294,6 +679,12 @@ void Subdivider::_create_subdivision_faces(OpenSubdiv::Far::TopologyRefiner *ref
 
 	Far::TopologyLevel const &last_level = refiner->GetLevel(p_level);
 	int face_count_out = last_level.GetNumFaces();
+
+	//mixed topology only exists in level 0, Catmull-Clark splits every face into quads
+	if (topology_data.vertex_count_per_face == 0) {
+		topology_data.vertex_count_per_face = 4;
+		topology_data.face_vertex_count_array.clear();
+	}
 	int uv_index_offset = use_uv ? topology_data.uv_count - last_level.GetNumFVarValues(Channels::UV) : -1;
 
 	int vertex_index_offset = topology_data.vertex_count - last_level.GetNumVertices();
@@ -319,22 +710,77 @@ void Subdivider::_create_subdivision_faces(OpenSubdiv::Far::TopologyRefiner *ref
 		}
 	}
 	topology_data.index_array = index_array;
+	topology_data.index_count = index_array.size();
+	topology_data.face_count = face_count_out;
 	if (use_uv) {
 		topology_data.uv_index_array = uv_index_array;
 	}
 }
 
+void Subdivider::_create_lod_data(Far::TopologyRefiner *refiner, const int32_t p_level) {
+	topology_data.lod_corners.clear();
+	topology_data.lod_face_vertex_counts.clear();
+	const bool loop = _get_refiner_type() == Sdc::SchemeType::SCHEME_LOOP;
+	const int last_face_vertex_count = topology_data.vertex_count_per_face;
+	ERR_FAIL_COND(topology_data.lod_errors.size() != p_level);
+
+	for (int level = 0; level < p_level; level++) {
+		const Far::TopologyLevel &coarse_level = refiner->GetLevel(level);
+		PackedInt32Array corners;
+		PackedInt32Array face_vertex_counts;
+		corners.resize(coarse_level.GetNumFaceVertices());
+		face_vertex_counts.resize(coarse_level.GetNumFaces());
+		int32_t *corners_ptrw = corners.ptrw();
+		int32_t *face_vertex_counts_ptrw = face_vertex_counts.ptrw();
+		int corner_index = 0;
+		for (int face_index = 0; face_index < coarse_level.GetNumFaces(); face_index++) {
+			const int face_vertex_count = coarse_level.GetFaceVertices(face_index).size();
+			face_vertex_counts_ptrw[face_index] = face_vertex_count;
+			for (int corner = 0; corner < face_vertex_count; corner++) {
+				//child face n of a face is the one at its corner n
+				int child_face = face_index;
+				int child_corner = corner;
+				int child_face_vertex_count = face_vertex_count;
+				for (int child_level = level; child_level < p_level; child_level++) {
+					child_face = refiner->GetLevel(child_level).GetFaceChildFaces(child_face)[child_corner];
+					//Catmull-Clark children of non quads start at the parent corner
+					if (!loop && child_face_vertex_count != 4) {
+						child_corner = 0;
+					}
+					child_face_vertex_count = loop ? 3 : 4;
+				}
+				corners_ptrw[corner_index++] = child_face * last_face_vertex_count + child_corner;
+			}
+		}
+
+		topology_data.lod_corners.push_back(corners);
+		topology_data.lod_face_vertex_counts.push_back(face_vertex_counts);
+	}
+
+	//lod distances need to grow with every coarser level, even for flat meshes where nothing moves
+	float min_error = CMP_EPSILON;
+	for (int level = p_level - 1; level >= 0; level--) {
+		topology_data.lod_errors.write[level] = MAX(topology_data.lod_errors[level], min_error);
+		min_error = topology_data.lod_errors[level] * 1.01 + CMP_EPSILON;
+	}
+}
+
 PackedVector3Array Subdivider::_calculate_smooth_normals(const PackedVector3Array &quad_vertex_array, const PackedInt32Array &quad_index_array) const {
 	PackedVector3Array normals;
 	normals.resize(quad_vertex_array.size());
-	for (int f = 0; f < quad_index_array.size(); f += topology_data.vertex_count_per_face) {
+	const bool mixed = topology_data.vertex_count_per_face == 0;
+	int face_vertex_count = topology_data.vertex_count_per_face;
+	for (int f = 0, face_index = 0; f < quad_index_array.size(); f += face_vertex_count, face_index++) {
+		if (mixed) {
+			face_vertex_count = topology_data.face_vertex_count_array[face_index];
+		}
 		// // We will use the first three verts to calculate a normal
 		const Vector3 &p_point1 = quad_vertex_array[quad_index_array[f]];
 		const Vector3 &p_point2 = quad_vertex_array[quad_index_array[f + 1]];
 		const Vector3 &p_point3 = quad_vertex_array[quad_index_array[f + 2]];
 		Vector3 normal_calculated = (p_point1 - p_point3).cross(p_point1 - p_point2);
 		normal_calculated.normalize();
-		for (int n_pos = f; n_pos < f + topology_data.vertex_count_per_face; n_pos++) {
+		for (int n_pos = f; n_pos < f + face_vertex_count; n_pos++) {
 			int vertexIndex = quad_index_array[n_pos];
 			normals[vertexIndex] += normal_calculated;
 		}
@@ -346,7 +792,271 @@ PackedVector3Array Subdivider::_calculate_smooth_normals(const PackedVector3Arra
 	return normals;
 }
 
-Array Subdivider::_get_triangle_arrays() const {
+bool Subdivider::_get_cage_normals(const Array &p_arrays, int32_t p_format, PackedVector3Array &r_normal_array) const {
+	if (!use_cage_normals || !(p_format & Mesh::ARRAY_FORMAT_NORMAL) || p_arrays[TopologyDataMesh::ARRAY_NORMAL].get_type() != Variant::PACKED_VECTOR3_ARRAY) {
+		return false;
+	}
+	const PackedVector3Array &vertex_array = p_arrays[TopologyDataMesh::ARRAY_VERTEX];
+	const PackedVector3Array &normal_array = p_arrays[TopologyDataMesh::ARRAY_NORMAL];
+	ERR_FAIL_COND_V_MSG(normal_array.size() != vertex_array.size(), false, "Cage normals need to be per vertex, calculating smooth normals instead.");
+	r_normal_array = normal_array;
+	return true;
+}
+
+void Subdivider::_normalize_normals(PackedVector3Array &r_normal_array) {
+	Vector3 *normal_ptrw = r_normal_array.ptrw();
+	parallel_for(r_normal_array.size(), [&](int p_begin, int p_end) {
+		for (int vertex_index = p_begin; vertex_index < p_end; vertex_index++) {
+			normal_ptrw[vertex_index].normalize();
+		}
+	});
+}
+
+Array Subdivider::_create_triangle_arrays(const PackedInt32Array &p_triangle_corners) {
+	const bool use_uv = topology_data.uv_array.size();
+	const bool use_bones = topology_data.bones_array.size() && topology_data.weights_array.size();
+	const bool has_normals = topology_data.normal_array.size();
+	const int corner_count = topology_data.index_array.size();
+	const int32_t *index_ptr = topology_data.index_array.ptr();
+	const int32_t *uv_index_ptr = use_uv ? topology_data.uv_index_array.ptr() : nullptr;
+	ERR_FAIL_COND_V(use_uv && topology_data.uv_index_array.size() != corner_count, Array());
+
+	//first output vertex of every subdivided vertex, more of them (different uv's at seams) get chained with next_output
+	LocalVector<int32_t> first_output;
+	first_output.resize(topology_data.vertex_array.size());
+	for (uint32_t vertex_index = 0; vertex_index < first_output.size(); vertex_index++) {
+		first_output[vertex_index] = -1;
+	}
+	LocalVector<int32_t> next_output;
+	LocalVector<int32_t> output_uv_index;
+	LocalVector<int32_t> output_vertex_index;
+	LocalVector<int32_t> corner_output;
+	corner_output.resize(corner_count);
+	for (int corner = 0; corner < corner_count; corner++) {
+		const int32_t vertex_index = index_ptr[corner];
+		const int32_t uv_index = use_uv ? uv_index_ptr[corner] : -1;
+		ERR_FAIL_INDEX_V(vertex_index, int(first_output.size()), Array());
+		int32_t output = first_output[vertex_index];
+		int32_t last_output = -1;
+		while (output != -1 && output_uv_index[output] != uv_index) {
+			last_output = output;
+			output = next_output[output];
+		}
+		if (output == -1) {
+			output = output_vertex_index.size();
+			output_vertex_index.push_back(vertex_index);
+			output_uv_index.push_back(uv_index);
+			next_output.push_back(-1);
+			if (last_output == -1) {
+				first_output[vertex_index] = output;
+			} else {
+				next_output[last_output] = output;
+			}
+		}
+		corner_output[corner] = output;
+	}
+
+	const int output_count = output_vertex_index.size();
+	PackedInt32Array index_array;
+	index_array.resize(p_triangle_corners.size());
+	int32_t *index_ptrw = index_array.ptrw();
+	const int32_t *triangle_corners_ptr = p_triangle_corners.ptr();
+	for (int index = 0; index < index_array.size(); index++) {
+		index_ptrw[index] = corner_output[triangle_corners_ptr[index]];
+	}
+
+	//triangles come in refinement order, reorder them for the vertex cache and the vertices for sequential fetches
+	VertexCacheOptimizer::optimize_vertex_cache(index_array, output_count);
+	const PackedInt32Array fetch_remap = VertexCacheOptimizer::optimize_vertex_fetch(index_array, output_count);
+	ERR_FAIL_COND_V(fetch_remap.size() != output_count, Array());
+	vertex_remap.resize(output_count);
+	int32_t *vertex_remap_ptrw = vertex_remap.ptrw();
+	LocalVector<int32_t> optimized_uv_index;
+	LocalVector<int32_t> optimized_output;
+	optimized_uv_index.resize(output_count);
+	optimized_output.resize(output_count);
+	for (int output = 0; output < output_count; output++) {
+		vertex_remap_ptrw[output] = output_vertex_index[fetch_remap[output]];
+		optimized_uv_index[output] = output_uv_index[fetch_remap[output]];
+		optimized_output[fetch_remap[output]] = output;
+	}
+
+	//coarser levels reuse the vertices their corners end up at, so lods need no extra vertices and no simplification
+	lods.clear();
+	for (int lod_level = 0; lod_level < topology_data.lod_corners.size(); lod_level++) {
+		const PackedInt32Array &lod_corners = topology_data.lod_corners[lod_level];
+		const PackedInt32Array &lod_face_vertex_counts = topology_data.lod_face_vertex_counts[lod_level];
+		PackedInt32Array lod_index_array;
+		int face_start = 0;
+		for (int face_index = 0; face_index < lod_face_vertex_counts.size(); face_index++) {
+			const int face_vertex_count = lod_face_vertex_counts[face_index];
+			ERR_FAIL_COND_V(face_start + face_vertex_count > lod_corners.size(), Array());
+			if (face_vertex_count == 4) { //same split as the last level
+				const int quad_corners[6] = { 0, 1, 3, 1, 2, 3 };
+				for (int corner : quad_corners) {
+					lod_index_array.push_back(optimized_output[corner_output[lod_corners[face_start + corner]]]);
+				}
+			} else { //fan, triangles and n-gons only exist in the coarsest levels
+				for (int corner = 1; corner < face_vertex_count - 1; corner++) {
+					lod_index_array.push_back(optimized_output[corner_output[lod_corners[face_start]]]);
+					lod_index_array.push_back(optimized_output[corner_output[lod_corners[face_start + corner]]]);
+					lod_index_array.push_back(optimized_output[corner_output[lod_corners[face_start + corner + 1]]]);
+				}
+			}
+			face_start += face_vertex_count;
+		}
+		VertexCacheOptimizer::optimize_vertex_cache(lod_index_array, output_count);
+		lods[topology_data.lod_errors[lod_level]] = lod_index_array;
+	}
+
+	Array arrays;
+	arrays.resize(Mesh::ARRAY_MAX);
+	arrays[Mesh::ARRAY_VERTEX] = remap_vertices(topology_data.vertex_array, vertex_remap);
+	if (has_normals) {
+		arrays[Mesh::ARRAY_NORMAL] = remap_vertices(topology_data.normal_array, vertex_remap);
+	}
+	if (use_uv) {
+		PackedVector2Array uv_array;
+		uv_array.resize(output_count);
+		Vector2 *uv_ptrw = uv_array.ptrw();
+		for (int output = 0; output < output_count; output++) {
+			uv_ptrw[output] = topology_data.uv_array[optimized_uv_index[output]];
+		}
+		arrays[Mesh::ARRAY_TEX_UV] = uv_array;
+	}
+	if (use_bones) {
+		PackedInt32Array bones_array;
+		PackedFloat32Array weights_array;
+		bones_array.resize(output_count * 4);
+		weights_array.resize(output_count * 4);
+		int32_t *bones_ptrw = bones_array.ptrw();
+		float *weights_ptrw = weights_array.ptrw();
+		const int32_t *source_bones_ptr = topology_data.bones_array.ptr();
+		const float *source_weights_ptr = topology_data.weights_array.ptr();
+		for (int output = 0; output < output_count; output++) {
+			const int32_t vertex_index = vertex_remap_ptrw[output];
+			for (int bone_index = 0; bone_index < 4; bone_index++) {
+				bones_ptrw[output * 4 + bone_index] = source_bones_ptr[vertex_index * 4 + bone_index];
+				weights_ptrw[output * 4 + bone_index] = source_weights_ptr[vertex_index * 4 + bone_index];
+			}
+		}
+		arrays[Mesh::ARRAY_BONES] = bones_array;
+		arrays[Mesh::ARRAY_WEIGHTS] = weights_array;
+	}
+
+	arrays[Mesh::ARRAY_INDEX] = index_array;
+	return _add_tangents(arrays);
+}
+
+Array Subdivider::_add_tangents(const Array &p_arrays) const {
+	if (p_arrays[Mesh::ARRAY_NORMAL].get_type() != Variant::PACKED_VECTOR3_ARRAY || p_arrays[Mesh::ARRAY_TEX_UV].get_type() != Variant::PACKED_VECTOR2_ARRAY) {
+		return p_arrays;
+	}
+	if (tangent_mode == TANGENT_MODE_ANALYTIC) {
+		const PackedVector3Array vertex_array = p_arrays[Mesh::ARRAY_VERTEX];
+		const PackedInt32Array index_array = p_arrays[Mesh::ARRAY_INDEX];
+		VertexFaceFan triangle_fan;
+		triangle_fan.create(index_array, 3, vertex_array.size());
+		Array arrays = p_arrays;
+		arrays[Mesh::ARRAY_TANGENT] = triangle_fan.calculate_tangents(vertex_array, p_arrays[Mesh::ARRAY_NORMAL], p_arrays[Mesh::ARRAY_TEX_UV], index_array);
+		return arrays;
+	}
+	//works on the indexed mesh and keeps the vertex order
+	Ref<SurfaceTool> st;
+	st.instantiate();
+	st->create_from_arrays(p_arrays, Mesh::PRIMITIVE_TRIANGLES);
+	st->generate_tangents();
+	return st->commit_to_arrays();
+}
+
+PackedVector3Array Subdivider::remap_vertices(const PackedVector3Array &p_vertex_array, const PackedInt32Array &p_vertex_remap) {
+	PackedVector3Array remapped_array;
+	remapped_array.resize(p_vertex_remap.size());
+	Vector3 *remapped_ptrw = remapped_array.ptrw();
+	const Vector3 *vertex_ptr = p_vertex_array.ptr();
+	const int32_t *remap_ptr = p_vertex_remap.ptr();
+	const int vertex_count = p_vertex_array.size();
+	for (int output = 0; output < remapped_array.size(); output++) {
+		ERR_FAIL_INDEX_V(remap_ptr[output], vertex_count, PackedVector3Array());
+		remapped_ptrw[output] = vertex_ptr[remap_ptr[output]];
+	}
+	return remapped_array;
+}
+
+void Subdivider::create_normal_fan(VertexFaceFan &r_fan, PackedInt32Array &r_face_index_array) const {
+	r_fan.clear();
+	if (topology_data.vertex_count_per_face != 0) {
+		r_face_index_array = topology_data.index_array;
+		r_fan.create(r_face_index_array, topology_data.vertex_count_per_face, topology_data.vertex_array.size());
+		return;
+	}
+
+	PackedInt32Array triangle_index_array;
+	for (int face_index = 0, face_start = 0; face_index < topology_data.face_vertex_count_array.size(); face_index++) {
+		const int face_vertex_count = topology_data.face_vertex_count_array[face_index];
+		ERR_FAIL_COND(face_start + face_vertex_count > topology_data.index_array.size());
+		for (int corner = 1; corner < face_vertex_count - 1; corner++) {
+			triangle_index_array.push_back(topology_data.index_array[face_start]);
+			triangle_index_array.push_back(topology_data.index_array[face_start + corner]);
+			triangle_index_array.push_back(topology_data.index_array[face_start + corner + 1]);
+		}
+		face_start += face_vertex_count;
+	}
+	r_face_index_array = triangle_index_array;
+	r_fan.create(r_face_index_array, 3, topology_data.vertex_array.size());
+}
+
+PackedInt32Array Subdivider::get_vertex_remap() const {
+	return vertex_remap;
+}
+
+Dictionary Subdivider::get_lods() const {
+	return lods;
+}
+
+void Subdivider::set_final_level_only(bool p_final_level_only) {
+	final_level_only = p_final_level_only;
+}
+
+bool Subdivider::get_final_level_only() const {
+	return final_level_only;
+}
+
+void Subdivider::set_tangent_mode(TangentMode p_tangent_mode) {
+	tangent_mode = p_tangent_mode;
+}
+
+Subdivider::TangentMode Subdivider::get_tangent_mode() const {
+	return tangent_mode;
+}
+
+void Subdivider::set_use_cage_normals(bool p_use_cage_normals) {
+	use_cage_normals = p_use_cage_normals;
+}
+
+bool Subdivider::get_use_cage_normals() const {
+	return use_cage_normals;
+}
+
+PackedVector3Array Subdivider::get_subdivided_vertices(const Array &p_arrays, int p_level, const PackedInt32Array &p_vertex_remap) {
+	_subdivide_vertices(p_arrays, p_level);
+	if (p_vertex_remap.is_empty()) {
+		return topology_data.vertex_array;
+	}
+	return remap_vertices(topology_data.vertex_array, p_vertex_remap);
+}
+
+PackedVector3Array Subdivider::get_subdivided_vertices_from_refinement(const Array &p_arrays, const TopologyDataMesh::StencilTableView &p_stencil_table,
+		const PackedInt32Array &p_vertex_remap) {
+	ERR_FAIL_COND_V(!p_stencil_table.is_valid(), PackedVector3Array());
+	const PackedVector3Array vertex_array = _apply_stencils(p_arrays[TopologyDataMesh::ARRAY_VERTEX], p_stencil_table);
+	if (p_vertex_remap.is_empty()) {
+		return vertex_array;
+	}
+	return remap_vertices(vertex_array, p_vertex_remap);
+}
+
+Array Subdivider::_get_triangle_arrays() {
 	return Array();
 }
 
@@ -357,11 +1067,30 @@ Vector<int> Subdivider::_get_face_vertex_count() const {
 int32_t Subdivider::_get_vertices_per_face_count() const {
 	return 0;
 }
-Array Subdivider::_get_direct_triangle_arrays() const {
+Array Subdivider::_get_direct_triangle_arrays() {
 	return Array();
 }
 
 void Subdivider::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("get_subdivided_arrays"), &Subdivider::get_subdivided_arrays);
 	ClassDB::bind_method(D_METHOD("get_subdivided_topology_arrays"), &Subdivider::get_subdivided_topology_arrays);
+	ClassDB::bind_method(D_METHOD("get_subdivided_arrays_from_refinement"),
+			static_cast<Array (Subdivider::*)(const Array &, const Array &, int32_t, bool)>(&Subdivider::get_subdivided_arrays_from_refinement));
+	ClassDB::bind_method(D_METHOD("get_refinement_arrays"), &Subdivider::get_refinement_arrays);
+	ClassDB::bind_method(D_METHOD("get_vertex_remap"), &Subdivider::get_vertex_remap);
+	ClassDB::bind_method(D_METHOD("get_lods"), &Subdivider::get_lods);
+	ClassDB::bind_method(D_METHOD("set_final_level_only", "final_level_only"), &Subdivider::set_final_level_only);
+	ClassDB::bind_method(D_METHOD("get_final_level_only"), &Subdivider::get_final_level_only);
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "final_level_only"), "set_final_level_only", "get_final_level_only");
+	ClassDB::bind_method(D_METHOD("set_tangent_mode", "tangent_mode"), &Subdivider::set_tangent_mode);
+	ClassDB::bind_method(D_METHOD("get_tangent_mode"), &Subdivider::get_tangent_mode);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "tangent_mode", PROPERTY_HINT_ENUM, "Analytic,MikkTSpace"), "set_tangent_mode", "get_tangent_mode");
+
+	ClassDB::bind_method(D_METHOD("set_use_cage_normals", "use_cage_normals"), &Subdivider::set_use_cage_normals);
+	ClassDB::bind_method(D_METHOD("get_use_cage_normals"), &Subdivider::get_use_cage_normals);
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "use_cage_normals"), "set_use_cage_normals", "get_use_cage_normals");
+
+	BIND_ENUM_CONSTANT(TANGENT_MODE_ANALYTIC);
+	BIND_ENUM_CONSTANT(TANGENT_MODE_MIKKTSPACE);
+	ClassDB::bind_method(D_METHOD("get_subdivided_vertices", "arrays", "level", "vertex_remap"), &Subdivider::get_subdivided_vertices);
 }
@@ -5,6 +5,9 @@
 #include "godot_cpp/core/binder_common.hpp"
 #include "godot_cpp/templates/vector.hpp"
 
+#include "resources/topology_data_mesh.hpp"
+#include "utility/vertex_face_fan.hpp"
+
 #include "far/primvarRefiner.h"
 #include "far/topologyDescriptor.h"
 
@@ -13,6 +16,12 @@ using namespace godot;
 class Subdivider : public RefCounted {
 	GDCLASS(Subdivider, RefCounted);
 
+public:
+	enum TangentMode {
+		TANGENT_MODE_ANALYTIC, //per vertex from uv derivatives of the subdivided triangles, parallel
+		TANGENT_MODE_MIKKTSPACE, //SurfaceTool::generate_tangents, matches most baking tools exactly but is a lot slower
+	};
+
 protected:
 	/**
 	 * @brief Just struct for storing arrays for easier use than array
@@ -26,8 +35,13 @@ protected:
 		PackedInt32Array index_array;
 		PackedInt32Array bones_array;
 		PackedFloat32Array weights_array;
+		PackedInt32Array face_vertex_count_array; //only filled for mixed topology, otherwise every face has vertex_count_per_face vertices
+		//per coarser level (index = level): position in index_array of the last level for every face corner of that level
+		Vector<PackedInt32Array> lod_corners;
+		Vector<PackedInt32Array> lod_face_vertex_counts;
+		Vector<float> lod_errors; //upper bound of the distance between a vertex of the level and its descendant in the last level
 
-		int32_t vertex_count_per_face = 0;
+		int32_t vertex_count_per_face = 0; //0 if faces have different vertex counts
 		int32_t index_count = 0;
 		int32_t face_count = 0;
 		int32_t vertex_count = 0;
@@ -45,6 +59,9 @@ protected:
 	 *
 	 */
 	TopologyData topology_data;
+	bool final_level_only = false;
+	TangentMode tangent_mode = TANGENT_MODE_ANALYTIC;
+	bool use_cage_normals = false;
 
 	/**
 	 * @brief Sets internal topology data
@@ -55,20 +72,97 @@ protected:
 	 * @param calculate_normals
 	 */
 	void subdivide(const Array &p_arrays, int p_level, int32_t p_format, bool calculate_normals);
+	/**
+	 * @brief Only refines the vertex array of topology_data, no faces, lod data or normals. Used for per frame vertex updates.
+	 *
+	 * @param p_arrays
+	 * @param p_level
+	 */
+	void _subdivide_vertices(const Array &p_arrays, int p_level);
+	/**
+	 * @brief Sets internal topology data from precomputed refinement data, no refiner gets created
+	 *
+	 * @param p_arrays cage arrays, only the vertex array gets used
+	 * @param p_refinement_arrays see TopologyDataMesh::RefinementArrayType, stencil arrays are ignored
+	 * @param p_stencil_table
+	 * @param p_format
+	 * @param calculate_normals
+	 */
+	void subdivide_from_refinement(const Array &p_arrays, const Array &p_refinement_arrays, const TopologyDataMesh::StencilTableView &p_stencil_table,
+			int32_t p_format, bool calculate_normals);
+	PackedVector3Array _apply_stencils(const PackedVector3Array &p_cage_vertex_array, const TopologyDataMesh::StencilTableView &p_stencil_table) const;
 	OpenSubdiv::Far::TopologyDescriptor _create_topology_descriptor(Vector<int> &subdiv_face_vertex_count,
 			OpenSubdiv::Far::TopologyDescriptor::FVarChannel *channels, const int32_t p_format);
 	OpenSubdiv::Far::TopologyRefiner *_create_topology_refiner(const int32_t p_level, const int num_channels);
-	void _create_subdivision_vertices(OpenSubdiv::Far::TopologyRefiner *refiner, const int p_level, const int32_t p_format);
+	/**
+	 * @brief Interpolates all primvars of p_format into topology_data
+	 *
+	 * @param refiner
+	 * @param p_level
+	 * @param p_format
+	 * @param p_measure_lod_errors measures how far vertices move per level for the lod distances, only needed by _create_lod_data
+	 */
+	void _create_subdivision_vertices(OpenSubdiv::Far::TopologyRefiner *refiner, const int p_level, const int32_t p_format, bool p_measure_lod_errors);
 	void _create_subdivision_faces(OpenSubdiv::Far::TopologyRefiner *refiner,
 			const int32_t p_level, const int32_t p_format);
+	/**
+	 * @brief Fills the lod data of topology_data, every corner of a coarser level gets mapped to the corner of its descendant face
+	 * in the last level. Needs the lod errors measured by _create_subdivision_vertices.
+	 *
+	 * @param refiner
+	 * @param p_level
+	 */
+	void _create_lod_data(OpenSubdiv::Far::TopologyRefiner *refiner, const int32_t p_level);
+	/**
+	 * @brief Fills the lod data of topology_data from the REFINEMENT_LOD_* arrays stored by get_refinement_arrays,
+	 * needs the index array of the last level to be set already. Stays empty for data without lods.
+	 *
+	 * @param p_refinement_arrays
+	 */
+	void _set_lod_data_from_refinement(const Array &p_refinement_arrays);
 	PackedVector3Array _calculate_smooth_normals(const PackedVector3Array &quad_vertex_array, const PackedInt32Array &quad_index_array) const;
+	/**
+	 * @brief Per vertex cage normals if use_cage_normals is enabled and p_arrays has them
+	 *
+	 * @param p_arrays cage arrays
+	 * @param p_format
+	 * @param r_normal_array
+	 * @return bool false if normals need to be calculated from the subdivided vertices
+	 */
+	bool _get_cage_normals(const Array &p_arrays, int32_t p_format, PackedVector3Array &r_normal_array) const;
+	static void _normalize_normals(PackedVector3Array &r_normal_array);
 
 	virtual OpenSubdiv::Sdc::SchemeType _get_refiner_type() const;
 	virtual Vector<int> _get_face_vertex_count() const;
 	virtual int32_t _get_vertices_per_face_count() const;
-	virtual Array _get_triangle_arrays() const;
+	virtual Array _get_triangle_arrays();
 	//might be needed if actual topology data with not just quads OR triangles is used, otherwise just calls _get_triangle_arrays
-	virtual Array _get_direct_triangle_arrays() const;
+	virtual Array _get_direct_triangle_arrays();
+
+	/**
+	 * @brief Output vertex -> topology_data vertex of the last created triangle arrays
+	 *
+	 */
+	PackedInt32Array vertex_remap;
+	/**
+	 * @brief Index arrays of the coarser levels over the vertices of the last created triangle arrays, see get_lods
+	 *
+	 */
+	Dictionary lods;
+	/**
+	 * @brief Creates indexed triangle arrays from topology_data. Face corners with the same vertex and uv index share
+	 * one output vertex, so vertices only get split at uv seams. Triangles get reordered for the vertex cache and vertices
+	 * are in order of their first use, see VertexCacheOptimizer.
+	 *
+	 * @param p_triangle_corners corner (position in index_array) of every triangle vertex
+	 * @return Array mesh arrays, tangents get generated if normals and uv's exist
+	 */
+	Array _create_triangle_arrays(const PackedInt32Array &p_triangle_corners);
+	/**
+	 * @brief Generates tangents with tangent_mode if p_arrays have normals and uv's
+	 *
+	 */
+	Array _add_tangents(const Array &p_arrays) const;
 
 public:
 	enum Channels {
@@ -77,4 +171,107 @@ public:
 
 	Array get_subdivided_arrays(const Array &p_arrays, int p_level, int32_t p_format, bool calculate_normals); //Returns triangle faces for rendering
 	Array get_subdivided_topology_arrays(const Array &p_arrays, int p_level, int32_t p_format, bool calculate_normals); //returns actual face data
-};
\ No newline at end of file
+	Array get_subdivided_arrays_from_refinement(const Array &p_arrays, const Array &p_refinement_arrays, int32_t p_format, bool calculate_normals); //same as get_subdivided_arrays, just skips refinement
+	//stencils can also come from a memory mapped file here, their indices need to be checked with is_valid_for beforehand
+	Array get_subdivided_arrays_from_refinement(const Array &p_arrays, const Array &p_refinement_arrays, const TopologyDataMesh::StencilTableView &p_stencil_table,
+			int32_t p_format, bool calculate_normals);
+	/**
+	 * @brief Subdivides moved cage vertices, but keeps the triangles, uv's and vertex order of p_base_arrays. Triangulating
+	 * n-gons depends on the vertex positions, blend shapes need the triangulation of the base mesh to line up with it.
+	 *
+	 * @param p_arrays cage arrays with the moved vertices, same topology as the base mesh
+	 * @param p_level
+	 * @param p_refinement_arrays precomputed refinement data of p_level, can be empty
+	 * @param p_base_arrays what the last get_subdivided_arrays(_from_refinement) call of this subdivider returned for the base mesh
+	 * @param p_format
+	 * @return Array triangle arrays with vertices, normals, tangents if p_base_arrays has uv's, uv's and indices
+	 */
+	Array get_subdivided_arrays_with_base(const Array &p_arrays, int p_level, const Array &p_refinement_arrays, const Array &p_base_arrays,
+			int32_t p_format);
+
+	/**
+	 * @brief Refines once and returns everything that only depends on topology: the final level stencil table
+	 * and the refined index, uv and bone arrays. Gets stored in TopologyDataMesh per level.
+	 *
+	 * @param p_arrays cage arrays
+	 * @param p_level subdivision level, at least 1
+	 * @param p_format
+	 * @return Array see TopologyDataMesh::RefinementArrayType
+	 */
+	Array get_refinement_arrays(const Array &p_arrays, int p_level, int32_t p_format);
+
+	/**
+	 * @brief If enabled only the vertices, uv's and weights of the last level are kept and index arrays start at 0.
+	 * Levels in between get interpolated through two alternating buffers. Otherwise (default) all levels stay in the arrays one after another,
+	 * e.g. for get_subdivided_topology_arrays. SubdivisionBaker and SubdivMeshInstance3D enable it.
+	 *
+	 * @param p_final_level_only
+	 */
+	void set_final_level_only(bool p_final_level_only);
+	bool get_final_level_only() const;
+
+	/**
+	 * @brief How tangents of meshes with normals and uv's get generated. TANGENT_MODE_ANALYTIC (default) only differs
+	 * from MikkTSpace where uv's are distorted a lot, use TANGENT_MODE_MIKKTSPACE if normal maps show seams.
+	 * SubdivisionBaker and BakedSubdivMesh default to TANGENT_MODE_MIKKTSPACE instead.
+	 *
+	 * @param p_tangent_mode
+	 */
+	void set_tangent_mode(TangentMode p_tangent_mode);
+	TangentMode get_tangent_mode() const;
+
+	/**
+	 * @brief If enabled the authored cage normals (TopologyDataMesh::ARRAY_NORMAL) get interpolated like positions and
+	 * renormalized, instead of calculating smooth normals from the subdivided faces. Keeps custom normals, meant for static
+	 * and baked meshes, per frame vertex updates still calculate normals from the deformed faces.
+	 *
+	 * @param p_use_cage_normals
+	 */
+	void set_use_cage_normals(bool p_use_cage_normals);
+	bool get_use_cage_normals() const;
+
+	/**
+	 * @brief Output vertex -> subdivided vertex of the last get_subdivided_arrays call
+	 *
+	 * @return PackedInt32Array
+	 */
+	PackedInt32Array get_vertex_remap() const;
+	/**
+	 * @brief Coarser subdivision levels of the last get_subdivided_arrays call as mesh lods. They use the same vertices,
+	 * corners of a coarser level use the vertex they end up at in the last level.
+	 *
+	 * @return Dictionary lod distance -> PackedInt32Array, like the lods parameter of ArrayMesh::add_surface_from_arrays.
+	 * Empty for level 0 and for refinement data stored before lods were part of it.
+	 */
+	Dictionary get_lods() const;
+	/**
+	 * @brief Creates a fan over the faces of the last subdivision, VertexFaceFan::calculate_normals with it gives the same normals
+	 * as the subdivision itself. Only depends on topology, so it can be kept for per frame updates.
+	 * Faces of level 0 mixed meshes get triangulated.
+	 *
+	 * @param r_fan fan over the subdivided vertices (not the triangle mesh vertices, see get_vertex_remap)
+	 * @param r_face_index_array faces the fan was created from
+	 */
+	void create_normal_fan(VertexFaceFan &r_fan, PackedInt32Array &r_face_index_array) const;
+	/**
+	 * @brief Returns p_vertex_array[p_vertex_remap[i]] for every i
+	 *
+	 * @param p_vertex_array
+	 * @param p_vertex_remap
+	 * @return PackedVector3Array empty on invalid indices
+	 */
+	static PackedVector3Array remap_vertices(const PackedVector3Array &p_vertex_array, const PackedInt32Array &p_vertex_remap);
+	/**
+	 * @brief Only subdivides positions and returns them in the vertex order of earlier triangle arrays, used for per frame updates
+	 *
+	 * @param p_arrays cage arrays, vertex, index and (mixed) face vertex count array get used
+	 * @param p_level
+	 * @param p_vertex_remap get_vertex_remap of the call that created the triangle arrays, if empty vertices stay in subdivided order
+	 * @return PackedVector3Array
+	 */
+	PackedVector3Array get_subdivided_vertices(const Array &p_arrays, int p_level, const PackedInt32Array &p_vertex_remap);
+	PackedVector3Array get_subdivided_vertices_from_refinement(const Array &p_arrays, const TopologyDataMesh::StencilTableView &p_stencil_table,
+			const PackedInt32Array &p_vertex_remap);
+};
+
+VARIANT_ENUM_CAST(Subdivider::TangentMode);
@@ -1,33 +1,110 @@
 #include "subdivision_baker.hpp"
 #include "godot_cpp/variant/utility_functions.hpp"
+#include "mixed_subdivider.hpp"
 #include "quad_subdivider.hpp"
 #include "triangle_subdivider.hpp"
 
-Array SubdivisionBaker::get_baked_arrays(const Array &topology_arrays, int p_level, int64_t p_format, TopologyDataMesh::TopologyType topology_type) {
+Ref<Subdivider> SubdivisionBaker::_create_subdivider(TopologyDataMesh::TopologyType topology_type) const {
+	Ref<Subdivider> subdivider;
 	switch (topology_type) {
 		case TopologyDataMesh::QUAD: {
-			Ref<QuadSubdivider> subdivider;
-			subdivider.instantiate();
-			return subdivider->get_subdivided_arrays(topology_arrays, p_level, p_format, true);
+			Ref<QuadSubdivider> quad_subdivider;
+			quad_subdivider.instantiate();
+			subdivider = quad_subdivider;
+			break;
 		}
 
 		case TopologyDataMesh::TRIANGLE: {
-			Ref<TriangleSubdivider> subdivider;
-			subdivider.instantiate();
-			return subdivider->get_subdivided_arrays(topology_arrays, p_level, p_format, true);
+			Ref<TriangleSubdivider> triangle_subdivider;
+			triangle_subdivider.instantiate();
+			subdivider = triangle_subdivider;
+			break;
+		}
+
+		case TopologyDataMesh::MIXED: {
+			Ref<MixedSubdivider> mixed_subdivider;
+			mixed_subdivider.instantiate();
+			subdivider = mixed_subdivider;
+			break;
 		}
 
 		default:
-			return Array();
+			return Ref<Subdivider>();
+	}
+	subdivider->set_final_level_only(true);
+	subdivider->set_tangent_mode(tangent_mode);
+	return subdivider;
+}
+
+void SubdivisionBaker::set_tangent_mode(Subdivider::TangentMode p_tangent_mode) {
+	tangent_mode = p_tangent_mode;
+}
+
+Subdivider::TangentMode SubdivisionBaker::get_tangent_mode() const {
+	return tangent_mode;
+}
+
+void SubdivisionBaker::set_use_cage_normals(bool p_use_cage_normals) {
+	use_cage_normals = p_use_cage_normals;
+}
+
+bool SubdivisionBaker::get_use_cage_normals() const {
+	return use_cage_normals;
+}
+
+Array SubdivisionBaker::get_baked_arrays(const Array &topology_arrays, int p_level, int64_t p_format, TopologyDataMesh::TopologyType topology_type,
+		const Array &p_refinement_arrays) {
+	return get_baked_arrays(topology_arrays, p_level, p_format, topology_type, p_refinement_arrays, nullptr);
+}
+
+Array SubdivisionBaker::get_baked_arrays(const Array &topology_arrays, int p_level, int64_t p_format, TopologyDataMesh::TopologyType topology_type,
+		const Array &p_refinement_arrays, Dictionary *r_lods) {
+	Ref<Subdivider> subdivider = _create_subdivider(topology_type);
+	ERR_FAIL_COND_V(subdivider.is_null(), Array());
+	const Array baked_arrays = _bake_arrays(subdivider, topology_arrays, p_level, p_format, p_refinement_arrays);
+	if (r_lods) {
+		*r_lods = subdivider->get_lods();
+	}
+	return baked_arrays;
+}
+
+Array SubdivisionBaker::_bake_arrays(const Ref<Subdivider> &p_subdivider, const Array &topology_arrays, int p_level, int64_t p_format,
+		const Array &p_refinement_arrays) const {
+	p_subdivider->set_use_cage_normals(use_cage_normals);
+	if (p_level > 0 && !p_refinement_arrays.is_empty()) {
+		return p_subdivider->get_subdivided_arrays_from_refinement(topology_arrays, p_refinement_arrays, p_format, true);
+	}
+	return p_subdivider->get_subdivided_arrays(topology_arrays, p_level, p_format, true);
+}
+
+void SubdivisionBaker::bake_refinement_data(const Ref<TopologyDataMesh> &p_topology_data_mesh, int32_t p_level) {
+	ERR_FAIL_COND(p_topology_data_mesh.is_null());
+	ERR_FAIL_COND(p_level <= 0);
+	for (int surface_index = 0; surface_index < p_topology_data_mesh->get_surface_count(); surface_index++) {
+		Ref<Subdivider> subdivider = _create_subdivider(p_topology_data_mesh->surface_get_topology_type(surface_index));
+		ERR_CONTINUE(subdivider.is_null());
+		const Array refinement_arrays = subdivider->get_refinement_arrays(p_topology_data_mesh->surface_get_arrays(surface_index), p_level,
+				p_topology_data_mesh->surface_get_format(surface_index));
+		ERR_CONTINUE(refinement_arrays.is_empty());
+		p_topology_data_mesh->surface_set_refinement_data(surface_index, p_level, refinement_arrays);
 	}
 }
 
 TypedArray<Array> SubdivisionBaker::get_baked_blend_shape_arrays(const Array &base_arrays, const Array &relative_topology_blend_shape_arrays,
-		int32_t p_level, int64_t p_format, TopologyDataMesh::TopologyType topology_type) {
+		int32_t p_level, int64_t p_format, TopologyDataMesh::TopologyType topology_type, const Array &p_refinement_arrays) {
 	Array blend_shape_arrays = base_arrays.duplicate(false);
 	p_format &= ~Mesh::ARRAY_FORMAT_BONES;
 	p_format &= ~Mesh::ARRAY_FORMAT_WEIGHTS;
 	TypedArray<Array> baked_blend_shape_arrays;
+	if (relative_topology_blend_shape_arrays.is_empty()) {
+		return baked_blend_shape_arrays;
+	}
+	//n-gons get triangulated by their positions, every shape keeps the triangles and vertex order of the base mesh instead
+	Ref<Subdivider> subdivider = _create_subdivider(topology_type);
+	ERR_FAIL_COND_V(subdivider.is_null(), baked_blend_shape_arrays);
+	const Array baked_base_arrays = _bake_arrays(subdivider, base_arrays, p_level, p_format, p_refinement_arrays);
+	ERR_FAIL_COND_V(baked_base_arrays.is_empty(), baked_blend_shape_arrays);
+
 	const PackedVector3Array &topology_vertex_array = base_arrays[TopologyDataMesh::ARRAY_VERTEX];
 	for (int blend_shape_idx = 0; blend_shape_idx < relative_topology_blend_shape_arrays.size(); blend_shape_idx++) {
 		const Array &single_blend_shape_arrays = relative_topology_blend_shape_arrays[blend_shape_idx];
@@ -39,7 +116,8 @@ TypedArray<Array> SubdivisionBaker::get_baked_blend_shape_arrays(const Array &ba
 
 		blend_shape_arrays[Mesh::ARRAY_VERTEX] = blend_shape_vertex_array_absolute;
 
-		Array full_baked_array = get_baked_arrays(blend_shape_arrays, p_level, p_format, topology_type);
+		Array full_baked_array = subdivider->get_subdivided_arrays_with_base(blend_shape_arrays, p_level, p_refinement_arrays, baked_base_arrays, p_format);
+		ERR_CONTINUE(full_baked_array.is_empty());
 
 		//Vertex, normal, tangent
 		Array single_baked_blend_shape_array;
@@ -53,7 +131,8 @@ TypedArray<Array> SubdivisionBaker::get_baked_blend_shape_arrays(const Array &ba
 	return baked_blend_shape_arrays;
 }
 
-Ref<ImporterMesh> SubdivisionBaker::get_importer_mesh(const Ref<ImporterMesh> &p_base, const Ref<TopologyDataMesh> &p_topology_data_mesh, int32_t p_level, bool bake_blendshapes) {
+Ref<ImporterMesh> SubdivisionBaker::get_importer_mesh(const Ref<ImporterMesh> &p_base, const Ref<TopologyDataMesh> &p_topology_data_mesh, int32_t p_level, bool bake_blendshapes,
+		bool p_lods) {
 	Ref<ImporterMesh> mesh;
 	if (!p_base.is_null()) {
 		mesh = p_base;
@@ -75,15 +154,18 @@ Ref<ImporterMesh> SubdivisionBaker::get_importer_mesh(const Ref<ImporterMesh> &p
 		const String &surface_name = p_topology_data_mesh->surface_get_name(surface_index);
 		const Ref<Material> &surface_material = p_topology_data_mesh->surface_get_material(surface_index);
 
-		Array surface_baked_arrays = get_baked_arrays(source_arrays, p_level, p_format, topology_type);
+		const Array refinement_arrays = p_topology_data_mesh->surface_get_refinement_data(surface_index, p_level);
+
+		Dictionary lods;
+		Array surface_baked_arrays = get_baked_arrays(source_arrays, p_level, p_format, topology_type, refinement_arrays, p_lods ? &lods : nullptr);
 
 		TypedArray<Array> baked_blend_shape_arrays;
 		if (bake_blendshapes && p_topology_data_mesh->get_blend_shape_count() > 0) {
 			baked_blend_shape_arrays = get_baked_blend_shape_arrays(source_arrays, p_topology_data_mesh->surface_get_blend_shape_arrays(surface_index),
-					p_level, p_format, topology_type);
+					p_level, p_format, topology_type, refinement_arrays);
 		}
 
-		mesh->add_surface(Mesh::PRIMITIVE_TRIANGLES, surface_baked_arrays, baked_blend_shape_arrays, Dictionary(), surface_material, surface_name, 0);
+		mesh->add_surface(Mesh::PRIMITIVE_TRIANGLES, surface_baked_arrays, baked_blend_shape_arrays, lods, surface_material, surface_name, 0);
 	}
 
 	return mesh;
@@ -99,8 +181,9 @@ Ref<ArrayMesh> SubdivisionBaker::get_array_mesh(const Ref<ArrayMesh> &p_base, co
 		mesh.instantiate();
 	}
 
-	importer_mesh = get_importer_mesh(importer_mesh, p_topology_data_mesh, p_level, bake_blendshapes);
-	if (generate_lods) {
+	importer_mesh = get_importer_mesh(importer_mesh, p_topology_data_mesh, p_level, bake_blendshapes, generate_lods);
+	//subdivision levels already are lods and share the vertices, no need to simplify the dense mesh
+	if (generate_lods && p_level == 0) {
 		importer_mesh->generate_lods(UtilityFunctions::deg_to_rad(25), UtilityFunctions::deg_to_rad(60), Array());
 	}
 	mesh = importer_mesh->get_mesh(mesh);
@@ -108,7 +191,15 @@ Ref<ArrayMesh> SubdivisionBaker::get_array_mesh(const Ref<ArrayMesh> &p_base, co
 }
 
 void SubdivisionBaker::_bind_methods() {
-	ClassDB::bind_method(D_METHOD("get_baked_arrays", "topology_arrays", "subdivision_level", "format", "topology_type"), &SubdivisionBaker::get_baked_arrays);
+	ClassDB::bind_method(D_METHOD("get_baked_arrays", "topology_arrays", "subdivision_level", "format", "topology_type", "refinement_arrays"),
+			static_cast<Array (SubdivisionBaker::*)(const Array &, int32_t, int64_t, TopologyDataMesh::TopologyType, const Array &)>(&SubdivisionBaker::get_baked_arrays), DEFVAL(Array()));
+	ClassDB::bind_method(D_METHOD("bake_refinement_data", "topology_data_mesh", "subdivision_level"), &SubdivisionBaker::bake_refinement_data);
 	ClassDB::bind_method(D_METHOD("get_importer_mesh", "base", "topology_data_mesh", "subdivision_level"), &SubdivisionBaker::get_importer_mesh);
 	ClassDB::bind_method(D_METHOD("get_array_mesh", "base", "topology_data_mesh", "subdivision_level", "generate_lods"), &SubdivisionBaker::get_array_mesh);
+	ClassDB::bind_method(D_METHOD("set_use_cage_normals", "use_cage_normals"), &SubdivisionBaker::set_use_cage_normals);
+	ClassDB::bind_method(D_METHOD("get_use_cage_normals"), &SubdivisionBaker::get_use_cage_normals);
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "use_cage_normals"), "set_use_cage_normals", "get_use_cage_normals");
+	ClassDB::bind_method(D_METHOD("set_tangent_mode", "tangent_mode"), &SubdivisionBaker::set_tangent_mode);
+	ClassDB::bind_method(D_METHOD("get_tangent_mode"), &SubdivisionBaker::get_tangent_mode);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "tangent_mode", PROPERTY_HINT_ENUM, "Analytic,MikkTSpace"), "set_tangent_mode", "get_tangent_mode");
 }
\ No newline at end of file
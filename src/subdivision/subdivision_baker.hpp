@@ -5,18 +5,51 @@
 #include "godot_cpp/classes/ref_counted.hpp"
 #include "godot_cpp/core/binder_common.hpp"
 #include "resources/topology_data_mesh.hpp"
+#include "subdivider.hpp"
 
 using namespace godot;
 class SubdivisionBaker : public RefCounted {
 	GDCLASS(SubdivisionBaker, RefCounted);
 
 protected:
+	bool use_cage_normals = false;
+	Subdivider::TangentMode tangent_mode = Subdivider::TANGENT_MODE_MIKKTSPACE; //baked once, exact normal map tangents are worth it
+
 	static void _bind_methods();
+	//final level only subdivider with the settings of this baker
+	Ref<Subdivider> _create_subdivider(TopologyDataMesh::TopologyType topology_type) const;
+	//uses p_refinement_arrays instead of refining if not empty
+	Array _bake_arrays(const Ref<Subdivider> &p_subdivider, const Array &topology_arrays, int p_level, int64_t p_format, const Array &p_refinement_arrays) const;
 
 public:
+	//interpolate the cage normals instead of calculating smooth normals, see Subdivider::set_use_cage_normals
+	void set_use_cage_normals(bool p_use_cage_normals);
+	bool get_use_cage_normals() const;
+	//how tangents get generated, see Subdivider::set_tangent_mode. Defaults to TANGENT_MODE_MIKKTSPACE
+	void set_tangent_mode(Subdivider::TangentMode p_tangent_mode);
+	Subdivider::TangentMode get_tangent_mode() const;
+
+	//generate_lods uses the coarser subdivision levels as lods, only level 0 still needs ImporterMesh::generate_lods
 	Ref<ArrayMesh> get_array_mesh(const Ref<ArrayMesh> &p_base, const Ref<TopologyDataMesh> &p_topology_data_mesh, int32_t p_level, bool generate_lods, bool bake_blendshapes = false);
-	Ref<ImporterMesh> get_importer_mesh(const Ref<ImporterMesh> &p_base, const Ref<TopologyDataMesh> &p_topology_data_mesh, int32_t p_level, bool bake_blendshapes = false);
-	Array get_baked_arrays(const Array &topology_arrays, int32_t p_level, int64_t p_format, TopologyDataMesh::TopologyType topology_type);
+	//p_lods adds the coarser subdivision levels as lods of every surface, see Subdivider::get_lods
+	Ref<ImporterMesh> get_importer_mesh(const Ref<ImporterMesh> &p_base, const Ref<TopologyDataMesh> &p_topology_data_mesh, int32_t p_level, bool bake_blendshapes = false,
+			bool p_lods = true);
+	//uses p_refinement_arrays instead of refining if not empty
+	Array get_baked_arrays(const Array &topology_arrays, int32_t p_level, int64_t p_format, TopologyDataMesh::TopologyType topology_type,
+			const Array &p_refinement_arrays = Array());
+	//r_lods gets the coarser levels as lods, refinement data brings its own (see TopologyDataMesh::REFINEMENT_LOD_CORNERS)
+	Array get_baked_arrays(const Array &topology_arrays, int32_t p_level, int64_t p_format, TopologyDataMesh::TopologyType topology_type,
+			const Array &p_refinement_arrays, Dictionary *r_lods);
+	//vertices, normals and tangents of every shape, in the vertex order of the base mesh from get_baked_arrays
 	TypedArray<Array> get_baked_blend_shape_arrays(const Array &base_arrays, const Array &relative_topology_blend_shape_arrays,
-			int32_t p_level, int64_t p_format, TopologyDataMesh::TopologyType topology_type);
+			int32_t p_level, int64_t p_format, TopologyDataMesh::TopologyType topology_type, const Array &p_refinement_arrays = Array());
+
+	/**
+	 * @brief Precomputes stencils and refined topology of every surface for p_level and stores them in the mesh,
+	 * SubdivMeshInstance3D and baking then skip refinement for that level
+	 *
+	 * @param p_topology_data_mesh
+	 * @param p_level subdivision level, at least 1
+	 */
+	void bake_refinement_data(const Ref<TopologyDataMesh> &p_topology_data_mesh, int32_t p_level);
 };
\ No newline at end of file
@@ -12,34 +12,74 @@
 #include "godot_cpp/templates/vector.hpp"
 #include "godot_cpp/variant/builtin_types.hpp"
 
+#include "mixed_subdivider.hpp"
 #include "quad_subdivider.hpp"
 #include "triangle_subdivider.hpp"
 
-Array SubdivisionMesh::_get_subdivided_arrays(const Array &p_arrays, int p_level, int32_t p_format, bool calculate_normals, TopologyDataMesh::TopologyType topology_type) {
-	const PackedVector3Array &vertex_array = p_arrays[TopologyDataMesh::ARRAY_VERTEX];
-	if (vertex_array.is_empty()) {
-		Array empty_surface;
-		empty_surface.resize(Mesh::ARRAY_MAX);
-		return empty_surface;
-	}
+Ref<Subdivider> SubdivisionMesh::_create_subdivider(TopologyDataMesh::TopologyType topology_type) {
 	switch (topology_type) {
 		case TopologyDataMesh::QUAD: {
-			Ref<QuadSubdivider> subdivider;
-			subdivider.instantiate();
-			return subdivider->get_subdivided_arrays(p_arrays, p_level, p_format, calculate_normals);
+			Ref<QuadSubdivider> quad_subdivider;
+			quad_subdivider.instantiate();
+			quad_subdivider->set_final_level_only(true);
+			return quad_subdivider;
 		}
 
 		case TopologyDataMesh::TRIANGLE: {
-			Ref<TriangleSubdivider> subdivider;
-			subdivider.instantiate();
-			return subdivider->get_subdivided_arrays(p_arrays, p_level, p_format, calculate_normals);
+			Ref<TriangleSubdivider> triangle_subdivider;
+			triangle_subdivider.instantiate();
+			triangle_subdivider->set_final_level_only(true);
+			return triangle_subdivider;
+		}
+
+		case TopologyDataMesh::MIXED: {
+			Ref<MixedSubdivider> mixed_subdivider;
+			mixed_subdivider.instantiate();
+			mixed_subdivider->set_final_level_only(true);
+			return mixed_subdivider;
 		}
 
 		default:
-			return Array();
+			return Ref<Subdivider>();
 	}
 }
 
+Array SubdivisionMesh::_get_subdivided_arrays(const Array &p_arrays, int p_level, int32_t p_format, bool calculate_normals, TopologyDataMesh::TopologyType topology_type,
+		const Array &p_refinement_arrays, const TopologyDataMesh::StencilTableView &p_stencil_table, PackedInt32Array *r_vertex_remap, Dictionary *r_lods,
+		SurfaceShading *r_shading) {
+	const PackedVector3Array &vertex_array = p_arrays[TopologyDataMesh::ARRAY_VERTEX];
+	if (vertex_array.is_empty()) {
+		Array empty_surface;
+		empty_surface.resize(Mesh::ARRAY_MAX);
+		return empty_surface;
+	}
+	Ref<Subdivider> subdivider = _create_subdivider(topology_type);
+	ERR_FAIL_COND_V(subdivider.is_null(), Array());
+
+	Array subdivided_arrays;
+	//precomputed stencils skip creating the refiner completely
+	if (p_level > 0 && !p_refinement_arrays.is_empty() && p_stencil_table.is_valid()) {
+		subdivided_arrays = subdivider->get_subdivided_arrays_from_refinement(p_arrays, p_refinement_arrays, p_stencil_table, p_format, calculate_normals);
+	} else {
+		subdivided_arrays = subdivider->get_subdivided_arrays(p_arrays, p_level, p_format, calculate_normals);
+	}
+	if (r_vertex_remap) {
+		*r_vertex_remap = subdivider->get_vertex_remap();
+	}
+	if (r_lods) {
+		*r_lods = subdivider->get_lods();
+	}
+	if (r_shading && calculate_normals) {
+		subdivider->create_normal_fan(r_shading->normal_fan, r_shading->face_index_array);
+		if (subdivided_arrays[Mesh::ARRAY_TANGENT].get_type() == Variant::PACKED_FLOAT32_ARRAY) {
+			r_shading->triangle_index_array = subdivided_arrays[Mesh::ARRAY_INDEX];
+			r_shading->uv_array = subdivided_arrays[Mesh::ARRAY_TEX_UV];
+			r_shading->tangent_fan.create(r_shading->triangle_index_array, 3, r_shading->uv_array.size());
+		}
+	}
+	return subdivided_arrays;
+}
+
 void SubdivisionMesh::update_subdivision(Ref<TopologyDataMesh> p_mesh, int32_t p_level) {
 	_update_subdivision(p_mesh, p_level, Vector<Array>()); //TODO: maybe split functions up
 }
@@ -48,6 +88,10 @@ void SubdivisionMesh::_update_subdivision(Ref<TopologyDataMesh> p_mesh, int32_t
 	subdiv_mesh.clear_surfaces();
 	subdiv_vertex_count.clear();
 	subdiv_index_count.clear();
+	surface_refinement_arrays.clear();
+	surface_stencil_tables.clear();
+	surface_vertex_remaps.clear();
+	surface_shadings.clear();
 
 	ERR_FAIL_COND(p_mesh.is_null());
 	ERR_FAIL_COND(p_level < 0);
@@ -62,36 +106,75 @@ void SubdivisionMesh::_update_subdivision(Ref<TopologyDataMesh> p_mesh, int32_t
 
 		Array v_arrays = cached_data_arrays.size() ? cached_data_arrays[surface_index]
 												   : p_mesh->surface_get_arrays(surface_index);
-		Array subdiv_triangle_arrays = _get_subdivided_arrays(v_arrays, p_level, surface_format, true, p_mesh->surface_get_topology_type(surface_index));
+		//stencils stay where they are (possibly a memory mapped file), everything else is small enough to copy
+		const Array refinement_arrays = p_mesh->_surface_get_refinement_data(surface_index, p_level, false);
+		TopologyDataMesh::StencilTableView stencil_table;
+		p_mesh->surface_get_stencil_table(surface_index, p_level, stencil_table);
+		surface_refinement_arrays.push_back(refinement_arrays);
+		surface_stencil_tables.push_back(stencil_table);
+		PackedInt32Array vertex_remap;
+		Dictionary lods;
+		SurfaceShading shading;
+		Array subdiv_triangle_arrays = _get_subdivided_arrays(v_arrays, p_level, surface_format, true, p_mesh->surface_get_topology_type(surface_index),
+				refinement_arrays, stencil_table, &vertex_remap, &lods, &shading);
+		surface_vertex_remaps.push_back(vertex_remap);
+		surface_shadings.push_back(shading);
 
 		Ref<Material> material = p_mesh->surface_get_material(surface_index);
-		subdiv_mesh.add_surface(subdiv_triangle_arrays, Dictionary(), material, "", surface_format);
+		subdiv_mesh.add_surface(subdiv_triangle_arrays, lods, material, "", surface_format);
 	}
 	current_level = p_level;
 }
 
 void SubdivisionMesh::update_subdivision_vertices(int p_surface, const PackedVector3Array &new_vertex_array,
-		const PackedInt32Array &index_array, TopologyDataMesh::TopologyType topology_type) {
+		const PackedInt32Array &index_array, const PackedInt32Array &face_vertex_count_array, TopologyDataMesh::TopologyType topology_type) {
 	int p_level = current_level;
 	ERR_FAIL_COND(p_level < 0);
-
-	int32_t surface_format = Mesh::ARRAY_FORMAT_VERTEX;
-	surface_format &= Mesh::ARRAY_FORMAT_INDEX;
+	ERR_FAIL_INDEX(p_surface, surface_vertex_remaps.size());
 
 	Array v_arrays;
 	v_arrays.resize(TopologyDataMesh::ARRAY_MAX);
 	v_arrays[TopologyDataMesh::ARRAY_VERTEX] = new_vertex_array;
 	v_arrays[TopologyDataMesh::ARRAY_INDEX] = index_array;
+	v_arrays[TopologyDataMesh::ARRAY_FACE_VERTEX_COUNT] = face_vertex_count_array;
+
+	Ref<Subdivider> subdivider = _create_subdivider(topology_type);
+	ERR_FAIL_COND(subdivider.is_null());
+	//positions stay in subdivided order until normals are done, so vertices split at uv seams share their normal
+	PackedVector3Array subdivided_vertex_array;
+	if (p_level > 0 && !surface_refinement_arrays[p_surface].is_empty() && surface_stencil_tables[p_surface].is_valid()) {
+		subdivided_vertex_array = subdivider->get_subdivided_vertices_from_refinement(v_arrays, surface_stencil_tables[p_surface], PackedInt32Array());
+	} else {
+		subdivided_vertex_array = subdivider->get_subdivided_vertices(v_arrays, p_level, PackedInt32Array());
+	}
 
-	//TODO: also update normals
-	// currently normal generation too slow to actually update
-	Array subdiv_triangle_arrays = _get_subdivided_arrays(v_arrays, p_level, surface_format, false, topology_type);
+	//vertices get written in the layout of the triangle mesh, which only splits at uv seams
+	const PackedInt32Array &vertex_remap = surface_vertex_remaps[p_surface];
+	const SurfaceShading &shading = surface_shadings[p_surface];
+	Array subdiv_triangle_arrays;
+	subdiv_triangle_arrays.resize(Mesh::ARRAY_MAX);
+	const PackedVector3Array vertex_array = Subdivider::remap_vertices(subdivided_vertex_array, vertex_remap);
+	subdiv_triangle_arrays[Mesh::ARRAY_VERTEX] = vertex_array;
+	//cached fans make this a few linear parallel passes, cheaper than the stencils that produced the positions
+	if (!shading.normal_fan.is_empty()) {
+		const PackedVector3Array normal_array = Subdivider::remap_vertices(
+				shading.normal_fan.calculate_normals(subdivided_vertex_array, shading.face_index_array), vertex_remap);
+		subdiv_triangle_arrays[Mesh::ARRAY_NORMAL] = normal_array;
+		if (!shading.tangent_fan.is_empty()) {
+			subdiv_triangle_arrays[Mesh::ARRAY_TANGENT] = shading.tangent_fan.calculate_tangents(vertex_array, normal_array,
+					shading.uv_array, shading.triangle_index_array);
+		}
+	}
 
 	subdiv_mesh.update_surface_vertices(p_surface, subdiv_triangle_arrays);
 }
 
 void SubdivisionMesh::clear() {
 	subdiv_mesh.clear_surfaces();
+	surface_refinement_arrays.clear();
+	surface_stencil_tables.clear();
+	surface_vertex_remaps.clear();
+	surface_shadings.clear();
 	subdiv_vertex_count.clear();
 	subdiv_index_count.clear();
 }
@@ -11,6 +11,7 @@
 
 #include "rendering/local_mesh.h"
 #include "resources/topology_data_mesh.hpp"
+#include "subdivider.hpp"
 
 using namespace godot;
 
@@ -23,10 +24,30 @@ private:
 	LocalMesh subdiv_mesh; //generated triangle mesh
 
 	int current_level = -1;
+	Vector<Array> surface_refinement_arrays; //precomputed refinement data of current_level per surface, empty Array if the mesh has none
+	Vector<TopologyDataMesh::StencilTableView> surface_stencil_tables; //might point into a memory mapped file
+	Vector<PackedInt32Array> surface_vertex_remaps; //triangle mesh vertex -> subdivided vertex, see Subdivider::get_vertex_remap
+
+	/**
+	 * @brief Everything besides positions that's needed to recalculate normals and tangents after a vertex update.
+	 * Only depends on topology, so it gets created once per surface in _update_subdivision.
+	 *
+	 */
+	struct SurfaceShading {
+		VertexFaceFan normal_fan; //over subdivided vertices, empty if the surface has no normals
+		PackedInt32Array face_index_array;
+		VertexFaceFan tangent_fan; //over triangle mesh vertices, empty if the surface has no tangents
+		PackedInt32Array triangle_index_array;
+		PackedVector2Array uv_array;
+	};
+	Vector<SurfaceShading> surface_shadings;
 
 protected:
 	static void _bind_methods();
-	Array _get_subdivided_arrays(const Array &p_arrays, int p_level, int32_t p_format, bool calculate_normals, TopologyDataMesh::TopologyType topology_type);
+	static Ref<Subdivider> _create_subdivider(TopologyDataMesh::TopologyType topology_type);
+	Array _get_subdivided_arrays(const Array &p_arrays, int p_level, int32_t p_format, bool calculate_normals, TopologyDataMesh::TopologyType topology_type,
+			const Array &p_refinement_arrays = Array(), const TopologyDataMesh::StencilTableView &p_stencil_table = TopologyDataMesh::StencilTableView(),
+			PackedInt32Array *r_vertex_remap = nullptr, Dictionary *r_lods = nullptr, SurfaceShading *r_shading = nullptr);
 
 	Vector<int64_t> subdiv_vertex_count; //variables used for compatibility with mesh
 	Vector<int64_t> subdiv_index_count;
@@ -39,7 +60,7 @@ public:
 	void update_subdivision(Ref<TopologyDataMesh> p_mesh, int p_level);
 	void _update_subdivision(Ref<TopologyDataMesh> p_mesh, int p_level, const Vector<Array> &cached_data_arrays);
 	void update_subdivision_vertices(int p_surface, const PackedVector3Array &new_vertex_array,
-			const PackedInt32Array &index_array, TopologyDataMesh::TopologyType topology_type);
+			const PackedInt32Array &index_array, const PackedInt32Array &face_vertex_count_array, TopologyDataMesh::TopologyType topology_type);
 	void clear();
 
 	int64_t surface_get_vertex_array_size(int p_surface) const;
@@ -1,6 +1,5 @@
 #include "triangle_subdivider.hpp"
 #include "godot_cpp/classes/mesh.hpp"
-#include "godot_cpp/classes/surface_tool.hpp"
 
 using namespace OpenSubdiv;
 
@@ -8,41 +7,15 @@ OpenSubdiv::Sdc::SchemeType TriangleSubdivider::_get_refiner_type() const {
 	return OpenSubdiv::Sdc::SchemeType::SCHEME_LOOP;
 }
 
-Array TriangleSubdivider::_get_triangle_arrays() const {
-	Ref<SurfaceTool> st;
-	st.instantiate();
-
-	bool use_uv = topology_data.uv_array.size();
-	bool use_bones = topology_data.weights_array.size();
-	bool has_normals = topology_data.normal_array.size();
-
-	st->begin(Mesh::PRIMITIVE_TRIANGLES);
-	for (int index = 0; index < topology_data.index_array.size(); index++) {
-		if (use_uv) {
-			st->set_uv(topology_data.uv_array[topology_data.uv_index_array[index]]);
-		}
-		if (has_normals) {
-			st->set_normal(topology_data.normal_array[topology_data.index_array[index]]);
-		}
-		if (use_bones) {
-			PackedInt32Array bones_array;
-			PackedFloat32Array weights_array;
-			for (int bone_index = 0; bone_index < 4; bone_index++) {
-				bones_array.append(topology_data.bones_array[topology_data.index_array[index] * 4 + bone_index]);
-				weights_array.append(topology_data.weights_array[topology_data.index_array[index] * 4 + bone_index]);
-			}
-			st->set_bones(bones_array);
-			st->set_weights(weights_array);
-		}
-		st->add_vertex(topology_data.vertex_array[topology_data.index_array[index]]);
-		st->add_index(index);
+Array TriangleSubdivider::_get_triangle_arrays() {
+	//faces already are triangles
+	PackedInt32Array triangle_corners;
+	triangle_corners.resize(topology_data.index_array.size());
+	int32_t *triangle_corners_ptrw = triangle_corners.ptrw();
+	for (int index = 0; index < triangle_corners.size(); index++) {
+		triangle_corners_ptrw[index] = index;
 	}
-
-	if (has_normals && use_uv) {
-		st->generate_tangents();
-	}
-
-	return st->commit_to_arrays();
+	return _create_triangle_arrays(triangle_corners);
 }
 
 Vector<int> TriangleSubdivider::_get_face_vertex_count() const {
@@ -55,7 +28,7 @@ Vector<int> TriangleSubdivider::_get_face_vertex_count() const {
 int32_t TriangleSubdivider::_get_vertices_per_face_count() const {
 	return 3;
 }
-Array TriangleSubdivider::_get_direct_triangle_arrays() const {
+Array TriangleSubdivider::_get_direct_triangle_arrays() {
 	return _get_triangle_arrays();
 };
 
@@ -11,8 +11,8 @@ class TriangleSubdivider : public Subdivider {
 protected:
 	static void _bind_methods();
 	virtual OpenSubdiv::Sdc::SchemeType _get_refiner_type() const override;
-	virtual Array _get_triangle_arrays() const override;
+	virtual Array _get_triangle_arrays() override;
 	virtual Vector<int> _get_face_vertex_count() const override;
 	virtual int32_t _get_vertices_per_face_count() const override;
-	virtual Array _get_direct_triangle_arrays() const override;
+	virtual Array _get_direct_triangle_arrays() override;
 };
@@ -0,0 +1,105 @@
+#include "mapped_file.hpp"
+
+#include "godot_cpp/classes/project_settings.hpp"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+void MappedFile::_bind_methods() {
+}
+
+Error MappedFile::open(const String &p_path) {
+	close();
+	const String global_path = ProjectSettings::get_singleton()->globalize_path(p_path);
+	if (global_path.begins_with("res://") || global_path.begins_with("user://")) {
+		return ERR_FILE_CANT_OPEN; //no filesystem location
+	}
+
+#ifdef _WIN32
+	HANDLE file = CreateFileW((LPCWSTR)global_path.wide_string().get_data(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+			nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return ERR_FILE_CANT_OPEN;
+	}
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+		CloseHandle(file);
+		return ERR_FILE_CANT_OPEN;
+	}
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr) {
+		CloseHandle(file);
+		return ERR_FILE_CANT_OPEN;
+	}
+	const void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == nullptr) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return ERR_FILE_CANT_OPEN;
+	}
+	file_handle = file;
+	mapping_handle = mapping;
+	data = static_cast<const uint8_t *>(view);
+	size = file_size.QuadPart;
+#else
+	const int fd = ::open(global_path.utf8().get_data(), O_RDONLY);
+	if (fd < 0) {
+		return ERR_FILE_CANT_OPEN;
+	}
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+		::close(fd);
+		return ERR_FILE_CANT_OPEN;
+	}
+	void *view = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd); //mapping stays valid without the descriptor
+	if (view == MAP_FAILED) {
+		return ERR_FILE_CANT_OPEN;
+	}
+	data = static_cast<const uint8_t *>(view);
+	size = file_stat.st_size;
+#endif
+	return OK;
+}
+
+void MappedFile::close() {
+	if (!data) {
+		return;
+	}
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+	CloseHandle(mapping_handle);
+	CloseHandle(file_handle);
+	mapping_handle = nullptr;
+	file_handle = nullptr;
+#else
+	munmap(const_cast<uint8_t *>(data), size);
+#endif
+	data = nullptr;
+	size = 0;
+}
+
+bool MappedFile::is_open() const {
+	return data != nullptr;
+}
+
+const uint8_t *MappedFile::get_data() const {
+	return data;
+}
+
+uint64_t MappedFile::get_size() const {
+	return size;
+}
+
+MappedFile::~MappedFile() {
+	close();
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "godot_cpp/classes/ref_counted.hpp"
+#include "godot_cpp/core/binder_common.hpp"
+
+using namespace godot;
+
+/**
+ * @brief Read only memory mapping of a file on disk, pages get loaded by the OS on first access
+ * and are shared between every process mapping the same file.
+ *
+ * @details Only works for files that exist on the actual filesystem (res:// while running from the editor, user://),
+ * files inside a pck can't be mapped and open fails. The mapping stays open as long as any reference is alive.
+ * Windows doesn't allow replacing a mapped file at all and everywhere else a file truncated in place invalidates the mapping,
+ * so mappings need to be released before the file gets written again, see TopologyDataMesh::release_files.
+ */
+class MappedFile : public RefCounted {
+	GDCLASS(MappedFile, RefCounted);
+
+private:
+	const uint8_t *data = nullptr;
+	uint64_t size = 0;
+#ifdef _WIN32
+	void *file_handle = nullptr;
+	void *mapping_handle = nullptr;
+#endif
+
+protected:
+	static void _bind_methods();
+
+public:
+	/**
+	 * @brief Maps the whole file, closes the previous mapping first
+	 *
+	 * @param p_path res://, user:// or absolute path
+	 * @return Error ERR_FILE_CANT_OPEN if the file isn't on disk or mapping isn't supported
+	 */
+	Error open(const String &p_path);
+	void close();
+	bool is_open() const;
+
+	const uint8_t *get_data() const;
+	uint64_t get_size() const;
+
+	MappedFile() {}
+	~MappedFile();
+};
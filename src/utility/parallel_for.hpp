@@ -0,0 +1,73 @@
+#pragma once
+
+#include "godot_cpp/classes/worker_thread_pool.hpp"
+
+using namespace godot;
+
+/**
+ * @brief Set while a parallel_for chunk or a ParallelForTaskScope runs on a pool thread, nested calls then run inline
+ * instead of waiting on tasks that might never get a free thread. Shared by all parallel_for instantiations.
+ */
+inline bool &parallel_for_inside_task() {
+	static thread_local bool inside_task = false;
+	return inside_task;
+}
+
+/**
+ * @brief Marks the current thread as running a WorkerThreadPool task until the scope ends. Tasks that get added to the
+ * pool directly and call parallel_for need this, otherwise they block a pool thread while waiting on group tasks.
+ */
+struct ParallelForTaskScope {
+	bool previous_inside_task;
+
+	ParallelForTaskScope() :
+			previous_inside_task(parallel_for_inside_task()) {
+		parallel_for_inside_task() = true;
+	}
+	~ParallelForTaskScope() {
+		parallel_for_inside_task() = previous_inside_task;
+	}
+};
+
+/**
+ * @brief Splits the range [0, p_count) into chunks and runs p_function(begin, end) for each of them on the WorkerThreadPool.
+ *
+ * @details Small inputs (a single chunk) and calls from inside another parallel_for or a ParallelForTaskScope just run
+ * on the calling thread.
+ * Chunks are disjoint, so p_function can write into a shared output buffer as long as the write pointer was
+ * fetched (ptrw) before calling this.
+ *
+ * @param p_count amount of elements
+ * @param p_function callable with signature (int p_begin, int p_end)
+ * @param p_chunk_size elements processed per task
+ */
+template <typename F>
+void parallel_for(int p_count, const F &p_function, int p_chunk_size = 16384) {
+	if (p_count <= 0) {
+		return;
+	}
+	const int chunk_count = (p_count + p_chunk_size - 1) / p_chunk_size;
+	if (chunk_count == 1 || parallel_for_inside_task()) {
+		p_function(0, p_count);
+		return;
+	}
+
+	struct Userdata {
+		const F *function;
+		int count;
+		int chunk_size;
+	};
+	Userdata userdata = { &p_function, p_count, p_chunk_size };
+
+	WorkerThreadPool *pool = WorkerThreadPool::get_singleton();
+	WorkerThreadPool::GroupID group_id = pool->add_native_group_task(
+			+[](void *p_userdata, uint32_t p_chunk) {
+				const Userdata *data = static_cast<const Userdata *>(p_userdata);
+				int begin = p_chunk * data->chunk_size;
+				int end = MIN(begin + data->chunk_size, data->count);
+				ParallelForTaskScope task_scope;
+				(*data->function)(begin, end);
+			},
+			&userdata, chunk_count, -1, true, "godot_subdiv parallel_for");
+	pool->wait_for_group_task_completion(group_id);
+}
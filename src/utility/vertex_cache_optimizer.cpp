@@ -0,0 +1,180 @@
+#include "vertex_cache_optimizer.hpp"
+
+#include "godot_cpp/core/error_macros.hpp"
+#include "godot_cpp/templates/local_vector.hpp"
+
+void VertexCacheOptimizer::optimize_vertex_cache(PackedInt32Array &r_index_array, int p_vertex_count, int p_cache_size) {
+	const int index_count = r_index_array.size();
+	ERR_FAIL_COND(index_count % 3 != 0);
+	ERR_FAIL_COND(p_cache_size <= 0);
+	const int triangle_count = index_count / 3;
+	if (triangle_count == 0 || p_vertex_count <= 0) {
+		return;
+	}
+	const int32_t *index_ptr = r_index_array.ptr();
+
+	//triangles that still need to be emitted per vertex, also used to build the adjacency
+	LocalVector<int32_t> live_triangle_count;
+	live_triangle_count.resize(p_vertex_count);
+	for (int vertex_index = 0; vertex_index < p_vertex_count; vertex_index++) {
+		live_triangle_count[vertex_index] = 0;
+	}
+	for (int index = 0; index < index_count; index++) {
+		ERR_FAIL_INDEX(index_ptr[index], p_vertex_count);
+		live_triangle_count[index_ptr[index]]++;
+	}
+
+	//vertex -> triangles, triangles of vertex v are adjacency[adjacency_offsets[v]] until adjacency[adjacency_offsets[v + 1]]
+	LocalVector<int32_t> adjacency_offsets;
+	adjacency_offsets.resize(p_vertex_count + 1);
+	adjacency_offsets[0] = 0;
+	for (int vertex_index = 0; vertex_index < p_vertex_count; vertex_index++) {
+		adjacency_offsets[vertex_index + 1] = adjacency_offsets[vertex_index] + live_triangle_count[vertex_index];
+	}
+	LocalVector<int32_t> adjacency_fill;
+	adjacency_fill.resize(p_vertex_count);
+	memcpy(adjacency_fill.ptr(), adjacency_offsets.ptr(), p_vertex_count * sizeof(int32_t));
+	LocalVector<int32_t> adjacency;
+	adjacency.resize(index_count);
+	for (int index = 0; index < index_count; index++) {
+		adjacency[adjacency_fill[index_ptr[index]]++] = index / 3;
+	}
+
+	LocalVector<int32_t> cache_time;
+	cache_time.resize(p_vertex_count);
+	for (int vertex_index = 0; vertex_index < p_vertex_count; vertex_index++) {
+		cache_time[vertex_index] = 0;
+	}
+	LocalVector<uint8_t> emitted;
+	emitted.resize(triangle_count);
+	for (int triangle = 0; triangle < triangle_count; triangle++) {
+		emitted[triangle] = 0;
+	}
+	LocalVector<int32_t> dead_end_stack;
+	LocalVector<int32_t> candidates;
+
+	PackedInt32Array optimized_index_array;
+	optimized_index_array.resize(index_count);
+	int32_t *optimized_ptrw = optimized_index_array.ptrw();
+	int output_index = 0;
+
+	int time = p_cache_size + 1; //every vertex starts outside of the cache
+	int cursor = 0; //fallback if the dead end stack runs empty, vertices before it have no live triangles
+	int fanning_vertex = 0;
+	while (fanning_vertex >= 0) {
+		//emit all remaining triangles around the fanning vertex
+		candidates.clear();
+		for (int adjacency_index = adjacency_offsets[fanning_vertex]; adjacency_index < adjacency_offsets[fanning_vertex + 1]; adjacency_index++) {
+			const int32_t triangle = adjacency[adjacency_index];
+			if (emitted[triangle]) {
+				continue;
+			}
+			emitted[triangle] = 1;
+			for (int corner = 0; corner < 3; corner++) {
+				const int32_t vertex_index = index_ptr[triangle * 3 + corner];
+				optimized_ptrw[output_index++] = vertex_index;
+				dead_end_stack.push_back(vertex_index);
+				candidates.push_back(vertex_index);
+				live_triangle_count[vertex_index]--;
+				if (time - cache_time[vertex_index] > p_cache_size) {
+					cache_time[vertex_index] = time;
+					time++;
+				}
+			}
+		}
+
+		//next fanning vertex is the candidate that stays in cache the longest while its own triangles get emitted
+		fanning_vertex = -1;
+		int best_priority = -1;
+		for (uint32_t candidate_index = 0; candidate_index < candidates.size(); candidate_index++) {
+			const int32_t vertex_index = candidates[candidate_index];
+			if (live_triangle_count[vertex_index] <= 0) {
+				continue;
+			}
+			int priority = 0;
+			if (time - cache_time[vertex_index] + 2 * live_triangle_count[vertex_index] <= p_cache_size) {
+				priority = time - cache_time[vertex_index];
+			}
+			if (priority > best_priority) {
+				best_priority = priority;
+				fanning_vertex = vertex_index;
+			}
+		}
+
+		//dead end: most recently used vertex with live triangles, otherwise the next one in input order
+		while (fanning_vertex == -1 && !dead_end_stack.is_empty()) {
+			const int32_t vertex_index = dead_end_stack[dead_end_stack.size() - 1];
+			dead_end_stack.resize(dead_end_stack.size() - 1);
+			if (live_triangle_count[vertex_index] > 0) {
+				fanning_vertex = vertex_index;
+			}
+		}
+		while (fanning_vertex == -1 && cursor < p_vertex_count) {
+			if (live_triangle_count[cursor] > 0) {
+				fanning_vertex = cursor;
+			}
+			cursor++;
+		}
+	}
+
+	ERR_FAIL_COND(output_index != index_count);
+	r_index_array = optimized_index_array;
+}
+
+PackedInt32Array VertexCacheOptimizer::optimize_vertex_fetch(PackedInt32Array &r_index_array, int p_vertex_count) {
+	const int index_count = r_index_array.size();
+	for (int index = 0; index < index_count; index++) {
+		ERR_FAIL_INDEX_V(r_index_array[index], p_vertex_count, PackedInt32Array());
+	}
+
+	LocalVector<int32_t> new_vertex_index;
+	new_vertex_index.resize(p_vertex_count);
+	for (int vertex_index = 0; vertex_index < p_vertex_count; vertex_index++) {
+		new_vertex_index[vertex_index] = -1;
+	}
+	PackedInt32Array vertex_remap;
+	vertex_remap.resize(p_vertex_count);
+	int32_t *remap_ptrw = vertex_remap.ptrw();
+	int32_t *index_ptrw = r_index_array.ptrw();
+	int next_vertex = 0;
+	for (int index = 0; index < index_count; index++) {
+		const int32_t old_vertex = index_ptrw[index];
+		if (new_vertex_index[old_vertex] == -1) {
+			new_vertex_index[old_vertex] = next_vertex;
+			remap_ptrw[next_vertex] = old_vertex;
+			next_vertex++;
+		}
+		index_ptrw[index] = new_vertex_index[old_vertex];
+	}
+	for (int vertex_index = 0; vertex_index < p_vertex_count; vertex_index++) {
+		if (new_vertex_index[vertex_index] == -1) {
+			remap_ptrw[next_vertex++] = vertex_index;
+		}
+	}
+	return vertex_remap;
+}
+
+float VertexCacheOptimizer::get_average_cache_miss_ratio(const PackedInt32Array &p_index_array, int p_vertex_count, int p_cache_size) {
+	const int triangle_count = p_index_array.size() / 3;
+	ERR_FAIL_COND_V(p_cache_size <= 0, 0.0);
+	if (triangle_count == 0) {
+		return 0.0;
+	}
+	LocalVector<int32_t> cache_time;
+	cache_time.resize(p_vertex_count);
+	for (int vertex_index = 0; vertex_index < p_vertex_count; vertex_index++) {
+		cache_time[vertex_index] = 0;
+	}
+	int time = p_cache_size + 1;
+	int misses = 0;
+	for (int index = 0; index < triangle_count * 3; index++) {
+		const int32_t vertex_index = p_index_array[index];
+		ERR_FAIL_INDEX_V(vertex_index, p_vertex_count, 0.0);
+		if (time - cache_time[vertex_index] > p_cache_size) {
+			cache_time[vertex_index] = time;
+			time++;
+			misses++;
+		}
+	}
+	return float(misses) / float(triangle_count);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "godot_cpp/variant/packed_int32_array.hpp"
+
+using namespace godot;
+
+/**
+ * @brief Reorders triangle meshes for the GPU: triangles for the post transform vertex cache, vertices in the
+ * order they get first used, so vertex fetches run mostly sequential through the buffer.
+ *
+ * @details Triangle order uses Tipsify (Sander, Nehab, Barczak 2007), which runs in linear time and gets close to
+ * Forsyth's results, so it's cheap enough to run every time a surface gets subdivided.
+ */
+class VertexCacheOptimizer {
+public:
+	static const int DEFAULT_CACHE_SIZE = 16;
+
+	/**
+	 * @brief Reorders the triangles of p_index_array, vertices stay untouched
+	 *
+	 * @param r_index_array triangle list, gets overwritten
+	 * @param p_vertex_count
+	 * @param p_cache_size size of the simulated fifo vertex cache
+	 */
+	static void optimize_vertex_cache(PackedInt32Array &r_index_array, int p_vertex_count, int p_cache_size = DEFAULT_CACHE_SIZE);
+
+	/**
+	 * @brief Numbers vertices in the order they first appear in p_index_array and rewrites the indices.
+	 * Vertices that aren't used by any triangle get moved to the end.
+	 *
+	 * @param r_index_array triangle list, gets overwritten
+	 * @param p_vertex_count
+	 * @return PackedInt32Array new vertex -> old vertex, empty on invalid indices
+	 */
+	static PackedInt32Array optimize_vertex_fetch(PackedInt32Array &r_index_array, int p_vertex_count);
+
+	/**
+	 * @brief Average amount of vertex shader invocations per triangle with a fifo cache, 0.5 is the best possible
+	 * for large regular meshes and 3 the worst. Only used to verify the other methods.
+	 *
+	 * @param p_index_array
+	 * @param p_vertex_count
+	 * @param p_cache_size
+	 * @return float
+	 */
+	static float get_average_cache_miss_ratio(const PackedInt32Array &p_index_array, int p_vertex_count, int p_cache_size = DEFAULT_CACHE_SIZE);
+};
@@ -0,0 +1,161 @@
+#include "vertex_face_fan.hpp"
+
+#include "godot_cpp/core/error_macros.hpp"
+#include "utility/parallel_for.hpp"
+
+void VertexFaceFan::create(const PackedInt32Array &p_index_array, int32_t p_face_vertex_count, int32_t p_vertex_count) {
+	clear();
+	const int index_count = p_index_array.size();
+	ERR_FAIL_COND(p_face_vertex_count < 3);
+	ERR_FAIL_COND(index_count % p_face_vertex_count != 0);
+	ERR_FAIL_COND(p_vertex_count < 0);
+	const int32_t *index_ptr = p_index_array.ptr();
+
+	offsets.resize(p_vertex_count + 1);
+	for (int vertex_index = 0; vertex_index <= p_vertex_count; vertex_index++) {
+		offsets[vertex_index] = 0;
+	}
+	for (int index = 0; index < index_count; index++) {
+		if (index_ptr[index] < 0 || index_ptr[index] >= p_vertex_count) {
+			clear();
+			ERR_FAIL_MSG("Index out of range while creating face fan.");
+		}
+		offsets[index_ptr[index] + 1]++;
+	}
+	for (int vertex_index = 0; vertex_index < p_vertex_count; vertex_index++) {
+		offsets[vertex_index + 1] += offsets[vertex_index];
+	}
+
+	LocalVector<int32_t> fill;
+	fill.resize(p_vertex_count);
+	for (int vertex_index = 0; vertex_index < p_vertex_count; vertex_index++) {
+		fill[vertex_index] = offsets[vertex_index];
+	}
+	faces.resize(index_count);
+	for (int index = 0; index < index_count; index++) {
+		faces[fill[index_ptr[index]]++] = index / p_face_vertex_count;
+	}
+
+	face_vertex_count = p_face_vertex_count;
+	vertex_count = p_vertex_count;
+}
+
+void VertexFaceFan::clear() {
+	face_vertex_count = 0;
+	vertex_count = 0;
+	offsets.clear();
+	faces.clear();
+}
+
+bool VertexFaceFan::is_empty() const {
+	return face_vertex_count == 0;
+}
+
+int32_t VertexFaceFan::get_face_vertex_count() const {
+	return face_vertex_count;
+}
+
+int32_t VertexFaceFan::get_vertex_count() const {
+	return vertex_count;
+}
+
+PackedVector3Array VertexFaceFan::calculate_normals(const PackedVector3Array &p_vertex_array, const PackedInt32Array &p_index_array) const {
+	ERR_FAIL_COND_V(is_empty(), PackedVector3Array());
+	ERR_FAIL_COND_V(p_vertex_array.size() != vertex_count, PackedVector3Array());
+	ERR_FAIL_COND_V(p_index_array.size() != int(faces.size()), PackedVector3Array());
+	const int face_count = faces.size() / face_vertex_count;
+	const Vector3 *vertex_ptr = p_vertex_array.ptr();
+	const int32_t *index_ptr = p_index_array.ptr();
+
+	LocalVector<Vector3> face_normals;
+	face_normals.resize(face_count);
+	parallel_for(face_count, [&](int p_begin, int p_end) {
+		for (int face_index = p_begin; face_index < p_end; face_index++) {
+			const int32_t *face_ptr = index_ptr + face_index * face_vertex_count;
+			const Vector3 &point1 = vertex_ptr[face_ptr[0]];
+			const Vector3 &point2 = vertex_ptr[face_ptr[1]];
+			const Vector3 &point3 = vertex_ptr[face_ptr[2]];
+			face_normals[face_index] = (point1 - point3).cross(point1 - point2).normalized();
+		}
+	});
+
+	PackedVector3Array normal_array;
+	normal_array.resize(vertex_count);
+	Vector3 *normal_ptrw = normal_array.ptrw();
+	parallel_for(vertex_count, [&](int p_begin, int p_end) {
+		for (int vertex_index = p_begin; vertex_index < p_end; vertex_index++) {
+			Vector3 normal;
+			for (int32_t fan_index = offsets[vertex_index]; fan_index < offsets[vertex_index + 1]; fan_index++) {
+				normal += face_normals[faces[fan_index]];
+			}
+			normal_ptrw[vertex_index] = normal.normalized();
+		}
+	});
+	return normal_array;
+}
+
+PackedFloat32Array VertexFaceFan::calculate_tangents(const PackedVector3Array &p_vertex_array, const PackedVector3Array &p_normal_array,
+		const PackedVector2Array &p_uv_array, const PackedInt32Array &p_index_array) const {
+	ERR_FAIL_COND_V(face_vertex_count != 3, PackedFloat32Array());
+	ERR_FAIL_COND_V(p_vertex_array.size() != vertex_count || p_normal_array.size() != vertex_count || p_uv_array.size() != vertex_count,
+			PackedFloat32Array());
+	ERR_FAIL_COND_V(p_index_array.size() != int(faces.size()), PackedFloat32Array());
+	const int triangle_count = faces.size() / 3;
+	const Vector3 *vertex_ptr = p_vertex_array.ptr();
+	const Vector3 *normal_ptr = p_normal_array.ptr();
+	const Vector2 *uv_ptr = p_uv_array.ptr();
+	const int32_t *index_ptr = p_index_array.ptr();
+
+	//direction of increasing u and v on every triangle, zero for triangles without uv area
+	LocalVector<Vector3> triangle_u_directions;
+	LocalVector<Vector3> triangle_v_directions;
+	triangle_u_directions.resize(triangle_count);
+	triangle_v_directions.resize(triangle_count);
+	parallel_for(triangle_count, [&](int p_begin, int p_end) {
+		for (int triangle = p_begin; triangle < p_end; triangle++) {
+			const int32_t *triangle_ptr = index_ptr + triangle * 3;
+			const Vector3 edge1 = vertex_ptr[triangle_ptr[1]] - vertex_ptr[triangle_ptr[0]];
+			const Vector3 edge2 = vertex_ptr[triangle_ptr[2]] - vertex_ptr[triangle_ptr[0]];
+			const Vector2 uv_edge1 = uv_ptr[triangle_ptr[1]] - uv_ptr[triangle_ptr[0]];
+			const Vector2 uv_edge2 = uv_ptr[triangle_ptr[2]] - uv_ptr[triangle_ptr[0]];
+			const real_t determinant = uv_edge1.x * uv_edge2.y - uv_edge2.x * uv_edge1.y;
+			//no epsilon here, uv areas of dense meshes are tiny but still valid
+			if (determinant == 0.0) {
+				triangle_u_directions[triangle] = Vector3();
+				triangle_v_directions[triangle] = Vector3();
+				continue;
+			}
+			const real_t inverse_determinant = 1.0 / determinant;
+			triangle_u_directions[triangle] = (edge1 * uv_edge2.y - edge2 * uv_edge1.y) * inverse_determinant;
+			triangle_v_directions[triangle] = (edge2 * uv_edge1.x - edge1 * uv_edge2.x) * inverse_determinant;
+		}
+	});
+
+	PackedFloat32Array tangent_array;
+	tangent_array.resize(vertex_count * 4);
+	float *tangent_ptrw = tangent_array.ptrw();
+	parallel_for(vertex_count, [&](int p_begin, int p_end) {
+		for (int vertex_index = p_begin; vertex_index < p_end; vertex_index++) {
+			Vector3 u_direction;
+			Vector3 v_direction;
+			for (int32_t fan_index = offsets[vertex_index]; fan_index < offsets[vertex_index + 1]; fan_index++) {
+				u_direction += triangle_u_directions[faces[fan_index]];
+				v_direction += triangle_v_directions[faces[fan_index]];
+			}
+			//Gram-Schmidt against the normal, any perpendicular direction if the uv's are degenerate
+			const Vector3 &normal = normal_ptr[vertex_index];
+			Vector3 tangent = u_direction - normal * normal.dot(u_direction);
+			if (tangent.is_zero_approx()) {
+				tangent = normal.cross(Math::abs(normal.y) < 0.99 ? Vector3(0, 1, 0) : Vector3(1, 0, 0));
+			}
+			tangent.normalize();
+			//SurfaceTool stores the negated mikktspace bitangent, so a v direction along normal x tangent means -1
+			const float sign = normal.cross(tangent).dot(v_direction) > 0 ? -1.0 : 1.0;
+			tangent_ptrw[vertex_index * 4 + 0] = tangent.x;
+			tangent_ptrw[vertex_index * 4 + 1] = tangent.y;
+			tangent_ptrw[vertex_index * 4 + 2] = tangent.z;
+			tangent_ptrw[vertex_index * 4 + 3] = sign;
+		}
+	});
+	return tangent_array;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "godot_cpp/templates/local_vector.hpp"
+#include "godot_cpp/variant/packed_float32_array.hpp"
+#include "godot_cpp/variant/packed_int32_array.hpp"
+#include "godot_cpp/variant/packed_vector2_array.hpp"
+#include "godot_cpp/variant/packed_vector3_array.hpp"
+
+using namespace godot;
+
+/**
+ * @brief Faces around every vertex of a mesh where all faces have the same vertex count. Only depends on topology,
+ * so it gets built once and normals and tangents can then be gathered per vertex in parallel without any atomics.
+ *
+ * @details Faces get processed in parallel first (one result per face), then every vertex sums up the results of its fan.
+ * Sums run in fan order, so results don't depend on the thread count.
+ */
+class VertexFaceFan {
+	int32_t face_vertex_count = 0;
+	int32_t vertex_count = 0;
+	//faces of vertex v are faces[offsets[v]] until faces[offsets[v + 1]]
+	LocalVector<int32_t> offsets;
+	LocalVector<int32_t> faces;
+
+public:
+	/**
+	 * @brief Builds the fan, indices outside of p_vertex_count clear it
+	 *
+	 * @param p_index_array faces one after another
+	 * @param p_face_vertex_count 3 for triangles, 4 for quads
+	 * @param p_vertex_count
+	 */
+	void create(const PackedInt32Array &p_index_array, int32_t p_face_vertex_count, int32_t p_vertex_count);
+	void clear();
+	bool is_empty() const;
+	int32_t get_face_vertex_count() const;
+	int32_t get_vertex_count() const;
+
+	/**
+	 * @brief Same normals as Subdivider::_calculate_smooth_normals: normalized face normals of the first three face vertices
+	 * summed up per vertex
+	 *
+	 * @param p_vertex_array
+	 * @param p_index_array same index array the fan was created with
+	 * @return PackedVector3Array normalized, empty on invalid input
+	 */
+	PackedVector3Array calculate_normals(const PackedVector3Array &p_vertex_array, const PackedInt32Array &p_index_array) const;
+
+	/**
+	 * @brief Tangents from uv and position derivatives of every triangle (Lengyel), orthogonalized against the normal.
+	 * Needs a triangle fan. w is the binormal sign with the same convention as SurfaceTool::generate_tangents.
+	 *
+	 * @param p_vertex_array
+	 * @param p_normal_array
+	 * @param p_uv_array
+	 * @param p_index_array same index array the fan was created with
+	 * @return PackedFloat32Array 4 floats per vertex like Mesh::ARRAY_TANGENT, empty on invalid input
+	 */
+	PackedFloat32Array calculate_tangents(const PackedVector3Array &p_vertex_array, const PackedVector3Array &p_normal_array,
+			const PackedVector2Array &p_uv_array, const PackedInt32Array &p_index_array) const;
+};
@@ -0,0 +1,373 @@
+#include "doctest.h"
+#include "godot_cpp/classes/dir_access.hpp"
+#include "godot_cpp/classes/file_access.hpp"
+#include "godot_cpp/classes/importer_mesh.hpp"
+#include "godot_cpp/classes/importer_mesh_instance3d.hpp"
+#include "godot_cpp/classes/mesh_instance3d.hpp"
+#include "godot_cpp/classes/node3d.hpp"
+#include "import/topology_data_importer.hpp"
+#include "nodes/subdiv_mesh_instance_3d.hpp"
+#include "resources/baked_subdiv_mesh.hpp"
+
+//converts a single ImporterMeshInstance3D to a SubdivMeshInstance3D at level 0 and returns the generated TopologyDataMesh
+static Ref<TopologyDataMesh> convert_importer_mesh(const Ref<ImporterMesh> &p_importer_mesh, bool p_streaming_import = false, float p_weld_tolerance = 0.0) {
+	Node3D *root = memnew(Node3D);
+	ImporterMeshInstance3D *importer_mesh_instance = memnew(ImporterMeshInstance3D);
+	importer_mesh_instance->set_mesh(p_importer_mesh);
+	root->add_child(importer_mesh_instance);
+
+	TopologyDataImporter *importer = memnew(TopologyDataImporter);
+	importer->set_streaming_import(p_streaming_import);
+	importer->set_weld_tolerance(p_weld_tolerance);
+	importer->set_use_import_cache(false);
+	importer->convert_importer_meshinstance_to_subdiv(importer_mesh_instance, TopologyDataImporter::SUBDIV_MESHINSTANCE, 0);
+	memdelete(importer);
+
+	Ref<TopologyDataMesh> topology_data_mesh;
+	SubdivMeshInstance3D *subdiv_mesh_instance = Object::cast_to<SubdivMeshInstance3D>(root->get_child(0));
+	if (subdiv_mesh_instance) {
+		topology_data_mesh = subdiv_mesh_instance->get_mesh();
+	}
+	memdelete(root);
+	return topology_data_mesh;
+}
+
+//quad split into two triangles with separate vertices per triangle like most exporters write them
+static Array create_split_quad_arrays(const Vector3 &p_offset) {
+	const Vector3 corners[6] = { Vector3(0, 0, 0), Vector3(1, 0, 0), Vector3(1, 0, 1), Vector3(0, 0, 0), Vector3(1, 0, 1), Vector3(0, 0, 1) };
+	PackedVector3Array vertex_array;
+	PackedInt32Array index_array;
+	for (int corner = 0; corner < 6; corner++) {
+		vertex_array.push_back(corners[corner] + p_offset);
+		index_array.push_back(corner);
+	}
+	Array arrays;
+	arrays.resize(Mesh::ARRAY_MAX);
+	arrays[Mesh::ARRAY_VERTEX] = vertex_array;
+	arrays[Mesh::ARRAY_INDEX] = index_array;
+	return arrays;
+}
+
+TEST_CASE("blend shapes follow the weld tolerance") {
+	Array arrays = create_split_quad_arrays(Vector3());
+	//shared corners of the second triangle are only within the weld tolerance, not exactly equal
+	PackedVector3Array vertex_array = arrays[Mesh::ARRAY_VERTEX];
+	vertex_array.set(3, vertex_array[3] + Vector3(0.000001, 0, 0));
+	vertex_array.set(4, vertex_array[4] + Vector3(0, 0.000001, 0));
+	arrays[Mesh::ARRAY_VERTEX] = vertex_array;
+
+	Array blend_shape_arrays = create_split_quad_arrays(Vector3(0, 1, 0));
+	TypedArray<Array> blend_shapes;
+	blend_shapes.push_back(blend_shape_arrays);
+
+	Ref<ImporterMesh> importer_mesh;
+	importer_mesh.instantiate();
+	importer_mesh->add_blend_shape("up");
+	importer_mesh->add_surface(Mesh::PRIMITIVE_TRIANGLES, arrays, blend_shapes);
+
+	//exact welding by default keeps the shifted corners apart
+	Ref<TopologyDataMesh> exact_mesh = convert_importer_mesh(importer_mesh);
+	REQUIRE(exact_mesh.is_valid());
+	const PackedVector3Array exact_vertex_array = exact_mesh->surface_get_arrays(0)[TopologyDataMesh::ARRAY_VERTEX];
+	CHECK_EQ(exact_vertex_array.size(), 6);
+
+	Ref<TopologyDataMesh> topology_data_mesh = convert_importer_mesh(importer_mesh, false, 0.00001);
+	REQUIRE(topology_data_mesh.is_valid());
+	REQUIRE_EQ(topology_data_mesh->get_surface_count(), 1);
+	const Array surface_arrays = topology_data_mesh->surface_get_arrays(0);
+	const PackedVector3Array topology_vertex_array = surface_arrays[TopologyDataMesh::ARRAY_VERTEX];
+	CHECK_EQ(topology_vertex_array.size(), 4);
+
+	const Array topology_blend_shape = topology_data_mesh->surface_get_single_blend_shape_array(0, 0);
+	const PackedVector3Array blend_vertex_array = topology_blend_shape[TopologyDataMesh::ARRAY_VERTEX];
+	REQUIRE_EQ(blend_vertex_array.size(), topology_vertex_array.size());
+	for (int vertex_index = 0; vertex_index < blend_vertex_array.size(); vertex_index++) {
+		CHECK(blend_vertex_array[vertex_index].is_equal_approx(Vector3(0, 1, 0)));
+	}
+}
+
+TEST_CASE("merge quads from triangles that aren't consecutive") {
+	//two quads next to each other, triangles of both quads interleaved in the index array
+	const Vector3 positions[6] = { Vector3(0, 0, 0), Vector3(1, 0, 0), Vector3(1, 0, 1), Vector3(0, 0, 1), Vector3(2, 0, 0), Vector3(2, 0, 1) };
+	const int32_t indices[12] = { 0, 1, 2, 1, 4, 5, 0, 2, 3, 1, 5, 2 };
+	PackedVector3Array vertex_array;
+	for (const Vector3 &position : positions) {
+		vertex_array.push_back(position);
+	}
+	PackedInt32Array index_array;
+	for (int32_t index : indices) {
+		index_array.push_back(index);
+	}
+	Array arrays;
+	arrays.resize(Mesh::ARRAY_MAX);
+	arrays[Mesh::ARRAY_VERTEX] = vertex_array;
+	arrays[Mesh::ARRAY_INDEX] = index_array;
+
+	Ref<ImporterMesh> importer_mesh;
+	importer_mesh.instantiate();
+	importer_mesh->add_surface(Mesh::PRIMITIVE_TRIANGLES, arrays);
+
+	Ref<TopologyDataMesh> topology_data_mesh = convert_importer_mesh(importer_mesh);
+	REQUIRE(topology_data_mesh.is_valid());
+	REQUIRE_EQ(topology_data_mesh->get_surface_count(), 1);
+	CHECK_EQ(topology_data_mesh->surface_get_topology_type(0), TopologyDataMesh::QUAD);
+	const Array surface_arrays = topology_data_mesh->surface_get_arrays(0);
+	const PackedVector3Array topology_vertex_array = surface_arrays[TopologyDataMesh::ARRAY_VERTEX];
+	const PackedInt32Array topology_index_array = surface_arrays[TopologyDataMesh::ARRAY_INDEX];
+	REQUIRE_EQ(topology_index_array.size(), 8);
+
+	//every quad has to be one of the two unit squares, not a parallelogram across both
+	for (int quad = 0; quad < 2; quad++) {
+		Vector3 center;
+		for (int corner = 0; corner < 4; corner++) {
+			center += topology_vertex_array[topology_index_array[quad * 4 + corner]] * 0.25;
+		}
+		CHECK((center.is_equal_approx(Vector3(0.5, 0, 0.5)) || center.is_equal_approx(Vector3(1.5, 0, 0.5))));
+	}
+}
+
+TEST_CASE("equilateral triangle grid stays triangles") {
+	//triangular lattice, all upward triangles first so consecutive triangles never share an edge
+	const int grid_size = 4;
+	PackedVector3Array vertex_array;
+	for (int z = 0; z <= grid_size; z++) {
+		for (int x = 0; x <= grid_size; x++) {
+			vertex_array.push_back(Vector3(x + z * 0.5, 0, z * Math::sqrt(3.0) * 0.5));
+		}
+	}
+	PackedInt32Array index_array;
+	for (int upward = 1; upward >= 0; upward--) {
+		for (int z = 0; z < grid_size; z++) {
+			for (int x = 0; x < grid_size; x++) {
+				const int corner = z * (grid_size + 1) + x;
+				const int above = corner + grid_size + 1;
+				if (upward) {
+					index_array.append(corner);
+					index_array.append(corner + 1);
+					index_array.append(above);
+				} else {
+					index_array.append(corner + 1);
+					index_array.append(above + 1);
+					index_array.append(above);
+				}
+			}
+		}
+	}
+	Array arrays;
+	arrays.resize(Mesh::ARRAY_MAX);
+	arrays[Mesh::ARRAY_VERTEX] = vertex_array;
+	arrays[Mesh::ARRAY_INDEX] = index_array;
+
+	Ref<ImporterMesh> importer_mesh;
+	importer_mesh.instantiate();
+	importer_mesh->add_surface(Mesh::PRIMITIVE_TRIANGLES, arrays);
+
+	Ref<TopologyDataMesh> topology_data_mesh = convert_importer_mesh(importer_mesh);
+	REQUIRE(topology_data_mesh.is_valid());
+	CHECK_EQ(topology_data_mesh->surface_get_topology_type(0), TopologyDataMesh::TRIANGLE);
+	const Array surface_arrays = topology_data_mesh->surface_get_arrays(0);
+	const PackedInt32Array topology_index_array = surface_arrays[TopologyDataMesh::ARRAY_INDEX];
+	CHECK_EQ(topology_index_array.size(), index_array.size());
+}
+
+TEST_CASE("uvs are deduplicated per cage vertex") {
+	//strip of two quads with continuous uvs and a separate quad that reuses uvs of the strip
+	const Vector3 positions[12] = {
+		Vector3(0, 0, 0), Vector3(1, 0, 0), Vector3(1, 0, 1), Vector3(0, 0, 1),
+		Vector3(1, 0, 0), Vector3(2, 0, 0), Vector3(2, 0, 1), Vector3(1, 0, 1),
+		Vector3(5, 0, 0), Vector3(6, 0, 0), Vector3(6, 0, 1), Vector3(5, 0, 1)
+	};
+	const Vector2 uvs[12] = {
+		Vector2(0, 0), Vector2(0.5, 0), Vector2(0.5, 1), Vector2(0, 1),
+		Vector2(0.5, 0), Vector2(1, 0), Vector2(1, 1), Vector2(0.5, 1),
+		Vector2(0, 0), Vector2(0.5, 0), Vector2(0.5, 1), Vector2(0, 1)
+	};
+	//every triangle gets its own vertices, uvs of the second triangle are off by less than the uv quantization
+	const int quad_triangle_corners[6] = { 0, 1, 2, 0, 2, 3 };
+	PackedVector3Array vertex_array;
+	PackedVector2Array uv_array;
+	PackedInt32Array index_array;
+	for (int quad = 0; quad < 3; quad++) {
+		for (int corner = 0; corner < 6; corner++) {
+			const int quad_corner = quad * 4 + quad_triangle_corners[corner];
+			vertex_array.push_back(positions[quad_corner]);
+			uv_array.push_back(uvs[quad_corner] + (corner >= 3 ? Vector2(0.0000001, 0) : Vector2()));
+			index_array.push_back(index_array.size());
+		}
+	}
+	Array arrays;
+	arrays.resize(Mesh::ARRAY_MAX);
+	arrays[Mesh::ARRAY_VERTEX] = vertex_array;
+	arrays[Mesh::ARRAY_TEX_UV] = uv_array;
+	arrays[Mesh::ARRAY_INDEX] = index_array;
+
+	Ref<ImporterMesh> importer_mesh;
+	importer_mesh.instantiate();
+	importer_mesh->add_surface(Mesh::PRIMITIVE_TRIANGLES, arrays);
+
+	Ref<TopologyDataMesh> topology_data_mesh = convert_importer_mesh(importer_mesh);
+	REQUIRE(topology_data_mesh.is_valid());
+	REQUIRE_EQ(topology_data_mesh->get_surface_count(), 1);
+	CHECK_EQ(topology_data_mesh->surface_get_topology_type(0), TopologyDataMesh::QUAD);
+	const Array surface_arrays = topology_data_mesh->surface_get_arrays(0);
+	const PackedVector3Array topology_vertex_array = surface_arrays[TopologyDataMesh::ARRAY_VERTEX];
+	const PackedInt32Array topology_index_array = surface_arrays[TopologyDataMesh::ARRAY_INDEX];
+	const PackedVector2Array topology_uv_array = surface_arrays[TopologyDataMesh::ARRAY_TEX_UV];
+	const PackedInt32Array topology_uv_index_array = surface_arrays[TopologyDataMesh::ARRAY_UV_INDEX];
+	CHECK_EQ(topology_vertex_array.size(), 10);
+	REQUIRE_EQ(topology_uv_index_array.size(), topology_index_array.size());
+
+	//one uv per cage vertex, equal uvs of the unrelated quad aren't merged into the strip
+	CHECK_EQ(topology_uv_array.size(), 10);
+	for (int corner = 0; corner < topology_index_array.size(); corner++) {
+		const Vector3 &position = topology_vertex_array[topology_index_array[corner]];
+		const Vector2 &uv = topology_uv_array[topology_uv_index_array[corner]];
+		const Vector2 expected_uv = position.x >= 5 ? Vector2((position.x - 5) * 0.5, position.z) : Vector2(position.x * 0.5, position.z);
+		CHECK(uv.is_equal_approx(expected_uv));
+	}
+}
+
+//grid of quads in the xz plane, every triangle has its own vertices
+static Array create_split_grid_arrays(int p_size, const Vector3 &p_offset) {
+	PackedVector3Array vertex_array;
+	PackedInt32Array index_array;
+	const Vector3 quad_corners[6] = { Vector3(0, 0, 0), Vector3(1, 0, 0), Vector3(1, 0, 1), Vector3(0, 0, 0), Vector3(1, 0, 1), Vector3(0, 0, 1) };
+	for (int z = 0; z < p_size; z++) {
+		for (int x = 0; x < p_size; x++) {
+			for (const Vector3 &quad_corner : quad_corners) {
+				index_array.push_back(vertex_array.size());
+				vertex_array.push_back(p_offset + Vector3(x, 0, z) + quad_corner);
+			}
+		}
+	}
+	Array arrays;
+	arrays.resize(Mesh::ARRAY_MAX);
+	arrays[Mesh::ARRAY_VERTEX] = vertex_array;
+	arrays[Mesh::ARRAY_INDEX] = index_array;
+	return arrays;
+}
+
+TEST_CASE("streaming import matches batch import") {
+	//first surface is split into several shards of the weld cell map
+	const int grid_sizes[2] = { 150, 2 };
+	Ref<ImporterMesh> importer_mesh;
+	importer_mesh.instantiate();
+	importer_mesh->add_blend_shape("up");
+	for (int grid_size : grid_sizes) {
+		TypedArray<Array> blend_shapes;
+		blend_shapes.push_back(create_split_grid_arrays(grid_size, Vector3(0, 1, 0)));
+		importer_mesh->add_surface(Mesh::PRIMITIVE_TRIANGLES, create_split_grid_arrays(grid_size, Vector3()), blend_shapes);
+	}
+
+	Ref<TopologyDataMesh> batch_mesh = convert_importer_mesh(importer_mesh);
+	Ref<TopologyDataMesh> streaming_mesh = convert_importer_mesh(importer_mesh, true);
+	REQUIRE(batch_mesh.is_valid());
+	REQUIRE(streaming_mesh.is_valid());
+	REQUIRE_EQ(batch_mesh->get_surface_count(), 2);
+	REQUIRE_EQ(streaming_mesh->get_surface_count(), 2);
+	CHECK_EQ(streaming_mesh->get_blend_shape_count(), 1);
+	for (int surface_index = 0; surface_index < 2; surface_index++) {
+		const Array batch_arrays = batch_mesh->surface_get_arrays(surface_index);
+		const PackedVector3Array batch_vertex_array = batch_arrays[TopologyDataMesh::ARRAY_VERTEX];
+		CHECK_EQ(batch_vertex_array.size(), (grid_sizes[surface_index] + 1) * (grid_sizes[surface_index] + 1));
+		CHECK_EQ(streaming_mesh->surface_get_topology_type(surface_index), batch_mesh->surface_get_topology_type(surface_index));
+		CHECK(streaming_mesh->surface_get_arrays(surface_index) == batch_arrays);
+		CHECK(streaming_mesh->surface_get_blend_shape_arrays(surface_index) == batch_mesh->surface_get_blend_shape_arrays(surface_index));
+	}
+}
+
+TEST_CASE("tolerant weld of a large mesh") {
+	//every corner gets shifted by less than the tolerance, enough vertices to split the weld into several shards
+	const int grid_size = 150;
+	Array arrays = create_split_grid_arrays(grid_size, Vector3());
+	PackedVector3Array vertex_array = arrays[Mesh::ARRAY_VERTEX];
+	for (int vertex_index = 0; vertex_index < vertex_array.size(); vertex_index++) {
+		const real_t jitter = (vertex_index % 7) * 0.000001;
+		vertex_array.set(vertex_index, vertex_array[vertex_index] + Vector3(jitter, -jitter, jitter));
+	}
+	arrays[Mesh::ARRAY_VERTEX] = vertex_array;
+
+	Ref<ImporterMesh> importer_mesh;
+	importer_mesh.instantiate();
+	importer_mesh->add_surface(Mesh::PRIMITIVE_TRIANGLES, arrays);
+
+	Ref<TopologyDataMesh> topology_data_mesh = convert_importer_mesh(importer_mesh, false, 0.0001);
+	REQUIRE(topology_data_mesh.is_valid());
+	CHECK_EQ(topology_data_mesh->surface_get_topology_type(0), TopologyDataMesh::QUAD);
+	const Array surface_arrays = topology_data_mesh->surface_get_arrays(0);
+	const PackedVector3Array topology_vertex_array = surface_arrays[TopologyDataMesh::ARRAY_VERTEX];
+	CHECK_EQ(topology_vertex_array.size(), (grid_size + 1) * (grid_size + 1));
+
+	//streaming welds the same way
+	Ref<TopologyDataMesh> streaming_mesh = convert_importer_mesh(importer_mesh, true, 0.0001);
+	REQUIRE(streaming_mesh.is_valid());
+	CHECK(streaming_mesh->surface_get_arrays(0) == surface_arrays);
+}
+
+//converts a single ImporterMeshInstance3D to a BakedSubdivMesh at level 1 through the import cache at p_cache_path
+static Ref<BakedSubdivMesh> convert_importer_mesh_baked(const Ref<ImporterMesh> &p_importer_mesh, const String &p_cache_path, int p_cache_max_size) {
+	Node3D *root = memnew(Node3D);
+	ImporterMeshInstance3D *importer_mesh_instance = memnew(ImporterMeshInstance3D);
+	importer_mesh_instance->set_mesh(p_importer_mesh);
+	root->add_child(importer_mesh_instance);
+
+	TopologyDataImporter *importer = memnew(TopologyDataImporter);
+	importer->set_use_import_cache(true);
+	importer->set_import_cache_path(p_cache_path);
+	importer->set_import_cache_max_size(p_cache_max_size);
+	importer->convert_importer_meshinstance_to_subdiv(importer_mesh_instance, TopologyDataImporter::BAKED_SUBDIV_MESH, 1);
+	memdelete(importer);
+
+	Ref<BakedSubdivMesh> baked_subdiv_mesh;
+	MeshInstance3D *mesh_instance = Object::cast_to<MeshInstance3D>(root->get_child(0));
+	if (mesh_instance) {
+		baked_subdiv_mesh = mesh_instance->get_mesh();
+	}
+	memdelete(root);
+	return baked_subdiv_mesh;
+}
+
+TEST_CASE("import cache keeps baked subdiv meshes and removes stale files") {
+	const String cache_path = "user://topology_data_importer_cache_test";
+	REQUIRE_EQ(DirAccess::make_dir_recursive_absolute(cache_path), OK);
+	//left over by an older cache version
+	const String stale_file = cache_path.path_join("0_stale.tdmesh");
+	{
+		Ref<FileAccess> file = FileAccess::open(stale_file, FileAccess::WRITE);
+		REQUIRE(file.is_valid());
+		file->store_8(0);
+	}
+
+	Ref<ImporterMesh> importer_mesh;
+	importer_mesh.instantiate();
+	importer_mesh->add_surface(Mesh::PRIMITIVE_TRIANGLES, create_split_quad_arrays(Vector3()));
+	Ref<BakedSubdivMesh> baked_mesh = convert_importer_mesh_baked(importer_mesh, cache_path, 1024);
+	REQUIRE(baked_mesh.is_valid());
+	REQUIRE_EQ(baked_mesh->get_surface_count(), 1);
+	CHECK_FALSE(FileAccess::file_exists(stale_file));
+	Ref<DirAccess> cache_dir = DirAccess::open(cache_path);
+	REQUIRE(cache_dir.is_valid());
+	CHECK_EQ(cache_dir->get_files().size(), 2); //TopologyDataMesh and BakedSubdivMesh
+
+	//second import loads the BakedSubdivMesh from the cache
+	Ref<BakedSubdivMesh> cached_mesh = convert_importer_mesh_baked(importer_mesh, cache_path, 1024);
+	REQUIRE(cached_mesh.is_valid());
+	REQUIRE_EQ(cached_mesh->get_surface_count(), 1);
+	CHECK_FALSE(cached_mesh->is_baking());
+	CHECK(cached_mesh->surface_get_arrays(0) == baked_mesh->surface_get_arrays(0));
+	CHECK_EQ(cache_dir->get_files().size(), 2);
+
+	//without space only the files of the current import stay
+	Ref<ImporterMesh> other_importer_mesh;
+	other_importer_mesh.instantiate();
+	other_importer_mesh->add_surface(Mesh::PRIMITIVE_TRIANGLES, create_split_quad_arrays(Vector3(2, 0, 0)));
+	Ref<BakedSubdivMesh> other_mesh = convert_importer_mesh_baked(other_importer_mesh, cache_path, 0);
+	REQUIRE(other_mesh.is_valid());
+	const PackedStringArray cache_files = cache_dir->get_files();
+	CHECK_EQ(cache_files.size(), 2);
+
+	for (int file_index = 0; file_index < cache_files.size(); file_index++) {
+		cache_dir->remove(cache_files[file_index]);
+	}
+	DirAccess::remove_absolute(cache_path);
+}
@@ -0,0 +1,97 @@
+#include "doctest.h"
+#include "godot_cpp/classes/file_access.hpp"
+#include "import/topology_data_obj_loader.hpp"
+#include "resources/topology_data_mesh.hpp"
+
+//quad and pentagon in group "poly", single triangle without uv's in group "tri"
+static String write_test_obj() {
+	String path = "user://topology_data_obj_loader_test.obj";
+	Ref<FileAccess> file = FileAccess::open(path, FileAccess::WRITE);
+	file->store_string(
+			"# test file\n"
+			"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv 2 0.5 0\nv 1.5 -1 0\nv 0.5 -1.0e0 0\n"
+			"vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\n"
+			"g poly\n"
+			"f 1/1 2/2 3/3 4/4\n"
+			"f 2/1 7/2 6/3 5/4 3/3\n"
+			"g tri\n"
+			"f -3 -2 -1\r\n");
+	file->close();
+	return path;
+}
+
+TEST_CASE("obj loader keeps polygons and groups") {
+	Ref<TopologyDataObjLoader> loader;
+	loader.instantiate();
+	Error err;
+	Ref<TopologyDataMesh> mesh = loader->load_obj(write_test_obj(), err);
+	REQUIRE(err == OK);
+	REQUIRE(mesh.is_valid());
+	REQUIRE_EQ(mesh->get_surface_count(), 2);
+
+	CHECK_EQ(mesh->surface_get_name(0), String("poly"));
+	CHECK_EQ(mesh->surface_get_topology_type(0), TopologyDataMesh::TopologyType::MIXED);
+	Array poly_arrays = mesh->surface_get_arrays(0);
+	const PackedVector3Array &poly_vertex_array = poly_arrays[TopologyDataMesh::ARRAY_VERTEX];
+	const PackedInt32Array &poly_index_array = poly_arrays[TopologyDataMesh::ARRAY_INDEX];
+	const PackedInt32Array &poly_uv_index_array = poly_arrays[TopologyDataMesh::ARRAY_UV_INDEX];
+	const PackedInt32Array &face_vertex_count_array = poly_arrays[TopologyDataMesh::ARRAY_FACE_VERTEX_COUNT];
+	CHECK_EQ(poly_vertex_array.size(), 7);
+	CHECK_EQ(poly_index_array.size(), 9);
+	CHECK_EQ(poly_uv_index_array.size(), 9);
+	REQUIRE_EQ(face_vertex_count_array.size(), 2);
+	CHECK_EQ(face_vertex_count_array[0], 4);
+	CHECK_EQ(face_vertex_count_array[1], 5);
+	//winding gets reversed, first corner stays
+	CHECK_EQ(poly_vertex_array[poly_index_array[0]], Vector3(0, 0, 0));
+	CHECK_EQ(poly_vertex_array[poly_index_array[1]], Vector3(0, 1, 0));
+
+	CHECK_EQ(mesh->surface_get_name(1), String("tri"));
+	CHECK_EQ(mesh->surface_get_topology_type(1), TopologyDataMesh::TopologyType::TRIANGLE);
+	CHECK_FALSE(mesh->surface_get_format(1).has_flag(Mesh::ARRAY_FORMAT_TEX_UV));
+	Array tri_arrays = mesh->surface_get_arrays(1);
+	const PackedVector3Array &tri_vertex_array = tri_arrays[TopologyDataMesh::ARRAY_VERTEX];
+	CHECK_EQ(tri_vertex_array.size(), 3);
+}
+
+TEST_CASE("obj loader keeps normals and single component uvs") {
+	String path = "user://topology_data_obj_loader_normal_test.obj";
+	Ref<FileAccess> file = FileAccess::open(path, FileAccess::WRITE);
+	file->store_string(
+			"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+			"vt 0.25\nvt 0.75 0.5\n"
+			"vn 0 0 2\n"
+			"f 1/1/1 2/2/1 3/2/1 4/1/1\n");
+	file->close();
+
+	Ref<TopologyDataObjLoader> loader;
+	loader.instantiate();
+	Error err;
+	Ref<TopologyDataMesh> mesh = loader->load_obj(path, err);
+	REQUIRE(err == OK);
+	REQUIRE(mesh.is_valid());
+	REQUIRE_EQ(mesh->get_surface_count(), 1);
+	CHECK(mesh->surface_get_format(0).has_flag(Mesh::ARRAY_FORMAT_TEX_UV));
+	CHECK(mesh->surface_get_format(0).has_flag(Mesh::ARRAY_FORMAT_NORMAL));
+
+	Array arrays = mesh->surface_get_arrays(0);
+	const PackedVector3Array &vertex_array = arrays[TopologyDataMesh::ARRAY_VERTEX];
+	const PackedVector3Array &normal_array = arrays[TopologyDataMesh::ARRAY_NORMAL];
+	const PackedVector2Array &uv_array = arrays[TopologyDataMesh::ARRAY_TEX_UV];
+	REQUIRE_EQ(normal_array.size(), vertex_array.size());
+	for (int vertex_index = 0; vertex_index < normal_array.size(); vertex_index++) {
+		CHECK(normal_array[vertex_index].is_equal_approx(Vector3(0, 0, 1)));
+	}
+	REQUIRE_EQ(uv_array.size(), 2);
+	//missing v defaults to 0, flipped like every other uv
+	CHECK(uv_array[0].is_equal_approx(Vector2(0.25, 1.0)));
+	CHECK(uv_array[1].is_equal_approx(Vector2(0.75, 0.5)));
+}
+
+TEST_CASE("obj loader only handles topology data meshes") {
+	Ref<TopologyDataObjLoader> loader;
+	loader.instantiate();
+	CHECK(loader->_handles_type("TopologyDataMesh"));
+	CHECK_FALSE(loader->_handles_type("Resource"));
+	CHECK_FALSE(loader->_handles_type("ArrayMesh"));
+}
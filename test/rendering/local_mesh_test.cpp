@@ -0,0 +1,99 @@
+#include "doctest.h"
+#include "godot_cpp/classes/mesh.hpp"
+#include "rendering/local_mesh.h"
+
+//positions only, tightly packed like the vertex stream of a surface without normals
+static const int TEST_VERTEX_COUNT = 300;
+static const uint32_t TEST_VERTEX_STRIDE = sizeof(float) * 3;
+
+static Vector<uint32_t> create_position_offsets() {
+	Vector<uint32_t> offsets;
+	offsets.resize(Mesh::ARRAY_MAX);
+	offsets.fill(0);
+	return offsets;
+}
+
+static PackedVector3Array create_vertex_array() {
+	PackedVector3Array vertex_array;
+	for (int vertex_index = 0; vertex_index < TEST_VERTEX_COUNT; vertex_index++) {
+		vertex_array.push_back(Vector3(vertex_index, 0, 0));
+	}
+	return vertex_array;
+}
+
+TEST_CASE("local mesh dirty vertex ranges") {
+	const Vector<uint32_t> offsets = create_position_offsets();
+	PackedByteArray vertex_buffer;
+	vertex_buffer.resize(TEST_VERTEX_COUNT * TEST_VERTEX_STRIDE);
+	vertex_buffer.fill(0);
+	PackedVector3Array vertex_array = create_vertex_array();
+	Vector<Vector2i> dirty_ranges;
+
+	//first write changes everything but vertex 0, which is already zero
+	CHECK(LocalMesh::write_vertex_channels(vertex_buffer, TEST_VERTEX_STRIDE, offsets, vertex_array, PackedVector3Array(), PackedFloat32Array(),
+			TEST_VERTEX_COUNT, dirty_ranges));
+	REQUIRE_EQ(dirty_ranges.size(), 1);
+	CHECK_EQ(dirty_ranges[0], Vector2i(1, TEST_VERTEX_COUNT));
+
+	SUBCASE("unchanged data uploads nothing") {
+		CHECK_FALSE(LocalMesh::write_vertex_channels(vertex_buffer, TEST_VERTEX_STRIDE, offsets, vertex_array, PackedVector3Array(), PackedFloat32Array(),
+				TEST_VERTEX_COUNT, dirty_ranges));
+		CHECK(dirty_ranges.is_empty());
+	}
+
+	SUBCASE("close ranges get merged") {
+		vertex_array.set(10, Vector3(0, 1, 0));
+		vertex_array.set(10 + LocalMesh::DIRTY_RANGE_MERGE_GAP, Vector3(0, 1, 0));
+		CHECK(LocalMesh::write_vertex_channels(vertex_buffer, TEST_VERTEX_STRIDE, offsets, vertex_array, PackedVector3Array(), PackedFloat32Array(),
+				TEST_VERTEX_COUNT, dirty_ranges));
+		REQUIRE_EQ(dirty_ranges.size(), 1);
+		CHECK_EQ(dirty_ranges[0], Vector2i(10, 11 + LocalMesh::DIRTY_RANGE_MERGE_GAP));
+	}
+
+	SUBCASE("distant ranges stay separate") {
+		vertex_array.set(10, Vector3(0, 1, 0));
+		vertex_array.set(11, Vector3(0, 1, 0));
+		vertex_array.set(13 + LocalMesh::DIRTY_RANGE_MERGE_GAP, Vector3(0, 1, 0));
+		CHECK(LocalMesh::write_vertex_channels(vertex_buffer, TEST_VERTEX_STRIDE, offsets, vertex_array, PackedVector3Array(), PackedFloat32Array(),
+				TEST_VERTEX_COUNT, dirty_ranges));
+		REQUIRE_EQ(dirty_ranges.size(), 2);
+		CHECK_EQ(dirty_ranges[0], Vector2i(10, 12));
+		CHECK_EQ(dirty_ranges[1], Vector2i(13 + LocalMesh::DIRTY_RANGE_MERGE_GAP, 14 + LocalMesh::DIRTY_RANGE_MERGE_GAP));
+	}
+
+	SUBCASE("changes get written") {
+		vertex_array.set(TEST_VERTEX_COUNT - 1, Vector3(1, 2, 3));
+		LocalMesh::write_vertex_channels(vertex_buffer, TEST_VERTEX_STRIDE, offsets, vertex_array, PackedVector3Array(), PackedFloat32Array(),
+				TEST_VERTEX_COUNT, dirty_ranges);
+		const float *written = reinterpret_cast<const float *>(vertex_buffer.ptr() + (TEST_VERTEX_COUNT - 1) * TEST_VERTEX_STRIDE);
+		CHECK_EQ(written[0], 1.0f);
+		CHECK_EQ(written[1], 2.0f);
+		CHECK_EQ(written[2], 3.0f);
+	}
+}
+
+TEST_CASE("local mesh dirty ranges of normals only") {
+	//position followed by the octahedral encoded normal
+	const uint32_t vertex_stride = sizeof(float) * 3 + sizeof(uint32_t);
+	Vector<uint32_t> offsets = create_position_offsets();
+	offsets.write[Mesh::ARRAY_NORMAL] = sizeof(float) * 3;
+	PackedByteArray vertex_buffer;
+	vertex_buffer.resize(TEST_VERTEX_COUNT * vertex_stride);
+	vertex_buffer.fill(0);
+	PackedVector3Array normal_array;
+	normal_array.resize(TEST_VERTEX_COUNT);
+	normal_array.fill(Vector3(0, 1, 0));
+	Vector<Vector2i> dirty_ranges;
+	LocalMesh::write_vertex_channels(vertex_buffer, vertex_stride, offsets, PackedVector3Array(), normal_array, PackedFloat32Array(),
+			TEST_VERTEX_COUNT, dirty_ranges);
+
+	normal_array.set(5, Vector3(1, 0, 0));
+	//normals don't count as moved positions
+	CHECK_FALSE(LocalMesh::write_vertex_channels(vertex_buffer, vertex_stride, offsets, PackedVector3Array(), normal_array, PackedFloat32Array(),
+			TEST_VERTEX_COUNT, dirty_ranges));
+	REQUIRE_EQ(dirty_ranges.size(), 1);
+	CHECK_EQ(dirty_ranges[0], Vector2i(5, 6));
+	//positions weren't touched
+	const float *position = reinterpret_cast<const float *>(vertex_buffer.ptr() + 5 * vertex_stride);
+	CHECK_EQ(position[0], 0.0f);
+}
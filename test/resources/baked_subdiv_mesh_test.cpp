@@ -0,0 +1,136 @@
+#include "doctest.h"
+#include "godot_cpp/classes/resource_loader.hpp"
+#include "godot_cpp/classes/resource_saver.hpp"
+#include "resources/baked_subdiv_mesh.hpp"
+#include "resources/topology_data_mesh.hpp"
+
+TEST_CASE("BakedSubdivMesh reuses stored bake") {
+	Ref<TopologyDataMesh> data_mesh = ResourceLoader::get_singleton()->load("res://test/cube.tres");
+	Ref<BakedSubdivMesh> mesh;
+	mesh.instantiate();
+	mesh->set_store_bake(true);
+	mesh->set_background_bake(false);
+	mesh->set_subdiv_level(1);
+	mesh->set_data_mesh(data_mesh);
+	REQUIRE_EQ(mesh->get_surface_count(), 1);
+	const String bake_hash = mesh->_get_bake_hash();
+	CHECK_FALSE(bake_hash.is_empty());
+
+	const String path = "user://baked_subdiv_mesh_test.res";
+	REQUIRE(ResourceSaver::get_singleton()->save(mesh, path) == OK);
+	Ref<BakedSubdivMesh> loaded = ResourceLoader::get_singleton()->load(path, "", ResourceLoader::CACHE_MODE_IGNORE);
+	REQUIRE(loaded.is_valid());
+	CHECK_EQ(loaded->_get_bake_hash(), bake_hash);
+	REQUIRE_EQ(loaded->get_surface_count(), 1);
+	const PackedVector3Array expected_vertex_array = mesh->surface_get_arrays(0)[Mesh::ARRAY_VERTEX];
+	const PackedVector3Array loaded_vertex_array = loaded->surface_get_arrays(0)[Mesh::ARRAY_VERTEX];
+	CHECK_EQ(loaded_vertex_array.size(), expected_vertex_array.size());
+
+	//a different level doesn't match the stored hash anymore
+	loaded->set_background_bake(false);
+	loaded->set_subdiv_level(2);
+	CHECK_NE(loaded->_get_bake_hash(), bake_hash);
+	const PackedVector3Array rebaked_vertex_array = loaded->surface_get_arrays(0)[Mesh::ARRAY_VERTEX];
+	CHECK_GT(rebaked_vertex_array.size(), expected_vertex_array.size());
+}
+
+TEST_CASE("BakedSubdivMesh background bake shows cage until done") {
+	Ref<TopologyDataMesh> data_mesh = ResourceLoader::get_singleton()->load("res://test/cube.tres");
+	Ref<BakedSubdivMesh> cage_mesh;
+	cage_mesh.instantiate();
+	cage_mesh->set_background_bake(false);
+	cage_mesh->set_data_mesh(data_mesh);
+	const PackedVector3Array cage_vertex_array = cage_mesh->surface_get_arrays(0)[Mesh::ARRAY_VERTEX];
+
+	Ref<BakedSubdivMesh> mesh;
+	mesh.instantiate();
+	mesh->set_subdiv_level(2);
+	mesh->set_subdiv_level(3); //supersedes level 2
+	mesh->set_data_mesh(data_mesh);
+	REQUIRE_EQ(mesh->get_surface_count(), 1);
+	const PackedVector3Array placeholder_vertex_array = mesh->surface_get_arrays(0)[Mesh::ARRAY_VERTEX];
+	CHECK_EQ(placeholder_vertex_array.size(), cage_vertex_array.size());
+
+	mesh->wait_for_bake();
+	CHECK_FALSE(mesh->is_baking());
+	const PackedVector3Array baked_vertex_array = mesh->surface_get_arrays(0)[Mesh::ARRAY_VERTEX];
+	CHECK_GT(baked_vertex_array.size(), cage_vertex_array.size());
+}
+
+TEST_CASE("BakedSubdivMesh only stores the hash of a finished background bake") {
+	Ref<TopologyDataMesh> data_mesh = ResourceLoader::get_singleton()->load("res://test/cube.tres");
+	Ref<BakedSubdivMesh> mesh;
+	mesh.instantiate();
+	mesh->set_subdiv_level(2);
+	mesh->set_data_mesh(data_mesh);
+	REQUIRE(mesh->is_baking());
+	mesh->set_store_bake(true); //surfaces are still the cage
+	CHECK(mesh->_get_bake_hash().is_empty());
+
+	mesh->wait_for_bake();
+	const String bake_hash = mesh->_get_bake_hash();
+	CHECK_FALSE(bake_hash.is_empty());
+
+	Ref<BakedSubdivMesh> expected_mesh;
+	expected_mesh.instantiate();
+	expected_mesh->set_store_bake(true);
+	expected_mesh->set_background_bake(false);
+	expected_mesh->set_subdiv_level(2);
+	expected_mesh->set_data_mesh(data_mesh);
+	CHECK_EQ(bake_hash, expected_mesh->_get_bake_hash());
+}
+
+TEST_CASE("BakedSubdivMesh reuses stored bake of quantized data") {
+	//a duplicate has no path, so it gets embedded and loaded from its quantized arrays
+	Ref<TopologyDataMesh> data_mesh = Ref<Resource>(ResourceLoader::get_singleton()->load("res://test/cube.tres"))->duplicate();
+	data_mesh->set_quantized_storage(true);
+	Ref<BakedSubdivMesh> mesh;
+	mesh.instantiate();
+	mesh->set_store_bake(true);
+	mesh->set_background_bake(false);
+	mesh->set_subdiv_level(1);
+	mesh->set_data_mesh(data_mesh);
+	const String bake_hash = mesh->_get_bake_hash();
+	REQUIRE_FALSE(bake_hash.is_empty());
+
+	const String path = "user://baked_subdiv_mesh_quantized_test.res";
+	REQUIRE(ResourceSaver::get_singleton()->save(mesh, path) == OK);
+	Ref<BakedSubdivMesh> loaded = ResourceLoader::get_singleton()->load(path, "", ResourceLoader::CACHE_MODE_IGNORE);
+	REQUIRE(loaded.is_valid());
+	CHECK(loaded->get_data_mesh()->get_quantized_storage());
+	CHECK(loaded->is_using_stored_bake());
+	CHECK_FALSE(loaded->is_baking());
+	CHECK_EQ(loaded->_get_bake_hash(), bake_hash);
+
+	//saving the loaded mesh again keeps the same hash
+	REQUIRE(ResourceSaver::get_singleton()->save(loaded, path) == OK);
+	Ref<BakedSubdivMesh> reloaded = ResourceLoader::get_singleton()->load(path, "", ResourceLoader::CACHE_MODE_IGNORE);
+	REQUIRE(reloaded.is_valid());
+	CHECK(reloaded->is_using_stored_bake());
+	CHECK_EQ(reloaded->_get_bake_hash(), bake_hash);
+}
+
+TEST_CASE("BakedSubdivMesh tangent mode is part of the stored bake") {
+	Ref<TopologyDataMesh> data_mesh = ResourceLoader::get_singleton()->load("res://test/cube.tres");
+	Ref<BakedSubdivMesh> mesh;
+	mesh.instantiate();
+	CHECK_EQ(mesh->get_tangent_mode(), Subdivider::TANGENT_MODE_MIKKTSPACE);
+	mesh->set_store_bake(true);
+	mesh->set_background_bake(false);
+	mesh->set_subdiv_level(1);
+	mesh->set_data_mesh(data_mesh);
+	const String mikktspace_hash = mesh->_get_bake_hash();
+	REQUIRE_FALSE(mikktspace_hash.is_empty());
+
+	mesh->set_tangent_mode(Subdivider::TANGENT_MODE_ANALYTIC);
+	const String analytic_hash = mesh->_get_bake_hash();
+	CHECK_NE(analytic_hash, mikktspace_hash);
+
+	const String path = "user://baked_subdiv_mesh_tangent_test.res";
+	REQUIRE(ResourceSaver::get_singleton()->save(mesh, path) == OK);
+	Ref<BakedSubdivMesh> loaded = ResourceLoader::get_singleton()->load(path, "", ResourceLoader::CACHE_MODE_IGNORE);
+	REQUIRE(loaded.is_valid());
+	CHECK_EQ(loaded->get_tangent_mode(), Subdivider::TANGENT_MODE_ANALYTIC);
+	CHECK(loaded->is_using_stored_bake());
+	CHECK_EQ(loaded->_get_bake_hash(), analytic_hash);
+}
@@ -0,0 +1,199 @@
+#include "doctest.h"
+#include "godot_cpp/classes/file_access.hpp"
+#include "godot_cpp/classes/resource_loader.hpp"
+#include "resources/topology_data_mesh.hpp"
+#include "resources/topology_data_mesh_format.hpp"
+#include "subdivision/subdivision_baker.hpp"
+#include "test_utility_methods.hpp"
+
+TEST_CASE("tdmesh save and load keeps surfaces and blend shapes") {
+	PackedVector3Array vertex_array;
+	vertex_array.push_back(Vector3(0, 0, 0));
+	vertex_array.push_back(Vector3(0, 1, 0));
+	vertex_array.push_back(Vector3(1, 1, 0));
+	vertex_array.push_back(Vector3(1, 0, 0));
+	int32_t index_arr[] = { 0, 1, 2, 3 };
+	PackedVector2Array uv_array;
+	uv_array.push_back(Vector2(0, 0));
+	uv_array.push_back(Vector2(0, 1));
+	uv_array.push_back(Vector2(1, 1));
+	uv_array.push_back(Vector2(1, 0));
+
+	Array arrays;
+	arrays.resize(TopologyDataMesh::ARRAY_MAX);
+	arrays[TopologyDataMesh::ARRAY_VERTEX] = vertex_array;
+	arrays[TopologyDataMesh::ARRAY_INDEX] = create_packed_int32_array(index_arr, 4);
+	arrays[TopologyDataMesh::ARRAY_TEX_UV] = uv_array;
+	arrays[TopologyDataMesh::ARRAY_UV_INDEX] = create_packed_int32_array(index_arr, 4);
+
+	PackedVector3Array blend_shape_vertex_array;
+	blend_shape_vertex_array.resize(4);
+	blend_shape_vertex_array.fill(Vector3(0, 0, 0.5));
+	Array blend_shape_array;
+	blend_shape_array.resize(TopologyDataMesh::ARRAY_MAX);
+	blend_shape_array[TopologyDataMesh::ARRAY_VERTEX] = blend_shape_vertex_array;
+	Array blend_shapes;
+	blend_shapes.push_back(blend_shape_array);
+
+	Ref<TopologyDataMesh> mesh;
+	mesh.instantiate();
+	mesh->add_blend_shape_name("push");
+	mesh->add_surface(arrays, Dictionary(), blend_shapes, Ref<Material>(), "quad",
+			Mesh::ARRAY_FORMAT_VERTEX | Mesh::ARRAY_FORMAT_INDEX | Mesh::ARRAY_FORMAT_TEX_UV, TopologyDataMesh::TopologyType::QUAD);
+
+	const String path = "user://topology_data_mesh_format_test.tdmesh";
+	Ref<TopologyDataMeshFormatSaver> saver;
+	saver.instantiate();
+	REQUIRE(saver->_save(mesh, path, 0) == OK);
+
+	Ref<TopologyDataMeshFormatLoader> loader;
+	loader.instantiate();
+	Error err;
+	Ref<TopologyDataMesh> loaded = loader->load_topology_data_mesh(path, err);
+	REQUIRE(err == OK);
+	REQUIRE_EQ(loaded->get_surface_count(), 1);
+	CHECK_EQ(loaded->surface_get_name(0), String("quad"));
+	CHECK_EQ(loaded->surface_get_topology_type(0), TopologyDataMesh::TopologyType::QUAD);
+	CHECK_EQ(loaded->get_blend_shape_count(), 1);
+
+	Array loaded_arrays = loaded->surface_get_arrays(0);
+	CHECK(equal_approx(loaded_arrays[TopologyDataMesh::ARRAY_VERTEX], vertex_array));
+	const PackedInt32Array &loaded_index_array = loaded_arrays[TopologyDataMesh::ARRAY_INDEX];
+	CHECK_EQ(loaded_index_array.size(), 4);
+	const PackedVector2Array &loaded_uv_array = loaded_arrays[TopologyDataMesh::ARRAY_TEX_UV];
+	CHECK_EQ(loaded_uv_array[2], Vector2(1, 1));
+	const Array &loaded_blend_shape_array = loaded->surface_get_single_blend_shape_array(0, 0);
+	CHECK(equal_approx(loaded_blend_shape_array[TopologyDataMesh::ARRAY_VERTEX], blend_shape_vertex_array));
+}
+
+TEST_CASE("tdmesh loads surfaces lazily") {
+	Ref<TopologyDataMesh> mesh = ResourceLoader::get_singleton()->load("res://test/cube.tres", "", ResourceLoader::CACHE_MODE_IGNORE);
+	const Array expected_arrays = mesh->surface_get_arrays(0);
+	mesh->add_surface(expected_arrays, Dictionary(), Array(), Ref<Material>(), "second",
+			mesh->surface_get_format(0), mesh->surface_get_topology_type(0));
+
+	const String path = "user://topology_data_mesh_format_lazy_test.tdmesh";
+	Ref<TopologyDataMeshFormatSaver> saver;
+	saver.instantiate();
+	REQUIRE(saver->_save(mesh, path, 0) == OK);
+
+	Ref<TopologyDataMeshFormatLoader> loader;
+	loader.instantiate();
+	Error err;
+	Ref<TopologyDataMesh> loaded = loader->load_topology_data_mesh(path, err);
+	REQUIRE(err == OK);
+	REQUIRE_EQ(loaded->get_surface_count(), 2);
+	CHECK_FALSE(loaded->surface_is_loaded(0));
+	CHECK_FALSE(loaded->surface_is_loaded(1));
+	CHECK_EQ(loaded->surface_get_name(1), String("second"));
+
+	const Array loaded_arrays = loaded->surface_get_arrays(1);
+	CHECK(loaded->surface_is_loaded(1));
+	CHECK_FALSE(loaded->surface_is_loaded(0));
+	CHECK(equal_approx(loaded_arrays[TopologyDataMesh::ARRAY_VERTEX], expected_arrays[TopologyDataMesh::ARRAY_VERTEX]));
+	CHECK_EQ(PackedInt32Array(loaded_arrays[TopologyDataMesh::ARRAY_INDEX]), PackedInt32Array(expected_arrays[TopologyDataMesh::ARRAY_INDEX]));
+
+	//reads the rest so the file can be overwritten
+	loaded->release_files();
+	CHECK(loaded->surface_is_loaded(0));
+	CHECK_EQ(PackedInt32Array(loaded->surface_get_arrays(0)[TopologyDataMesh::ARRAY_INDEX]), PackedInt32Array(expected_arrays[TopologyDataMesh::ARRAY_INDEX]));
+	REQUIRE(saver->_save(loaded, path, 0) == OK);
+
+	loader->set_lazy_loading(false);
+	loaded = loader->load_topology_data_mesh(path, err);
+	REQUIRE(err == OK);
+	CHECK(loaded->surface_is_loaded(0));
+}
+
+TEST_CASE("tdmesh keeps memory mapped stencil tables") {
+	Ref<TopologyDataMesh> mesh = ResourceLoader::get_singleton()->load("res://test/cube.tres", "", ResourceLoader::CACHE_MODE_IGNORE);
+	Ref<SubdivisionBaker> baker;
+	baker.instantiate();
+	baker->bake_refinement_data(mesh, 2);
+	const Array expected_refinement_arrays = mesh->surface_get_refinement_data(0, 2);
+	REQUIRE(!expected_refinement_arrays.is_empty());
+
+	const String path = "user://topology_data_mesh_format_mapped_test.tdmesh";
+	Ref<TopologyDataMeshFormatSaver> saver;
+	saver.instantiate();
+	REQUIRE(saver->_save(mesh, path, 0) == OK);
+
+	Ref<TopologyDataMeshFormatLoader> loader;
+	loader.instantiate();
+	Error err;
+	Ref<TopologyDataMesh> loaded = loader->load_topology_data_mesh(path, err);
+	REQUIRE(err == OK);
+
+	TopologyDataMesh::StencilTableView stencil_table;
+	REQUIRE(loaded->surface_get_stencil_table(0, 2, stencil_table));
+	CHECK(stencil_table.mapped_file.is_valid());
+	const PackedInt32Array &expected_stencil_sizes = expected_refinement_arrays[TopologyDataMesh::REFINEMENT_STENCIL_SIZES];
+	const PackedFloat32Array &expected_stencil_weights = expected_refinement_arrays[TopologyDataMesh::REFINEMENT_STENCIL_WEIGHTS];
+	REQUIRE_EQ(stencil_table.stencil_count, expected_stencil_sizes.size());
+	REQUIRE_EQ(stencil_table.control_count, expected_stencil_weights.size());
+	CHECK_EQ(stencil_table.sizes[stencil_table.stencil_count - 1], expected_stencil_sizes[stencil_table.stencil_count - 1]);
+	CHECK_EQ(stencil_table.weights[stencil_table.control_count - 1], expected_stencil_weights[stencil_table.control_count - 1]);
+
+	//copies the mapped stencils back into packed arrays
+	const Array loaded_refinement_arrays = loaded->surface_get_refinement_data(0, 2);
+	CHECK_EQ(PackedInt32Array(loaded_refinement_arrays[TopologyDataMesh::REFINEMENT_STENCIL_INDICES]),
+			PackedInt32Array(expected_refinement_arrays[TopologyDataMesh::REFINEMENT_STENCIL_INDICES]));
+	CHECK_EQ(PackedInt32Array(loaded_refinement_arrays[TopologyDataMesh::REFINEMENT_INDEX]),
+			PackedInt32Array(expected_refinement_arrays[TopologyDataMesh::REFINEMENT_INDEX]));
+
+	SUBCASE("saving over the mapped file releases the mapping") {
+		stencil_table = TopologyDataMesh::StencilTableView();
+		REQUIRE(saver->_save(loaded, path, 0) == OK);
+		REQUIRE(loaded->surface_get_stencil_table(0, 2, stencil_table));
+		CHECK(stencil_table.mapped_file.is_null());
+		CHECK_EQ(PackedFloat32Array(loaded->surface_get_refinement_data(0, 2)[TopologyDataMesh::REFINEMENT_STENCIL_WEIGHTS]),
+				PackedFloat32Array(expected_refinement_arrays[TopologyDataMesh::REFINEMENT_STENCIL_WEIGHTS]));
+
+		Ref<TopologyDataMesh> reloaded = loader->load_topology_data_mesh(path, err);
+		REQUIRE(err == OK);
+		CHECK_EQ(PackedInt32Array(reloaded->surface_get_refinement_data(0, 2)[TopologyDataMesh::REFINEMENT_STENCIL_INDICES]),
+				PackedInt32Array(expected_refinement_arrays[TopologyDataMesh::REFINEMENT_STENCIL_INDICES]));
+	}
+}
+
+TEST_CASE("tdmesh loader rejects unknown topology types") {
+	PackedVector3Array vertex_array;
+	vertex_array.push_back(Vector3(0, 0, 0));
+	vertex_array.push_back(Vector3(0, 1, 0));
+	vertex_array.push_back(Vector3(1, 1, 0));
+	int32_t index_arr[] = { 0, 1, 2 };
+	Array arrays;
+	arrays.resize(TopologyDataMesh::ARRAY_MAX);
+	arrays[TopologyDataMesh::ARRAY_VERTEX] = vertex_array;
+	arrays[TopologyDataMesh::ARRAY_INDEX] = create_packed_int32_array(index_arr, 3);
+
+	Ref<TopologyDataMesh> mesh;
+	mesh.instantiate();
+	mesh->add_surface(arrays, Dictionary(), Array(), Ref<Material>(), "tri",
+			Mesh::ARRAY_FORMAT_VERTEX | Mesh::ARRAY_FORMAT_INDEX, TopologyDataMesh::TopologyType::TRIANGLE);
+
+	const String path = "user://topology_data_mesh_format_topology_type_test.tdmesh";
+	Ref<TopologyDataMeshFormatSaver> saver;
+	saver.instantiate();
+	REQUIRE(saver->_save(mesh, path, 0) == OK);
+
+	//magic, version, real size, mesh name, blend shape count, surface count, surface name, format
+	const uint64_t topology_type_offset = 4 + 4 + 1 + 4 + 4 + 4 + (4 + 3) + 4;
+	{
+		Ref<FileAccess> file = FileAccess::open(path, FileAccess::READ_WRITE);
+		REQUIRE(file.is_valid());
+		file->seek(topology_type_offset);
+		REQUIRE_EQ(file->get_32(), uint32_t(TopologyDataMesh::TopologyType::TRIANGLE));
+		file->seek(topology_type_offset);
+		file->store_32(7);
+	}
+
+	Ref<TopologyDataMeshFormatLoader> loader;
+	loader.instantiate();
+	CHECK(loader->_handles_type("TopologyDataMesh"));
+	CHECK_FALSE(loader->_handles_type("Resource"));
+	Error err;
+	Ref<TopologyDataMesh> loaded = loader->load_topology_data_mesh(path, err);
+	CHECK(loaded.is_null());
+	CHECK_EQ(err, ERR_FILE_CORRUPT);
+}
@@ -0,0 +1,152 @@
+#include "doctest.h"
+#include "resources/topology_data_mesh.hpp"
+#include "resources/topology_data_quantization.hpp"
+#include "test_utility_methods.hpp"
+
+TEST_CASE("quantized storage restores arrays within precision") {
+	PackedVector3Array vertex_array;
+	vertex_array.push_back(Vector3(-1, 0, 0.25));
+	vertex_array.push_back(Vector3(-1, 2, 0));
+	vertex_array.push_back(Vector3(1, 2, 0.5));
+	vertex_array.push_back(Vector3(1, 0, 0));
+	int32_t index_arr[] = { 0, 1, 2, 3 };
+	PackedVector2Array uv_array;
+	uv_array.push_back(Vector2(0, 0));
+	uv_array.push_back(Vector2(0, 1));
+	uv_array.push_back(Vector2(0.5, 1));
+	uv_array.push_back(Vector2(0.5, 0));
+	int32_t bones_arr[] = { 0, 1, 0, 0, 2, 0, 0, 0, 300, 1, 0, 0, 3, 0, 0, 0 };
+	PackedFloat32Array weights_array;
+	for (int vertex_index = 0; vertex_index < 4; vertex_index++) {
+		weights_array.push_back(0.7);
+		weights_array.push_back(0.3);
+		weights_array.push_back(0);
+		weights_array.push_back(0);
+	}
+
+	Array arrays;
+	arrays.resize(TopologyDataMesh::ARRAY_MAX);
+	arrays[TopologyDataMesh::ARRAY_VERTEX] = vertex_array;
+	arrays[TopologyDataMesh::ARRAY_INDEX] = create_packed_int32_array(index_arr, 4);
+	arrays[TopologyDataMesh::ARRAY_TEX_UV] = uv_array;
+	arrays[TopologyDataMesh::ARRAY_UV_INDEX] = create_packed_int32_array(index_arr, 4);
+	arrays[TopologyDataMesh::ARRAY_BONES] = create_packed_int32_array(bones_arr, 16);
+	arrays[TopologyDataMesh::ARRAY_WEIGHTS] = weights_array;
+
+	Dictionary quantization;
+	AABB aabb(Vector3(-1, 0, 0), Vector3(2, 2, 0.5));
+	Array quantized_arrays = TopologyDataQuantization::quantize_arrays(arrays, aabb, quantization);
+	CHECK_EQ(quantized_arrays[TopologyDataMesh::ARRAY_VERTEX].get_type(), Variant::PACKED_BYTE_ARRAY);
+	CHECK_EQ(int(quantization["bone_bytes"]), 2); //bone 300 doesn't fit into 8 bit
+	Array restored_arrays = TopologyDataQuantization::dequantize_arrays(quantized_arrays, quantization);
+
+	const PackedVector3Array &restored_vertex_array = restored_arrays[TopologyDataMesh::ARRAY_VERTEX];
+	REQUIRE_EQ(restored_vertex_array.size(), vertex_array.size());
+	for (int vertex_index = 0; vertex_index < vertex_array.size(); vertex_index++) {
+		CHECK(restored_vertex_array[vertex_index].distance_to(vertex_array[vertex_index]) < 0.0001);
+	}
+	const PackedVector2Array &restored_uv_array = restored_arrays[TopologyDataMesh::ARRAY_TEX_UV];
+	CHECK(restored_uv_array[2].distance_to(Vector2(0.5, 1)) < 0.0001);
+	CHECK_EQ(PackedInt32Array(restored_arrays[TopologyDataMesh::ARRAY_BONES]), create_packed_int32_array(bones_arr, 16));
+	const PackedFloat32Array &restored_weights_array = restored_arrays[TopologyDataMesh::ARRAY_WEIGHTS];
+	CHECK(Math::abs(restored_weights_array[0] - 0.7f) < 0.0001);
+	CHECK_EQ(PackedInt32Array(restored_arrays[TopologyDataMesh::ARRAY_INDEX]), create_packed_int32_array(index_arr, 4));
+}
+
+TEST_CASE("quantized blend shapes use half floats") {
+	PackedVector3Array delta_array;
+	delta_array.push_back(Vector3(0.001, -0.5, 2));
+	delta_array.push_back(Vector3(0, 0, 0));
+	Array blend_shape_arrays;
+	blend_shape_arrays.resize(TopologyDataMesh::ARRAY_MAX);
+	blend_shape_arrays[TopologyDataMesh::ARRAY_VERTEX] = delta_array;
+
+	Array quantized_arrays = TopologyDataQuantization::quantize_blend_shape_arrays(blend_shape_arrays);
+	const PackedByteArray &quantized_deltas = quantized_arrays[TopologyDataMesh::ARRAY_VERTEX];
+	CHECK_EQ(quantized_deltas.size(), 2 * 3 * 2);
+	Array restored_arrays = TopologyDataQuantization::dequantize_blend_shape_arrays(quantized_arrays);
+	const PackedVector3Array &restored_delta_array = restored_arrays[TopologyDataMesh::ARRAY_VERTEX];
+	CHECK(Math::abs(restored_delta_array[0].x - 0.001f) < 0.000001);
+	CHECK_EQ(restored_delta_array[0].y, -0.5);
+	CHECK_EQ(restored_delta_array[0].z, 2);
+	CHECK_EQ(restored_delta_array[1], Vector3(0, 0, 0));
+}
+
+TEST_CASE("quantized blend shapes clamp to the largest finite half") {
+	PackedVector3Array delta_array;
+	delta_array.push_back(Vector3(1e6, -1e6, 65520));
+	Array blend_shape_arrays;
+	blend_shape_arrays.resize(TopologyDataMesh::ARRAY_MAX);
+	blend_shape_arrays[TopologyDataMesh::ARRAY_VERTEX] = delta_array;
+
+	Array restored_arrays = TopologyDataQuantization::dequantize_blend_shape_arrays(TopologyDataQuantization::quantize_blend_shape_arrays(blend_shape_arrays));
+	const PackedVector3Array &restored_delta_array = restored_arrays[TopologyDataMesh::ARRAY_VERTEX];
+	CHECK_EQ(restored_delta_array[0], Vector3(65504, -65504, 65504));
+}
+
+TEST_CASE("quantized surfaces keep shared border vertices together") {
+	//the surfaces have very different bounds, quantizing each relative to its own would round the border differently
+	PackedVector3Array first_vertex_array;
+	first_vertex_array.push_back(Vector3(0, 0, 0));
+	first_vertex_array.push_back(Vector3(0, 1, 0));
+	first_vertex_array.push_back(Vector3(0.7123, 1, 0.3317));
+	first_vertex_array.push_back(Vector3(0.7123, 0, 0.1931));
+	PackedVector3Array second_vertex_array;
+	second_vertex_array.push_back(Vector3(0.7123, 0, 0.1931));
+	second_vertex_array.push_back(Vector3(0.7123, 1, 0.3317));
+	second_vertex_array.push_back(Vector3(7.1, 5.3, -2.9));
+	second_vertex_array.push_back(Vector3(7.1, -3.7, 4.4));
+	int32_t index_arr[] = { 0, 1, 2, 3 };
+
+	Ref<TopologyDataMesh> mesh;
+	mesh.instantiate();
+	Array arrays;
+	arrays.resize(TopologyDataMesh::ARRAY_MAX);
+	arrays[TopologyDataMesh::ARRAY_INDEX] = create_packed_int32_array(index_arr, 4);
+	arrays[TopologyDataMesh::ARRAY_VERTEX] = first_vertex_array;
+	mesh->add_surface_from_arrays(TopologyDataMesh::QUAD, arrays.duplicate());
+	arrays[TopologyDataMesh::ARRAY_VERTEX] = second_vertex_array;
+	mesh->add_surface_from_arrays(TopologyDataMesh::QUAD, arrays.duplicate());
+	mesh->set_quantized_storage(true);
+
+	Ref<TopologyDataMesh> loaded_mesh;
+	loaded_mesh.instantiate();
+	loaded_mesh->set("_data", mesh->get("_data"));
+	REQUIRE_EQ(loaded_mesh->get_surface_count(), 2);
+	const PackedVector3Array first_restored_array = loaded_mesh->surface_get_arrays(0)[TopologyDataMesh::ARRAY_VERTEX];
+	const PackedVector3Array second_restored_array = loaded_mesh->surface_get_arrays(1)[TopologyDataMesh::ARRAY_VERTEX];
+	CHECK_EQ(first_restored_array[2], second_restored_array[1]);
+	CHECK_EQ(first_restored_array[3], second_restored_array[0]);
+	CHECK(first_restored_array[2].distance_to(first_vertex_array[2]) < 0.001);
+}
+
+TEST_CASE("quantizing restored arrays again keeps them exactly") {
+	//far from the origin compared to its size, bounds of the restored vertices also differ from the original ones
+	PackedVector3Array vertex_array;
+	vertex_array.push_back(Vector3(5000.123, -0.371, 12.5));
+	vertex_array.push_back(Vector3(5001.7, 2.219, 13.001));
+	vertex_array.push_back(Vector3(5003.05, 0.5, 12.77));
+	vertex_array.push_back(Vector3(5002.2, 1.333, 12.9));
+	int32_t index_arr[] = { 0, 1, 2, 3 };
+	Array arrays;
+	arrays.resize(TopologyDataMesh::ARRAY_MAX);
+	arrays[TopologyDataMesh::ARRAY_VERTEX] = vertex_array;
+	arrays[TopologyDataMesh::ARRAY_INDEX] = create_packed_int32_array(index_arr, 4);
+
+	const auto round_trip = [](const Array &p_arrays) {
+		const PackedVector3Array &vertices = p_arrays[TopologyDataMesh::ARRAY_VERTEX];
+		AABB aabb(vertices[0], Vector3());
+		for (int vertex_index = 1; vertex_index < vertices.size(); vertex_index++) {
+			aabb.expand_to(vertices[vertex_index]);
+		}
+		Dictionary quantization;
+		const Array quantized_arrays = TopologyDataQuantization::quantize_arrays(p_arrays, aabb, quantization);
+		return TopologyDataQuantization::dequantize_arrays(quantized_arrays, quantization);
+	};
+	const Array restored_arrays = round_trip(arrays);
+	const PackedVector3Array restored_vertex_array = restored_arrays[TopologyDataMesh::ARRAY_VERTEX];
+	for (int vertex_index = 0; vertex_index < vertex_array.size(); vertex_index++) {
+		CHECK(restored_vertex_array[vertex_index].distance_to(vertex_array[vertex_index]) < 0.001);
+	}
+	CHECK_EQ(PackedVector3Array(round_trip(restored_arrays)[TopologyDataMesh::ARRAY_VERTEX]), restored_vertex_array);
+}
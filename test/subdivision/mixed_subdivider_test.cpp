@@ -0,0 +1,55 @@
+#include "doctest.h"
+#include "godot_cpp/variant/utility_functions.hpp"
+#include "resources/topology_data_mesh.hpp"
+#include "subdivision/mixed_subdivider.hpp"
+#include "test_utility_methods.hpp"
+
+//quad with a triangle and a pentagon attached
+static Array create_mixed_arrays() {
+	Array arr;
+	PackedVector3Array vertex_array;
+	vertex_array.push_back(Vector3(0, 0, 0));
+	vertex_array.push_back(Vector3(0, 1, 0));
+	vertex_array.push_back(Vector3(1, 1, 0));
+	vertex_array.push_back(Vector3(1, 0, 0));
+	vertex_array.push_back(Vector3(2, 0.5, 0));
+	vertex_array.push_back(Vector3(0.5, -1, 0));
+	vertex_array.push_back(Vector3(1.5, -1, 0));
+	vertex_array.push_back(Vector3(-0.5, -0.5, 0));
+
+	int32_t index_arr[] = { 0, 1, 2, 3, 3, 2, 4, 0, 3, 6, 5, 7 };
+	PackedInt32Array index_array = create_packed_int32_array(index_arr, 12);
+	int32_t face_vertex_count_arr[] = { 4, 3, 5 };
+	PackedInt32Array face_vertex_count_array = create_packed_int32_array(face_vertex_count_arr, 3);
+
+	arr.resize(TopologyDataMesh::ARRAY_MAX);
+	arr[TopologyDataMesh::ARRAY_VERTEX] = vertex_array;
+	arr[TopologyDataMesh::ARRAY_INDEX] = index_array;
+	arr[TopologyDataMesh::ARRAY_FACE_VERTEX_COUNT] = face_vertex_count_array;
+	return arr;
+}
+
+TEST_CASE("mixed subdiv level zero") {
+	Array arr = create_mixed_arrays();
+	int32_t p_format = Mesh::ARRAY_FORMAT_VERTEX;
+	Ref<MixedSubdivider> subdivider;
+	subdivider.instantiate();
+	Array result = subdivider->get_subdivided_arrays(arr, 0, p_format, false);
+	CHECK(result.size() == Mesh::ARRAY_MAX);
+	const PackedInt32Array &result_index_array = result[Mesh::ARRAY_INDEX];
+	CHECK_EQ(result_index_array.size(), (2 + 1 + 3) * 3);
+}
+
+TEST_CASE("mixed subdivide once") {
+	Array arr = create_mixed_arrays();
+	int32_t p_format = Mesh::ARRAY_FORMAT_VERTEX;
+	Ref<MixedSubdivider> subdivider;
+	subdivider.instantiate();
+	Array result = subdivider->get_subdivided_topology_arrays(arr, 1, p_format, true);
+	const PackedVector3Array &vertex_array = result[TopologyDataMesh::ARRAY_VERTEX];
+	const PackedVector3Array &normal_array = result[TopologyDataMesh::ARRAY_NORMAL];
+	const PackedInt32Array &index_array = result[TopologyDataMesh::ARRAY_INDEX];
+	CHECK(vertex_array.size() != 0);
+	CHECK_EQ(index_array.size(), (4 + 3 + 5) * 4); //every face gets split into one quad per face vertex
+	CHECK(normal_array.size() == vertex_array.size());
+}
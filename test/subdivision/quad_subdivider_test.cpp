@@ -71,10 +71,154 @@ TEST_CASE("subdiv level zero") {
 	const PackedVector3Array &result_vertex_array = result[Mesh::ARRAY_VERTEX];
 	const PackedInt32Array &result_index_array = result[Mesh::ARRAY_INDEX];
 	CHECK(result_vertex_array.size() != 0);
-	CHECK(result_vertex_array == vertex_array);
 	CHECK(result_index_array.size() % 3 == 0);
 
+	//output vertices get reordered for the vertex cache, the remap leads back to the cage vertices
+	const PackedInt32Array vertex_remap = subdivider->get_vertex_remap();
+	REQUIRE_EQ(vertex_remap.size(), vertex_array.size());
+	for (int vertex_index = 0; vertex_index < result_vertex_array.size(); vertex_index++) {
+		CHECK_EQ(result_vertex_array[vertex_index], vertex_array[vertex_remap[vertex_index]]);
+	}
 	int32_t expected_index_arr[] = { 0, 1, 3, 1, 2, 3 };
-	PackedInt32Array expected_index_array = create_packed_int32_array(expected_index_arr, 6);
-	CHECK_EQ(expected_index_array, result_index_array);
-}
\ No newline at end of file
+	REQUIRE_EQ(result_index_array.size(), 6);
+	for (int index = 0; index < result_index_array.size(); index++) {
+		CHECK_EQ(vertex_remap[result_index_array[index]], expected_index_arr[index]);
+	}
+}
+TEST_CASE("triangle arrays share vertices") {
+	Ref<TopologyDataMesh> a = ResourceLoader::get_singleton()->load("res://test/cube.tres");
+	const Array arr = a->surface_get_arrays(0);
+	Ref<QuadSubdivider> subdivider;
+	subdivider.instantiate();
+	Array result = subdivider->get_subdivided_arrays(arr, 2, a->surface_get_format(0), true);
+	const PackedVector3Array &vertex_array = result[Mesh::ARRAY_VERTEX];
+	const PackedInt32Array &index_array = result[Mesh::ARRAY_INDEX];
+	//every quad got 4 own vertices before, shared vertices only get split at uv seams
+	CHECK_LT(vertex_array.size(), index_array.size() / 6 * 4);
+	for (int index = 0; index < index_array.size(); index++) {
+		REQUIRE_LT(index_array[index], vertex_array.size());
+	}
+
+	//per frame updates write in the same vertex order
+	const PackedInt32Array vertex_remap = subdivider->get_vertex_remap();
+	REQUIRE_EQ(vertex_remap.size(), vertex_array.size());
+	Ref<QuadSubdivider> update_subdivider;
+	update_subdivider.instantiate();
+	CHECK(equal_approx(update_subdivider->get_subdivided_vertices(arr, 2, vertex_remap), vertex_array));
+}
+
+TEST_CASE("coarser levels as lods") {
+	Ref<TopologyDataMesh> a = ResourceLoader::get_singleton()->load("res://test/cube.tres");
+	const Array arr = a->surface_get_arrays(0);
+	Ref<QuadSubdivider> subdivider;
+	subdivider.instantiate();
+	Array result = subdivider->get_subdivided_arrays(arr, 2, a->surface_get_format(0), true);
+	const PackedVector3Array &vertex_array = result[Mesh::ARRAY_VERTEX];
+	const Dictionary lods = subdivider->get_lods();
+	REQUIRE_EQ(lods.size(), 2);
+
+	//sorted by distance the coarsest level comes last
+	Array lod_distances = lods.keys();
+	lod_distances.sort();
+	CHECK_GT(float(lod_distances[1]), float(lod_distances[0]));
+	const PackedInt32Array &level_1_index_array = lods[lod_distances[0]];
+	const PackedInt32Array &level_0_index_array = lods[lod_distances[1]];
+	CHECK_EQ(level_1_index_array.size(), 6 * 4 * 6);
+	CHECK_EQ(level_0_index_array.size(), 6 * 6);
+	for (int index = 0; index < level_1_index_array.size(); index++) {
+		REQUIRE_LT(level_1_index_array[index], vertex_array.size());
+	}
+	for (int index = 0; index < level_0_index_array.size(); index++) {
+		REQUIRE_LT(level_0_index_array[index], vertex_array.size());
+	}
+
+	subdivider->get_subdivided_arrays(arr, 0, a->surface_get_format(0), true);
+	CHECK(subdivider->get_lods().is_empty());
+}
+
+TEST_CASE("final level only") {
+	Ref<TopologyDataMesh> a = ResourceLoader::get_singleton()->load("res://test/cube.tres");
+	const Array arr = a->surface_get_arrays(0);
+	Ref<QuadSubdivider> subdivider;
+	subdivider.instantiate();
+	//off by default so the public api keeps returning all levels
+	REQUIRE_FALSE(subdivider->get_final_level_only());
+	subdivider->set_final_level_only(true);
+	Array final_level = subdivider->get_subdivided_topology_arrays(arr, 2, a->surface_get_format(0), false);
+	subdivider->set_final_level_only(false);
+	Array all_levels = subdivider->get_subdivided_topology_arrays(arr, 2, a->surface_get_format(0), false);
+
+	const PackedVector3Array &final_vertex_array = final_level[TopologyDataMesh::ARRAY_VERTEX];
+	const PackedVector3Array &all_vertex_array = all_levels[TopologyDataMesh::ARRAY_VERTEX];
+	const PackedInt32Array &final_index_array = final_level[TopologyDataMesh::ARRAY_INDEX];
+	const PackedInt32Array &all_index_array = all_levels[TopologyDataMesh::ARRAY_INDEX];
+	//cube level 2: 8 + 26 + 98 vertices
+	CHECK_EQ(final_vertex_array.size(), 98);
+	REQUIRE_EQ(all_vertex_array.size(), 8 + 26 + 98);
+	const int vertex_offset = all_vertex_array.size() - final_vertex_array.size();
+	CHECK(equal_approx(all_vertex_array.slice(vertex_offset), final_vertex_array));
+	REQUIRE_EQ(final_index_array.size(), all_index_array.size());
+	for (int index = 0; index < final_index_array.size(); index++) {
+		REQUIRE_EQ(final_index_array[index], all_index_array[index] - vertex_offset);
+	}
+	const PackedVector2Array &final_uv_array = final_level[TopologyDataMesh::ARRAY_TEX_UV];
+	const PackedVector2Array &all_uv_array = all_levels[TopologyDataMesh::ARRAY_TEX_UV];
+	CHECK_LT(final_uv_array.size(), all_uv_array.size());
+}
+
+TEST_CASE("normal fan matches subdivided normals") {
+	Ref<TopologyDataMesh> a = ResourceLoader::get_singleton()->load("res://test/cube.tres");
+	const Array arr = a->surface_get_arrays(0);
+	Ref<QuadSubdivider> subdivider;
+	subdivider.instantiate();
+	Array result = subdivider->get_subdivided_arrays(arr, 2, a->surface_get_format(0), true);
+	const PackedVector3Array &normal_array = result[Mesh::ARRAY_NORMAL];
+	const PackedInt32Array vertex_remap = subdivider->get_vertex_remap();
+
+	VertexFaceFan normal_fan;
+	PackedInt32Array face_index_array;
+	subdivider->create_normal_fan(normal_fan, face_index_array);
+	REQUIRE(!normal_fan.is_empty());
+	CHECK_EQ(normal_fan.get_face_vertex_count(), 4);
+
+	//per frame updates only subdivide positions, normals come from the cached fan
+	const PackedVector3Array subdivided_vertex_array = subdivider->get_subdivided_vertices(arr, 2, PackedInt32Array());
+	CHECK_EQ(subdivided_vertex_array.size(), normal_fan.get_vertex_count());
+	const PackedVector3Array fan_normal_array = normal_fan.calculate_normals(subdivided_vertex_array, face_index_array);
+	CHECK(equal_approx(Subdivider::remap_vertices(fan_normal_array, vertex_remap), normal_array));
+}
+
+TEST_CASE("cage normals") {
+	Ref<TopologyDataMesh> a = ResourceLoader::get_singleton()->load("res://test/cube.tres");
+	Array arr = a->surface_get_arrays(0).duplicate(false);
+	const PackedVector3Array &cage_vertex_array = arr[TopologyDataMesh::ARRAY_VERTEX];
+	//authored normals that differ from anything the geometry would give
+	PackedVector3Array cage_normal_array;
+	for (int vertex_index = 0; vertex_index < cage_vertex_array.size(); vertex_index++) {
+		cage_normal_array.push_back(Vector3(0, 2, 0));
+	}
+	arr[TopologyDataMesh::ARRAY_NORMAL] = cage_normal_array;
+	const int32_t format = a->surface_get_format(0) | Mesh::ARRAY_FORMAT_NORMAL;
+
+	Ref<QuadSubdivider> subdivider;
+	subdivider.instantiate();
+	subdivider->set_use_cage_normals(true);
+	for (int level = 0; level <= 2; level++) {
+		Array result = subdivider->get_subdivided_arrays(arr, level, format, true);
+		const PackedVector3Array &normal_array = result[Mesh::ARRAY_NORMAL];
+		const PackedVector3Array &vertex_array = result[Mesh::ARRAY_VERTEX];
+		REQUIRE_EQ(normal_array.size(), vertex_array.size());
+		for (int vertex_index = 0; vertex_index < normal_array.size(); vertex_index++) {
+			REQUIRE(normal_array[vertex_index].is_equal_approx(Vector3(0, 1, 0)));
+		}
+	}
+
+	subdivider->set_use_cage_normals(false);
+	Array result = subdivider->get_subdivided_arrays(arr, 1, format, true);
+	const PackedVector3Array &normal_array = result[Mesh::ARRAY_NORMAL];
+	int upward_normal_count = 0;
+	for (int vertex_index = 0; vertex_index < normal_array.size(); vertex_index++) {
+		upward_normal_count += normal_array[vertex_index].is_equal_approx(Vector3(0, 1, 0));
+	}
+	CHECK_LT(upward_normal_count, normal_array.size());
+}
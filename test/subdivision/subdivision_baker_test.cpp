@@ -2,6 +2,7 @@
 
 #include "godot_cpp/classes/resource_loader.hpp"
 #include "subdivision/subdivision_baker.hpp"
+#include "test_utility_methods.hpp"
 
 //just checks for non empty usable data
 TEST_CASE("Simple bake") {
@@ -21,4 +22,166 @@ TEST_CASE("Simple bake") {
 	CHECK_EQ(bones_array.size(), vertex_amount * 4);
 	const PackedFloat32Array &weights_array = result_arrays[Mesh::ARRAY_WEIGHTS];
 	CHECK_EQ(bones_array.size(), weights_array.size());
-}
\ No newline at end of file
+}
+TEST_CASE("Refinement data gives same result as refining") {
+	Ref<SubdivisionBaker> baker;
+	baker.instantiate();
+	Ref<TopologyDataMesh> source_mesh = ResourceLoader::get_singleton()->load("res://test/skinning_test.tres", "", ResourceLoader::CACHE_MODE_IGNORE);
+	baker->bake_refinement_data(source_mesh, 2);
+	REQUIRE(!source_mesh->surface_get_refinement_data(0, 2).is_empty());
+	CHECK(source_mesh->surface_get_refinement_data(0, 1).is_empty());
+
+	const Array &source_arrays = source_mesh->surface_get_arrays(0);
+	int64_t format = source_mesh->surface_get_format(0);
+	TopologyDataMesh::TopologyType topology_type = source_mesh->surface_get_topology_type(0);
+	Array expected_arrays = baker->get_baked_arrays(source_arrays, 2, format, topology_type);
+	Array result_arrays = baker->get_baked_arrays(source_arrays, 2, format, topology_type, source_mesh->surface_get_refinement_data(0, 2));
+
+	CHECK(equal_approx(result_arrays[Mesh::ARRAY_VERTEX], expected_arrays[Mesh::ARRAY_VERTEX]));
+	CHECK(equal_approx(result_arrays[Mesh::ARRAY_NORMAL], expected_arrays[Mesh::ARRAY_NORMAL]));
+	CHECK_EQ(PackedInt32Array(result_arrays[Mesh::ARRAY_INDEX]), PackedInt32Array(expected_arrays[Mesh::ARRAY_INDEX]));
+	CHECK_EQ(PackedInt32Array(result_arrays[Mesh::ARRAY_BONES]), PackedInt32Array(expected_arrays[Mesh::ARRAY_BONES]));
+}
+
+TEST_CASE("Refinement data gives the same lods as refining") {
+	Ref<SubdivisionBaker> baker;
+	baker.instantiate();
+	Ref<TopologyDataMesh> source_mesh = ResourceLoader::get_singleton()->load("res://test/skinning_test.tres", "", ResourceLoader::CACHE_MODE_IGNORE);
+	baker->bake_refinement_data(source_mesh, 2);
+	const Array refinement_arrays = source_mesh->surface_get_refinement_data(0, 2);
+	REQUIRE(!refinement_arrays.is_empty());
+
+	const Array &source_arrays = source_mesh->surface_get_arrays(0);
+	int64_t format = source_mesh->surface_get_format(0);
+	TopologyDataMesh::TopologyType topology_type = source_mesh->surface_get_topology_type(0);
+	Dictionary expected_lods;
+	Dictionary result_lods;
+	baker->get_baked_arrays(source_arrays, 2, format, topology_type, Array(), &expected_lods);
+	baker->get_baked_arrays(source_arrays, 2, format, topology_type, refinement_arrays, &result_lods);
+
+	REQUIRE_EQ(expected_lods.size(), 2);
+	REQUIRE_EQ(result_lods.size(), expected_lods.size());
+	const Array expected_distances = expected_lods.keys();
+	for (int lod_index = 0; lod_index < expected_distances.size(); lod_index++) {
+		REQUIRE(result_lods.has(expected_distances[lod_index]));
+		CHECK_EQ(PackedInt32Array(result_lods[expected_distances[lod_index]]), PackedInt32Array(expected_lods[expected_distances[lod_index]]));
+	}
+
+	//refinement data stored before lods were part of it still gets used, just without lods
+	Array old_refinement_arrays = refinement_arrays.duplicate(false);
+	old_refinement_arrays.resize(TopologyDataMesh::REFINEMENT_LOD_CORNERS);
+	source_mesh->surface_set_refinement_data(0, 2, old_refinement_arrays);
+	REQUIRE_EQ(source_mesh->surface_get_refinement_data(0, 2).size(), int(TopologyDataMesh::REFINEMENT_MAX));
+	Dictionary old_lods;
+	Array old_arrays = baker->get_baked_arrays(source_arrays, 2, format, topology_type, source_mesh->surface_get_refinement_data(0, 2), &old_lods);
+	CHECK(!old_arrays.is_empty());
+	CHECK(old_lods.is_empty());
+}
+TEST_CASE("Stored refinement data gets validated on load") {
+	Ref<SubdivisionBaker> baker;
+	baker.instantiate();
+	Ref<TopologyDataMesh> source_mesh = ResourceLoader::get_singleton()->load("res://test/skinning_test.tres", "", ResourceLoader::CACHE_MODE_IGNORE);
+	baker->bake_refinement_data(source_mesh, 2);
+	const Array expected_refinement_arrays = source_mesh->surface_get_refinement_data(0, 2);
+	REQUIRE(!expected_refinement_arrays.is_empty());
+
+	Dictionary data = source_mesh->get("_data");
+	Array surfaces = data["surfaces"];
+	Dictionary surface = surfaces[0];
+	Dictionary refinement_data = surface["refinement_data"];
+	Array broken_refinement_arrays = expected_refinement_arrays.duplicate();
+	broken_refinement_arrays.resize(TopologyDataMesh::REFINEMENT_STENCIL_WEIGHTS);
+	refinement_data[0] = expected_refinement_arrays; //level 0 is never refined
+	refinement_data[1] = broken_refinement_arrays;
+	refinement_data["3"] = expected_refinement_arrays;
+
+	Ref<TopologyDataMesh> loaded_mesh;
+	loaded_mesh.instantiate();
+	loaded_mesh->set("_data", data);
+	REQUIRE_EQ(loaded_mesh->get_surface_count(), 1);
+	CHECK_EQ(PackedInt32Array(loaded_mesh->surface_get_refinement_data(0, 2)[TopologyDataMesh::REFINEMENT_STENCIL_INDICES]),
+			PackedInt32Array(expected_refinement_arrays[TopologyDataMesh::REFINEMENT_STENCIL_INDICES]));
+	CHECK(loaded_mesh->surface_get_refinement_data(0, 0).is_empty());
+	CHECK(loaded_mesh->surface_get_refinement_data(0, 1).is_empty());
+	CHECK(loaded_mesh->surface_get_refinement_data(0, 3).is_empty());
+}
+
+TEST_CASE("Refinement data with out of range stencil indices gets rejected") {
+	Ref<SubdivisionBaker> baker;
+	baker.instantiate();
+	Ref<TopologyDataMesh> source_mesh = ResourceLoader::get_singleton()->load("res://test/skinning_test.tres", "", ResourceLoader::CACHE_MODE_IGNORE);
+	baker->bake_refinement_data(source_mesh, 2);
+	const Array expected_refinement_arrays = source_mesh->surface_get_refinement_data(0, 2);
+	REQUIRE(!expected_refinement_arrays.is_empty());
+
+	const PackedVector3Array cage_vertex_array = source_mesh->surface_get_arrays(0)[TopologyDataMesh::ARRAY_VERTEX];
+	PackedInt32Array broken_stencil_indices = expected_refinement_arrays[TopologyDataMesh::REFINEMENT_STENCIL_INDICES];
+	broken_stencil_indices.set(broken_stencil_indices.size() - 1, cage_vertex_array.size());
+	Array broken_refinement_arrays = expected_refinement_arrays.duplicate();
+	broken_refinement_arrays[TopologyDataMesh::REFINEMENT_STENCIL_INDICES] = broken_stencil_indices;
+
+	//keeps the valid data that was there before
+	source_mesh->surface_set_refinement_data(0, 2, broken_refinement_arrays);
+	CHECK_EQ(PackedInt32Array(source_mesh->surface_get_refinement_data(0, 2)[TopologyDataMesh::REFINEMENT_STENCIL_INDICES]),
+			PackedInt32Array(expected_refinement_arrays[TopologyDataMesh::REFINEMENT_STENCIL_INDICES]));
+	source_mesh->surface_set_refinement_data(0, 1, broken_refinement_arrays);
+	CHECK(source_mesh->surface_get_refinement_data(0, 1).is_empty());
+
+	Dictionary data = source_mesh->get("_data");
+	Array surfaces = data["surfaces"];
+	Dictionary surface = surfaces[0];
+	Dictionary refinement_data = surface["refinement_data"];
+	refinement_data[3] = broken_refinement_arrays;
+	Ref<TopologyDataMesh> loaded_mesh;
+	loaded_mesh.instantiate();
+	loaded_mesh->set("_data", data);
+	REQUIRE_EQ(loaded_mesh->get_surface_count(), 1);
+	CHECK(!loaded_mesh->surface_get_refinement_data(0, 2).is_empty());
+	CHECK(loaded_mesh->surface_get_refinement_data(0, 3).is_empty());
+
+	//arrays passed in directly get checked once per call
+	const Array result_arrays = baker->get_baked_arrays(source_mesh->surface_get_arrays(0), 2, source_mesh->surface_get_format(0),
+			source_mesh->surface_get_topology_type(0), broken_refinement_arrays);
+	CHECK(result_arrays.is_empty());
+}
+
+TEST_CASE("Blend shapes of n-gons keep the vertex order of the base mesh") {
+	PackedVector3Array vertex_array;
+	for (int vertex_index = 0; vertex_index < 6; vertex_index++) {
+		vertex_array.push_back(Vector3(Math::cos(vertex_index * Math_PI / 3), Math::sin(vertex_index * Math_PI / 3), 0));
+	}
+	int32_t index_arr[] = { 0, 1, 2, 3, 4, 5 };
+	int32_t face_vertex_count_arr[] = { 6 };
+	Array arrays;
+	arrays.resize(TopologyDataMesh::ARRAY_MAX);
+	arrays[TopologyDataMesh::ARRAY_VERTEX] = vertex_array;
+	arrays[TopologyDataMesh::ARRAY_INDEX] = create_packed_int32_array(index_arr, 6);
+	arrays[TopologyDataMesh::ARRAY_FACE_VERTEX_COUNT] = create_packed_int32_array(face_vertex_count_arr, 1);
+
+	//moving the first vertex inwards makes it concave, so the shape alone would get clipped into different ears
+	const Vector3 delta = Vector3(-0.8, 0, 0);
+	PackedVector3Array delta_array;
+	delta_array.resize(vertex_array.size());
+	delta_array.fill(Vector3());
+	delta_array.set(0, delta);
+	Array blend_shape_arrays;
+	blend_shape_arrays.resize(TopologyDataMesh::ARRAY_MAX);
+	blend_shape_arrays[TopologyDataMesh::ARRAY_VERTEX] = delta_array;
+	Array relative_blend_shape_arrays;
+	relative_blend_shape_arrays.push_back(blend_shape_arrays);
+
+	Ref<SubdivisionBaker> baker;
+	baker.instantiate();
+	const Array base_arrays = baker->get_baked_arrays(arrays, 0, Mesh::ARRAY_FORMAT_VERTEX, TopologyDataMesh::MIXED);
+	const TypedArray<Array> baked_blend_shape_arrays = baker->get_baked_blend_shape_arrays(arrays, relative_blend_shape_arrays, 0,
+			Mesh::ARRAY_FORMAT_VERTEX, TopologyDataMesh::MIXED);
+	REQUIRE_EQ(baked_blend_shape_arrays.size(), 1);
+	const Array shape_arrays = baked_blend_shape_arrays[0];
+	const PackedVector3Array base_vertex_array = base_arrays[Mesh::ARRAY_VERTEX];
+	const PackedVector3Array shape_vertex_array = shape_arrays[Mesh::ARRAY_VERTEX];
+	REQUIRE_EQ(shape_vertex_array.size(), base_vertex_array.size());
+	for (int vertex_index = 0; vertex_index < base_vertex_array.size(); vertex_index++) {
+		const Vector3 expected_offset = base_vertex_array[vertex_index].is_equal_approx(vertex_array[0]) ? delta : Vector3();
+		CHECK(shape_vertex_array[vertex_index].is_equal_approx(base_vertex_array[vertex_index] + expected_offset));
+	}
+}
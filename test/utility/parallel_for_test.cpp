@@ -0,0 +1,44 @@
+#include "doctest.h"
+#include "godot_cpp/templates/local_vector.hpp"
+#include "utility/parallel_for.hpp"
+
+TEST_CASE("parallel_for covers the whole range once") {
+	const int count = 100000;
+	LocalVector<int> visits;
+	visits.resize(count);
+	int *visit_write = visits.ptr();
+	for (int index = 0; index < count; index++) {
+		visit_write[index] = 0;
+	}
+	parallel_for(
+			count, [&](int p_begin, int p_end) {
+				for (int index = p_begin; index < p_end; index++) {
+					visit_write[index]++;
+				}
+			},
+			1000);
+	for (int index = 0; index < count; index++) {
+		CHECK_EQ(visits[index], 1);
+	}
+}
+
+TEST_CASE("parallel_for runs inline inside a task scope") {
+	CHECK_FALSE(parallel_for_inside_task());
+	{
+		ParallelForTaskScope task_scope;
+		int call_count = 0;
+		parallel_for(
+				100000, [&](int p_begin, int p_end) {
+					CHECK_EQ(p_begin, 0);
+					CHECK_EQ(p_end, 100000);
+					call_count++;
+				},
+				1000);
+		CHECK_EQ(call_count, 1);
+		{
+			ParallelForTaskScope nested_scope;
+		}
+		CHECK(parallel_for_inside_task());
+	}
+	CHECK_FALSE(parallel_for_inside_task());
+}
@@ -0,0 +1,70 @@
+#include "doctest.h"
+#include "godot_cpp/templates/hash_set.hpp"
+#include "test_utility_methods.hpp"
+#include "utility/vertex_cache_optimizer.hpp"
+
+//grid of quads with triangles in row order
+static PackedInt32Array create_grid_index_array(int p_size) {
+	PackedInt32Array index_array;
+	for (int y = 0; y < p_size; y++) {
+		for (int x = 0; x < p_size; x++) {
+			const int32_t vertex_index = y * (p_size + 1) + x;
+			index_array.push_back(vertex_index);
+			index_array.push_back(vertex_index + 1);
+			index_array.push_back(vertex_index + p_size + 1);
+			index_array.push_back(vertex_index + 1);
+			index_array.push_back(vertex_index + p_size + 2);
+			index_array.push_back(vertex_index + p_size + 1);
+		}
+	}
+	return index_array;
+}
+
+//triangles as sorted vertex triples, ignores triangle order
+static HashSet<int64_t> get_triangle_set(const PackedInt32Array &p_index_array, const PackedInt32Array &p_vertex_remap) {
+	HashSet<int64_t> triangles;
+	for (int index = 0; index < p_index_array.size(); index += 3) {
+		int64_t vertices[3];
+		for (int corner = 0; corner < 3; corner++) {
+			const int32_t vertex_index = p_index_array[index + corner];
+			vertices[corner] = p_vertex_remap.is_empty() ? vertex_index : p_vertex_remap[vertex_index];
+		}
+		//rotate so winding stays part of the key
+		int first = 0;
+		for (int corner = 1; corner < 3; corner++) {
+			if (vertices[corner] < vertices[first]) {
+				first = corner;
+			}
+		}
+		triangles.insert(vertices[first] << 40 | vertices[(first + 1) % 3] << 20 | vertices[(first + 2) % 3]);
+	}
+	return triangles;
+}
+
+TEST_CASE("vertex cache optimization keeps triangles and lowers cache misses") {
+	const int grid_size = 32;
+	const int vertex_count = (grid_size + 1) * (grid_size + 1);
+	const PackedInt32Array grid_index_array = create_grid_index_array(grid_size);
+	PackedInt32Array index_array = grid_index_array;
+	VertexCacheOptimizer::optimize_vertex_cache(index_array, vertex_count);
+	REQUIRE_EQ(index_array.size(), grid_index_array.size());
+	CHECK_LT(VertexCacheOptimizer::get_average_cache_miss_ratio(index_array, vertex_count),
+			VertexCacheOptimizer::get_average_cache_miss_ratio(grid_index_array, vertex_count));
+
+	const HashSet<int64_t> grid_triangles = get_triangle_set(grid_index_array, PackedInt32Array());
+	const HashSet<int64_t> optimized_triangles = get_triangle_set(index_array, PackedInt32Array());
+	CHECK_EQ(grid_triangles.size(), optimized_triangles.size());
+	for (const int64_t &triangle : grid_triangles) {
+		CHECK(optimized_triangles.has(triangle));
+	}
+}
+
+TEST_CASE("vertex fetch optimization numbers vertices by first use") {
+	int32_t index_arr[] = { 4, 2, 0, 2, 3, 0 };
+	PackedInt32Array index_array = create_packed_int32_array(index_arr, 6);
+	const PackedInt32Array vertex_remap = VertexCacheOptimizer::optimize_vertex_fetch(index_array, 5);
+	int32_t expected_index_arr[] = { 0, 1, 2, 1, 3, 2 };
+	int32_t expected_remap_arr[] = { 4, 2, 0, 3, 1 }; //1 is unused and moves to the end
+	CHECK(index_array == create_packed_int32_array(expected_index_arr, 6));
+	CHECK(vertex_remap == create_packed_int32_array(expected_remap_arr, 5));
+}
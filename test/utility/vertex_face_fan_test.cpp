@@ -0,0 +1,79 @@
+#include "doctest.h"
+#include "test_utility_methods.hpp"
+#include "utility/vertex_face_fan.hpp"
+
+//unit quad on the xz plane facing up, split into two triangles, uv = xz
+static PackedVector3Array create_plane_vertex_array() {
+	PackedVector3Array vertex_array;
+	vertex_array.push_back(Vector3(0, 0, 0));
+	vertex_array.push_back(Vector3(1, 0, 0));
+	vertex_array.push_back(Vector3(1, 0, 1));
+	vertex_array.push_back(Vector3(0, 0, 1));
+	return vertex_array;
+}
+
+static PackedInt32Array create_plane_index_array() {
+	PackedInt32Array index_array;
+	const int32_t indices[6] = { 0, 1, 2, 0, 2, 3 };
+	for (int32_t index : indices) {
+		index_array.push_back(index);
+	}
+	return index_array;
+}
+
+TEST_CASE("face fan normals") {
+	const PackedVector3Array vertex_array = create_plane_vertex_array();
+	const PackedInt32Array index_array = create_plane_index_array();
+	VertexFaceFan fan;
+	fan.create(index_array, 3, vertex_array.size());
+	REQUIRE(!fan.is_empty());
+	const PackedVector3Array normal_array = fan.calculate_normals(vertex_array, index_array);
+	REQUIRE(normal_array.size() == vertex_array.size());
+	for (int vertex_index = 0; vertex_index < normal_array.size(); vertex_index++) {
+		CHECK(normal_array[vertex_index].is_equal_approx(Vector3(0, 1, 0)));
+	}
+
+	//same as the quad itself
+	PackedInt32Array quad_index_array;
+	for (int32_t vertex_index = 0; vertex_index < 4; vertex_index++) {
+		quad_index_array.push_back(vertex_index);
+	}
+	fan.create(quad_index_array, 4, vertex_array.size());
+	CHECK(fan.calculate_normals(vertex_array, quad_index_array) == normal_array);
+}
+
+TEST_CASE("face fan tangents") {
+	const PackedVector3Array vertex_array = create_plane_vertex_array();
+	const PackedInt32Array index_array = create_plane_index_array();
+	PackedVector3Array normal_array;
+	PackedVector2Array uv_array;
+	for (int vertex_index = 0; vertex_index < vertex_array.size(); vertex_index++) {
+		normal_array.push_back(Vector3(0, 1, 0));
+		uv_array.push_back(Vector2(vertex_array[vertex_index].x, vertex_array[vertex_index].z));
+	}
+	VertexFaceFan fan;
+	fan.create(index_array, 3, vertex_array.size());
+
+	SUBCASE("uv aligned") {
+		const PackedFloat32Array tangent_array = fan.calculate_tangents(vertex_array, normal_array, uv_array, index_array);
+		REQUIRE(tangent_array.size() == vertex_array.size() * 4);
+		for (int vertex_index = 0; vertex_index < vertex_array.size(); vertex_index++) {
+			const Vector3 tangent(tangent_array[vertex_index * 4], tangent_array[vertex_index * 4 + 1], tangent_array[vertex_index * 4 + 2]);
+			CHECK(tangent.is_equal_approx(Vector3(1, 0, 0)));
+			CHECK(tangent_array[vertex_index * 4 + 3] == 1.0);
+		}
+	}
+
+	SUBCASE("mirrored uv flips the sign") {
+		for (int vertex_index = 0; vertex_index < uv_array.size(); vertex_index++) {
+			uv_array.set(vertex_index, Vector2(1.0 - uv_array[vertex_index].x, uv_array[vertex_index].y));
+		}
+		const PackedFloat32Array tangent_array = fan.calculate_tangents(vertex_array, normal_array, uv_array, index_array);
+		REQUIRE(tangent_array.size() == vertex_array.size() * 4);
+		for (int vertex_index = 0; vertex_index < vertex_array.size(); vertex_index++) {
+			const Vector3 tangent(tangent_array[vertex_index * 4], tangent_array[vertex_index * 4 + 1], tangent_array[vertex_index * 4 + 2]);
+			CHECK(tangent.is_equal_approx(Vector3(-1, 0, 0)));
+			CHECK(tangent_array[vertex_index * 4 + 3] == -1.0);
+		}
+	}
+}